@@ -14,12 +14,19 @@ const char *appKey = "appKey";
 #define INTERVAL 1
 #define N_MEASUREMENTS 3
 
+// The measurement store and the payload buffer of the Packet library are sized for this sketch
+// on AVR boards (MEASUREMENT_STORE_SIZE and PAYLOAD_MAX_SIZE): for more measurements or another version,
+// set them with compiler flags, e.g. -DMEASUREMENT_STORE_SIZE=112, as the library is compiled apart.
+static_assert(LOCATION_DATA_SIZE + N_MEASUREMENTS * MEASUREMENT_DATA_SIZE <= MEASUREMENT_STORE_SIZE,
+              "MEASUREMENT_STORE_SIZE too small for N_MEASUREMENTS");
+static_assert(PAYLOAD_SIZE_V1 <= PAYLOAD_MAX_SIZE, "PAYLOAD_MAX_SIZE too small for a version 1 payload");
+
 TheThingsNetwork ttn(loraSerial, debugSerial, freqPlan);
 TheThingsNode *node;
 
 uint32_t timestamp;
 uint8_t count;
-measurement_t measurementsArray[N_MEASUREMENTS];
+MeasurementStore store;
 Packet packet(INTERVAL, N_MEASUREMENTS);
 
 #define PORT_SETUP 1
@@ -59,7 +66,7 @@ void setup()
   while (!debugSerial && millis() < 10000)
     ;
 
-  packet.setMeasurementsArray(measurementsArray);
+  packet.setMeasurementStore(&store);
 
   // Config Node
   node = TheThingsNode::setup();
@@ -31,24 +31,35 @@ const char *urlInflux = "https://lln-smart-city.azurewebsites.net/api/InfluxDBIn
 const char *token = "AUTHORIZATION_TOKEN";
 
 // BME280 constants
+#include <Bme280Driver.h>
 #define BME280_SDA_PIN 4
 #define BME280_SCL_PIN 15
 #define TEMPERATURE_EMERGENCY_THRESHOLD 30
 #define PRESSURE_EMERGENCY_THRESHOLD 102000
 #define HUMIDITY_EMERGENCY_THRESHOLD 80
+Bme280Driver bme280(BME280_SDA_PIN, BME280_SCL_PIN,
+                    TEMPERATURE_EMERGENCY_THRESHOLD,
+                    PRESSURE_EMERGENCY_THRESHOLD,
+                    HUMIDITY_EMERGENCY_THRESHOLD);
 
 // MQ135 constants
+#include <GasSensorDriver.h>
 #define MQ135_PIN   36
 #define CO2_EMERGENCY_THRESHOLD 700
+GasSensorDriver gasSensor(MQ135_PIN, CO2_EMERGENCY_THRESHOLD);
 
 // Sound sensor constants
+#include <SoundSensorDriver.h>
 #define SOUND_PIN   39
 #define NOISE_EMERGENCY_THRESHOLD 4090
+SoundSensorDriver soundSensor(SOUND_PIN, NOISE_EMERGENCY_THRESHOLD);
 
 // GPS constants
+#include <GpsDriver.h>
 #define GPS_SERIAL_BAUD 9600
 #define GPS_RX  16
 #define GPS_TX  17
+GpsDriver gps(GPS_SERIAL_BAUD, GPS_RX, GPS_TX);
 
 void setup()
 {
@@ -56,13 +67,10 @@ void setup()
     esp.initPacket(WAKEUP_PERIOD_MIN, N_MEASUREMENTS, VERSION);
     esp.initWifi(ssid, password, googleKey, urlInflux, token);
     esp.setup();
-    esp.addBme280(BME280_SDA_PIN, BME280_SCL_PIN,
-                  TEMPERATURE_EMERGENCY_THRESHOLD,
-                  PRESSURE_EMERGENCY_THRESHOLD,
-                  HUMIDITY_EMERGENCY_THRESHOLD);
-    esp.addGasSensor(MQ135_PIN, CO2_EMERGENCY_THRESHOLD);
-    esp.addSoundSensor(SOUND_PIN, NOISE_EMERGENCY_THRESHOLD);
-    esp.addGPS(GPS_SERIAL_BAUD, GPS_RX, GPS_TX);
+    esp.addSensor(&bme280);
+    esp.addSensor(&gasSensor);
+    esp.addSensor(&soundSensor);
+    esp.addSensor(&gps);
 }
 
 void loop()
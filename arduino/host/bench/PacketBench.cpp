@@ -0,0 +1,187 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host benchmark of the LoRaWAN payload encoder (Packet::buildLoraPayload),
+ * for versions 1 to 5 and 1 to 8 measurements.
+ * Reports the payload size, the encoding time and the heap allocations
+ * per call, for both the internal buffer and the caller-buffer overloads.
+ * Also compares the float scaling of Packet::scaleFloat with the former
+ * double-precision pow/round conversion.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#include "Packet.h"
+#include "AllocCounter.h"
+
+#define INTERVAL   10
+#define ITERATIONS 50000
+// Each measurement keeps the best of several runs, to filter out scheduling noise
+#define REPEATS    5
+// Same size as appData in ESP32_LoRaWAN
+#define BUFFER_SIZE 222
+// Number of values converted by the scaling benchmark
+#define SCALE_VALUES 1024
+
+// Fields measured by the device, kept in the measurement store
+#define BENCH_FIELDS (PRESENCE_BIT(HEADER_BATTERY) | PRESENCE_BIT(HEADER_TEMPERATURE) | \
+                      PRESENCE_BIT(HEADER_PRESSURE) | PRESENCE_BIT(HEADER_HUMIDITY) | \
+                      PRESENCE_BIT(HEADER_CO2) | PRESENCE_BIT(HEADER_NOISE) | LOCATION_FIELDS)
+
+typedef std::chrono::steady_clock bench_clock;
+
+/**
+ * Fills the packet with the values a BME280 + MQ135 + sound sensor device,
+ * with a Wi-Fi location, would record.
+ * @param packet: packet to fill
+ * @param nMeasurements: number of measurements to record
+ */
+static void fillPacket(Packet& packet, uint8_t nMeasurements) {
+	for (uint8_t i = 0; i < nMeasurements; i++) {
+		packet.addBattery(87 - i, i);
+		packet.addTemperature(21.37 + 0.1 * i, i);
+		packet.addPressure(101325.42 - 3 * i, i);
+		packet.addHumidity(45.5 + 0.2 * i, i);
+		packet.addCO2(412.2 + i, i);
+		packet.addNoise(1830 + i, i);
+		packet.addLatitude(50.668081, i);
+		packet.addLongitude(4.611562, i);
+		packet.addAltitude(112.5, i);
+	}
+}
+
+/**
+ * Runs ITERATIONS fills of the packet, each followed by the given encoding,
+ * REPEATS times.
+ * @param packet: packet to benchmark
+ * @param nMeasurements: number of measurements to record before each encoding
+ * @param encode: true to encode the payload after each fill
+ * @param buffer: caller-provided payload buffer, NULL for the internal buffer
+ * @param size_ptr: pointer to the payload size, for the caller-provided buffer
+ * @return: best mean time of a fill and encoding, in nanoseconds
+ */
+static double measure(Packet& packet, uint8_t nMeasurements, bool encode,
+                      uint8_t* buffer, uint8_t* size_ptr) {
+	double best = -1;
+	for (uint8_t r = 0; r < REPEATS; r++) {
+		bench_clock::time_point start = bench_clock::now();
+		for (uint32_t i = 0; i < ITERATIONS; i++) {
+			fillPacket(packet, nMeasurements);
+			if (encode && buffer != NULL)
+				packet.buildLoraPayload(buffer, size_ptr, BUFFER_SIZE);
+			else if (encode)
+				packet.buildLoraPayload();
+		}
+		bench_clock::time_point end = bench_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS;
+		if (best < 0 || ns < best)
+			best = ns;
+	}
+	packet.clearArray();
+	return best;
+}
+
+/**
+ * Benchmarks one encoder configuration and prints one line of results.
+ * @param version: requested packet format version
+ * @param nMeasurements: requested number of measurements
+ */
+static void benchmark(uint8_t version, uint8_t nMeasurements) {
+	MeasurementStore store;
+	Packet packet(INTERVAL, nMeasurements, version);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+
+	packet.setFields(BENCH_FIELDS);
+	// The packet may have downgraded the configuration
+	uint8_t n = packet.getNMeasurements();
+
+	double fillNs = measure(packet, n, false, NULL, NULL);
+
+	// Caller-provided buffer
+	uint8_t buffer[BUFFER_SIZE];
+	uint8_t size = 0;
+	resetAllocStats();
+	double bufferNs = measure(packet, n, true, buffer, &size) - fillNs;
+	alloc_stats_t bufferAllocs = getAllocStats();
+
+	// Internal buffer
+	resetAllocStats();
+	double internalNs = measure(packet, n, true, NULL, NULL) - fillNs;
+	alloc_stats_t internalAllocs = getAllocStats();
+
+	uint32_t calls = ITERATIONS * REPEATS;
+	printf("%7u %4u %9u %5u %5u %11.1f %9.2f %11.1f %9.2f %9.1f\n",
+		version, nMeasurements, packet.getVersion(), n, size,
+		bufferNs, (double) bufferAllocs.count / calls,
+		internalNs, (double) internalAllocs.count / calls,
+		(double) internalAllocs.bytes / calls);
+}
+
+/**
+ * Former conversion of the float values, in double precision.
+ * @param data: data value
+ * @param precision: number of decimal places
+ * @return: the scaled value
+ */
+static int64_t scaleDouble(float data, uint8_t precision) {
+	double factor = pow(10.0, (double) precision);
+	return (int64_t) round(data*factor);
+}
+
+/**
+ * Benchmarks one float scaling function, and prints one line of results.
+ * @param name: name of the function
+ * @param scale: scaling function
+ * @param values: values to convert
+ * @param precision: number of decimal places
+ */
+static void benchmarkScaling(const char* name, int64_t (*scale)(float, uint8_t),
+                             const float* values, uint8_t precision) {
+	volatile int64_t sink = 0;
+	double best = -1;
+	for (uint8_t r = 0; r < REPEATS; r++) {
+		bench_clock::time_point start = bench_clock::now();
+		for (uint32_t i = 0; i < ITERATIONS / 10; i++) {
+			for (uint16_t j = 0; j < SCALE_VALUES; j++)
+				sink = sink + scale(values[j], precision);
+		}
+		bench_clock::time_point end = bench_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - start).count() /
+		            ((double) ITERATIONS / 10 * SCALE_VALUES);
+		if (best < 0 || ns < best)
+			best = ns;
+	}
+	printf("%-20s %9u %9.2f\n", name, precision, best);
+}
+
+int main() {
+	printf("# Packet::buildLoraPayload, best of %u runs of %u iterations per configuration\n", REPEATS, ITERATIONS);
+	printf("# buf: buildLoraPayload(payload, size_ptr, capacity), internal: buildLoraPayload()\n");
+	printf("# bytes: payload size, 0 if it does not fit in the %u-byte LoRaWAN buffer\n", BUFFER_SIZE);
+	printf("%7s %4s %9s %5s %5s %11s %9s %11s %9s %9s\n",
+		"version", "n", "effective", "n_eff", "bytes",
+		"buf_ns/op", "buf_alloc", "int_ns/op", "int_alloc", "int_bytes");
+	for (uint8_t version = 1; version <= 5; version++) {
+		for (uint8_t n = 1; n <= MAX_MEASUREMENTS; n = n < 8 ? n + 1 : 2 * n) {
+			benchmark(version, n);
+		}
+	}
+
+	printf("\n# Float scaling, best of %u runs of %u conversions\n", REPEATS, ITERATIONS / 10 * SCALE_VALUES);
+	printf("# The host has a double-precision FPU, unlike the ESP32:\n");
+	printf("# see the ScaleBenchmark example of the Packet library for the cycle counts on the device\n");
+	printf("%-20s %9s %9s\n", "function", "precision", "ns/op");
+	float values[SCALE_VALUES];
+	for (uint16_t j = 0; j < SCALE_VALUES; j++)
+		values[j] = -40.0f + j * 0.137f;
+	for (uint8_t precision = 2; precision <= 6; precision += 4) {
+		benchmarkScaling("pow/round (double)", scaleDouble, values, precision);
+		benchmarkScaling("Packet::scaleFloat", Packet::scaleFloat, values, precision);
+	}
+	return 0;
+}
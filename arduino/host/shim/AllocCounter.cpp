@@ -0,0 +1,85 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Heap allocation counter for the host build.
+ */
+
+#include "AllocCounter.h"
+
+#include <stdlib.h>
+#include <new>
+
+static alloc_stats_t stats = {0, 0};
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+	stats.count++;
+	stats.bytes += size;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+	stats.count++;
+	stats.bytes += n * size;
+	return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+	stats.count++;
+	stats.bytes += size;
+	return __real_realloc(ptr, size);
+}
+
+}
+
+void* operator new(size_t size) {
+	stats.count++;
+	stats.bytes += size;
+	void* ptr = __real_malloc(size ? size : 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void* ptr, size_t size) noexcept {
+	free(ptr);
+}
+
+/**
+ * Resets the allocation counters.
+ */
+void resetAllocStats() {
+	stats.count = 0;
+	stats.bytes = 0;
+}
+
+/**
+ * Retrieves the allocations made since the last reset.
+ * @return: number of allocations and allocated bytes
+ */
+alloc_stats_t getAllocStats() {
+	return stats;
+}
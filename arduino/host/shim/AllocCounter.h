@@ -0,0 +1,24 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Heap allocation counter for the host build.
+ * Counts the calls to malloc/calloc/realloc made by the objects linked with
+ * -Wl,--wrap (see the Makefile), as well as all the C++ operator new calls.
+ */
+
+#ifndef AllocCounter_h
+#define AllocCounter_h
+
+#include <stddef.h>
+
+typedef struct {
+	size_t count;
+	size_t bytes;
+} alloc_stats_t;
+
+void resetAllocStats();
+alloc_stats_t getAllocStats();
+
+#endif
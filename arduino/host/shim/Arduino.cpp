@@ -0,0 +1,158 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Thin Arduino core shim, to build our custom libraries on a Linux host.
+ */
+
+#include "Arduino.h"
+
+#include <stdio.h>
+
+HostSerial Serial;
+
+/**
+ * Converts an integer to a string in the given base.
+ * @param value: absolute value to convert
+ * @param negative: true if a minus sign must be prepended
+ * @param base: number base
+ * @return: the converted string
+ */
+static std::string integerToString(unsigned long value, bool negative, uint8_t base) {
+	const char* digits = "0123456789abcdef";
+	std::string str;
+	do {
+		str.insert(str.begin(), digits[value % base]);
+		value /= base;
+	} while (value > 0);
+	if (negative)
+		str.insert(str.begin(), '-');
+	return str;
+}
+
+/**
+ * Converts a floating point number to a string with a fixed number of decimals.
+ * @param value: value to convert
+ * @param decimals: number of decimal places
+ * @return: the converted string
+ */
+static std::string floatToString(double value, uint8_t decimals) {
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+	return std::string(buffer);
+}
+
+// String
+
+String::String(const char* str) : _str(str) {}
+String::String(const std::string& str) : _str(str) {}
+String::String(char c) : _str(1, c) {}
+String::String(int value, uint8_t base) :
+	_str(integerToString(value < 0 ? -(long) value : value, value < 0, base)) {}
+String::String(unsigned int value, uint8_t base) : _str(integerToString(value, false, base)) {}
+String::String(long value, uint8_t base) :
+	_str(integerToString(value < 0 ? -value : value, value < 0, base)) {}
+String::String(unsigned long value, uint8_t base) : _str(integerToString(value, false, base)) {}
+String::String(float value, uint8_t decimals) : _str(floatToString(value, decimals)) {}
+String::String(double value, uint8_t decimals) : _str(floatToString(value, decimals)) {}
+
+unsigned int String::length() const {
+	return _str.length();
+}
+
+const char* String::c_str() const {
+	return _str.c_str();
+}
+
+int String::indexOf(const String& str) const {
+	size_t index = _str.find(str._str);
+	return index == std::string::npos ? -1 : (int) index;
+}
+
+int String::indexOf(char c) const {
+	size_t index = _str.find(c);
+	return index == std::string::npos ? -1 : (int) index;
+}
+
+String String::substring(unsigned int from) const {
+	return from < _str.length() ? String(_str.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+	if (from > to) {
+		unsigned int tmp = from;
+		from = to;
+		to = tmp;
+	}
+	return from < _str.length() ? String(_str.substr(from, to - from)) : String();
+}
+
+float String::toFloat() const {
+	return atof(_str.c_str());
+}
+
+String& String::operator+=(const String& str) {
+	_str += str._str;
+	return *this;
+}
+
+bool String::operator==(const String& str) const {
+	return _str == str._str;
+}
+
+bool String::operator!=(const String& str) const {
+	return _str != str._str;
+}
+
+String operator+(const String& lhs, const String& rhs) {
+	String result(lhs);
+	result += rhs;
+	return result;
+}
+
+// Serial
+
+void HostSerial::begin(unsigned long baud) {}
+
+void HostSerial::print(const String& str) {
+	print(str.c_str());
+}
+
+void HostSerial::print(const char* str) {
+	if (!_silent)
+		fputs(str, stdout);
+}
+
+void HostSerial::print(char c) {
+	if (!_silent)
+		fputc(c, stdout);
+}
+
+void HostSerial::print(int value, int base) {
+	print(String(value, base));
+}
+
+void HostSerial::print(unsigned int value, int base) {
+	print(String(value, base));
+}
+
+void HostSerial::print(long value, int base) {
+	print(String(value, base));
+}
+
+void HostSerial::print(unsigned long value, int base) {
+	print(String(value, base));
+}
+
+void HostSerial::print(double value, int decimals) {
+	print(String(value, decimals));
+}
+
+void HostSerial::println() {
+	print("\r\n");
+}
+
+void HostSerial::setSilent(bool silent) {
+	_silent = silent;
+}
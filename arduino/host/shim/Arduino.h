@@ -0,0 +1,124 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Thin Arduino core shim, to build our custom libraries on a Linux host.
+ * Only the parts of the Arduino API used by our libraries are provided.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+// Number bases
+#define DEC 10
+#define HEX 16
+
+// Flash storage qualifiers are meaningless on the host
+#define PROGMEM
+#define F(str) (str)
+// The RTC memory of the ESP32 is ordinary memory on the host
+#define RTC_DATA_ATTR
+
+// Pin modes and levels
+#define INPUT  0x01
+#define OUTPUT 0x03
+#define LOW    0x0
+#define HIGH   0x1
+
+// Math
+#define PI          3.1415926535897932384626433832795
+#define TWO_PI      6.283185307179586476925286766559
+#define radians(deg) ((deg) * (PI / 180.0))
+#define degrees(rad) ((rad) * (180.0 / PI))
+#define sq(x)        ((x) * (x))
+
+typedef uint8_t byte;
+
+// Time, either the wall-clock time of the host (Clock.cpp),
+// or the virtual time of the simulation (../sim/SimClock.cpp)
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// GPIO and ESP32 core, only provided by the simulation (../sim/SimHal.cpp)
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+bool setCpuFrequencyMhz(uint32_t frequency);
+uint32_t getCpuFrequencyMhz();
+bool btStop();
+void yield();
+
+/* Minimal Arduino String, backed by a std::string */
+class String {
+
+	public:
+		String(const char* str = "");
+		String(const std::string& str);
+		String(char c);
+		String(int value, uint8_t base = DEC);
+		String(unsigned int value, uint8_t base = DEC);
+		String(long value, uint8_t base = DEC);
+		String(unsigned long value, uint8_t base = DEC);
+		String(float value, uint8_t decimals = 2);
+		String(double value, uint8_t decimals = 2);
+
+		unsigned int length() const;
+		const char* c_str() const;
+		int indexOf(const String& str) const;
+		int indexOf(char c) const;
+		String substring(unsigned int from) const;
+		String substring(unsigned int from, unsigned int to) const;
+		float toFloat() const;
+
+		String& operator+=(const String& str);
+		bool operator==(const String& str) const;
+		bool operator!=(const String& str) const;
+		friend String operator+(const String& lhs, const String& rhs);
+
+	private:
+		std::string _str;
+};
+
+/* Serial port, printing on the standard output */
+class HostSerial {
+
+	public:
+		void begin(unsigned long baud);
+		void print(const String& str);
+		void print(const char* str);
+		void print(char c);
+		void print(int value, int base = DEC);
+		void print(unsigned int value, int base = DEC);
+		void print(long value, int base = DEC);
+		void print(unsigned long value, int base = DEC);
+		void print(double value, int decimals = 2);
+		void println();
+		// Host only: silences the output, e.g. of long simulations
+		void setSilent(bool silent);
+		template <typename T>
+		void println(T value) {
+			print(value);
+			println();
+		}
+		template <typename T>
+		void println(T value, int format) {
+			print(value, format);
+			println();
+		}
+
+	private:
+		bool _silent = false;
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,25 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Checks of the host tests: a failed check prints its location and condition,
+ * and is counted in failures, reported by the main function of the test.
+ */
+
+#ifndef Check_h
+#define Check_h
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+#endif
@@ -0,0 +1,15 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Print class of the Arduino core shim: only included by some libraries,
+ * which print through Serial (see Arduino.h).
+ */
+
+#ifndef Print_h
+#define Print_h
+
+#include "Arduino.h"
+
+#endif
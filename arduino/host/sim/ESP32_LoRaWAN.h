@@ -0,0 +1,165 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * LoRaWAN library of the Heltec boards, as used by EspDevice,
+ * with a loopback radio: the uplinks are recorded, and acknowledged, by SimLoRaWAN (SimLoRaWAN.h).
+ */
+
+#ifndef SimESP32_LoRaWAN_h
+#define SimESP32_LoRaWAN_h
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "Wire.h"
+
+// Pins of the Heltec WiFi LoRa 32 board
+#define SCK      5
+#define MISO     19
+#define MOSI     27
+#define SS       18
+#define RST_LoRa 14
+#define DIO0     26
+#define DIO1     35
+
+// Arduino settings of the board
+#define LoRaWAN_DEBUG_LEVEL 0
+#define ACTIVE_REGION       LORAMAC_REGION_EU868
+
+#define LORAWAN_APP_DATA_MAX_SIZE 222
+#define APP_TX_DUTYCYCLE_RND      1000
+
+typedef enum eDeviceClass {
+	CLASS_A,
+	CLASS_B,
+	CLASS_C,
+} DeviceClass_t;
+
+typedef enum eLoRaMacRegion_t {
+	LORAMAC_REGION_AS923,
+	LORAMAC_REGION_AU915,
+	LORAMAC_REGION_CN470,
+	LORAMAC_REGION_CN779,
+	LORAMAC_REGION_EU433,
+	LORAMAC_REGION_EU868,
+	LORAMAC_REGION_KR920,
+	LORAMAC_REGION_IN865,
+	LORAMAC_REGION_US915,
+	LORAMAC_REGION_US915_HYBRID,
+} LoRaMacRegion_t;
+
+typedef enum eLoRaMacStatus {
+	LORAMAC_STATUS_OK,
+	LORAMAC_STATUS_LENGTH_ERROR = 8,
+} LoRaMacStatus_t;
+
+typedef struct sLoRaMacTxInfo {
+	uint8_t MaxPossiblePayload;
+	uint8_t CurrentPayloadSize;
+} LoRaMacTxInfo_t;
+
+LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t* txInfo);
+
+typedef enum eMcps {
+	MCPS_UNCONFIRMED,
+	MCPS_CONFIRMED,
+	MCPS_MULTICAST,
+	MCPS_PROPRIETARY,
+} Mcps_t;
+
+typedef enum eLoRaMacEventInfoStatus {
+	LORAMAC_EVENT_INFO_STATUS_OK,
+	LORAMAC_EVENT_INFO_STATUS_ERROR,
+} LoRaMacEventInfoStatus_t;
+
+// Confirmation of an uplink, given to uplinkConfirmHandle once its receive windows are over
+typedef struct sMcpsConfirm {
+	Mcps_t McpsRequest;
+	LoRaMacEventInfoStatus_t Status;
+	uint8_t Datarate;
+	bool AckReceived;
+	uint8_t NbRetries;
+} McpsConfirm_t;
+
+void uplinkConfirmHandle(McpsConfirm_t* mcpsConfirm);
+
+typedef enum {
+	RF_IDLE,
+	RF_RX_RUNNING,
+	RF_TX_RUNNING,
+} RadioState_t;
+
+struct Radio_s {
+	RadioState_t (*GetStatus)(void);
+};
+
+extern const struct Radio_s Radio;
+
+enum eDeviceState {
+	DEVICE_STATE_INIT,
+	DEVICE_STATE_JOIN,
+	DEVICE_STATE_SEND,
+	DEVICE_STATE_CYCLE,
+	DEVICE_STATE_SLEEP
+};
+
+class LoRaWanClass {
+
+	public:
+		void init(DeviceClass_t classMode, LoRaMacRegion_t region);
+		void join();
+		void send(DeviceClass_t classMode);
+		void cycle(uint32_t dutyCycle);
+		void sleep(DeviceClass_t classMode, uint8_t debugLevel);
+		void displayJoining() {}
+		void displayJoined() {}
+		void displaySending() {}
+		void displayAck() {}
+		void displayMcuInit() {}
+
+};
+
+class McuClass {
+
+	public:
+		void init(int nss, int reset, int dio0, int dio1, uint32_t* codeid) {}
+
+};
+
+/* OLED display, without any output */
+class SSD1306 {
+
+	public:
+		void init() {}
+		void wakeup() {}
+		void sleep() {}
+		void clear() {}
+		void display() {}
+		void flipScreenVertically() {}
+		void drawString(int16_t x, int16_t y, String text) {}
+
+};
+
+int32_t randr(int32_t min, int32_t max);
+
+extern enum eDeviceState deviceState;
+extern uint8_t appPort;
+extern uint32_t txDutyCycleTime;
+extern uint8_t appData[LORAWAN_APP_DATA_MAX_SIZE];
+extern uint8_t appDataSize;
+extern bool overTheAirActivation;
+extern LoRaMacRegion_t loraWanRegion;
+extern bool loraWanAdr;
+extern bool isTxConfirmed;
+extern uint8_t confirmedNbTrials;
+extern DeviceClass_t loraWanClass;
+extern uint8_t NwkSKey[];
+extern uint8_t AppSKey[];
+extern uint32_t DevAddr;
+extern uint16_t userChannelsMask[6];
+extern LoRaWanClass LoRaWAN;
+extern McuClass Mcu;
+extern SSD1306 Display;
+
+#endif
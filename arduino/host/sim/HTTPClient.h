@@ -0,0 +1,32 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * HTTP client of the simulation: the requests are recorded by SimWifi (SimWifi.h).
+ */
+
+#ifndef SimHTTPClient_h
+#define SimHTTPClient_h
+
+#include "Arduino.h"
+#include <map>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient {
+
+	public:
+		bool begin(String url, const char* certificate);
+		void addHeader(const String& name, const String& value);
+		int POST(String payload);
+		int POST(uint8_t* payload, size_t size);
+		void end();
+
+	private:
+		String _url;
+		std::map<std::string, std::string> _headers;
+
+};
+
+#endif
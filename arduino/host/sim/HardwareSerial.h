@@ -0,0 +1,65 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * UARTs of the simulation, to which fake devices are attached,
+ * like the GPS module sending its NMEA sentences.
+ */
+
+#ifndef SimHardwareSerial_h
+#define SimHardwareSerial_h
+
+#include "Arduino.h"
+#include <string>
+
+// Number of UARTs of the ESP32
+#define SIM_UARTS 3
+
+#define SERIAL_8N1 0x800001c
+
+/* Fake device of a UART */
+class SimUartDevice {
+
+	public:
+		virtual ~SimUartDevice() {}
+		// Called when the UART is started
+		virtual void begin() {}
+		/**
+		 * Bytes sent by the device in a time interval since the start of the UART.
+		 * @param from: start of the interval (in µs), excluded
+		 * @param to: end of the interval (in µs), included
+		 * @param output: string to which the bytes are appended
+		 */
+		virtual void transmit(uint64_t from, uint64_t to, std::string& output) = 0;
+
+};
+
+class HardwareSerial {
+
+	public:
+		HardwareSerial(int uart);
+
+		void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx = -1, int8_t tx = -1);
+		void end();
+		int available();
+		int read();
+
+		// Simulation: attaches a fake device to a UART, which stays attached across the boots
+		static void attach(uint8_t uart, SimUartDevice* device);
+
+	private:
+		uint8_t _uart;
+		bool _started;
+		uint64_t _begin;
+		uint64_t _polled;
+		std::string _received;
+		size_t _index;
+
+		void receive();
+
+		static SimUartDevice* _devices[SIM_UARTS];
+
+};
+
+#endif
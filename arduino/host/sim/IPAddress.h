@@ -0,0 +1,30 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * IPv4 address of the simulation, stored in network order like the ESP32 core.
+ */
+
+#ifndef SimIPAddress_h
+#define SimIPAddress_h
+
+#include "Arduino.h"
+
+class IPAddress {
+
+	public:
+		IPAddress();
+		IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+		IPAddress(uint32_t address);
+
+		bool fromString(const char* address);
+		operator uint32_t() const;
+		uint8_t operator[](int index) const;
+
+	private:
+		uint8_t _bytes[4];
+
+};
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * NVS flash of the ESP32 (Preferences library) in the simulation:
+ * the keys are kept in memory, and survive the deep sleeps and the reboots.
+ */
+
+#ifndef SimPreferences_h
+#define SimPreferences_h
+
+#include "Arduino.h"
+#include <string>
+
+class Preferences {
+
+	public:
+		Preferences();
+
+		bool begin(const char* name, bool readOnly = false, const char* partitionLabel = NULL);
+		void end();
+		bool clear();
+		bool remove(const char* key);
+
+		size_t putUShort(const char* key, uint16_t value);
+		uint16_t getUShort(const char* key, uint16_t defaultValue = 0);
+		size_t putBytes(const char* key, const void* value, size_t length);
+		size_t getBytesLength(const char* key);
+		size_t getBytes(const char* key, void* buffer, size_t maxLength);
+
+	private:
+		std::string _name;
+		bool _started;
+		bool _readOnly;
+
+		std::string getPath(const char* key);
+
+};
+
+#endif
@@ -0,0 +1,38 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * SPI bus of the simulation. No device is attached: the LoRa radio
+ * is simulated above the MAC layer (see SimLoRaWAN.h).
+ */
+
+#ifndef SimSPI_h
+#define SimSPI_h
+
+#include "Arduino.h"
+
+#define MSBFIRST  1
+#define SPI_MODE0 0
+
+class SPISettings {
+
+	public:
+		SPISettings(uint32_t clock = 1000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0) {}
+
+};
+
+class SPIClass {
+
+	public:
+		void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+		void end() {}
+		void beginTransaction(SPISettings settings) {}
+		void endTransaction() {}
+		uint8_t transfer(uint8_t data) { return 0xff; }
+
+};
+
+extern SPIClass SPI;
+
+#endif
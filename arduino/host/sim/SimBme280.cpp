@@ -0,0 +1,171 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Fake BME280 of the simulation.
+ */
+
+#include "SimBme280.h"
+#include "SimClock.h"
+#include "SimSearch.h"
+
+// Registers
+#define REG_CALIB_T      0x88
+#define REG_CALIB_P      0x8E
+#define REG_CALIB_H1     0xA1
+#define REG_CALIB_H2     0xE1
+#define REG_CHIP_ID      0xD0
+#define REG_PRESSURE     0xF7
+#define REG_TEMPERATURE  0xFA
+#define REG_HUMIDITY     0xFD
+#define CHIP_ID          0x60
+// Range of the raw measurements
+#define ADC_20_BITS_MAX  0xFFFFF
+#define ADC_16_BITS_MAX  0xFFFF
+
+// Typical calibration coefficients (example of the datasheet for T and P)
+static const uint16_t T1 = 27504;
+static const int16_t T2 = 26435;
+static const int16_t T3 = -1000;
+static const uint16_t P1 = 36477;
+static const int16_t P2 = -10685;
+static const int16_t P3 = 3024;
+static const int16_t P4 = 2855;
+static const int16_t P5 = 140;
+static const int16_t P6 = -7;
+static const int16_t P7 = 15500;
+static const int16_t P8 = -14600;
+static const int16_t P9 = 6000;
+static const uint8_t H1 = 75;
+static const int16_t H2 = 370;
+static const uint8_t H3 = 0;
+static const int16_t H4 = 303;
+static const int16_t H5 = 50;
+static const int8_t H6 = 30;
+
+/**
+ * Writes a 16-bit little-endian value in the registers.
+ */
+static void write16(uint8_t* registers, uint8_t reg, uint16_t value) {
+	registers[reg] = value & 0xff;
+	registers[reg + 1] = value >> 8;
+}
+
+SimBme280::SimBme280() {
+	memset(_registers, 0, sizeof(_registers));
+	_registers[REG_CHIP_ID] = CHIP_ID;
+	const uint16_t calibration[12] = {T1, (uint16_t) T2, (uint16_t) T3, P1, (uint16_t) P2, (uint16_t) P3,
+	                                  (uint16_t) P4, (uint16_t) P5, (uint16_t) P6, (uint16_t) P7,
+	                                  (uint16_t) P8, (uint16_t) P9};
+	for (uint8_t i = 0; i < 12; i++)
+		write16(_registers, REG_CALIB_T + 2 * i, calibration[i]);
+	_registers[REG_CALIB_H1] = H1;
+	write16(_registers, REG_CALIB_H2, H2);
+	_registers[REG_CALIB_H2 + 2] = H3;
+	// H4 and H5 are 12-bit values sharing a register
+	_registers[REG_CALIB_H2 + 3] = H4 >> 4;
+	_registers[REG_CALIB_H2 + 4] = (H4 & 0x0f) | ((H5 & 0x0f) << 4);
+	_registers[REG_CALIB_H2 + 5] = H5 >> 4;
+	_registers[REG_CALIB_H2 + 6] = H6;
+	_temperature = SimHal::constant(20);
+	_pressure = SimHal::constant(101325);
+	_humidity = SimHal::constant(50);
+}
+
+void SimBme280::setTemperature(sim_script_t temperature) {
+	_temperature = temperature;
+}
+
+void SimBme280::setPressure(sim_script_t pressure) {
+	_pressure = pressure;
+}
+
+void SimBme280::setHumidity(sim_script_t humidity) {
+	_humidity = humidity;
+}
+
+/**
+ * Reads a register. Reading the first register of a measurement samples the environment.
+ */
+uint8_t SimBme280::readRegister(uint8_t reg) {
+	if (reg == REG_PRESSURE || reg == REG_TEMPERATURE || reg == REG_HUMIDITY)
+		measure();
+	return _registers[reg];
+}
+
+/**
+ * Writes a register: configuration, or soft reset, which leaves the registers as they are.
+ */
+void SimBme280::writeRegister(uint8_t reg, uint8_t value) {
+	if (reg >= REG_CHIP_ID)
+		_registers[reg] = value;
+}
+
+/**
+ * Samples the scripted environment, and writes the raw measurements
+ * whose compensation is the closest to it.
+ */
+void SimBme280::measure() {
+	uint64_t time = SimClock::nowMs();
+	int32_t tFine;
+	int32_t temperature = SimSearch::increasing(0, ADC_20_BITS_MAX, _temperature(time) * 100,
+		[&](int32_t adc) { return (double) compensateTemperature(adc, &tFine); });
+	compensateTemperature(temperature, &tFine);
+	// The pressure decreases with its raw measurement
+	int32_t pressure = SimSearch::increasing(0, ADC_20_BITS_MAX, -_pressure(time) * 256,
+		[&](int32_t adc) { return -(double) compensatePressure(adc, tFine); });
+	int32_t humidity = SimSearch::increasing(0, ADC_16_BITS_MAX, _humidity(time) * 1024,
+		[&](int32_t adc) { return (double) (compensateHumidity(adc, tFine) >> 12); });
+	_registers[REG_PRESSURE] = pressure >> 12;
+	_registers[REG_PRESSURE + 1] = (pressure >> 4) & 0xff;
+	_registers[REG_PRESSURE + 2] = (pressure & 0x0f) << 4;
+	_registers[REG_TEMPERATURE] = temperature >> 12;
+	_registers[REG_TEMPERATURE + 1] = (temperature >> 4) & 0xff;
+	_registers[REG_TEMPERATURE + 2] = (temperature & 0x0f) << 4;
+	_registers[REG_HUMIDITY] = humidity >> 8;
+	_registers[REG_HUMIDITY + 1] = humidity & 0xff;
+}
+
+/**
+ * Temperature, in 0.01 °C.
+ */
+int32_t SimBme280::compensateTemperature(int32_t adc, int32_t* tFine) {
+	int32_t var1 = ((((adc >> 3) - ((int32_t) T1 << 1))) * ((int32_t) T2)) >> 11;
+	int32_t var2 = (((((adc >> 4) - ((int32_t) T1)) * ((adc >> 4) - ((int32_t) T1))) >> 12) *
+	                ((int32_t) T3)) >> 14;
+	*tFine = var1 + var2;
+	return (*tFine * 5 + 128) >> 8;
+}
+
+/**
+ * Pressure, in Pa as a Q24.8 fixed-point value.
+ */
+int64_t SimBme280::compensatePressure(int32_t adc, int32_t tFine) {
+	int64_t var1 = ((int64_t) tFine) - 128000;
+	int64_t var2 = var1 * var1 * (int64_t) P6;
+	var2 = var2 + ((var1 * (int64_t) P5) << 17);
+	var2 = var2 + (((int64_t) P4) << 35);
+	var1 = ((var1 * var1 * (int64_t) P3) >> 8) + ((var1 * (int64_t) P2) << 12);
+	var1 = (((((int64_t) 1) << 47) + var1)) * ((int64_t) P1) >> 33;
+	if (var1 == 0)
+		return 0;
+	int64_t p = 1048576 - adc;
+	p = (((p << 31) - var2) * 3125) / var1;
+	var1 = (((int64_t) P9) * (p >> 13) * (p >> 13)) >> 25;
+	var2 = (((int64_t) P8) * p) >> 19;
+	return ((p + var1 + var2) >> 8) + (((int64_t) P7) << 4);
+}
+
+/**
+ * Humidity, in % as a Q22.10 fixed-point value shifted by 12 bits.
+ */
+int32_t SimBme280::compensateHumidity(int32_t adc, int32_t tFine) {
+	int32_t v = tFine - ((int32_t) 76800);
+	v = (((((adc << 14) - (((int32_t) H4) << 20) - (((int32_t) H5) * v)) + ((int32_t) 16384)) >> 15) *
+	     (((((((v * ((int32_t) H6)) >> 10) * (((v * ((int32_t) H3)) >> 11) + ((int32_t) 32768))) >> 10) +
+	        ((int32_t) 2097152)) * ((int32_t) H2) + 8192) >> 14));
+	v = v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t) H1)) >> 4);
+	v = v < 0 ? 0 : v;
+	return v > 419430400 ? 419430400 : v;
+}
@@ -0,0 +1,45 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Fake BME280 of the simulation, on the I2C bus: the registers of the chip,
+ * with typical calibration coefficients, and raw measurements encoding the
+ * scripted temperature, pressure and humidity.
+ */
+
+#ifndef SimBme280_h
+#define SimBme280_h
+
+#include "Wire.h"
+#include "SimHal.h"
+
+class SimBme280 : public SimI2cDevice {
+
+	public:
+		SimBme280();
+
+		// Scripted environment: temperature (in °C), pressure (in Pa), humidity (in %)
+		void setTemperature(sim_script_t temperature);
+		void setPressure(sim_script_t pressure);
+		void setHumidity(sim_script_t humidity);
+
+		uint8_t readRegister(uint8_t reg);
+		void writeRegister(uint8_t reg, uint8_t value);
+
+	private:
+		uint8_t _registers[256];
+		sim_script_t _temperature;
+		sim_script_t _pressure;
+		sim_script_t _humidity;
+
+		void measure();
+
+		// Compensation formulas of the datasheet
+		static int32_t compensateTemperature(int32_t adc, int32_t* tFine);
+		static int64_t compensatePressure(int32_t adc, int32_t tFine);
+		static int32_t compensateHumidity(int32_t adc, int32_t tFine);
+
+};
+
+#endif
@@ -0,0 +1,287 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Fake BME680 of the simulation.
+ */
+
+#include "SimBme680.h"
+#include "SimClock.h"
+#include "SimSearch.h"
+
+// Registers
+#define REG_RES_HEAT_VAL    0x00
+#define REG_RES_HEAT_RANGE  0x02
+#define REG_RANGE_SW_ERR    0x04
+#define REG_FIELD0          0x1D
+#define REG_CTRL_MEAS       0x74
+#define REG_COEFF1          0x89
+#define REG_COEFF2          0xE1
+#define REG_CHIP_ID         0xD0
+#define CHIP_ID             0x61
+#define COEFF1_LENGTH       25
+// Field data, from REG_FIELD0
+#define FIELD_STATUS        0
+#define FIELD_PRESSURE      2
+#define FIELD_TEMPERATURE   5
+#define FIELD_HUMIDITY      8
+#define FIELD_GAS           13
+#define STATUS_NEW_DATA     0x80
+#define GAS_VALID           0x20
+#define GAS_HEAT_STAB       0x10
+// Power modes
+#define MODE_MASK           0x03
+#define MODE_FORCED         0x01
+// Range of the raw measurements
+#define ADC_20_BITS_MAX     0xFFFFF
+#define ADC_16_BITS_MAX     0xFFFF
+#define ADC_GAS_MAX         0x3FF
+#define GAS_RANGES          16
+// Air quality: the gas resistance of clean air, halved every AIR_QUALITY_HALVING points
+#define CLEAN_AIR_RESISTANCE 500000.0
+#define AIR_QUALITY_HALVING  50.0
+
+// Calibration coefficients of a typical sensor
+static const uint16_t T1 = 26038;
+static const int16_t T2 = 26337;
+static const int8_t T3 = 3;
+static const uint16_t P1 = 36337;
+static const int16_t P2 = -10548;
+static const int8_t P3 = 88;
+static const int16_t P4 = 7380;
+static const int16_t P5 = -121;
+static const int8_t P6 = 30;
+static const int8_t P7 = 59;
+static const int16_t P8 = -1374;
+static const int16_t P9 = -2556;
+static const uint8_t P10 = 30;
+static const uint16_t H1 = 779;
+static const uint16_t H2 = 1004;
+static const int8_t H3 = 0;
+static const int8_t H4 = 45;
+static const int8_t H5 = 20;
+static const uint8_t H6 = 120;
+static const int8_t H7 = -100;
+static const int8_t RANGE_SW_ERR = 0;
+
+/**
+ * Writes a calibration coefficient, at its index in the calibration array of the Bosch driver.
+ */
+static void writeCoefficient(uint8_t* registers, uint8_t index, uint8_t value) {
+	if (index < COEFF1_LENGTH)
+		registers[REG_COEFF1 + index] = value;
+	else
+		registers[REG_COEFF2 + index - COEFF1_LENGTH] = value;
+}
+
+/**
+ * Writes a 16-bit little-endian calibration coefficient.
+ */
+static void writeCoefficient16(uint8_t* registers, uint8_t index, uint16_t value) {
+	writeCoefficient(registers, index, value & 0xff);
+	writeCoefficient(registers, index + 1, value >> 8);
+}
+
+SimBme680::SimBme680() {
+	memset(_registers, 0, sizeof(_registers));
+	_registers[REG_CHIP_ID] = CHIP_ID;
+	writeCoefficient16(_registers, 1, T2);
+	writeCoefficient(_registers, 3, T3);
+	writeCoefficient16(_registers, 5, P1);
+	writeCoefficient16(_registers, 7, P2);
+	writeCoefficient(_registers, 9, P3);
+	writeCoefficient16(_registers, 11, P4);
+	writeCoefficient16(_registers, 13, P5);
+	writeCoefficient(_registers, 15, P7);
+	writeCoefficient(_registers, 16, P6);
+	writeCoefficient16(_registers, 19, P8);
+	writeCoefficient16(_registers, 21, P9);
+	writeCoefficient(_registers, 23, P10);
+	// H1 and H2 are 12-bit values sharing a register
+	writeCoefficient(_registers, 25, H2 >> 4);
+	writeCoefficient(_registers, 26, ((H2 & 0x0f) << 4) | (H1 & 0x0f));
+	writeCoefficient(_registers, 27, H1 >> 4);
+	writeCoefficient(_registers, 28, H3);
+	writeCoefficient(_registers, 29, H4);
+	writeCoefficient(_registers, 30, H5);
+	writeCoefficient(_registers, 31, H6);
+	writeCoefficient(_registers, 32, H7);
+	writeCoefficient16(_registers, 33, T1);
+	_registers[REG_RES_HEAT_VAL] = 48;
+	_registers[REG_RES_HEAT_RANGE] = 1 << 4;
+	_registers[REG_RANGE_SW_ERR] = RANGE_SW_ERR << 4;
+	_temperature = SimHal::constant(20);
+	_pressure = SimHal::constant(101325);
+	_humidity = SimHal::constant(50);
+	_airQuality = SimHal::constant(50);
+	_measurements = 0;
+}
+
+void SimBme680::setTemperature(sim_script_t temperature) {
+	_temperature = temperature;
+}
+
+void SimBme680::setPressure(sim_script_t pressure) {
+	_pressure = pressure;
+}
+
+void SimBme680::setHumidity(sim_script_t humidity) {
+	_humidity = humidity;
+}
+
+void SimBme680::setAirQuality(sim_script_t airQuality) {
+	_airQuality = airQuality;
+}
+
+uint32_t SimBme680::getMeasurements() {
+	return _measurements;
+}
+
+uint8_t SimBme680::readRegister(uint8_t reg) {
+	return _registers[reg];
+}
+
+/**
+ * Writes a register. Setting the forced mode runs a measurement,
+ * after which the sensor is back in sleep mode.
+ */
+void SimBme680::writeRegister(uint8_t reg, uint8_t value) {
+	if (reg == REG_CTRL_MEAS && (value & MODE_MASK) == MODE_FORCED) {
+		measure();
+		value &= ~MODE_MASK;
+	}
+	if (reg >= REG_FIELD0)
+		_registers[reg] = value;
+}
+
+/**
+ * Gas resistance of the given air quality index.
+ * @param airQuality: indoor air quality index
+ * @return: the gas resistance (in Ohm)
+ */
+float SimBme680::gasResistance(float airQuality) {
+	return CLEAN_AIR_RESISTANCE * pow(2, -airQuality / AIR_QUALITY_HALVING);
+}
+
+/**
+ * Air quality index of the given gas resistance.
+ * @param gasResistance: gas resistance (in Ohm)
+ * @return: the indoor air quality index
+ */
+float SimBme680::airQuality(float gasResistance) {
+	return -AIR_QUALITY_HALVING * log2(gasResistance / CLEAN_AIR_RESISTANCE);
+}
+
+/**
+ * Samples the scripted environment, and writes the field data
+ * whose compensation is the closest to it.
+ */
+void SimBme680::measure() {
+	uint64_t time = SimClock::nowMs();
+	int32_t tFine;
+	int32_t temperature = SimSearch::increasing(0, ADC_20_BITS_MAX, _temperature(time) * 100,
+		[&](int32_t adc) { return (double) compensateTemperature(adc, &tFine); });
+	compensateTemperature(temperature, &tFine);
+	// The pressure and the gas resistance decrease with their raw measurements
+	int32_t pressure = SimSearch::increasing(0, ADC_20_BITS_MAX, -_pressure(time),
+		[&](int32_t adc) { return -(double) compensatePressure(adc, tFine); });
+	int32_t humidity = SimSearch::increasing(0, ADC_16_BITS_MAX, _humidity(time) * 1000,
+		[&](int32_t adc) { return (double) compensateHumidity(adc, tFine); });
+	double resistance = gasResistance(_airQuality(time));
+	int32_t gas = 0;
+	uint8_t range = 0;
+	double error = INFINITY;
+	for (uint8_t r = 0; r < GAS_RANGES; r++) {
+		int32_t adc = SimSearch::increasing(0, ADC_GAS_MAX, -resistance,
+			[&](int32_t adc) { return -(double) compensateGas(adc, r); });
+		double rangeError = fabs(compensateGas(adc, r) - resistance);
+		if (rangeError < error) {
+			error = rangeError;
+			gas = adc;
+			range = r;
+		}
+	}
+	uint8_t* field = _registers + REG_FIELD0;
+	memset(field, 0, FIELD_GAS + 2);
+	field[FIELD_STATUS] = STATUS_NEW_DATA;
+	field[FIELD_PRESSURE] = pressure >> 12;
+	field[FIELD_PRESSURE + 1] = (pressure >> 4) & 0xff;
+	field[FIELD_PRESSURE + 2] = (pressure & 0x0f) << 4;
+	field[FIELD_TEMPERATURE] = temperature >> 12;
+	field[FIELD_TEMPERATURE + 1] = (temperature >> 4) & 0xff;
+	field[FIELD_TEMPERATURE + 2] = (temperature & 0x0f) << 4;
+	field[FIELD_HUMIDITY] = humidity >> 8;
+	field[FIELD_HUMIDITY + 1] = humidity & 0xff;
+	field[FIELD_GAS] = gas >> 2;
+	field[FIELD_GAS + 1] = ((gas & 0x03) << 6) | GAS_VALID | GAS_HEAT_STAB | range;
+	_measurements++;
+}
+
+/**
+ * Temperature, in 0.01 °C.
+ */
+int32_t SimBme680::compensateTemperature(int32_t adc, int32_t* tFine) {
+	int64_t var1 = (adc >> 3) - ((int32_t) T1 << 1);
+	int64_t var2 = (var1 * (int32_t) T2) >> 11;
+	int64_t var3 = ((var1 >> 1) * (var1 >> 1)) >> 12;
+	var3 = (var3 * ((int32_t) T3 << 4)) >> 14;
+	*tFine = (int32_t) (var2 + var3);
+	return (*tFine * 5 + 128) >> 8;
+}
+
+/**
+ * Pressure, in Pa.
+ */
+int32_t SimBme680::compensatePressure(int32_t adc, int32_t tFine) {
+	int32_t var1 = (tFine >> 1) - 64000;
+	int32_t var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) * (int32_t) P6) >> 2;
+	var2 = var2 + ((var1 * (int32_t) P5) << 1);
+	var2 = (var2 >> 2) + ((int32_t) P4 << 16);
+	var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) * ((int32_t) P3 << 5)) >> 3) + (((int32_t) P2 * var1) >> 1);
+	var1 = var1 >> 18;
+	var1 = ((32768 + var1) * (int32_t) P1) >> 15;
+	int32_t pressure = 1048576 - adc;
+	pressure = (int32_t) ((pressure - (var2 >> 12)) * ((uint32_t) 3125));
+	if (pressure >= 0x40000000)
+		pressure = (pressure / var1) << 1;
+	else
+		pressure = (pressure << 1) / var1;
+	var1 = ((int32_t) P9 * (int32_t) (((pressure >> 3) * (pressure >> 3)) >> 13)) >> 12;
+	var2 = ((int32_t) (pressure >> 2) * (int32_t) P8) >> 13;
+	int32_t var3 = ((int32_t) (pressure >> 8) * (int32_t) (pressure >> 8) * (int32_t) (pressure >> 8) *
+	                (int32_t) P10) >> 17;
+	return pressure + ((var1 + var2 + var3 + ((int32_t) P7 << 7)) >> 4);
+}
+
+/**
+ * Humidity, in 0.001 %.
+ */
+int32_t SimBme680::compensateHumidity(int32_t adc, int32_t tFine) {
+	int32_t temperature = ((tFine * 5) + 128) >> 8;
+	int32_t var1 = (adc - ((int32_t) H1 * 16)) - (((temperature * (int32_t) H3) / 100) >> 1);
+	int32_t var2 = ((int32_t) H2 * (((temperature * (int32_t) H4) / 100) +
+	                (((temperature * ((temperature * (int32_t) H5) / 100)) >> 6) / 100) + (1 << 14))) >> 10;
+	int32_t var3 = var1 * var2;
+	int32_t var4 = (((int32_t) H6 << 7) + ((temperature * (int32_t) H7) / 100)) >> 4;
+	int32_t var5 = ((var3 >> 14) * (var3 >> 14)) >> 10;
+	int32_t var6 = (var4 * var5) >> 1;
+	int32_t humidity = (((var3 + var6) >> 10) * 1000) >> 12;
+	return humidity > 100000 ? 100000 : (humidity < 0 ? 0 : humidity);
+}
+
+/**
+ * Gas resistance, in Ohm.
+ */
+uint32_t SimBme680::compensateGas(int32_t adc, uint8_t range) {
+	static const uint32_t lookupTable1[GAS_RANGES] = {
+		2147483647, 2147483647, 2147483647, 2147483647, 2147483647, 2126008810, 2147483647, 2130303777,
+		2147483647, 2147483647, 2143188679, 2136746228, 2147483647, 2126008810, 2147483647, 2147483647};
+	static const uint32_t lookupTable2[GAS_RANGES] = {
+		4096000000, 2048000000, 1024000000, 512000000, 255744255, 127110228, 64000000, 32258064,
+		16016016, 8000000, 4000000, 2000000, 1000000, 500000, 250000, 125000};
+	int64_t var1 = (int64_t) ((1340 + (5 * (int64_t) RANGE_SW_ERR)) * ((int64_t) lookupTable1[range])) >> 16;
+	int64_t var2 = (((int64_t) adc << 15) - (int64_t) 16777216) + var1;
+	int64_t var3 = ((int64_t) lookupTable2[range] * var1) >> 9;
+	return (uint32_t) ((var3 + (var2 >> 1)) / var2);
+}
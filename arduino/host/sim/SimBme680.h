@@ -0,0 +1,58 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Fake BME680 of the simulation, on the I2C bus: the registers of the chip,
+ * with typical calibration coefficients, and forced-mode measurements encoding
+ * the scripted temperature, pressure, humidity and air quality.
+ * The air quality is encoded as a gas resistance, which the BSEC stub
+ * of the simulation (SimBsec.cpp) decodes back.
+ */
+
+#ifndef SimBme680_h
+#define SimBme680_h
+
+#include "Wire.h"
+#include "SimHal.h"
+
+class SimBme680 : public SimI2cDevice {
+
+	public:
+		SimBme680();
+
+		// Scripted environment: temperature (in °C), pressure (in Pa), humidity (in %),
+		// indoor air quality index (0 to 500)
+		void setTemperature(sim_script_t temperature);
+		void setPressure(sim_script_t pressure);
+		void setHumidity(sim_script_t humidity);
+		void setAirQuality(sim_script_t airQuality);
+		// Number of forced-mode measurements since the start of the simulation
+		uint32_t getMeasurements();
+
+		uint8_t readRegister(uint8_t reg);
+		void writeRegister(uint8_t reg, uint8_t value);
+
+		// Mapping between the air quality index and the gas resistance (in Ohm)
+		static float gasResistance(float airQuality);
+		static float airQuality(float gasResistance);
+
+	private:
+		uint8_t _registers[256];
+		sim_script_t _temperature;
+		sim_script_t _pressure;
+		sim_script_t _humidity;
+		sim_script_t _airQuality;
+		uint32_t _measurements;
+
+		void measure();
+
+		// Integer compensation formulas of the Bosch driver (bme680.c)
+		static int32_t compensateTemperature(int32_t adc, int32_t* tFine);
+		static int32_t compensatePressure(int32_t adc, int32_t tFine);
+		static int32_t compensateHumidity(int32_t adc, int32_t tFine);
+		static uint32_t compensateGas(int32_t adc, uint8_t range);
+
+};
+
+#endif
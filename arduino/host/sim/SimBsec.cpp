@@ -0,0 +1,125 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Stub of the BSEC algorithm of Bosch, which is only distributed
+ * as binaries for the microcontrollers (libalgobsec.a).
+ * The stub requests a forced measurement at each call, in ultra low power mode,
+ * and passes the measurements through, decoding the air quality index
+ * from the gas resistance like the fake BME680 of the simulation encodes it.
+ */
+
+#include "inc/bsec_interface.h"
+#include "SimBme680.h"
+
+// Sample period of the ultra low power mode (in ns)
+#define BSEC_ULP_PERIOD_NS INT64_C(300000000000)
+// Heater profile of the ultra low power mode
+#define BSEC_HEATER_TEMPERATURE 320
+#define BSEC_HEATING_DURATION   150
+// Accuracy of the outputs: high
+#define BSEC_ACCURACY 3
+
+bsec_library_return_t bsec_get_version(bsec_version_t* bsec_version_p) {
+	bsec_version_p->major = 1;
+	bsec_version_p->minor = 4;
+	bsec_version_p->major_bugfix = 7;
+	bsec_version_p->minor_bugfix = 4;
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_init(void) {
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_update_subscription(const bsec_sensor_configuration_t* const requested_virtual_sensors,
+                                               const uint8_t n_requested_virtual_sensors,
+                                               bsec_sensor_configuration_t* required_sensor_settings,
+                                               uint8_t* n_required_sensor_settings) {
+	*n_required_sensor_settings = 0;
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_do_steps(const bsec_input_t* const inputs, const uint8_t n_inputs,
+                                    bsec_output_t* outputs, uint8_t* n_outputs) {
+	uint8_t n = 0;
+	for (uint8_t i = 0; i < n_inputs && n + 3 <= *n_outputs; i++) {
+		bsec_output_t output = {inputs[i].time_stamp, inputs[i].signal, 1, 0, BSEC_ACCURACY};
+		switch (inputs[i].sensor_id) {
+			case BSEC_INPUT_TEMPERATURE:
+				output.sensor_id = BSEC_OUTPUT_RAW_TEMPERATURE;
+				outputs[n++] = output;
+				output.sensor_id = BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE;
+				outputs[n++] = output;
+				break;
+			case BSEC_INPUT_HUMIDITY:
+				output.sensor_id = BSEC_OUTPUT_RAW_HUMIDITY;
+				outputs[n++] = output;
+				output.sensor_id = BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY;
+				outputs[n++] = output;
+				break;
+			case BSEC_INPUT_PRESSURE:
+				output.sensor_id = BSEC_OUTPUT_RAW_PRESSURE;
+				outputs[n++] = output;
+				break;
+			case BSEC_INPUT_GASRESISTOR:
+				output.sensor_id = BSEC_OUTPUT_RAW_GAS;
+				outputs[n++] = output;
+				output.signal = SimBme680::airQuality(inputs[i].signal);
+				output.sensor_id = BSEC_OUTPUT_IAQ;
+				outputs[n++] = output;
+				output.sensor_id = BSEC_OUTPUT_STATIC_IAQ;
+				outputs[n++] = output;
+				break;
+			default:
+				break;
+		}
+	}
+	*n_outputs = n;
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_reset_output(uint8_t sensor_id) {
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_set_configuration(const uint8_t* const serialized_settings,
+                                             const uint32_t n_serialized_settings, uint8_t* work_buffer,
+                                             const uint32_t n_work_buffer_size) {
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_set_state(const uint8_t* const serialized_state, const uint32_t n_serialized_state,
+                                     uint8_t* work_buffer, const uint32_t n_work_buffer_size) {
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_get_configuration(const uint8_t config_id, uint8_t* serialized_settings,
+                                             const uint32_t n_serialized_settings_max, uint8_t* work_buffer,
+                                             const uint32_t n_work_buffer, uint32_t* n_serialized_settings) {
+	*n_serialized_settings = 0;
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_get_state(const uint8_t state_set_id, uint8_t* serialized_state,
+                                     const uint32_t n_serialized_state_max, uint8_t* work_buffer,
+                                     const uint32_t n_work_buffer, uint32_t* n_serialized_state) {
+	memset(serialized_state, 0, n_serialized_state_max);
+	*n_serialized_state = n_serialized_state_max;
+	return BSEC_OK;
+}
+
+bsec_library_return_t bsec_sensor_control(const int64_t time_stamp, bsec_bme_settings_t* sensor_settings) {
+	sensor_settings->next_call = time_stamp + BSEC_ULP_PERIOD_NS;
+	sensor_settings->process_data = BSEC_PROCESS_TEMPERATURE | BSEC_PROCESS_HUMIDITY |
+	                                BSEC_PROCESS_PRESSURE | BSEC_PROCESS_GAS;
+	sensor_settings->heater_temperature = BSEC_HEATER_TEMPERATURE;
+	sensor_settings->heating_duration = BSEC_HEATING_DURATION;
+	sensor_settings->run_gas = 1;
+	sensor_settings->pressure_oversampling = 1;
+	sensor_settings->temperature_oversampling = 1;
+	sensor_settings->humidity_oversampling = 1;
+	sensor_settings->trigger_measurement = 1;
+	return BSEC_OK;
+}
@@ -0,0 +1,69 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Virtual time of the simulation, and time functions of the Arduino core.
+ */
+
+#include "Arduino.h"
+#include "SimClock.h"
+
+uint64_t SimClock::_now = 0;
+uint64_t SimClock::_boot = 0;
+
+uint64_t SimClock::now() {
+	return _now;
+}
+
+uint64_t SimClock::nowMs() {
+	return _now / 1000;
+}
+
+/**
+ * Advances the virtual time of the running task.
+ * @param duration: duration (in µs)
+ */
+void SimClock::advance(uint64_t duration) {
+	_now += duration;
+}
+
+/**
+ * Sets the virtual time, when switching between the simulated tasks.
+ * @param time: virtual time since the start of the simulation (in µs)
+ */
+void SimClock::set(uint64_t time) {
+	_now = time;
+}
+
+/**
+ * Boots the device at the current virtual time.
+ */
+void SimClock::boot() {
+	_boot = _now;
+}
+
+uint64_t SimClock::getBootTime() {
+	return _boot;
+}
+
+/**
+ * Milliseconds since the last boot.
+ */
+unsigned long millis() {
+	return (SimClock::now() - SimClock::getBootTime()) / 1000;
+}
+
+/**
+ * Microseconds since the last boot.
+ */
+unsigned long micros() {
+	return SimClock::now() - SimClock::getBootTime();
+}
+
+/**
+ * Advances the virtual time by the given number of milliseconds, without blocking.
+ */
+void delay(unsigned long ms) {
+	SimClock::advance(SIM_MS(ms));
+}
@@ -0,0 +1,44 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Virtual time of the simulation.
+ * delay() advances the virtual time instantly, so that months of wake cycles
+ * are simulated in seconds. millis() and micros() count from the last boot,
+ * like on the ESP32 after a deep sleep.
+ */
+
+#ifndef SimClock_h
+#define SimClock_h
+
+#include <stdint.h>
+
+// Conversions of the virtual time (in µs)
+#define SIM_MS(ms)          ((uint64_t) (ms) * 1000)
+#define SIM_SECONDS(s)      ((uint64_t) (s) * 1000000)
+#define SIM_MINUTES(min)    (SIM_SECONDS(min) * 60)
+#define SIM_HOURS(h)        (SIM_MINUTES(h) * 60)
+#define SIM_DAYS(d)         (SIM_HOURS(d) * 24)
+
+class SimClock {
+
+	public:
+		// Virtual time since the start of the simulation (in µs)
+		static uint64_t now();
+		// Virtual time since the start of the simulation (in ms), for the scripts
+		static uint64_t nowMs();
+		static void advance(uint64_t duration);
+		static void set(uint64_t time);
+
+		// Boot of the device: millis() and micros() restart from 0
+		static void boot();
+		static uint64_t getBootTime();
+
+	private:
+		static uint64_t _now;
+		static uint64_t _boot;
+
+};
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * FreeRTOS of the simulation.
+ * A task runs to completion when it is created, on its own virtual clock
+ * starting at its creation, after which the creating task resumes at its
+ * creation time: the tasks run concurrently in virtual time. The bits of an
+ * event group keep the virtual time at which they were set, so that waiting
+ * for them advances the waiting task to the end of the tasks it joins.
+ * The acquisition tasks mostly wait for their sensors, so the contention for
+ * the two cores and for the mutexes is not simulated.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "SimFreeRTOS.h"
+#include "SimClock.h"
+
+#define EVENT_BITS 24
+
+struct simSemaphore {
+	bool taken;
+};
+
+struct simEventGroup {
+	EventBits_t bits;
+	// Virtual time at which each bit was set
+	uint64_t times[EVENT_BITS];
+};
+
+static uint32_t tasks = 0;
+static uint32_t liveObjects = 0;
+
+uint32_t SimFreeRTOS::getTasks() {
+	return tasks;
+}
+
+uint32_t SimFreeRTOS::getLiveObjects() {
+	return liveObjects;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+	uint64_t creation = SimClock::now();
+	tasks++;
+	if (handle != NULL)
+		*handle = NULL;
+	task(parameters);
+	SimClock::set(creation);
+	return pdPASS;
+}
+
+/**
+ * The task returns right after deleting itself, which ends it in the simulation.
+ */
+void vTaskDelete(TaskHandle_t task) {}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+	liveObjects++;
+	SemaphoreHandle_t semaphore = new simSemaphore;
+	semaphore->taken = false;
+	return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+	if (semaphore->taken)
+		return pdFALSE;
+	semaphore->taken = true;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+	if (!semaphore->taken)
+		return pdFALSE;
+	semaphore->taken = false;
+	return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+	liveObjects--;
+	delete semaphore;
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+	liveObjects++;
+	EventGroupHandle_t group = new simEventGroup;
+	group->bits = 0;
+	return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+	for (uint8_t i = 0; i < EVENT_BITS; i++) {
+		if (bits & ((EventBits_t) 1 << i))
+			group->times[i] = SimClock::now();
+	}
+	group->bits |= bits;
+	return group->bits;
+}
+
+/**
+ * Waits for the bits, which were set by the tasks that already ran to completion:
+ * the waiting task resumes when the last (or first) of them was set.
+ * Bits that are not set would block forever on the device, the wait returns at once.
+ */
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clearOnExit, BaseType_t waitForAll, TickType_t ticks) {
+	EventBits_t set = group->bits & bits;
+	bool satisfied = waitForAll ? set == bits : set != 0;
+	if (satisfied) {
+		uint64_t resume = waitForAll ? 0 : UINT64_MAX;
+		for (uint8_t i = 0; i < EVENT_BITS; i++) {
+			if (!(set & ((EventBits_t) 1 << i)))
+				continue;
+			if (waitForAll ? group->times[i] > resume : group->times[i] < resume)
+				resume = group->times[i];
+		}
+		if (resume > SimClock::now())
+			SimClock::set(resume);
+	}
+	EventBits_t result = group->bits;
+	if (satisfied && clearOnExit)
+		group->bits &= ~bits;
+	return result;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+	liveObjects--;
+	delete group;
+}
@@ -0,0 +1,24 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Statistics of the FreeRTOS objects of the simulation.
+ */
+
+#ifndef SimFreeRTOSStats_h
+#define SimFreeRTOSStats_h
+
+#include <stdint.h>
+
+class SimFreeRTOS {
+
+	public:
+		// Number of tasks created since the start of the simulation
+		static uint32_t getTasks();
+		// Number of semaphores and event groups not deleted yet
+		static uint32_t getLiveObjects();
+
+};
+
+#endif
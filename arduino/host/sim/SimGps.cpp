@@ -0,0 +1,82 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Fake GPS module of the simulation.
+ */
+
+#include "SimGps.h"
+#include "SimClock.h"
+
+// Period of the NMEA sentences (in µs)
+#define GPS_PERIOD SIM_SECONDS(1)
+// Satellites used by the fix, and dilution of precision without a fix
+#define GPS_SATELLITES 8
+#define GPS_NO_FIX_HDOP 99.99
+
+SimGps::SimGps() {
+	_latitude = 50.6681;
+	_longitude = 4.6118;
+	_altitude = 150;
+	_timeToFix = 30000;
+	_hdop = 1.2;
+}
+
+void SimGps::setLocation(float latitude, float longitude, float altitude) {
+	_latitude = latitude;
+	_longitude = longitude;
+	_altitude = altitude;
+}
+
+void SimGps::setFix(uint32_t timeToFix, float hdop) {
+	_timeToFix = timeToFix;
+	_hdop = hdop;
+}
+
+/**
+ * Sends the sentences of the seconds elapsed in the interval.
+ */
+void SimGps::transmit(uint64_t from, uint64_t to, std::string& output) {
+	for (uint64_t time = (from / GPS_PERIOD + 1) * GPS_PERIOD; time <= to; time += GPS_PERIOD)
+		output += sentence(SimClock::now() - (to - time), time >= SIM_MS(_timeToFix));
+}
+
+/**
+ * Formats a coordinate in the NMEA format: degrees and decimal minutes, and hemisphere.
+ */
+static void formatCoordinate(char* buffer, size_t size, float value, uint8_t degreeDigits,
+                             char positive, char negative) {
+	float absolute = fabs(value);
+	int degrees = (int) absolute;
+	float minutes = (absolute - degrees) * 60;
+	snprintf(buffer, size, "%0*d%07.4f,%c", degreeDigits, degrees, minutes, value >= 0 ? positive : negative);
+}
+
+/**
+ * Builds the GGA sentence sent at a given time.
+ * @param time: virtual time of the simulation (in µs)
+ * @param fix: true if the module has a fix
+ * @return: the sentence, ending with CR LF
+ */
+std::string SimGps::sentence(uint64_t time, bool fix) {
+	uint64_t seconds = (time / SIM_SECONDS(1)) % 86400;
+	char body[128];
+	if (fix) {
+		char latitude[32], longitude[32];
+		formatCoordinate(latitude, sizeof(latitude), _latitude, 2, 'N', 'S');
+		formatCoordinate(longitude, sizeof(longitude), _longitude, 3, 'E', 'W');
+		snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,%s,%s,1,%02d,%.2f,%.1f,M,47.0,M,,",
+		         (int) (seconds / 3600), (int) (seconds / 60 % 60), (int) (seconds % 60),
+		         latitude, longitude, GPS_SATELLITES, _hdop, _altitude);
+	} else {
+		snprintf(body, sizeof(body), "GPGGA,%02d%02d%02d.00,,,,,0,00,%.2f,,,,,,",
+		         (int) (seconds / 3600), (int) (seconds / 60 % 60), (int) (seconds % 60), GPS_NO_FIX_HDOP);
+	}
+	uint8_t checksum = 0;
+	for (const char* c = body; *c; c++)
+		checksum ^= *c;
+	char sentence[144];
+	snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+	return sentence;
+}
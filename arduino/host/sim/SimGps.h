@@ -0,0 +1,39 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Fake GPS module of the simulation: one NMEA GGA sentence per second
+ * once the UART is started, without a fix until the scripted time to fix.
+ */
+
+#ifndef SimGps_h
+#define SimGps_h
+
+#include "HardwareSerial.h"
+
+class SimGps : public SimUartDevice {
+
+	public:
+		SimGps();
+
+		// Location of the fix (in degrees and m)
+		void setLocation(float latitude, float longitude, float altitude);
+		// Time from the start of the UART to the fix (in ms), and its horizontal dilution of precision
+		void setFix(uint32_t timeToFix, float hdop);
+
+		void transmit(uint64_t from, uint64_t to, std::string& output);
+
+		// NMEA sentence of the module, with its checksum
+		std::string sentence(uint64_t time, bool fix);
+
+	private:
+		float _latitude;
+		float _longitude;
+		float _altitude;
+		uint32_t _timeToFix;
+		float _hdop;
+
+};
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Hardware abstraction layer of the simulation, and GPIO and ESP32 core
+ * functions of the Arduino core.
+ */
+
+#include "Arduino.h"
+#include "SimHal.h"
+#include "SimClock.h"
+
+// Full scale of the 12-bit ADC of the ESP32
+#define ADC_MAX 4095
+// Default CPU frequency of the ESP32 (in MHz)
+#define CPU_FREQUENCY_MHZ 240
+
+sim_script_t SimHal::_analog[SIM_PINS];
+uint8_t SimHal::_levels[SIM_PINS];
+uint64_t SimHal::_levelSince[SIM_PINS];
+uint64_t SimHal::_timeHigh[SIM_PINS];
+uint64_t SimHal::_timeLow[SIM_PINS];
+uint32_t SimHal::_cpuFrequency = CPU_FREQUENCY_MHZ;
+
+/**
+ * Scripts the analog input of a pin.
+ * @param pin: GPIO pin
+ * @param script: raw value of the ADC (0 to 4095) as a function of the virtual time
+ */
+void SimHal::setAnalog(uint8_t pin, sim_script_t script) {
+	if (pin < SIM_PINS)
+		_analog[pin] = script;
+}
+
+/**
+ * Reads the scripted analog input of a pin.
+ * @param pin: GPIO pin
+ * @return: the raw value of the ADC, 0 if the pin is not scripted
+ */
+uint16_t SimHal::readAnalog(uint8_t pin) {
+	if (pin >= SIM_PINS || !_analog[pin])
+		return 0;
+	float value = _analog[pin](SimClock::nowMs());
+	if (value <= 0)
+		return 0;
+	if (value >= ADC_MAX)
+		return ADC_MAX;
+	return (uint16_t) (value + 0.5);
+}
+
+uint8_t SimHal::getLevel(uint8_t pin) {
+	return pin < SIM_PINS ? _levels[pin] : LOW;
+}
+
+/**
+ * Retrieves the total time spent by a pin at a level, since the start of the simulation.
+ * @param pin: GPIO pin
+ * @param level: HIGH or LOW
+ * @return: the total time (in µs)
+ */
+uint64_t SimHal::getTimeAtLevel(uint8_t pin, uint8_t level) {
+	if (pin >= SIM_PINS)
+		return 0;
+	uint64_t time = level == HIGH ? _timeHigh[pin] : _timeLow[pin];
+	if (_levels[pin] == level)
+		time += SimClock::now() - _levelSince[pin];
+	return time;
+}
+
+void SimHal::setLevel(uint8_t pin, uint8_t level) {
+	if (pin >= SIM_PINS)
+		return;
+	level = level == LOW ? LOW : HIGH;
+	if (level == _levels[pin])
+		return;
+	uint64_t duration = SimClock::now() - _levelSince[pin];
+	if (_levels[pin] == HIGH)
+		_timeHigh[pin] += duration;
+	else
+		_timeLow[pin] += duration;
+	_levels[pin] = level;
+	_levelSince[pin] = SimClock::now();
+}
+
+uint32_t SimHal::getCpuFrequency() {
+	return _cpuFrequency;
+}
+
+void SimHal::setCpuFrequency(uint32_t frequency) {
+	_cpuFrequency = frequency;
+}
+
+/**
+ * Resets the pins at boot: the outputs are floating, counted as HIGH
+ * (the Vext of the WiFi LoRa 32 board is off when its pin is high).
+ * The times at each level, and the analog scripts, are kept.
+ */
+void SimHal::reset() {
+	for (uint8_t pin = 0; pin < SIM_PINS; pin++)
+		setLevel(pin, HIGH);
+	_cpuFrequency = CPU_FREQUENCY_MHZ;
+}
+
+/**
+ * Script of a constant input.
+ * @param value: value of the input
+ * @return: the script
+ */
+sim_script_t SimHal::constant(float value) {
+	return [value](uint64_t time) { return value; };
+}
+
+// Arduino and ESP32 core
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	SimHal::setLevel(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+	return SimHal::getLevel(pin);
+}
+
+uint16_t analogRead(uint8_t pin) {
+	return SimHal::readAnalog(pin);
+}
+
+bool setCpuFrequencyMhz(uint32_t frequency) {
+	SimHal::setCpuFrequency(frequency);
+	return true;
+}
+
+uint32_t getCpuFrequencyMhz() {
+	return SimHal::getCpuFrequency();
+}
+
+bool btStop() {
+	return true;
+}
+
+void yield() {}
@@ -0,0 +1,54 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Hardware abstraction layer of the simulation: GPIO, scripted analog inputs,
+ * and the ESP32 core functions used by our libraries.
+ */
+
+#ifndef SimHal_h
+#define SimHal_h
+
+#include <stdint.h>
+#include <functional>
+
+// Number of GPIO pins of the ESP32
+#define SIM_PINS 40
+
+// Script of a simulated input: value as a function of the virtual time
+// since the start of the simulation (in ms)
+typedef std::function<float(uint64_t)> sim_script_t;
+
+class SimHal {
+
+	public:
+		// Scripted analog input of a pin, read by analogRead
+		static void setAnalog(uint8_t pin, sim_script_t script);
+		static uint16_t readAnalog(uint8_t pin);
+
+		// Digital output of a pin, and total time at the given level (in µs)
+		static uint8_t getLevel(uint8_t pin);
+		static uint64_t getTimeAtLevel(uint8_t pin, uint8_t level);
+		static void setLevel(uint8_t pin, uint8_t level);
+
+		static uint32_t getCpuFrequency();
+		static void setCpuFrequency(uint32_t frequency);
+
+		// Power-on reset of the pins
+		static void reset();
+
+		// Scripts
+		static sim_script_t constant(float value);
+
+	private:
+		static sim_script_t _analog[SIM_PINS];
+		static uint8_t _levels[SIM_PINS];
+		static uint64_t _levelSince[SIM_PINS];
+		static uint64_t _timeHigh[SIM_PINS];
+		static uint64_t _timeLow[SIM_PINS];
+		static uint32_t _cpuFrequency;
+
+};
+
+#endif
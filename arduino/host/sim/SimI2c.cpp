@@ -0,0 +1,114 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * I2C and SPI buses of the simulation.
+ */
+
+#include "Wire.h"
+#include "SPI.h"
+
+// Status of endTransmission: success, or NACK on the address
+#define I2C_SUCCESS      0
+#define I2C_NACK_ADDRESS 2
+
+TwoWire Wire(0);
+SPIClass SPI;
+
+TwoWire::TwoWire(uint8_t bus) {
+	_bus = bus;
+	_nDevices = 0;
+	_size = 0;
+	_index = 0;
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+	return true;
+}
+
+/**
+ * Attaches a fake device to the bus.
+ * @param address: I2C address of the device
+ * @param device: fake device, which must stay valid during the simulation
+ * @return: true if the device was attached, false if the bus is full
+ */
+bool TwoWire::attach(uint8_t address, SimI2cDevice* device) {
+	if (_nDevices >= SIM_I2C_DEVICES)
+		return false;
+	_addresses[_nDevices] = address;
+	_devices[_nDevices] = device;
+	_registers[_nDevices] = 0;
+	_nDevices++;
+	return true;
+}
+
+int8_t TwoWire::findDevice(uint8_t address) {
+	for (uint8_t i = 0; i < _nDevices; i++) {
+		if (_addresses[i] == address)
+			return i;
+	}
+	return -1;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+	_address = address;
+	_size = 0;
+}
+
+void TwoWire::beginTransmission(int address) {
+	beginTransmission((uint8_t) address);
+}
+
+size_t TwoWire::write(uint8_t data) {
+	if (_size >= SIM_I2C_BUFFER_SIZE)
+		return 0;
+	_buffer[_size++] = data;
+	return 1;
+}
+
+/**
+ * Sends the transmission to the device: the first byte is the register address,
+ * followed by (data, register address) pairs.
+ * @return: 0 on success, 2 if no device answers at the address
+ */
+uint8_t TwoWire::endTransmission(bool sendStop) {
+	int8_t device = findDevice(_address);
+	if (device < 0)
+		return I2C_NACK_ADDRESS;
+	if (_size > 0)
+		_registers[device] = _buffer[0];
+	for (uint8_t i = 1; i < _size; i += 2)
+		_devices[device]->writeRegister(_buffer[i - 1], _buffer[i]);
+	_size = 0;
+	return I2C_SUCCESS;
+}
+
+/**
+ * Reads successive registers of the device, from the last register address.
+ * @param address: I2C address of the device
+ * @param quantity: number of registers to read
+ * @return: the number of bytes read, 0 if no device answers at the address
+ */
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+	_size = 0;
+	_index = 0;
+	int8_t device = findDevice(address);
+	if (device < 0)
+		return 0;
+	for (uint8_t i = 0; i < quantity && _size < SIM_I2C_BUFFER_SIZE; i++)
+		_buffer[_size++] = _devices[device]->readRegister(_registers[device]++);
+	return _size;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity) {
+	return requestFrom((uint8_t) address, (uint8_t) quantity);
+}
+
+int TwoWire::available() {
+	return _size - _index;
+}
+
+int TwoWire::read() {
+	return _index < _size ? _buffer[_index++] : -1;
+}
@@ -0,0 +1,253 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Loopback LoRaWAN network of the simulation.
+ */
+
+#include "ESP32_LoRaWAN.h"
+#include "SimLoRaWAN.h"
+#include "SimClock.h"
+#include <math.h>
+#include <random>
+
+// Data rates of EU868: spreading factors (at 125 kHz) and maximum application payloads
+#define DATA_RATES 6
+static const uint8_t SPREADING_FACTORS[DATA_RATES] = {12, 11, 10, 9, 8, 7};
+static const uint8_t MAX_PAYLOADS[DATA_RATES] = {51, 51, 51, 115, 242, 242};
+#define BANDWIDTH 125000
+#define PREAMBLE_SYMBOLS 8
+// MAC overhead of a data frame: MHDR, FHDR without options, FPort and MIC
+#define FRAME_OVERHEAD 13
+// Join-request and join-accept (with the channel list of EU868) PHY payloads
+#define JOIN_REQUEST_SIZE 23
+#define JOIN_ACCEPT_SIZE  33
+// Receive windows: delays after the end of the transmission, data rate of RX2,
+// and length of a window without downlink (in symbols)
+#define JOIN_ACCEPT_DELAY1 SIM_SECONDS(5)
+#define RECEIVE_DELAY1     SIM_SECONDS(1)
+#define RECEIVE_DELAY2     SIM_SECONDS(2)
+// Acknowledgement of a confirmed uplink: PHY payload of an empty downlink with the ACK bit
+#define ACK_SIZE           12
+#define RX2_DATA_RATE      3
+#define RX_WINDOW_SYMBOLS  8
+#define DEFAULT_DATA_RATE  5
+
+bool SimLoRaWAN::_joined = false;
+uint8_t SimLoRaWAN::_dataRate = DEFAULT_DATA_RATE;
+sim_coverage_t SimLoRaWAN::_coverage;
+sim_adr_t SimLoRaWAN::_adr;
+std::vector<sim_uplink_t> SimLoRaWAN::_uplinks;
+uint32_t SimLoRaWAN::_joins = 0;
+uint64_t SimLoRaWAN::_airtime = 0;
+uint64_t SimLoRaWAN::_txEnd = 0;
+uint64_t SimLoRaWAN::_rxEnd = 0;
+bool SimLoRaWAN::_confirmPending = false;
+McpsConfirm_t SimLoRaWAN::_confirm;
+uint64_t SimLoRaWAN::_wakeupTime = 0;
+bool SimLoRaWAN::_sleeping = false;
+
+// Globals of the LoRaWAN library
+enum eDeviceState deviceState;
+uint32_t txDutyCycleTime;
+uint8_t appData[LORAWAN_APP_DATA_MAX_SIZE];
+uint8_t appDataSize;
+LoRaWanClass LoRaWAN;
+McuClass Mcu;
+SSD1306 Display;
+
+static RadioState_t getRadioStatus() {
+	return SimLoRaWAN::isTransmitting() ? RF_TX_RUNNING : RF_IDLE;
+}
+
+const struct Radio_s Radio = {getRadioStatus};
+
+/**
+ * Random number of the LoRaWAN library, deterministic in the simulation.
+ */
+int32_t randr(int32_t min, int32_t max) {
+	static std::minstd_rand generator(1);
+	return min + (int32_t) (generator() % (max - min + 1));
+}
+
+/**
+ * Uplink confirm handler of the LoRaWAN library, redefined by the device.
+ */
+void __attribute__((weak)) uplinkConfirmHandle(McpsConfirm_t* mcpsConfirm) {
+}
+
+LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t* txInfo) {
+	txInfo->MaxPossiblePayload = SimLoRaWAN::getMaxPayload(SimLoRaWAN::getDataRate());
+	txInfo->CurrentPayloadSize = size;
+	return size <= txInfo->MaxPossiblePayload ? LORAMAC_STATUS_OK : LORAMAC_STATUS_LENGTH_ERROR;
+}
+
+void LoRaWanClass::init(DeviceClass_t classMode, LoRaMacRegion_t region) {
+	deviceState = SimLoRaWAN::_joined ? DEVICE_STATE_SEND : DEVICE_STATE_JOIN;
+}
+
+void LoRaWanClass::join() {
+	SimLoRaWAN::join();
+	deviceState = DEVICE_STATE_SEND;
+}
+
+void LoRaWanClass::send(DeviceClass_t classMode) {
+	SimLoRaWAN::send(appPort, appData, appDataSize, isTxConfirmed);
+}
+
+void LoRaWanClass::cycle(uint32_t dutyCycle) {
+	SimLoRaWAN::cycle(dutyCycle);
+}
+
+void LoRaWanClass::sleep(DeviceClass_t classMode, uint8_t debugLevel) {
+	SimLoRaWAN::sleep();
+}
+
+void SimLoRaWAN::setDataRate(uint8_t dataRate) {
+	_dataRate = dataRate < DATA_RATES ? dataRate : DATA_RATES - 1;
+}
+
+uint8_t SimLoRaWAN::getDataRate() {
+	if (!_adr)
+		return _dataRate;
+	uint8_t dataRate = _adr(SimClock::nowMs());
+	return dataRate < DATA_RATES ? dataRate : DATA_RATES - 1;
+}
+
+void SimLoRaWAN::setAdr(sim_adr_t adr) {
+	_adr = adr;
+}
+
+void SimLoRaWAN::setCoverage(sim_coverage_t coverage) {
+	_coverage = coverage;
+}
+
+const std::vector<sim_uplink_t>& SimLoRaWAN::getUplinks() {
+	return _uplinks;
+}
+
+uint32_t SimLoRaWAN::getJoins() {
+	return _joins;
+}
+
+uint64_t SimLoRaWAN::getAirtime() {
+	return _airtime;
+}
+
+bool SimLoRaWAN::isSleeping() {
+	return _sleeping;
+}
+
+uint64_t SimLoRaWAN::getWakeupTime() {
+	return _wakeupTime;
+}
+
+bool SimLoRaWAN::isTransmitting() {
+	return SimClock::now() < _txEnd;
+}
+
+void SimLoRaWAN::wakeup() {
+	_sleeping = false;
+}
+
+uint8_t SimLoRaWAN::getMaxPayload(uint8_t dataRate) {
+	return MAX_PAYLOADS[dataRate];
+}
+
+uint32_t SimLoRaWAN::getAirtime(uint8_t dataRate, uint8_t size) {
+	return getPhyAirtime(dataRate, size + FRAME_OVERHEAD);
+}
+
+/**
+ * Time on air of a LoRa frame (Semtech AN1200.13), with an explicit header,
+ * a CRC, a 4/5 coding rate, and the low data rate optimization at SF11 and SF12.
+ * @param dataRate: data rate of the frame
+ * @param size: size of the PHY payload (in bytes)
+ * @return: the time on air (in µs)
+ */
+uint32_t SimLoRaWAN::getPhyAirtime(uint8_t dataRate, uint8_t size) {
+	uint8_t sf = SPREADING_FACTORS[dataRate];
+	uint8_t lowDataRate = sf >= 11 ? 1 : 0;
+	double symbol = (double) (1 << sf) / BANDWIDTH * 1e6;
+	double preamble = (PREAMBLE_SYMBOLS + 4.25) * symbol;
+	double symbols = ceil((8.0 * size - 4 * sf + 28 + 16) / (4 * (sf - 2 * lowDataRate))) * 5;
+	return (uint32_t) (preamble + (8 + (symbols > 0 ? symbols : 0)) * symbol);
+}
+
+/**
+ * Over-the-air activation, accepted in the first receive window.
+ */
+void SimLoRaWAN::join() {
+	uint8_t dataRate = getDataRate();
+	uint64_t request = getPhyAirtime(dataRate, JOIN_REQUEST_SIZE);
+	uint64_t accept = getPhyAirtime(dataRate, JOIN_ACCEPT_SIZE);
+	_airtime += request;
+	SimClock::advance(request + JOIN_ACCEPT_DELAY1 + accept);
+	_joins++;
+	_joined = true;
+}
+
+/**
+ * Records an uplink. A confirmed uplink received by the network is acknowledged in the RX1 window.
+ * Otherwise, the receive windows end after the RX2 window, without a downlink.
+ */
+void SimLoRaWAN::send(uint8_t port, const uint8_t* payload, uint8_t size, bool confirmed) {
+	uint8_t dataRate = getDataRate();
+	if (!_joined || size > getMaxPayload(dataRate))
+		return;
+	sim_uplink_t uplink;
+	uplink.time = SimClock::now();
+	uplink.port = port;
+	uplink.dataRate = dataRate;
+	uplink.airtime = getAirtime(dataRate, size);
+	uplink.confirmed = confirmed;
+	uplink.delivered = !_coverage || _coverage(SimClock::nowMs());
+	uplink.payload.assign(payload, payload + size);
+	_uplinks.push_back(uplink);
+	_airtime += uplink.airtime;
+	_txEnd = uplink.time + uplink.airtime;
+	if (confirmed && uplink.delivered) {
+		_rxEnd = _txEnd + RECEIVE_DELAY1 + getPhyAirtime(dataRate, ACK_SIZE);
+	} else {
+		double symbol = (double) (1 << SPREADING_FACTORS[RX2_DATA_RATE]) / BANDWIDTH * 1e6;
+		_rxEnd = _txEnd + RECEIVE_DELAY2 + (uint64_t) (RX_WINDOW_SYMBOLS * symbol);
+	}
+	_confirm.McpsRequest = confirmed ? MCPS_CONFIRMED : MCPS_UNCONFIRMED;
+	_confirm.Status = !confirmed || uplink.delivered ? LORAMAC_EVENT_INFO_STATUS_OK : LORAMAC_EVENT_INFO_STATUS_ERROR;
+	_confirm.Datarate = dataRate;
+	_confirm.AckReceived = confirmed && uplink.delivered;
+	_confirm.NbRetries = 1;
+	_confirmPending = true;
+}
+
+/**
+ * Starts the timer of the next wake-up.
+ */
+void SimLoRaWAN::cycle(uint32_t dutyCycle) {
+	_wakeupTime = SimClock::now() + SIM_MS(dutyCycle);
+}
+
+/**
+ * Waits for the end of the transmission, then of the receive windows,
+ * and confirms the uplink to the device,
+ * then goes to deep sleep until the timer of the next wake-up.
+ * @return: true if the device goes to deep sleep
+ */
+bool SimLoRaWAN::sleep() {
+	uint64_t now = SimClock::now();
+	if (now < _txEnd) {
+		SimClock::set(_txEnd);
+		return false;
+	}
+	if (now < _rxEnd) {
+		SimClock::set(_rxEnd);
+		return false;
+	}
+	if (_confirmPending) {
+		_confirmPending = false;
+		uplinkConfirmHandle(&_confirm);
+	}
+	_sleeping = true;
+	return true;
+}
@@ -0,0 +1,99 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Loopback LoRaWAN network of the simulation (EU868, class A):
+ * the join and the uplinks take their time on air and their receive windows
+ * on the virtual clock, and the uplinks are recorded instead of being sent.
+ * A scripted coverage makes the gateways unreachable during outages,
+ * and a scripted ADR changes the data rate of the uplinks.
+ * The only downlinks of the network are the acknowledgements of the confirmed uplinks.
+ */
+
+#ifndef SimLoRaWAN_h
+#define SimLoRaWAN_h
+
+#include <stdint.h>
+#include <functional>
+#include "ESP32_LoRaWAN.h"
+#include <vector>
+
+// Script of the coverage of the network: true if the gateways receive the uplinks,
+// as a function of the virtual time since the start of the simulation (in ms)
+typedef std::function<bool(uint64_t)> sim_coverage_t;
+// Script of the ADR of the network: data rate of the uplinks (0 to 5),
+// as a function of the virtual time since the start of the simulation (in ms)
+typedef std::function<uint8_t(uint64_t)> sim_adr_t;
+
+// Uplink recorded by the network
+typedef struct simUplink {
+	// Start of the transmission (virtual time, in µs)
+	uint64_t time;
+	uint8_t port;
+	uint8_t dataRate;
+	// Time on air (in µs)
+	uint32_t airtime;
+	// Confirmed uplink, and uplink received by the network (and acknowledged if confirmed)
+	bool confirmed;
+	bool delivered;
+	std::vector<uint8_t> payload;
+} sim_uplink_t;
+
+class SimLoRaWAN {
+
+	public:
+		// Data rate of the uplinks (0 to 5), as set by the ADR of the network
+		static void setDataRate(uint8_t dataRate);
+		static uint8_t getDataRate();
+		// Data rate changed over time by the ADR, instead of the fixed data rate
+		static void setAdr(sim_adr_t adr);
+		// Coverage of the network, always up without script
+		static void setCoverage(sim_coverage_t coverage);
+
+		static const std::vector<sim_uplink_t>& getUplinks();
+		static uint32_t getJoins();
+		// Total time on air of the device (in µs)
+		static uint64_t getAirtime();
+
+		// Deep sleep requested by the device, and its wake-up time (virtual time, in µs)
+		static bool isSleeping();
+		static uint64_t getWakeupTime();
+		// True while the radio transmits the last uplink
+		static bool isTransmitting();
+		// Called by the simulation when the device wakes up
+		static void wakeup();
+
+		// Maximum application payload of a data rate (in bytes)
+		static uint8_t getMaxPayload(uint8_t dataRate);
+		// Time on air of a frame with an application payload of the given size (in µs)
+		static uint32_t getAirtime(uint8_t dataRate, uint8_t size);
+		// Time on air of a PHY payload of the given size (in µs)
+		static uint32_t getPhyAirtime(uint8_t dataRate, uint8_t size);
+
+	private:
+		friend class LoRaWanClass;
+		static void join();
+		static void send(uint8_t port, const uint8_t* payload, uint8_t size, bool confirmed);
+		static void cycle(uint32_t dutyCycle);
+		static bool sleep();
+
+		static bool _joined;
+		static uint8_t _dataRate;
+		static sim_coverage_t _coverage;
+		static sim_adr_t _adr;
+		static std::vector<sim_uplink_t> _uplinks;
+		static uint32_t _joins;
+		static uint64_t _airtime;
+		// End of the transmission and of the receive windows of the last uplink
+		static uint64_t _txEnd;
+		static uint64_t _rxEnd;
+		// Confirmation of the last uplink, given to the device at the end of its receive windows
+		static bool _confirmPending;
+		static McpsConfirm_t _confirm;
+		static uint64_t _wakeupTime;
+		static bool _sleeping;
+
+};
+
+#endif
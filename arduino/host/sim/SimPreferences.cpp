@@ -0,0 +1,91 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * NVS flash of the simulation.
+ */
+
+#include "Preferences.h"
+#include <string.h>
+#include <map>
+#include <vector>
+
+// Maximum length of a namespace or of a key of the NVS
+#define NVS_KEY_MAX_LENGTH 15
+
+// Blobs of the NVS flash, by namespace and key
+static std::map<std::string, std::vector<uint8_t>> flash;
+
+Preferences::Preferences() {
+	_started = false;
+	_readOnly = false;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+	if (strlen(name) > NVS_KEY_MAX_LENGTH)
+		return false;
+	_name = name;
+	_started = true;
+	_readOnly = readOnly;
+	return true;
+}
+
+void Preferences::end() {
+	_started = false;
+}
+
+std::string Preferences::getPath(const char* key) {
+	return _name + "/" + key;
+}
+
+bool Preferences::clear() {
+	if (!_started || _readOnly)
+		return false;
+	std::string prefix = _name + "/";
+	for (auto it = flash.begin(); it != flash.end();) {
+		if (it->first.compare(0, prefix.size(), prefix) == 0)
+			it = flash.erase(it);
+		else
+			++it;
+	}
+	return true;
+}
+
+bool Preferences::remove(const char* key) {
+	if (!_started || _readOnly)
+		return false;
+	return flash.erase(getPath(key)) > 0;
+}
+
+size_t Preferences::putUShort(const char* key, uint16_t value) {
+	return putBytes(key, &value, sizeof(value));
+}
+
+uint16_t Preferences::getUShort(const char* key, uint16_t defaultValue) {
+	uint16_t value;
+	return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+	if (!_started || _readOnly || strlen(key) > NVS_KEY_MAX_LENGTH)
+		return 0;
+	const uint8_t* bytes = (const uint8_t*) value;
+	flash[getPath(key)].assign(bytes, bytes + length);
+	return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+	if (!_started)
+		return 0;
+	auto it = flash.find(getPath(key));
+	return it != flash.end() ? it->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+	size_t length = getBytesLength(key);
+	if (length == 0 || length > maxLength)
+		return 0;
+	memcpy(buffer, flash[getPath(key)].data(), length);
+	return length;
+}
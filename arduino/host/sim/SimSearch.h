@@ -0,0 +1,43 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Search of the raw measurement of a fake sensor whose compensated value
+ * is the closest to the scripted value.
+ */
+
+#ifndef SimSearch_h
+#define SimSearch_h
+
+#include <stdint.h>
+#include <math.h>
+
+class SimSearch {
+
+	public:
+		/**
+		 * Binary search of a non-decreasing function.
+		 * @param low: lowest raw measurement
+		 * @param high: highest raw measurement
+		 * @param target: compensated value to reach
+		 * @param value: compensated value of a raw measurement
+		 * @return: the raw measurement whose compensated value is the closest to the target
+		 */
+		template <typename Function>
+		static int32_t increasing(int32_t low, int32_t high, double target, Function value) {
+			while (low < high) {
+				int32_t middle = low + (high - low) / 2;
+				if (value(middle) < target)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+			if (low > 0 && fabs(value(low - 1) - target) <= fabs(value(low) - target))
+				return low - 1;
+			return low;
+		}
+
+};
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * UARTs of the simulation.
+ */
+
+#include "HardwareSerial.h"
+#include "SimClock.h"
+
+SimUartDevice* HardwareSerial::_devices[SIM_UARTS] = {NULL};
+
+HardwareSerial::HardwareSerial(int uart) {
+	_uart = uart;
+	_started = false;
+	_begin = 0;
+	_polled = 0;
+	_index = 0;
+}
+
+void HardwareSerial::attach(uint8_t uart, SimUartDevice* device) {
+	if (uart < SIM_UARTS)
+		_devices[uart] = device;
+}
+
+/**
+ * Starts the UART, and the device attached to it.
+ */
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rx, int8_t tx) {
+	_started = true;
+	_begin = SimClock::now();
+	_polled = _begin;
+	_received.clear();
+	_index = 0;
+	if (_uart < SIM_UARTS && _devices[_uart] != NULL)
+		_devices[_uart]->begin();
+}
+
+void HardwareSerial::end() {
+	_started = false;
+	_received.clear();
+	_index = 0;
+}
+
+/**
+ * Receives the bytes sent by the device since the last poll.
+ */
+void HardwareSerial::receive() {
+	uint64_t now = SimClock::now();
+	if (!_started || _uart >= SIM_UARTS || _devices[_uart] == NULL || now <= _polled)
+		return;
+	_devices[_uart]->transmit(_polled - _begin, now - _begin, _received);
+	_polled = now;
+}
+
+int HardwareSerial::available() {
+	receive();
+	return _received.size() - _index;
+}
+
+int HardwareSerial::read() {
+	receive();
+	if (_index >= _received.size())
+		return -1;
+	return (uint8_t) _received[_index++];
+}
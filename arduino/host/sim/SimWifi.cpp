@@ -0,0 +1,370 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Wi-Fi of the simulation.
+ */
+
+#include "WiFi.h"
+#include "HTTPClient.h"
+#include "WifiLocation.h"
+#include "SimWifi.h"
+#include "SimClock.h"
+#include "SimHal.h"
+
+#include <stdio.h>
+
+#define HTTP_CODE_NO_CONTENT 204
+
+// DHCP lease of the access point
+#define SIM_LEASE_IP      IPAddress(192, 168, 1, 100)
+#define SIM_LEASE_GATEWAY IPAddress(192, 168, 1, 1)
+#define SIM_LEASE_SUBNET  IPAddress(255, 255, 255, 0)
+
+bool SimWifi::_available = true;
+uint32_t SimWifi::_connectTime = 1500;
+sim_channel_t SimWifi::_channel;
+sim_scan_t SimWifi::_scan;
+uint32_t SimWifi::_scans = 0;
+uint32_t SimWifi::_scannedChannels = 0;
+std::vector<sim_access_point_t> SimWifi::_scanResults;
+int16_t SimWifi::_scanCount = -2;
+uint32_t SimWifi::_reconnectTime = 300;
+uint32_t SimWifi::_dhcpTime = 500;
+float SimWifi::_latitude = 50.6681;
+float SimWifi::_longitude = 4.6118;
+int SimWifi::_accuracy = 40;
+uint32_t SimWifi::_requestTime = 300;
+uint32_t SimWifi::_handshakeTime = 500;
+uint64_t SimWifi::_handshakes = 0;
+std::vector<sim_post_t> SimWifi::_posts;
+uint32_t SimWifi::_connections = 0;
+uint32_t SimWifi::_reconnections = 0;
+uint32_t SimWifi::_staticConnections = 0;
+uint32_t SimWifi::_locations = 0;
+std::string SimWifi::_locationBody;
+bool SimWifi::_started = false;
+uint64_t SimWifi::_begin = 0;
+bool SimWifi::_found = false;
+uint32_t SimWifi::_beginTime = 0;
+uint32_t SimWifi::_ip = 0;
+uint32_t SimWifi::_gateway = 0;
+uint32_t SimWifi::_subnet = 0;
+uint32_t SimWifi::_dns = 0;
+
+static uint8_t simBssid[] = SIM_BSSID;
+
+WiFiClass WiFi;
+
+void SimWifi::setAccessPoint(bool available, uint32_t connectTime) {
+	_available = available;
+	_connectTime = connectTime;
+}
+
+void SimWifi::setChannel(sim_channel_t channel) {
+	_channel = channel;
+}
+
+void SimWifi::setScan(sim_scan_t scan) {
+	_scan = scan;
+}
+
+/**
+ * Access points in range: the access point of the station, and its neighbours.
+ */
+std::vector<sim_access_point_t> SimWifi::getAccessPoints() {
+	if (_scan)
+		return _scan(SimClock::nowMs());
+	std::vector<sim_access_point_t> accessPoints;
+	sim_access_point_t accessPoint = {SIM_BSSID, -55, getChannel()};
+	if (_available)
+		accessPoints.push_back(accessPoint);
+	// Neighbours on the channels 1, 6 and 11
+	for (uint8_t i = 1; i <= 5; i++) {
+		sim_access_point_t neighbour = {{0x60, 0x38, 0xe0, 0x11, 0x22, i}, -60 - 6 * i, i % 3 * 5 + 1};
+		accessPoints.push_back(neighbour);
+	}
+	return accessPoints;
+}
+
+uint32_t SimWifi::getScans() {
+	return _scans;
+}
+
+uint32_t SimWifi::getScannedChannels() {
+	return _scannedChannels;
+}
+
+const std::string& SimWifi::getLocationBody() {
+	return _locationBody;
+}
+
+void SimWifi::setReconnectTime(uint32_t reconnectTime) {
+	_reconnectTime = reconnectTime;
+}
+
+void SimWifi::setDhcpTime(uint32_t dhcpTime) {
+	_dhcpTime = dhcpTime;
+}
+
+void SimWifi::setLocation(float latitude, float longitude, int accuracy) {
+	_latitude = latitude;
+	_longitude = longitude;
+	_accuracy = accuracy;
+}
+
+void SimWifi::setRequestTime(uint32_t requestTime) {
+	_requestTime = requestTime;
+}
+
+void SimWifi::setHandshakeTime(uint32_t handshakeTime) {
+	_handshakeTime = handshakeTime;
+}
+
+uint64_t SimWifi::getHandshakeTime() {
+	return _handshakes;
+}
+
+/**
+ * HTTPS request: the TLS handshake, at the CPU frequency, and the round trip time.
+ */
+void SimWifi::request() {
+	uint64_t handshake = SIM_MS(_handshakeTime) * 80 / SimHal::getCpuFrequency();
+	_handshakes += handshake;
+	SimClock::advance(handshake + SIM_MS(_requestTime));
+}
+
+const std::vector<sim_post_t>& SimWifi::getPosts() {
+	return _posts;
+}
+
+uint32_t SimWifi::getConnections() {
+	return _connections;
+}
+
+uint32_t SimWifi::getReconnections() {
+	return _reconnections;
+}
+
+uint32_t SimWifi::getStaticConnections() {
+	return _staticConnections;
+}
+
+uint32_t SimWifi::getLocations() {
+	return _locations;
+}
+
+int32_t SimWifi::getChannel() {
+	return _channel ? _channel(SimClock::nowMs()) : SIM_CHANNEL;
+}
+
+IPAddress::IPAddress() {
+	memset(_bytes, 0, sizeof(_bytes));
+}
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) {
+	_bytes[0] = first;
+	_bytes[1] = second;
+	_bytes[2] = third;
+	_bytes[3] = fourth;
+}
+
+IPAddress::IPAddress(uint32_t address) {
+	for (uint8_t i = 0; i < 4; i++)
+		_bytes[i] = address >> (8 * i);
+}
+
+bool IPAddress::fromString(const char* address) {
+	unsigned int bytes[4];
+	char end;
+	if (sscanf(address, "%u.%u.%u.%u%c", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &end) != 4)
+		return false;
+	for (uint8_t i = 0; i < 4; i++) {
+		if (bytes[i] > 255)
+			return false;
+		_bytes[i] = bytes[i];
+	}
+	return true;
+}
+
+IPAddress::operator uint32_t() const {
+	return (uint32_t) _bytes[0] | ((uint32_t) _bytes[1] << 8) |
+	       ((uint32_t) _bytes[2] << 16) | ((uint32_t) _bytes[3] << 24);
+}
+
+uint8_t IPAddress::operator[](int index) const {
+	return _bytes[index];
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+	if (mode == WIFI_OFF)
+		SimWifi::_started = false;
+	return true;
+}
+
+/**
+ * Starts the connection to the access point, established after its connection time:
+ * the scan, or the association on the given channel, then DHCP without static IP.
+ * With the channel and the BSSID of the access point, it is not found if it moved.
+ */
+wl_status_t WiFiClass::begin(const char* ssid, const char* password, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+	SimWifi::_started = true;
+	SimWifi::_begin = SimClock::now();
+	bool direct = channel != 0 && bssid != NULL;
+	SimWifi::_found = SimWifi::_available && (!direct ||
+		(channel == SimWifi::getChannel() && memcmp(bssid, simBssid, sizeof(simBssid)) == 0));
+	SimWifi::_beginTime = direct ? SimWifi::_reconnectTime : SimWifi::_connectTime;
+	if (SimWifi::_found) {
+		SimWifi::_connections++;
+		if (direct)
+			SimWifi::_reconnections++;
+		if (SimWifi::_ip == 0)
+			SimWifi::_beginTime += SimWifi::_dhcpTime;
+		else
+			SimWifi::_staticConnections++;
+	}
+	return WL_DISCONNECTED;
+}
+
+/**
+ * Sets the IP configuration of the station, DHCP with a null address.
+ */
+bool WiFiClass::config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns) {
+	SimWifi::_ip = localIP;
+	SimWifi::_gateway = gateway;
+	SimWifi::_subnet = subnet;
+	SimWifi::_dns = dns;
+	return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff) {
+	SimWifi::_started = false;
+	return true;
+}
+
+wl_status_t WiFiClass::status() {
+	if (!SimWifi::_started)
+		return WL_IDLE_STATUS;
+	if (SimClock::now() < SimWifi::_begin + SIM_MS(SimWifi::_beginTime))
+		return WL_DISCONNECTED;
+	if (!SimWifi::_found)
+		return WL_NO_SSID_AVAIL;
+	return WL_CONNECTED;
+}
+
+uint8_t* WiFiClass::BSSID() {
+	return status() == WL_CONNECTED ? simBssid : NULL;
+}
+
+int32_t WiFiClass::channel() {
+	return SimWifi::getChannel();
+}
+
+/**
+ * Scans the access points in range, on one channel or on all of them,
+ * which takes the time of the scan of each channel.
+ */
+int16_t WiFiClass::scanNetworks(bool async, bool showHidden, bool passive, uint32_t maxMsPerChannel, uint8_t channel) {
+	uint8_t channels = channel == 0 ? SIM_SCAN_CHANNELS : 1;
+	SimClock::advance(SIM_MS(channels * maxMsPerChannel));
+	SimWifi::_scans++;
+	SimWifi::_scannedChannels += channels;
+	SimWifi::_scanResults.clear();
+	if (!passive || maxMsPerChannel >= SIM_BEACON_MS) {
+		for (const sim_access_point_t& accessPoint : SimWifi::getAccessPoints()) {
+			if (channel == 0 || accessPoint.channel == channel)
+				SimWifi::_scanResults.push_back(accessPoint);
+		}
+	}
+	SimWifi::_scanCount = SimWifi::_scanResults.size();
+	return SimWifi::_scanCount;
+}
+
+int16_t WiFiClass::scanComplete() {
+	return SimWifi::_scanCount;
+}
+
+void WiFiClass::scanDelete() {
+	SimWifi::_scanResults.clear();
+	SimWifi::_scanCount = -2;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t index) {
+	return index < SimWifi::_scanResults.size() ? SimWifi::_scanResults[index].bssid : NULL;
+}
+
+int32_t WiFiClass::RSSI(uint8_t index) {
+	return index < SimWifi::_scanResults.size() ? SimWifi::_scanResults[index].rssi : 0;
+}
+
+int32_t WiFiClass::channel(uint8_t index) {
+	return index < SimWifi::_scanResults.size() ? SimWifi::_scanResults[index].channel : 0;
+}
+
+IPAddress WiFiClass::localIP() {
+	return SimWifi::_ip != 0 ? IPAddress(SimWifi::_ip) : SIM_LEASE_IP;
+}
+
+IPAddress WiFiClass::gatewayIP() {
+	return SimWifi::_ip != 0 ? IPAddress(SimWifi::_gateway) : SIM_LEASE_GATEWAY;
+}
+
+IPAddress WiFiClass::subnetMask() {
+	return SimWifi::_ip != 0 ? IPAddress(SimWifi::_subnet) : SIM_LEASE_SUBNET;
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t index) {
+	return SimWifi::_ip != 0 ? IPAddress(SimWifi::_dns) : SIM_LEASE_GATEWAY;
+}
+
+bool HTTPClient::begin(String url, const char* certificate) {
+	_url = url;
+	_headers.clear();
+	return true;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+	_headers[name.c_str()] = value.c_str();
+}
+
+/**
+ * Records a post, which takes the time of a request.
+ * @return: the HTTP response code
+ */
+int HTTPClient::POST(String payload) {
+	return POST((uint8_t*) payload.c_str(), payload.length());
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t size) {
+	if (WiFi.status() != WL_CONNECTED)
+		return HTTPC_ERROR_CONNECTION_REFUSED;
+	SimWifi::request();
+	sim_post_t post;
+	post.time = SimClock::now();
+	post.url = _url.c_str();
+	post.headers = _headers;
+	post.body.assign((const char*) payload, size);
+	SimWifi::_posts.push_back(post);
+	return HTTP_CODE_NO_CONTENT;
+}
+
+void HTTPClient::end() {
+}
+
+/**
+ * Geolocation of the access points, which takes the time of a request.
+ */
+location_t WifiLocation::getGeoFromWiFi(const char* body, size_t size) {
+	location_t location;
+	if (WiFi.status() != WL_CONNECTED)
+		return location;
+	SimWifi::request();
+	SimWifi::_locations++;
+	SimWifi::_locationBody.assign(body, size);
+	location.lat = SimWifi::_latitude;
+	location.lon = SimWifi::_longitude;
+	location.accuracy = SimWifi::_accuracy;
+	return location;
+}
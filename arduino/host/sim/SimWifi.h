@@ -0,0 +1,131 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Wi-Fi access point and servers of the simulation: the connections and the requests
+ * take their scripted time on the virtual clock, and the posts are recorded.
+ * The station reconnecting with the channel and the BSSID of the access point skips the scan,
+ * and the one with a static IP configuration skips DHCP.
+ */
+
+#ifndef SimWifi_h
+#define SimWifi_h
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// BSSID of the access point
+#define SIM_BSSID {0x24, 0x0a, 0xc4, 0x5e, 0x1c, 0x70}
+// Channel of the access point, without script
+#define SIM_CHANNEL 6
+// Channels of the scans, and beacon interval of the access points (in ms):
+// a passive scan shorter than the beacon interval misses the access points
+#define SIM_SCAN_CHANNELS 13
+#define SIM_BEACON_MS 103
+
+// Script of the channel of the access point, from the virtual time (in ms)
+typedef std::function<int32_t(uint64_t)> sim_channel_t;
+
+// Access point found by a scan
+typedef struct simAccessPoint {
+	uint8_t bssid[6];
+	int32_t rssi;
+	int32_t channel;
+} sim_access_point_t;
+// Script of the access points in range, from the virtual time (in ms)
+typedef std::function<std::vector<sim_access_point_t>(uint64_t)> sim_scan_t;
+
+// HTTP post recorded by the server
+typedef struct simPost {
+	// Virtual time of the request (in µs)
+	uint64_t time;
+	std::string url;
+	// Headers of the request, by name
+	std::map<std::string, std::string> headers;
+	std::string body;
+} sim_post_t;
+
+class SimWifi {
+
+	public:
+		// Access point: in range or not, and time to scan for it and to associate (in ms)
+		static void setAccessPoint(bool available, uint32_t connectTime);
+		// Channel of the access point, SIM_CHANNEL without script
+		static void setChannel(sim_channel_t channel);
+		// Access points in range, the access point and its neighbours without script
+		static void setScan(sim_scan_t scan);
+		static std::vector<sim_access_point_t> getAccessPoints();
+		// Time to associate with the access point without scan, and time of DHCP (in ms)
+		static void setReconnectTime(uint32_t reconnectTime);
+		static void setDhcpTime(uint32_t dhcpTime);
+		// Geolocation of the access points (in degrees), and its accuracy (in m)
+		static void setLocation(float latitude, float longitude, int accuracy);
+		// Round trip time of the HTTPS requests, without the CPU time of the handshake (in ms)
+		static void setRequestTime(uint32_t requestTime);
+		// CPU time of the TLS handshake at 80 MHz, shorter at higher frequencies (in ms)
+		static void setHandshakeTime(uint32_t handshakeTime);
+
+		static const std::vector<sim_post_t>& getPosts();
+		static uint32_t getConnections();
+		// Connections without scan, and without DHCP
+		static uint32_t getReconnections();
+		static uint32_t getStaticConnections();
+		static uint32_t getLocations();
+		static uint32_t getScans();
+		// Channels scanned by all the scans
+		static uint32_t getScannedChannels();
+		// Request body of the last geolocation
+		static const std::string& getLocationBody();
+		// Total time of the TLS handshakes (in µs)
+		static uint64_t getHandshakeTime();
+
+	private:
+		friend class WiFiClass;
+		friend class HTTPClient;
+		friend class WifiLocation;
+
+		static bool _available;
+		static uint32_t _connectTime;
+		static sim_channel_t _channel;
+		static sim_scan_t _scan;
+		static uint32_t _scans;
+		static uint32_t _scannedChannels;
+		// Results of the last scan, -2 without results
+		static std::vector<sim_access_point_t> _scanResults;
+		static int16_t _scanCount;
+		static uint32_t _reconnectTime;
+		static uint32_t _dhcpTime;
+		static float _latitude;
+		static float _longitude;
+		static int _accuracy;
+		static uint32_t _requestTime;
+		static uint32_t _handshakeTime;
+		static uint64_t _handshakes;
+		static std::vector<sim_post_t> _posts;
+		static uint32_t _connections;
+		static uint32_t _reconnections;
+		static uint32_t _staticConnections;
+		static uint32_t _locations;
+		static std::string _locationBody;
+		// Station: started or not, start of the connection (virtual time, in µs),
+		// access point found or not, and time to connect to it (in ms)
+		static bool _started;
+		static uint64_t _begin;
+		static bool _found;
+		static uint32_t _beginTime;
+		// IP configuration of the station, DHCP with a null address
+		static uint32_t _ip;
+		static uint32_t _gateway;
+		static uint32_t _subnet;
+		static uint32_t _dns;
+
+		static int32_t getChannel();
+		static void request();
+
+};
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Simulation of an ESP32 device on the host.
+ */
+
+#include "Simulation.h"
+
+Simulation::Simulation(sim_factory_t factory) {
+	_factory = factory;
+	_wakeups = 0;
+	_awakeTime = 0;
+	_maxAwakeTime = 0;
+}
+
+bool Simulation::run(uint64_t duration) {
+	uint64_t end = SimClock::now() + duration;
+	while (SimClock::now() < end) {
+		if (!wakeup())
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Runs a wake cycle, from the boot to the wake-up timer of the deep sleep.
+ * @return: false if the device did not go to deep sleep
+ */
+bool Simulation::wakeup() {
+	uint64_t boot = SimClock::now();
+	SimClock::boot();
+	SimHal::reset();
+	SimLoRaWAN::wakeup();
+	SimSketch* sketch = _factory();
+	sketch->setup();
+	for (uint16_t i = 0; i < SIM_MAX_LOOPS && !SimLoRaWAN::isSleeping(); i++)
+		sketch->loop();
+	delete sketch;
+	if (!SimLoRaWAN::isSleeping())
+		return false;
+	uint64_t awake = SimClock::now() - boot;
+	_wakeups++;
+	_awakeTime += awake;
+	if (awake > _maxAwakeTime)
+		_maxAwakeTime = awake;
+	// The wake-up timer started before the end of the receive windows may have expired already
+	if (SimLoRaWAN::getWakeupTime() > SimClock::now())
+		SimClock::set(SimLoRaWAN::getWakeupTime());
+	return true;
+}
+
+uint32_t Simulation::getWakeups() {
+	return _wakeups;
+}
+
+uint64_t Simulation::getAwakeTime() {
+	return _awakeTime;
+}
+
+uint64_t Simulation::getMeanAwakeTime() {
+	return _wakeups > 0 ? _awakeTime / _wakeups : 0;
+}
+
+uint64_t Simulation::getMaxAwakeTime() {
+	return _maxAwakeTime;
+}
+
+uint32_t Simulation::getUplinks(uint8_t port) {
+	uint32_t uplinks = 0;
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		if (uplink.port == port)
+			uplinks++;
+	}
+	return uplinks;
+}
@@ -0,0 +1,69 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Simulation of an ESP32 device on the host: the sketch is built again at each boot,
+ * like the device loses everything but its RTC memory in deep sleep,
+ * then runs its setup and loop until it goes to deep sleep.
+ * The RTC memory of the device is the global state of the process,
+ * so each simulated device must run in a new process (see test/SimulationTest.cpp).
+ */
+
+#ifndef Simulation_h
+#define Simulation_h
+
+#include <stdint.h>
+#include <functional>
+#include "SimClock.h"
+#include "SimHal.h"
+#include "SimLoRaWAN.h"
+#include "SimWifi.h"
+
+// Maximum number of calls to the loop of the sketch in a wake cycle
+#define SIM_MAX_LOOPS 1000
+
+/* Arduino sketch of a simulated device */
+class SimSketch {
+
+	public:
+		virtual ~SimSketch() {}
+		virtual void setup() = 0;
+		virtual void loop() = 0;
+
+};
+
+// Builds the sketch of the device, at each boot
+typedef std::function<SimSketch*()> sim_factory_t;
+
+class Simulation {
+
+	public:
+		Simulation(sim_factory_t factory);
+
+		/**
+		 * Runs the wake cycles of the device for a duration of virtual time.
+		 * @param duration: duration (in µs)
+		 * @return: false if the device did not go to deep sleep in a wake cycle
+		 */
+		bool run(uint64_t duration);
+
+		uint32_t getWakeups();
+		// Time awake, from the boot to the deep sleep (in µs)
+		uint64_t getAwakeTime();
+		uint64_t getMeanAwakeTime();
+		uint64_t getMaxAwakeTime();
+		// Number of uplinks on a LoRaWAN port
+		uint32_t getUplinks(uint8_t port);
+
+	private:
+		sim_factory_t _factory;
+		uint32_t _wakeups;
+		uint64_t _awakeTime;
+		uint64_t _maxAwakeTime;
+
+		bool wakeup();
+
+};
+
+#endif
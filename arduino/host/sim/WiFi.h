@@ -0,0 +1,60 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Wi-Fi station of the simulation, connecting to the access point of SimWifi (SimWifi.h),
+ * either after a scan, or directly with its channel and its BSSID.
+ */
+
+#ifndef SimWiFi_h
+#define SimWiFi_h
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum {
+	WIFI_OFF,
+	WIFI_STA,
+	WIFI_AP,
+	WIFI_AP_STA,
+} wifi_mode_t;
+
+typedef enum {
+	WL_IDLE_STATUS = 0,
+	WL_NO_SSID_AVAIL = 1,
+	WL_CONNECTED = 3,
+	WL_CONNECT_FAILED = 4,
+	WL_DISCONNECTED = 6,
+} wl_status_t;
+
+class WiFiClass {
+
+	public:
+		bool mode(wifi_mode_t mode);
+		wl_status_t begin(const char* ssid, const char* password = NULL, int32_t channel = 0,
+		                  const uint8_t* bssid = NULL, bool connect = true);
+		bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns = IPAddress());
+		bool disconnect(bool wifiOff = false);
+		wl_status_t status();
+
+		uint8_t* BSSID();
+		int32_t channel();
+		// Scan of the access points in range
+		int16_t scanNetworks(bool async = false, bool showHidden = false, bool passive = false,
+		                     uint32_t maxMsPerChannel = 300, uint8_t channel = 0);
+		int16_t scanComplete();
+		void scanDelete();
+		uint8_t* BSSID(uint8_t index);
+		int32_t RSSI(uint8_t index);
+		int32_t channel(uint8_t index);
+		IPAddress localIP();
+		IPAddress gatewayIP();
+		IPAddress subnetMask();
+		IPAddress dnsIP(uint8_t index = 0);
+
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Wi-Fi geolocation of the simulation, returning the location of SimWifi (SimWifi.h)
+ * instead of querying the Google Geolocation API.
+ */
+
+#ifndef SimWifiLocation_h
+#define SimWifiLocation_h
+
+#include "Arduino.h"
+
+typedef struct {
+	float lat = 0;
+	float lon = 0;
+	int accuracy = 40000;
+} location_t;
+
+class WifiLocation {
+
+	public:
+		WifiLocation(String googleKey = "") {}
+		void setKey(String googleKey) {}
+		location_t getGeoFromWiFi(const char* body, size_t size);
+
+};
+
+#endif
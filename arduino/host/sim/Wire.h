@@ -0,0 +1,69 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * I2C bus of the simulation, on which fake devices are attached.
+ * Like the BME280 and BME680 sensors, the devices are register maps:
+ * a write sends the register address followed by (data, register address) pairs,
+ * a read returns the successive registers from the last register address.
+ */
+
+#ifndef SimWire_h
+#define SimWire_h
+
+#include "Arduino.h"
+
+// Maximum number of devices on a bus
+#define SIM_I2C_DEVICES 8
+// Size of the transmission buffer
+#define SIM_I2C_BUFFER_SIZE 128
+
+/* Fake device of the I2C bus */
+class SimI2cDevice {
+
+	public:
+		virtual ~SimI2cDevice() {}
+		virtual uint8_t readRegister(uint8_t reg) = 0;
+		virtual void writeRegister(uint8_t reg, uint8_t value) = 0;
+
+};
+
+class TwoWire {
+
+	public:
+		TwoWire(uint8_t bus);
+
+		bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+		void beginTransmission(uint8_t address);
+		void beginTransmission(int address);
+		size_t write(uint8_t data);
+		uint8_t endTransmission(bool sendStop = true);
+		uint8_t requestFrom(uint8_t address, uint8_t quantity);
+		uint8_t requestFrom(int address, int quantity);
+		int available();
+		int read();
+
+		// Simulation: attaches a fake device, which stays attached across the boots
+		bool attach(uint8_t address, SimI2cDevice* device);
+
+	private:
+		uint8_t _bus;
+		uint8_t _addresses[SIM_I2C_DEVICES];
+		SimI2cDevice* _devices[SIM_I2C_DEVICES];
+		uint8_t _nDevices;
+		// Current transmission
+		uint8_t _address;
+		uint8_t _buffer[SIM_I2C_BUFFER_SIZE];
+		uint8_t _size;
+		uint8_t _index;
+		// Register address of the next read, per device
+		uint8_t _registers[SIM_I2C_DEVICES];
+
+		int8_t findDevice(uint8_t address);
+
+};
+
+extern TwoWire Wire;
+
+#endif
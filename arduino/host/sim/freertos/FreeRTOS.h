@@ -0,0 +1,28 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * FreeRTOS of the simulation: only the parts of the API used by our libraries.
+ * The tasks run to completion when they are created, each on its own virtual
+ * clock starting at its creation (see SimFreeRTOS.cpp).
+ */
+
+#ifndef SimFreeRTOS_h
+#define SimFreeRTOS_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+
+#define portMAX_DELAY ((TickType_t) 0xffffffff)
+
+#endif
@@ -0,0 +1,23 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * FreeRTOS event groups of the simulation.
+ */
+
+#ifndef SimEventGroups_h
+#define SimEventGroups_h
+
+#include "FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct simEventGroup* EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clearOnExit, BaseType_t waitForAll, TickType_t ticks);
+void vEventGroupDelete(EventGroupHandle_t group);
+
+#endif
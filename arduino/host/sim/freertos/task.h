@@ -0,0 +1,22 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * FreeRTOS tasks of the simulation.
+ */
+
+#ifndef SimTask_h
+#define SimTask_h
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void* parameters);
+typedef struct simTask* TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth,
+                                   void* parameters, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+
+#endif
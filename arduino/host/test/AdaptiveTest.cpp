@@ -0,0 +1,124 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host tests of the adaptive sampling policy (AdaptivePeriod library).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "AdaptivePeriod.h"
+#include "Check.h"
+
+// Headers of the fields used by the tests
+#define TEMPERATURE 2
+#define PRESSURE    3
+
+/**
+ * Checks if a step has the given wake-up period and number of measurements.
+ */
+static bool isStep(adaptive_step_t step, uint8_t wakeupPeriod, uint8_t nMeasurements) {
+	return step.wakeupPeriod == wakeupPeriod && step.nMeasurements == nMeasurements;
+}
+
+/**
+ * The battery steps apply from their level down to the level of the next step,
+ * whatever the order in which they are added.
+ */
+static void testBatterySteps() {
+	adaptive_state_t state;
+	memset(&state, 0, sizeof(state));
+	adaptive_step_t base = {0, 10, 4};
+	AdaptivePeriod policy;
+	CHECK(!policy.isEnabled());
+	CHECK(isStep(policy.select(&state, 50, base), 10, 4));
+
+	CHECK(policy.addStep(20, 30, 6));
+	CHECK(policy.addStep(50, 10, 4));
+	CHECK(policy.addStep(5, 60, 8));
+	CHECK(policy.isEnabled());
+	CHECK(isStep(policy.select(&state, 100, base), 10, 4));
+	CHECK(isStep(policy.select(&state, 50, base), 10, 4));
+	CHECK(isStep(policy.select(&state, 49, base), 30, 6));
+	CHECK(isStep(policy.select(&state, 20, base), 30, 6));
+	CHECK(isStep(policy.select(&state, 19, base), 60, 8));
+	// Below all the steps, the lowest one applies
+	CHECK(isStep(policy.select(&state, 1, base), 60, 8));
+
+	CHECK(!policy.addStep(101, 10, 4));
+	CHECK(!policy.addStep(10, 0, 4));
+	CHECK(!policy.addStep(10, 10, 0));
+	for (uint8_t i = 3; i < MAX_ADAPTIVE_STEPS; i++)
+		CHECK(policy.addStep(i, 120, 8));
+	CHECK(!policy.addStep(1, 120, 8));
+}
+
+/**
+ * A reading changing quickly, up or down, switches to the fast step for its hold time,
+ * if the battery is at or above the level of the fast step.
+ */
+static void testFastStep() {
+	adaptive_state_t state;
+	memset(&state, 0, sizeof(state));
+	adaptive_step_t base = {0, 10, 4};
+	AdaptivePeriod policy;
+	CHECK(!policy.setFastStep(30, 0, 1, 3));
+	CHECK(!policy.setFastStep(30, 2, 1, 0));
+	CHECK(policy.setFastStep(30, 2, 1, 3));
+	CHECK(policy.isEnabled());
+	CHECK(policy.setChangeRate(TEMPERATURE, 0.1));
+	CHECK(!policy.setChangeRate(0, 0.1));
+	CHECK(!policy.setChangeRate(ADAPTIVE_FIELDS + 1, 0.1));
+
+	// No previous value, then slow changes
+	policy.startCycle(&state);
+	CHECK(!policy.update(&state, TEMPERATURE, 20, 10));
+	policy.startCycle(&state);
+	CHECK(!policy.update(&state, TEMPERATURE, 20.5, 10));
+	CHECK(isStep(policy.select(&state, 80, base), 10, 4));
+	// Fields without rate are ignored
+	CHECK(!policy.update(&state, PRESSURE, 100000, 10));
+	CHECK(!policy.update(&state, PRESSURE, 90000, 10));
+
+	// Fast drop: 2 degrees in 10 minutes, held for 3 wake-ups
+	policy.startCycle(&state);
+	CHECK(policy.update(&state, TEMPERATURE, 18.5, 10));
+	CHECK(isStep(policy.select(&state, 80, base), 2, 1));
+	CHECK(isStep(policy.select(&state, 29, base), 10, 4));
+	for (uint8_t i = 0; i < 2; i++) {
+		policy.startCycle(&state);
+		CHECK(!policy.update(&state, TEMPERATURE, 18.5, 2));
+		CHECK(isStep(policy.select(&state, 80, base), 2, 1));
+	}
+	policy.startCycle(&state);
+	CHECK(!policy.update(&state, TEMPERATURE, 18.5, 2));
+	CHECK(isStep(policy.select(&state, 80, base), 10, 4));
+
+	// The rate is per minute: the same change over a shorter interval is faster
+	policy.startCycle(&state);
+	CHECK(!policy.update(&state, TEMPERATURE, 19, 10));
+	policy.startCycle(&state);
+	CHECK(policy.update(&state, TEMPERATURE, 19.5, 2));
+
+	// Without fast step, the rates are ignored
+	AdaptivePeriod steps;
+	CHECK(steps.addStep(0, 10, 4));
+	CHECK(steps.setChangeRate(TEMPERATURE, 0.1));
+	memset(&state, 0, sizeof(state));
+	CHECK(!steps.update(&state, TEMPERATURE, 20, 10));
+	CHECK(!steps.update(&state, TEMPERATURE, 30, 10));
+	CHECK(isStep(steps.select(&state, 80, base), 10, 4));
+}
+
+int main() {
+	testBatterySteps();
+	testFastStep();
+	if (failures > 0) {
+		printf("AdaptiveTest: %d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("AdaptiveTest: all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,166 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host test of the decoder of The Things Network (the-things-network/decoder.js),
+ * also used by the cloud function: decodes the uplinks of the simulation scenarios,
+ * written by SimulationTest, and compares them with their decoding by PacketDecoder.
+ * Usage: node test/DecoderTest.js <uplinks file> <decoder.js>
+ */
+
+var fs = require("fs");
+var path = require("path");
+
+// Location of the batch: at the top level of the decoded payloads from version 2,
+// and in each measurement in the decoding by PacketDecoder
+var LOCATION_KEYS = ["latitude", "longitude", "altitude"];
+// Keys of the payloads that are not measurements
+var PAYLOAD_KEYS = ["version", "interval", "measurements", "samples", "statistics",
+                    "age", "sequence", "lastTimestamp"];
+// Absent values of PacketDecoder (DEFAULT_INT and DEFAULT_FLOAT): a zero int is absent,
+// and so are the floats at or below DEFAULT_FLOAT
+var DEFAULT_INT = 0;
+var DEFAULT_FLOAT = -200;
+// Relative tolerance on the values, decoded as floats by PacketDecoder
+var TOLERANCE = 1e-5;
+
+var failures = 0;
+
+/**
+ * Records a failed check.
+ * @param uplink: uplink of the check
+ * @param message: description of the failure
+ */
+function fail(uplink, message) {
+  console.log(uplink.scenario + ", port " + uplink.fPort + " [" + uplink.bytes.join(",") + "]: " + message);
+  failures++;
+}
+
+/**
+ * Rewrites a payload decoded by the TTN decoder like the decoding by PacketDecoder:
+ * a version 1 payload as a measurement, and the location in each measurement.
+ * @param data: payload decoded by the TTN decoder
+ * @returns: the normalized payload
+ */
+function normalize(data) {
+  var normalized = {};
+  var location = {};
+  var fields = {timestamp: 0};
+  for (var key in data) {
+    if (key == "measurements" || key == "statistics")
+      continue;
+    if (PAYLOAD_KEYS.indexOf(key) >= 0)
+      normalized[key] = data[key];
+    else if (LOCATION_KEYS.indexOf(key) >= 0)
+      location[key] = data[key];
+    else
+      fields[key] = data[key];
+  }
+  var measurements = data.measurements || [fields];
+  normalized.measurements = measurements.map(function (measurement) {
+    return Object.assign({}, location, measurement);
+  });
+  if ("statistics" in data)
+    normalized.statistics = data.statistics;
+  return normalized;
+}
+
+/**
+ * Compares a value of the TTN decoder with the one of PacketDecoder.
+ * @param uplink: uplink of the values
+ * @param name: path of the value in the decoded payload
+ * @param actual: value of the TTN decoder
+ * @param expected: value of PacketDecoder
+ */
+function compare(uplink, name, actual, expected) {
+  if (typeof expected == "number") {
+    if (typeof actual != "number" || Math.abs(actual - expected) > TOLERANCE * Math.max(1, Math.abs(expected)))
+      fail(uplink, name + ": " + actual + " instead of " + expected);
+    return;
+  }
+  if (Array.isArray(expected)) {
+    if (!Array.isArray(actual) || actual.length != expected.length) {
+      fail(uplink, name + ": " + JSON.stringify(actual) + " instead of " + JSON.stringify(expected));
+      return;
+    }
+    for (var i = 0; i < expected.length; i++)
+      compare(uplink, name + "[" + i + "]", actual[i], expected[i]);
+    return;
+  }
+  if (actual === null || typeof actual != "object") {
+    fail(uplink, name + ": " + JSON.stringify(actual) + " instead of an object");
+    return;
+  }
+  for (var key in expected)
+    compare(uplink, name + "." + key, actual[key], expected[key]);
+  for (var key in actual) {
+    var value = actual[key];
+    if (!(key in expected) && !(typeof value == "number" && (value == DEFAULT_INT || value <= DEFAULT_FLOAT)))
+      fail(uplink, name + "." + key + ": " + JSON.stringify(value) + " not decoded by PacketDecoder");
+  }
+}
+
+/**
+ * Decodes an uplink with the TTN decoder, and checks it against PacketDecoder.
+ * The summaries of the profiler, not decoded by PacketDecoder, must decode without error.
+ * @param decodeUplink: entry function of the TTN decoder
+ * @param uplink: uplink written by SimulationTest
+ */
+function checkUplink(decodeUplink, uplink) {
+  var result = decodeUplink({bytes: uplink.bytes, fPort: uplink.fPort});
+  if (!("data" in result) || (result.errors && result.errors.length > 0)) {
+    fail(uplink, "not decoded: " + JSON.stringify(result.errors));
+    return;
+  }
+  if (uplink.expected === null) {
+    if (!(result.data.cycles > 0) || Object.keys(result.data.phases || {}).length == 0)
+      fail(uplink, "empty profile " + JSON.stringify(result.data));
+    return;
+  }
+  compare(uplink, "data", normalize(result.data), uplink.expected);
+}
+
+function main() {
+  if (process.argv.length < 4) {
+    console.log("Usage: node DecoderTest.js <uplinks file> <decoder.js>");
+    process.exit(1);
+  }
+  var decodeUplink = require(path.resolve(process.argv[3])).decodeUplink;
+  var lines = fs.readFileSync(process.argv[2], "utf8").split("\n");
+  // Uplinks per port, and aggregated payloads of versions 4 and 5
+  var ports = {};
+  var versions = {};
+  var aggregates = 0;
+  for (var i = 0; i < lines.length; i++) {
+    if (lines[i] == "")
+      continue;
+    var uplink = JSON.parse(lines[i]);
+    checkUplink(decodeUplink, uplink);
+    ports[uplink.fPort] = (ports[uplink.fPort] || 0) + 1;
+    if (uplink.expected !== null) {
+      versions[uplink.expected.version] = true;
+      if ("statistics" in uplink.expected)
+        aggregates++;
+    }
+  }
+  // Every kind of uplink of the devices
+  [2, 3, 4, 5].forEach(function (port) {
+    if (!ports[port])
+      fail({scenario: "all", fPort: port, bytes: []}, "no uplink");
+  });
+  [3, 4, 5].forEach(function (version) {
+    if (!versions[version])
+      fail({scenario: "all", fPort: 2, bytes: []}, "no payload of version " + version);
+  });
+  if (aggregates == 0)
+    fail({scenario: "all", fPort: 2, bytes: []}, "no aggregated payload");
+
+  if (failures > 0) {
+    console.log("DecoderTest: " + failures + " check(s) failed");
+    process.exit(1);
+  }
+  console.log("DecoderTest: all checks passed");
+}
+
+main();
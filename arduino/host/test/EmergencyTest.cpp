@@ -0,0 +1,113 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host tests of the emergency detector (EmergencyDetector library),
+ * replaying recorded series of sensor values.
+ * Each series is a CSV file with the parameters of the detector in a comment line
+ * ("# raise=30 clear=28.5 dwell=2 slope=0 interval=10"), followed by one sample
+ * per line: the value, and 1 if the sample must raise an emergency, 0 otherwise.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "EmergencyDetector.h"
+#include "Check.h"
+
+#define LINE_SIZE 256
+
+/**
+ * Replays a recorded series, and checks the samples raising an emergency.
+ * @param path: path of the CSV file of the series
+ */
+static void replaySeries(const char* path) {
+	FILE* file = fopen(path, "r");
+	CHECK(file != NULL);
+	if (file == NULL)
+		return;
+	char line[LINE_SIZE];
+	float raise, clear, slope, interval;
+	unsigned int dwell;
+	bool configured = false;
+	EmergencyDetector detector;
+	emergency_state_t state;
+	memset(&state, 0, sizeof(state));
+	uint16_t lineNumber = 0;
+	uint16_t raised = 0;
+	// Emergencies of the former detector, a single threshold checked at each sample
+	uint16_t thresholdCrossings = 0;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		lineNumber++;
+		if (sscanf(line, "# raise=%f clear=%f dwell=%u slope=%f interval=%f",
+		           &raise, &clear, &dwell, &slope, &interval) == 5) {
+			detector = EmergencyDetector(raise, clear, dwell, slope);
+			configured = true;
+			continue;
+		}
+		float value;
+		int expected;
+		if (line[0] == '#' || sscanf(line, "%f,%d", &value, &expected) != 2)
+			continue;
+		CHECK(configured);
+		bool result = detector.update(&state, value, interval);
+		if (result != (expected != 0))
+			printf("%s:%u: expected %s\n", path, lineNumber, expected ? "raised" : "not raised");
+		CHECK(result == (expected != 0));
+		raised += result;
+		thresholdCrossings += configured && value >= raise;
+	}
+	fclose(file);
+	printf("%s: %u emergency(ies), %u with a single threshold\n", path, raised, thresholdCrossings);
+}
+
+/**
+ * Disabled detectors never raise an emergency, and the parameters are bounded.
+ */
+static void testParameters() {
+	emergency_state_t state;
+	memset(&state, 0, sizeof(state));
+	EmergencyDetector disabled;
+	CHECK(!disabled.isEnabled());
+	CHECK(!disabled.update(&state, 1e9, 10));
+
+	// The clearing threshold is at most the raising threshold, and the dwell at least 1
+	EmergencyDetector detector(10, 20, 0, -1);
+	CHECK(detector.isEnabled());
+	CHECK(detector.update(&state, 10, 10));
+	CHECK(EmergencyDetector::isActive(&state));
+	CHECK(!detector.update(&state, 9.9, 10));
+	CHECK(!EmergencyDetector::isActive(&state));
+	// No rate of change trigger
+	CHECK(!detector.update(&state, -100, 10));
+	CHECK(!detector.update(&state, 9, 10));
+}
+
+int main(int argc, char** argv) {
+	testParameters();
+	const char* directory = argc > 1 ? argv[1] : "test/series";
+	DIR* dir = opendir(directory);
+	CHECK(dir != NULL);
+	uint8_t nSeries = 0;
+	struct dirent* entry;
+	while (dir != NULL && (entry = readdir(dir)) != NULL) {
+		size_t length = strlen(entry->d_name);
+		if (length < 4 || strcmp(entry->d_name + length - 4, ".csv") != 0)
+			continue;
+		char path[LINE_SIZE];
+		snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+		replaySeries(path);
+		nSeries++;
+	}
+	if (dir != NULL)
+		closedir(dir);
+	CHECK(nSeries > 0);
+	if (failures > 0) {
+		printf("EmergencyTest: %d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("EmergencyTest: all checks passed\n");
+	return 0;
+}
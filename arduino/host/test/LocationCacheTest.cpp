@@ -0,0 +1,163 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host tests of the cache of the Wi-Fi geolocations (LocationCache library).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "LocationCache.h"
+#include "Check.h"
+
+/**
+ * Builds the BSSID of the access point of an index.
+ */
+static void makeBssid(uint8_t index, uint8_t* bssid) {
+	uint8_t base[LOCATION_BSSID_SIZE] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x00};
+	memcpy(bssid, base, LOCATION_BSSID_SIZE);
+	bssid[5] = index;
+}
+
+/**
+ * Builds the fingerprint of the access points from first to last, of decreasing strength.
+ */
+static location_fingerprint_t makeFingerprint(uint8_t first, uint8_t last) {
+	location_fingerprint_t fingerprint;
+	LocationCache::initFingerprint(&fingerprint);
+	uint8_t bssid[LOCATION_BSSID_SIZE];
+	for (uint8_t i = first; i <= last; i++) {
+		makeBssid(i, bssid);
+		LocationCache::addAccessPoint(&fingerprint, bssid, -40 - (i - first));
+	}
+	return fingerprint;
+}
+
+/**
+ * Checks if a fingerprint holds the access point of an index.
+ */
+static bool hasAccessPoint(const location_fingerprint_t* fingerprint, uint8_t index) {
+	uint8_t bssid[LOCATION_BSSID_SIZE];
+	makeBssid(index, bssid);
+	uint32_t hash = LocationCache::hashBssid(bssid);
+	for (uint8_t i = 0; i < fingerprint->size; i++) {
+		if (fingerprint->hashes[i] == hash)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * The fingerprint keeps the strongest access points of a scan, once each,
+ * whatever the order of the scan.
+ */
+static void testFingerprint() {
+	location_fingerprint_t fingerprint;
+	LocationCache::initFingerprint(&fingerprint);
+	uint8_t bssid[LOCATION_BSSID_SIZE];
+	// Strength growing with the index, the weakest ones first
+	for (uint8_t i = 0; i < 2 * LOCATION_FINGERPRINT_SIZE; i++) {
+		makeBssid(i, bssid);
+		LocationCache::addAccessPoint(&fingerprint, bssid, -90 + 2 * i);
+	}
+	CHECK(fingerprint.size == LOCATION_FINGERPRINT_SIZE);
+	for (uint8_t i = 0; i < 2 * LOCATION_FINGERPRINT_SIZE; i++)
+		CHECK(hasAccessPoint(&fingerprint, i) == (i >= LOCATION_FINGERPRINT_SIZE));
+
+	// Access point seen again, and signal strength clamped
+	makeBssid(LOCATION_FINGERPRINT_SIZE, bssid);
+	LocationCache::addAccessPoint(&fingerprint, bssid, 0);
+	CHECK(fingerprint.size == LOCATION_FINGERPRINT_SIZE);
+	LocationCache::initFingerprint(&fingerprint);
+	LocationCache::addAccessPoint(&fingerprint, bssid, -200);
+	CHECK(fingerprint.size == 1 && fingerprint.rssi[0] == INT8_MIN);
+
+	CHECK(LocationCache::hashBssid(bssid) != 0);
+	uint8_t other[LOCATION_BSSID_SIZE];
+	makeBssid(LOCATION_FINGERPRINT_SIZE + 1, other);
+	CHECK(LocationCache::hashBssid(bssid) != LocationCache::hashBssid(other));
+}
+
+/**
+ * The similarity of the fingerprints is the Jaccard index of their access points.
+ */
+static void testSimilarity() {
+	location_fingerprint_t first = makeFingerprint(0, 7);
+	location_fingerprint_t empty = makeFingerprint(1, 0);
+	CHECK(LocationCache::getSimilarity(&first, &first) == 1);
+	CHECK(LocationCache::getSimilarity(&first, &empty) == 0);
+	CHECK(LocationCache::getSimilarity(&empty, &empty) == 0);
+	// 6 common access points out of 10
+	location_fingerprint_t shifted = makeFingerprint(2, 9);
+	CHECK(LocationCache::getSimilarity(&first, &shifted) == 0.6f);
+	CHECK(LocationCache::getSimilarity(&shifted, &first) == 0.6f);
+	location_fingerprint_t far = makeFingerprint(8, 15);
+	CHECK(LocationCache::getSimilarity(&first, &far) == 0);
+}
+
+/**
+ * A scan similar enough to a known fingerprint finds its location,
+ * and the oldest locations are evicted when the cache is full.
+ */
+static void testCache() {
+	LocationCache cache;
+	cached_location_t location;
+	location_fingerprint_t home = makeFingerprint(0, 7);
+	CHECK(!cache.find(&home, &location));
+	cache.add(&home, 50.67f, 4.61f, 20);
+	CHECK(cache.getTable()->count == 1);
+
+	// Same place, some access points seen or missed
+	location_fingerprint_t near = makeFingerprint(2, 9);
+	CHECK(cache.find(&near, &location));
+	CHECK(location.latitude == 50.67f && location.longitude == 4.61f && location.accuracy == 20);
+	// 4 common access points out of 12
+	location_fingerprint_t away = makeFingerprint(4, 11);
+	CHECK(!cache.find(&away, &location));
+	// Empty scan: never cached, never found
+	location_fingerprint_t empty = makeFingerprint(1, 0);
+	cache.add(&empty, 0, 0, 0);
+	CHECK(!cache.find(&empty, &location));
+	CHECK(cache.getTable()->count == 1);
+
+	// Similar fingerprint: replaces its location
+	cache.add(&near, 50.68f, 4.62f, 15);
+	CHECK(cache.getTable()->count == 1);
+	CHECK(cache.find(&home, &location) && location.latitude == 50.68f);
+
+	// Full cache: the oldest location is evicted
+	for (uint8_t i = 1; i <= LOCATION_CACHE_ENTRIES; i++) {
+		location_fingerprint_t other = makeFingerprint(16 * i, 16 * i + 7);
+		cache.add(&other, i, i, i);
+	}
+	CHECK(cache.getTable()->count == LOCATION_CACHE_ENTRIES);
+	CHECK(!cache.find(&home, &location));
+	for (uint8_t i = 1; i <= LOCATION_CACHE_ENTRIES; i++) {
+		location_fingerprint_t other = makeFingerprint(16 * i, 16 * i + 7);
+		CHECK(cache.find(&other, &location) && location.latitude == i);
+		CHECK(cache.getTable()->entries[LOCATION_CACHE_ENTRIES - i].accuracy == i);
+	}
+
+	// Table saved and loaded
+	location_table_t saved = *cache.getTable();
+	cache.clear();
+	CHECK(cache.getTable()->count == 0);
+	location_fingerprint_t last = makeFingerprint(16, 23);
+	CHECK(!cache.find(&last, &location));
+	*cache.getTable() = saved;
+	CHECK(cache.find(&last, &location) && location.latitude == 1);
+}
+
+int main() {
+	testFingerprint();
+	testSimilarity();
+	testCache();
+	if (failures > 0) {
+		printf("LocationCacheTest: %d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("LocationCacheTest: all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,832 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host tests of the LoRaWAN payload encoder (Packet library).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "Packet.h"
+#include "PacketDecoder.h"
+#include "Aggregator.h"
+#include "AllocCounter.h"
+#include "Check.h"
+
+#define INTERVAL 10
+// Value of the guard bytes placed after the payload buffers
+#define GUARD 0xA5
+
+/**
+ * Fills the packet with every field, for the given number of measurements.
+ */
+static void fillPacket(Packet& packet, uint8_t nMeasurements) {
+	for (uint8_t i = 0; i < nMeasurements; i++) {
+		packet.addBattery(90 - i, i);
+		packet.addTemperature(21.37, i);
+		packet.addPressure(101325.42, i);
+		packet.addHumidity(45.5, i);
+		packet.addLight(300, i);
+		packet.addLatitude(50.668081, i);
+		packet.addLongitude(4.611562, i);
+		packet.addAltitude(112.5, i);
+		packet.addCO2(412.2, i);
+		packet.addNoise(1830, i);
+		packet.addAirQuality(25.0, i);
+	}
+}
+
+/**
+ * Encoding in the internal buffer or in a caller-provided buffer
+ * must not allocate memory on the heap.
+ */
+static void testNoHeapAllocation() {
+	for (uint8_t version = 1; version <= 5; version++) {
+		for (uint8_t n = 1; n <= MAX_MEASUREMENTS_VERSION[version - 1]; n++) {
+			MeasurementStore store;
+			Packet packet(INTERVAL, n, version);
+			packet.setMeasurementStore(&store);
+			packet.clearArray();
+			uint8_t buffer[PAYLOAD_MAX_SIZE];
+			uint8_t size = 0;
+
+			fillPacket(packet, n);
+			resetAllocStats();
+			packet.buildLoraPayload();
+			CHECK(getAllocStats().count == 0);
+
+			fillPacket(packet, n);
+			resetAllocStats();
+			packet.buildLoraPayload(buffer, &size, sizeof(buffer));
+			CHECK(getAllocStats().count == 0);
+			CHECK(size == packet.getPayloadSize());
+		}
+	}
+}
+
+/**
+ * The worst case payload of every version must fit in the internal buffer,
+ * up to the 8-bit payload size limit.
+ */
+static void testInternalBufferSize() {
+	for (uint8_t version = 1; version <= 5; version++) {
+		MeasurementStore store;
+		Packet packet(INTERVAL, MAX_MEASUREMENTS_VERSION[version - 1], version);
+		packet.setMeasurementStore(&store);
+		packet.clearArray();
+		uint8_t n = packet.getNMeasurements();
+		fillPacket(packet, n);
+		uint8_t* payload = packet.buildLoraPayload();
+		if (version == 1 || version == 2) {
+			CHECK(payload != NULL);
+			CHECK(packet.getPayloadSize() == (version == 1 ? PAYLOAD_SIZE_V1 : PAYLOAD_SIZE_V2));
+		} else if (version == 4) {
+			CHECK(payload != NULL);
+			CHECK(packet.getPayloadSize() == PAYLOAD_SIZE_V4);
+		} else if (version == 5) {
+			// Worst case larger than the buffer, but constant values give one-byte deltas
+			CHECK(payload != NULL);
+			CHECK(packet.getPayloadSize() == 5 + LOCATION_DATA_SIZE + MEASUREMENT_DATA_SIZE +
+			                                 (n - 1) * (MEASUREMENT_DELTA_SIZE / VARINT_MAX_SIZE));
+		} else {
+			// Larger than what an 8-bit size can describe
+			CHECK(PAYLOAD_SIZE_V3 > UINT8_MAX);
+			CHECK(payload == NULL);
+		}
+	}
+}
+
+/**
+ * A payload larger than the buffer must fail without writing past the buffer,
+ * and must keep the measurements for a later encoding.
+ */
+static void testOverflow() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 4, 3);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	fillPacket(packet, 4);
+
+	uint8_t buffer[PAYLOAD_MAX_SIZE];
+	memset(buffer, GUARD, sizeof(buffer));
+	uint8_t size = 0xFF;
+	CHECK(packet.buildLoraPayload(buffer, &size, 64) == NULL);
+	CHECK(size == 0);
+	for (uint16_t i = 64; i < sizeof(buffer); i++)
+		CHECK(buffer[i] == GUARD);
+
+	// Measurements are kept, and can be encoded in a larger buffer
+	uint8_t largeBuffer[PAYLOAD_MAX_SIZE];
+	CHECK(packet.buildLoraPayload(largeBuffer, &size, sizeof(largeBuffer)) == largeBuffer);
+	CHECK(size > 64);
+	// Exact fit
+	fillPacket(packet, 4);
+	uint8_t exactSize = size;
+	CHECK(packet.buildLoraPayload(buffer, &size, exactSize) == buffer);
+	CHECK(size == exactSize);
+	CHECK(memcmp(buffer, largeBuffer, size) == 0);
+}
+
+/**
+ * The internal buffer and a caller-provided buffer produce the same payload.
+ */
+static void testSamePayload() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 3, 2);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+
+	uint8_t buffer[PAYLOAD_MAX_SIZE];
+	uint8_t size = 0;
+	fillPacket(packet, 3);
+	packet.buildLoraPayload(buffer, &size, sizeof(buffer));
+	fillPacket(packet, 3);
+	uint8_t* payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+	CHECK(packet.getPayloadSize() == size);
+	CHECK(memcmp(payload, buffer, size) == 0);
+	// Preamble: version and interval
+	CHECK(payload[0] == 2);
+	CHECK(payload[1] == INTERVAL);
+}
+
+/**
+ * Version 4 announces the fields in a presence bitmap, writes the location once,
+ * and marks the fields absent from a single measurement.
+ */
+static void testBitmapPayload() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 2, 4);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	packet.addBattery(90, 0);
+	packet.addTemperature(-1.5, 0);
+	packet.addNoise(1830, 0);
+	packet.addBattery(89, 1);
+	packet.addTemperature(-1.25, 1);
+	packet.addLatitude(50.5, 1);
+
+	uint8_t* payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+	const uint8_t expected[] = {
+		4, INTERVAL, 2,
+		// Bitmap: battery, temperature, latitude, noise
+		0x02, 0x43,
+		// Latitude, in steps of 1e-6 above -200
+		0x0E, 0xEE, 0x53, 0xA0,
+		// Measurement 0: battery, temperature (steps of 0.01 above -200), noise
+		90, 0x00, 0x00, 0x4D, 0x8A, 0x07, 0x26,
+		// Measurement 1: battery, temperature, absent noise
+		89, 0x00, 0x00, 0x4D, 0xA3, 0xFF, 0xFF
+	};
+	CHECK(packet.getPayloadSize() == sizeof(expected));
+	CHECK(memcmp(payload, expected, sizeof(expected)) == 0);
+}
+
+/**
+ * Version 5 writes the first measurement as version 4, and the next ones
+ * as zig-zag varint deltas with the last present value of the same field.
+ */
+static void testDeltaPayload() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 3, 5);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	packet.addBattery(90, 0);
+	packet.addTemperature(-1.5, 0);
+	packet.addNoise(1830, 0);
+	packet.addBattery(89, 1);
+	packet.addTemperature(-1.25, 1);
+	packet.addBattery(89, 2);
+	packet.addTemperature(10.0, 2);
+	packet.addNoise(1800, 2);
+	packet.addLatitude(50.5, 2);
+
+	uint8_t* payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+	const uint8_t expected[] = {
+		5, INTERVAL, 3,
+		// Bitmap: battery, temperature, latitude, noise
+		0x02, 0x43,
+		// Latitude
+		0x0E, 0xEE, 0x53, 0xA0,
+		// Measurement 0, absolute: battery, temperature, noise
+		90, 0x00, 0x00, 0x4D, 0x8A, 0x07, 0x26,
+		// Measurement 1: battery -1, temperature +25, absent noise
+		0x02, 0x33, 0x00,
+		// Measurement 2: battery +0, temperature +1125, noise -30 (from measurement 0)
+		0x01, 0xCB, 0x11, 0x3C
+	};
+	CHECK(packet.getPayloadSize() == sizeof(expected));
+	CHECK(memcmp(payload, expected, sizeof(expected)) == 0);
+}
+
+/**
+ * The largest deltas take 33 bits once zig-zag encoded and shifted,
+ * i.e. VARINT_MAX_SIZE bytes.
+ */
+static void testDeltaExtremes() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 2, 5);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	packet.addPressure(-1.0, 0);
+	packet.addPressure(20000000.0, 1);
+
+	uint8_t* payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+	// Delta of 2000000100, zig-zag encoded and shifted by one: 4000000201 = 0xEE6B28C9
+	const uint8_t expected[] = {
+		5, INTERVAL, 2, 0x00, 0x04,
+		0x00, 0x00, 0x4D, 0xBC,
+		0xC9, 0xD1, 0xAC, 0xF3, 0x0E
+	};
+	CHECK(packet.getPayloadSize() == sizeof(expected));
+	CHECK(memcmp(payload, expected, sizeof(expected)) == 0);
+}
+
+/**
+ * Non-default quantizations are announced after the bitmap,
+ * and values out of range are clamped.
+ */
+static void testQuantization() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 2, 4);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	CHECK(!packet.setQuantization(0, 0, 1, 1));
+	CHECK(!packet.setQuantization(HEADER_HUMIDITY, 0, 0.3, 1));
+	CHECK(!packet.setQuantization(HEADER_HUMIDITY, 0, 0.5, 5));
+	CHECK(packet.setQuantization(HEADER_PRESSURE, 80000, 1, 3));
+	CHECK(packet.setQuantization(HEADER_HUMIDITY, 0, 0.5, 1));
+	// Same as the default, not announced
+	CHECK(packet.setQuantization(HEADER_BATTERY, 0, 1, 1));
+	packet.addPressure(101325.42, 0);
+	packet.addHumidity(45.5, 0);
+	packet.addPressure(50000, 1);
+	packet.addHumidity(150, 1);
+
+	uint8_t* payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+	const uint8_t expected[] = {
+		4 | QUANTIZATION_FLAG, INTERVAL, 2,
+		// Bitmap: pressure, humidity
+		0x00, 0x0C,
+		// Quantizations: pressure (3 bytes, 1 Pa, from 80000 Pa), humidity (1 byte, 0.5%, from 0%)
+		0x00, 0x0C,
+		0x80, 0x00, 0x01, 0x38, 0x80,
+		0x2F, 0x00, 0x00, 0x00, 0x00,
+		// Measurement 0: pressure, humidity
+		0x00, 0x53, 0x4D, 91,
+		// Measurement 1: clamped pressure and humidity
+		0x00, 0x00, 0x00, 0xFE
+	};
+	CHECK(packet.getPayloadSize() == sizeof(expected));
+	CHECK(memcmp(payload, expected, sizeof(expected)) == 0);
+
+	// The quantizations of absent fields are not announced
+	packet.addBattery(90, 0);
+	payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+	CHECK(payload[0] == 4);
+
+	// init restores the default quantization
+	packet.init(INTERVAL, 2, 4);
+	packet.addPressure(101325.42, 0);
+	payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+	CHECK(payload[0] == 4);
+	CHECK(packet.getPayloadSize() == 5 + sizeof(uint32_t));
+}
+
+/**
+ * The versions 1 to 3 ignore the quantization overrides: their payloads are the same
+ * as without overrides, and the values stored keep the default quantization.
+ */
+static void testQuantizationBeforeVersion4() {
+	for (uint8_t version = 1; version <= 3; version++) {
+		uint8_t n = version == 1 ? 1 : 2;
+		uint8_t expected[PAYLOAD_MAX_SIZE];
+		uint8_t size = 0;
+		for (uint8_t overridden = 0; overridden <= 1; overridden++) {
+			MeasurementStore store;
+			Packet packet(INTERVAL, n, version);
+			packet.setMeasurementStore(&store);
+			if (overridden) {
+				CHECK(!packet.setQuantization(HEADER_HUMIDITY, 0, 0.5, 1));
+				CHECK(!packet.setQuantization(HEADER_PRESSURE, 80000, 1, 3));
+			}
+			packet.clearArray();
+			for (uint8_t i = 0; i < n; i++) {
+				packet.addHumidity(45.37, i);
+				packet.addPressure(60000, i);
+			}
+			CHECK(fabs(packet.getMeasurement(0).humidity - 45.37) < 0.01);
+			CHECK(fabs(packet.getMeasurement(0).pressure - 60000) < 1);
+			uint8_t* payload = packet.buildLoraPayload();
+			CHECK(payload != NULL);
+			if (!overridden) {
+				size = packet.getPayloadSize();
+				memcpy(expected, payload, size);
+			} else {
+				CHECK(packet.getPayloadSize() == size);
+				CHECK(memcmp(payload, expected, size) == 0);
+			}
+		}
+	}
+}
+
+/**
+ * The integer scaling path rounds as the double-precision one, give or take one unit
+ * when the scaled value is within a float rounding error of a half unit.
+ */
+static void testScaleFloat() {
+	CHECK(Packet::scaleFloat(21.37, 2) == 2137);
+	CHECK(Packet::scaleFloat(-1.5, 2) == -150);
+	CHECK(Packet::scaleFloat(-1.25, 1) == -13);
+	CHECK(Packet::scaleFloat(0.005, 2) == 1);
+	CHECK(Packet::scaleFloat(101325.42, 2) == 10132542);
+	CHECK(Packet::scaleFloat(50.668081, 6) == 50668079);
+	CHECK(Packet::scaleFloat(3e9, 0) == INT32_MAX);
+	CHECK(Packet::scaleFloat(-3e9, 0) == INT32_MIN);
+	CHECK(Packet::scaleFloat(3e9, 2) == (int64_t) INT32_MAX * 100);
+
+	uint32_t mismatches = 0;
+	for (int32_t i = -200000; i <= 200000; i++) {
+		float data = i * 0.0137f;
+		for (uint8_t precision = 0; precision <= 6; precision += 2) {
+			int64_t expected = (int64_t) round(data * pow(10.0, (double) precision));
+			int64_t scaled = Packet::scaleFloat(data, precision);
+			CHECK(llabs(scaled - expected) <= 1);
+			if (scaled != expected)
+				mismatches++;
+		}
+	}
+	// Only near half units, at the highest precision
+	CHECK(mismatches < 4 * 400001 / 100);
+}
+
+/**
+ * A packet without measurement store ignores the measurements,
+ * and still encodes its payloads, without any measurement.
+ */
+static void testNoMeasurementStore() {
+	for (uint8_t version = 1; version <= 5; version++) {
+		Packet packet(INTERVAL, 4, version);
+		fillPacket(packet, 4);
+		measurement_t measurement = packet.getMeasurement(0);
+		CHECK(measurement.battery == DEFAULT_INT);
+		CHECK(measurement.temperature == DEFAULT_FLOAT);
+		CHECK(packet.getNextBatchPayloadSize(0) == 0);
+		CHECK(packet.buildLoraPayload() != NULL);
+		CHECK(packet.getPayloadSize() > 0);
+	}
+}
+
+/**
+ * The measurement store only keeps the fields of the device, on the width of their quantization,
+ * and holds more measurements when fewer or narrower fields are kept.
+ */
+static void testMeasurementStore() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, MAX_MEASUREMENTS, 5);
+	packet.setMeasurementStore(&store);
+	// All the fields: location once, 25 bytes per measurement
+	CHECK(packet.getNMeasurements() == (MEASUREMENT_STORE_SIZE - LOCATION_DATA_SIZE) / MEASUREMENT_DATA_SIZE);
+
+	// BME280, MQ135 and sound sensor: 19 bytes per measurement
+	uint16_t fields = PRESENCE_BIT(HEADER_BATTERY) | PRESENCE_BIT(HEADER_TEMPERATURE) |
+	                  PRESENCE_BIT(HEADER_PRESSURE) | PRESENCE_BIT(HEADER_HUMIDITY) |
+	                  PRESENCE_BIT(HEADER_CO2) | PRESENCE_BIT(HEADER_NOISE) | LOCATION_FIELDS;
+	packet.setFields(fields);
+	CHECK(packet.getNMeasurements() == (MEASUREMENT_STORE_SIZE - 12) / 19);
+	// Narrower pressure and humidity: 15 bytes per measurement
+	packet.setQuantization(HEADER_PRESSURE, 80000, 1, 3);
+	packet.setQuantization(HEADER_HUMIDITY, 0, 0.5, 1);
+	uint8_t n = packet.getNMeasurements();
+	CHECK(n == (MEASUREMENT_STORE_SIZE - 12) / 15);
+	CHECK(n > 8);
+
+	packet.clearArray();
+	fillPacket(packet, n + 2);
+	CHECK(packet.getIndex() == n - 1);
+	measurement_t measurement = packet.getMeasurement(n - 1);
+	CHECK(measurement.battery == 90 - (n - 1));
+	CHECK(measurement.humidity == 45.5);
+	CHECK(measurement.pressure == 101325);
+	CHECK(fabs(measurement.temperature - 21.37) < 1e-4);
+	CHECK(fabs(measurement.latitude - 50.668081) < 1e-5);
+	// Fields not kept
+	CHECK(measurement.light == DEFAULT_INT);
+	CHECK(measurement.airQuality == DEFAULT_FLOAT);
+
+	// After a wake-up, the same configuration reads the same measurements
+	uint8_t payload[PAYLOAD_MAX_SIZE];
+	uint8_t size = 0;
+	Packet wokenPacket(INTERVAL, MAX_MEASUREMENTS, 5);
+	wokenPacket.setMeasurementStore(&store);
+	wokenPacket.setFields(fields);
+	wokenPacket.setQuantization(HEADER_PRESSURE, 80000, 1, 3);
+	wokenPacket.setQuantization(HEADER_HUMIDITY, 0, 0.5, 1);
+	wokenPacket.addBattery(90 - (n - 1), n - 1);
+	CHECK(packet.buildLoraPayload(payload, &size, sizeof(payload)) == payload);
+	fillPacket(packet, n);
+	uint8_t* wokenPayload = wokenPacket.buildLoraPayload();
+	CHECK(wokenPayload != NULL);
+	CHECK(wokenPacket.getPayloadSize() == size);
+	CHECK(memcmp(wokenPayload, payload, size) == 0);
+}
+
+/**
+ * Values recorded in the measurement store are encoded as before in versions 1 to 3,
+ * as the default quantization has the precision of these versions.
+ */
+static void testStoredValues() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 1, 1);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	packet.addBattery(87, 0);
+	packet.addTemperature(-12.34, 0);
+	packet.addPressure(101325.42, 0);
+	packet.addLatitude(50.668081, 0);
+	packet.addLongitude(-4.611562, 0);
+	packet.addNoise(1830, 0);
+	uint8_t* payload = packet.buildLoraPayload();
+	CHECK(payload != NULL);
+
+	uint8_t expected[PAYLOAD_SIZE_V1];
+	uint8_t i = 0;
+	expected[i++] = 1;
+	expected[i++] = HEADER_BATTERY;
+	expected[i++] = 87;
+	int64_t values[5] = {Packet::scaleFloat(-12.34, 2), Packet::scaleFloat(101325.42, 2),
+	                     Packet::scaleFloat(50.668081, 6), Packet::scaleFloat(-4.611562, 6), 1830};
+	uint8_t headers[5] = {HEADER_TEMPERATURE, HEADER_PRESSURE, HEADER_LATITUDE, HEADER_LONGITUDE, HEADER_NOISE};
+	for (uint8_t f = 0; f < 5; f++) {
+		uint8_t size = headers[f] == HEADER_NOISE ? 2 : 4;
+		expected[i++] = headers[f];
+		for (uint8_t b = 0; b < size; b++)
+			expected[i++] = (values[f] >> (8 * (size - 1 - b))) & 0xFF;
+	}
+	CHECK(packet.getPayloadSize() == i);
+	CHECK(memcmp(payload, expected, i) == 0);
+}
+
+/**
+ * Checks that two values of a field are equal, up to the float precision.
+ */
+static bool sameValue(float a, float b) {
+	return fabs(a - b) <= 1e-5 * (1 + fabs(a));
+}
+
+/**
+ * Checks that two measurements are equal, field by field of the schema.
+ */
+static bool sameMeasurement(const measurement_t& a, const measurement_t& b) {
+	bool same = true;
+#define TEST_FIELD_COMPARE(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	same = same && sameValue(a.member, b.member);
+	PACKET_FIELDS(TEST_FIELD_COMPARE)
+	return same;
+}
+
+/**
+ * Payloads of all versions are decoded by the C++ decoder generated from the field schema
+ * to the measurements recorded in the store, including absent fields,
+ * non-default quantizations and deltas.
+ */
+static void testDecoderRoundTrip() {
+	const uint8_t nMeasurements[5] = {1, 3, 8, 8, 20};
+	for (uint8_t version = 1; version <= 5; version++) {
+		MeasurementStore store;
+		uint8_t n = nMeasurements[version - 1];
+		Packet packet(INTERVAL, n, version);
+		packet.setMeasurementStore(&store);
+		packet.setFields(ALL_FIELDS & ~PRESENCE_BIT(HEADER_AIR_QUALITY) & ~PRESENCE_BIT(HEADER_LIGHT));
+		if (version == 5)
+			packet.setQuantization(HEADER_HUMIDITY, 0, 0.5, 1);
+		packet.clearArray();
+		fillPacket(packet, n);
+		// Absent values, and a negative value
+		packet.addNoise(DEFAULT_INT, 0);
+		packet.addTemperature(-5.25, n - 1);
+
+		measurement_t expected[MAX_MEASUREMENTS];
+		for (uint8_t i = 0; i < n; i++)
+			expected[i] = packet.getMeasurement(i);
+		uint8_t* payload = packet.buildLoraPayload();
+		CHECK(payload != NULL);
+
+		PacketDecoder decoder;
+		decoded_payload_t decoded;
+		CHECK(decoder.decode(payload, packet.getPayloadSize(), &decoded));
+		CHECK(decoded.version == version);
+		CHECK(decoded.interval == (version == 1 ? 0 : INTERVAL));
+		CHECK(decoded.nMeasurements == n);
+		for (uint8_t i = 0; i < n && i < decoded.nMeasurements; i++)
+			CHECK(sameMeasurement(expected[i], decoded.measurements[i]));
+		CHECK(decoded.measurements[0].noise == DEFAULT_INT);
+		CHECK(decoded.measurements[0].airQuality == DEFAULT_FLOAT);
+
+		// Truncated payloads are rejected
+		CHECK(!decoder.decode(payload, packet.getPayloadSize() - 1, &decoded));
+	}
+}
+
+/**
+ * Batches larger than the frame size are split at measurement boundaries into fragments
+ * that fit in the frame, and are reassembled by the decoder. Each fragment is a valid payload.
+ */
+static void testFragmentation() {
+	// Maximum payload size at SF12 in EU868
+	const uint8_t frameSize = 51;
+	const uint8_t nMeasurements[4] = {5, 8, 8, 32};
+	for (uint8_t version = 2; version <= 5; version++) {
+		MeasurementStore store;
+		uint8_t n = nMeasurements[version - 2];
+		Packet packet(INTERVAL, n, version);
+		packet.setMeasurementStore(&store);
+		packet.setFields(ALL_FIELDS & ~PRESENCE_BIT(HEADER_AIR_QUALITY));
+		packet.clearArray();
+		n = packet.getNMeasurements();
+		fillPacket(packet, n);
+		packet.addNoise(DEFAULT_INT, n - 1);
+		measurement_t expected[MAX_MEASUREMENTS];
+		for (uint8_t i = 0; i < n; i++)
+			expected[i] = packet.getMeasurement(i);
+
+		PacketDecoder decoder;
+		decoded_payload_t batch;
+		batch.received = 0;
+		uint8_t buffer[frameSize + 1];
+		uint8_t size;
+		uint8_t first = 0;
+		uint8_t nFragments = 0;
+		while (first < n && nFragments < n) {
+			uint8_t previous = first;
+			buffer[frameSize] = GUARD;
+			CHECK(packet.buildLoraFragment(buffer, &size, frameSize, 7, &first, n - 1) == buffer);
+			CHECK(size > FRAGMENT_HEADER_SIZE && size <= frameSize);
+			CHECK(buffer[frameSize] == GUARD);
+			CHECK(buffer[0] == 7 && buffer[1] == previous && buffer[2] == n - 1);
+			CHECK(first > previous);
+			nFragments++;
+			// The store is kept until the last fragment
+			CHECK((packet.getMeasurement(0).battery == DEFAULT_INT) == (first >= n));
+			// Each fragment can be decoded alone
+			decoded_payload_t alone;
+			CHECK(decoder.decode(buffer + FRAGMENT_HEADER_SIZE, size - FRAGMENT_HEADER_SIZE, &alone));
+			CHECK(alone.nMeasurements == first - previous);
+			CHECK(decoder.decodeFragment(buffer, size, &batch));
+		}
+		CHECK(nFragments > 1);
+		CHECK(decoder.isComplete(&batch));
+		CHECK(batch.version == version && batch.interval == INTERVAL && batch.sequence == 7);
+		CHECK(batch.nMeasurements == n);
+		for (uint8_t i = 0; i < n; i++)
+			CHECK(sameMeasurement(expected[i], batch.measurements[i]));
+	}
+
+	// Nothing to send, or not even one measurement fits in the frame
+	MeasurementStore store;
+	Packet packet(INTERVAL, 4, 4);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	fillPacket(packet, 4);
+	uint8_t buffer[PAYLOAD_MAX_SIZE];
+	uint8_t size;
+	uint8_t first = 4;
+	CHECK(packet.buildLoraFragment(buffer, &size, sizeof(buffer), 0, &first, 3) == NULL);
+	first = 0;
+	CHECK(packet.buildLoraFragment(buffer, &size, 20, 0, &first, 3) == NULL);
+	CHECK(size == 0 && first == 0);
+	CHECK(packet.getMeasurement(3).battery == 87);
+
+	// A fragment of another batch starts a new batch
+	PacketDecoder decoder;
+	decoded_payload_t batch;
+	batch.received = 0;
+	CHECK(packet.buildLoraFragment(buffer, &size, 51, 1, &first, 3) != NULL);
+	CHECK(decoder.decodeFragment(buffer, size, &batch));
+	buffer[0] = 2;
+	CHECK(decoder.decodeFragment(buffer, size, &batch));
+	CHECK(batch.sequence == 2 && batch.received == 1);
+	CHECK(!decoder.isComplete(&batch));
+}
+
+/**
+ * Uplinks sent again after an outage are decoded with their age,
+ * whether they are a whole payload or a fragment of a batch.
+ */
+static void testStoredUplink() {
+	MeasurementStore store;
+	Packet packet(INTERVAL, 4, 4);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	fillPacket(packet, 4);
+	measurement_t expected = packet.getMeasurement(3);
+	uint8_t buffer[STORED_HEADER_SIZE + PAYLOAD_MAX_SIZE];
+	uint8_t size;
+	CHECK(packet.buildLoraPayload(buffer + STORED_HEADER_SIZE, &size, PAYLOAD_MAX_SIZE) != NULL);
+	buffer[0] = 0x01;
+	buffer[1] = 0x2C;
+	buffer[2] = 2;
+
+	PacketDecoder decoder;
+	decoded_payload_t decoded;
+	CHECK(decoder.decodeStored(buffer, size + STORED_HEADER_SIZE, &decoded));
+	CHECK(decoded.age == 300);
+	CHECK(decoded.nMeasurements == 4);
+	CHECK(sameMeasurement(expected, decoded.measurements[3]));
+	CHECK(!decoder.decodeStored(buffer, STORED_HEADER_SIZE, &decoded));
+
+	// Fragment sent again, reassembled with the batch
+	packet.clearArray();
+	fillPacket(packet, 4);
+	uint8_t first = 2;
+	CHECK(packet.buildLoraFragment(buffer + STORED_HEADER_SIZE, &size, 115, 3, &first, 3) != NULL);
+	CHECK(first == 4);
+	buffer[2] = FRAGMENT_PORT;
+	decoded.received = 0;
+	CHECK(decoder.decodeStored(buffer, size + STORED_HEADER_SIZE, &decoded));
+	CHECK(decoded.age == 300 && decoded.sequence == 3);
+	CHECK(decoded.received == 0x0C && decoded.nMeasurements == 4);
+	CHECK(sameMeasurement(expected, decoded.measurements[3]));
+}
+
+/**
+ * The size of a batch can be computed before sending it, without clearing the store,
+ * so that the device can send as many measurements as fit in a frame.
+ */
+static void testBatchPayloadSize() {
+	// Maximum payload size at SF12 in EU868
+	const uint8_t frameSize = 51;
+	for (uint8_t version = 1; version <= 5; version++) {
+		MeasurementStore store;
+		Packet packet(INTERVAL, version == 1 ? 1 : MAX_MEASUREMENTS, version);
+		packet.setMeasurementStore(&store);
+		packet.setFields(PRESENCE_BIT(HEADER_BATTERY) | PRESENCE_BIT(HEADER_TEMPERATURE)
+		                 | PRESENCE_BIT(HEADER_HUMIDITY) | PRESENCE_BIT(HEADER_NOISE));
+		packet.clearArray();
+		uint8_t n = packet.getNMeasurements();
+		fillPacket(packet, n);
+		uint8_t previous = 0;
+		for (uint8_t i = 0; i < n; i++) {
+			uint8_t size = packet.getBatchPayloadSize(i);
+			CHECK(size == 0 || size > previous);
+			if (size == 0)
+				break;
+			previous = size;
+		}
+		CHECK(packet.getMeasurement(n - 1).battery == 90 - (n - 1));
+
+		// Batch sent when the next measurement would not fit, as done by EspDevice
+		packet.clearArray();
+		uint8_t count = 0;
+		while (true) {
+			fillPacket(packet, count + 1);
+			uint8_t nextSize = packet.getNextBatchPayloadSize(count);
+			// The store is left unchanged
+			CHECK(packet.getMeasurement(count + 1).battery == DEFAULT_INT);
+			if (nextSize == 0 || nextSize > frameSize)
+				break;
+			CHECK(nextSize > packet.getBatchPayloadSize(count));
+			count++;
+		}
+		if (version == 1)
+			CHECK(count == 0);
+		else
+			CHECK(count > 0 && count < n - 1);
+		uint8_t expected = packet.getBatchPayloadSize(count);
+		uint8_t buffer[frameSize];
+		uint8_t size;
+		CHECK(packet.buildLoraPayload(buffer, &size, sizeof(buffer)) == buffer);
+		CHECK(size == expected && size <= frameSize);
+	}
+}
+
+/**
+ * In aggregation mode, the payload contains the minimum, maximum, mean and
+ * standard deviation of the samples of each field, and the statistics are cleared once sent.
+ */
+static void testAggregation() {
+	// Running statistics
+	Aggregator aggregator;
+	aggregator.clear();
+	const float values[8] = {2, 4, 4, 4, 5, 5, 7, 9};
+	for (uint8_t i = 0; i < 8; i++)
+		aggregator.add(HEADER_TEMPERATURE - 1, values[i]);
+	CHECK(aggregator.getCount(HEADER_TEMPERATURE - 1) == 8 && aggregator.getSamples() == 8);
+	CHECK(aggregator.getCount(HEADER_NOISE - 1) == 0);
+	CHECK(aggregator.getMin(HEADER_TEMPERATURE - 1) == 2 && aggregator.getMax(HEADER_TEMPERATURE - 1) == 9);
+	CHECK(fabs(aggregator.getMean(HEADER_TEMPERATURE - 1) - 5) < 1e-5);
+	CHECK(fabs(aggregator.getStddev(HEADER_TEMPERATURE - 1) - sqrt(32.0 / 7)) < 1e-5);
+
+	// Only the bitmap formats support the aggregation mode
+	for (uint8_t version = 1; version <= 3; version++) {
+		Packet packet(INTERVAL, version == 1 ? 1 : 8, version);
+		CHECK(!packet.setAggregator(&aggregator) && !packet.isAggregating());
+	}
+
+	const uint8_t nSamples = 12;
+	for (uint8_t version = 4; version <= 5; version++) {
+		MeasurementStore store;
+		Packet packet(INTERVAL, 8, version);
+		packet.setMeasurementStore(&store);
+		packet.setFields(ALL_FIELDS & ~PRESENCE_BIT(HEADER_AIR_QUALITY));
+		packet.setQuantization(HEADER_HUMIDITY, 0, 0.5, 1);
+		aggregator.clear();
+		CHECK(packet.setAggregator(&aggregator) && packet.isAggregating());
+		packet.clearArray();
+		// One sample per wake-up, always in the first measurement of the store
+		for (uint8_t i = 0; i < nSamples; i++) {
+			packet.addLatitude(50.668081, 0);
+			packet.addLongitude(4.611562, 0);
+			packet.addAltitude(112.5, 0);
+			packet.addPressure(101325.42, 0);
+			packet.addCO2(412.2, 0);
+			packet.addBattery(90 - i, 0);
+			packet.addTemperature(20 + 0.25 * i, 0);
+			packet.addHumidity(i % 2 ? 40 : 50, 0);
+			packet.addNoise(DEFAULT_INT, 0);
+			packet.addLight(i < 4 ? 300 : DEFAULT_INT, 0);
+		}
+		CHECK(aggregator.getSamples() == nSamples);
+		CHECK(aggregator.getCount(HEADER_LIGHT - 1) == 4);
+		// The location is sent as is
+		CHECK(aggregator.getCount(HEADER_LATITUDE - 1) == 0);
+		float meanTemperature = aggregator.getMean(HEADER_TEMPERATURE - 1);
+		float stddevTemperature = aggregator.getStddev(HEADER_TEMPERATURE - 1);
+		float stddevHumidity = aggregator.getStddev(HEADER_HUMIDITY - 1);
+
+		// Aggregates are not fragmented
+		uint8_t buffer[PAYLOAD_MAX_SIZE];
+		uint8_t size;
+		uint8_t first = 0;
+		CHECK(packet.buildLoraFragment(buffer, &size, 20, 0, &first, 0) == NULL);
+
+		uint8_t* payload = packet.buildLoraPayload();
+		CHECK(payload != NULL);
+		CHECK(payload[0] == (version | AGGREGATE_FLAG | QUANTIZATION_FLAG));
+		CHECK(aggregator.getSamples() == 0);
+
+		PacketDecoder decoder;
+		decoded_payload_t decoded;
+		CHECK(decoder.decode(payload, packet.getPayloadSize(), &decoded));
+		CHECK(decoded.version == version && decoded.aggregate);
+		CHECK(decoded.samples == nSamples && decoded.nMeasurements == N_AGGREGATES);
+		measurement_t* statistics = decoded.measurements;
+		CHECK(statistics[AGGREGATE_MIN].battery == 90 - nSamples + 1);
+		CHECK(statistics[AGGREGATE_MAX].battery == 90);
+		CHECK(fabs(statistics[AGGREGATE_MIN].temperature - 20) < 0.005);
+		CHECK(fabs(statistics[AGGREGATE_MAX].temperature - (20 + 0.25 * (nSamples - 1))) < 0.005);
+		CHECK(fabs(statistics[AGGREGATE_MEAN].temperature - meanTemperature) < 0.005);
+		CHECK(fabs(statistics[AGGREGATE_STDDEV].temperature - stddevTemperature) < 0.005);
+		CHECK(statistics[AGGREGATE_MIN].humidity == 40 && statistics[AGGREGATE_MAX].humidity == 50);
+		CHECK(fabs(statistics[AGGREGATE_STDDEV].humidity - stddevHumidity) <= 0.25);
+		CHECK(statistics[AGGREGATE_MEAN].light == 300 && statistics[AGGREGATE_STDDEV].light == 0);
+		for (uint8_t i = 0; i < N_AGGREGATES; i++) {
+			CHECK(statistics[i].noise == DEFAULT_INT);
+			CHECK(statistics[i].airQuality == DEFAULT_FLOAT);
+			CHECK(fabs(statistics[i].latitude - 50.668081) < 1e-5);
+		}
+
+		// Truncated payloads are rejected, and aggregates are not fragments
+		CHECK(!decoder.decode(payload, packet.getPayloadSize() - 1, &decoded));
+		memcpy(buffer + FRAGMENT_HEADER_SIZE, payload, packet.getPayloadSize());
+		buffer[0] = buffer[1] = buffer[2] = 0;
+		decoded.received = 0;
+		CHECK(!decoder.decodeFragment(buffer, packet.getPayloadSize() + FRAGMENT_HEADER_SIZE, &decoded));
+	}
+}
+
+int main() {
+	testNoHeapAllocation();
+	testInternalBufferSize();
+	testOverflow();
+	testSamePayload();
+	testBitmapPayload();
+	testDeltaPayload();
+	testDeltaExtremes();
+	testQuantization();
+	testQuantizationBeforeVersion4();
+	testScaleFloat();
+	testMeasurementStore();
+	testNoMeasurementStore();
+	testStoredValues();
+	testDecoderRoundTrip();
+	testFragmentation();
+	testStoredUplink();
+	testBatchPayloadSize();
+	testAggregation();
+	if (failures > 0) {
+		printf("PacketTest: %d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("PacketTest: all checks passed\n");
+	return 0;
+}
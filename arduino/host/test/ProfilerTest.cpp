@@ -0,0 +1,119 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host tests of the wake cycle profiler (WakeProfiler library).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "WakeProfiler.h"
+#include "Check.h"
+
+/**
+ * Reads a varint from a summary.
+ * @param payload: summary
+ * @param offset: offset of the varint, moved after it
+ * @return: the value of the varint
+ */
+static uint32_t readVarint(const uint8_t* payload, uint8_t* offset) {
+	uint32_t data = 0;
+	uint8_t shift = 0;
+	uint8_t byte;
+	do {
+		byte = payload[(*offset)++];
+		data |= (uint32_t) (byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return data;
+}
+
+/**
+ * The durations of each phase are accumulated in a histogram,
+ * with a bucket per power of 4 from PROFILE_BUCKET_BASE_US.
+ */
+static void testRecord() {
+	WakeProfiler profiler;
+	profiler.clear();
+	CHECK(profiler.isEmpty());
+	profiler.record(PROFILE_WARMUP, 100);
+	profiler.record(PROFILE_WARMUP, 250);
+	profiler.record(PROFILE_WARMUP, 3000000);
+	profiler.record(PROFILE_WARMUP, 4000000000UL);
+	profiler.record(PROFILE_PHASES, 100);
+	CHECK(!profiler.isEmpty());
+	CHECK(profiler.getCount(PROFILE_WARMUP) == 4);
+	CHECK(profiler.getCount(PROFILE_SETUP) == 0 && profiler.getMean(PROFILE_SETUP) == 0);
+	CHECK(profiler.getMax(PROFILE_WARMUP) == 4000000000UL);
+	CHECK(profiler.getMean(PROFILE_WARMUP) == (100 + 250 + 3000000 + 4000000000ULL) / 4);
+	CHECK(profiler.getBucket(PROFILE_WARMUP, 0) == 2);
+	// 3 s: bucket of [1.024 s, 4.096 s)
+	CHECK(profiler.getBucket(PROFILE_WARMUP, 6) == 1);
+	CHECK(profiler.getBucket(PROFILE_WARMUP, PROFILE_BUCKETS - 1) == 1);
+
+	// Timing with the cycle counter
+	profile_timer_t timer = WakeProfiler::start();
+	delay(2);
+	uint32_t duration = WakeProfiler::elapsed(&timer);
+	CHECK(duration >= 2000 && duration < 1000000);
+	profiler.stop(PROFILE_BUILD, &timer);
+	CHECK(profiler.getCount(PROFILE_BUILD) == 1 && profiler.getMax(PROFILE_BUILD) >= duration);
+}
+
+/**
+ * The summary contains the phases fitting in the buffer, which are cleared;
+ * the other ones are sent in the next summary.
+ */
+static void testSummary() {
+	WakeProfiler profiler;
+	profiler.clear();
+	uint8_t buffer[64];
+	CHECK(profiler.buildSummary(buffer, sizeof(buffer)) == 0);
+	for (uint8_t cycle = 0; cycle < 20; cycle++) {
+		profiler.record(PROFILE_SETUP, 120000 + cycle);
+		profiler.record(PROFILE_READ + 2, 3000);
+		profiler.record(PROFILE_LORA_TX, 1500000);
+		profiler.endCycle();
+	}
+	CHECK(profiler.getCycles() == 20);
+
+	// Only the first phase fits
+	uint8_t size = profiler.buildSummary(buffer, 18);
+	CHECK(size > PROFILE_SUMMARY_HEADER_SIZE && size <= 18);
+	CHECK(buffer[0] == PROFILE_SUMMARY_VERSION && buffer[1] == 20);
+	CHECK(buffer[2] == 0 && buffer[3] == 1 << PROFILE_SETUP);
+	uint8_t offset = PROFILE_SUMMARY_HEADER_SIZE;
+	CHECK(readVarint(buffer, &offset) == 20);
+	CHECK(readVarint(buffer, &offset) == 120009);
+	CHECK(readVarint(buffer, &offset) == 120019);
+	// 120 ms: bucket of [64 ms, 256 ms), saturated at 15
+	CHECK(buffer[offset + 2] == 0xF0 && buffer[offset] == 0 && buffer[offset + 3] == 0);
+	CHECK(offset + PROFILE_HISTOGRAM_SIZE == size);
+	CHECK(profiler.getCount(PROFILE_SETUP) == 0 && profiler.getCycles() == 0);
+
+	// The phases are sent in turn, each summary starting after the last phase of the previous one
+	profiler.record(PROFILE_SETUP, 110000);
+	profiler.endCycle();
+	size = profiler.buildSummary(buffer, 18);
+	CHECK(buffer[1] == 1 && buffer[2] == 0 && buffer[3] == 1 << PROFILE_LORA_TX);
+	size = profiler.buildSummary(buffer, sizeof(buffer));
+	uint16_t bitmap = (buffer[2] << 8) | buffer[3];
+	CHECK(bitmap == ((1 << PROFILE_SETUP) | (1 << (PROFILE_READ + 2))));
+	offset = PROFILE_SUMMARY_HEADER_SIZE;
+	CHECK(readVarint(buffer, &offset) == 1);
+	CHECK(profiler.isEmpty());
+	CHECK(profiler.buildSummary(buffer, sizeof(buffer)) == 0);
+}
+
+int main() {
+	testRecord();
+	testSummary();
+	if (failures > 0) {
+		printf("ProfilerTest: %d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("ProfilerTest: all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,1025 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host simulation tests of the ESP32 devices (EspDevice library and sensor drivers):
+ * weeks of wake cycles on the virtual clock, checking the uplinks,
+ * the decoded measurements and the time awake.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+
+#include "Simulation.h"
+#include "SimBme280.h"
+#include "SimBme680.h"
+#include "SimGps.h"
+#include "SimFreeRTOS.h"
+#include "EspDevice.h"
+#include "Bme280Driver.h"
+#include "Bme680Driver.h"
+#include "GasSensorDriver.h"
+#include "SoundSensorDriver.h"
+#include "GpsDriver.h"
+#include "PacketDecoder.h"
+#include "LocationCache.h"
+#include "Check.h"
+
+// Pins of the sensors
+#define SDA_PIN   4
+#define SCL_PIN   15
+#define GAS_PIN   37
+#define SOUND_PIN 39
+#define GPS_RX    16
+#define GPS_TX    17
+#define GPS_BAUD  9600
+// I2C address of the BME680 (the one of the BME280 is defined by its driver)
+#define BME680_ADDRESS 0x77
+// Raw battery level, between MIN_ANALOG and MAX_ANALOG
+#define BATTERY_LEVEL 1900
+
+/* Device credentials, unused by the loopback network */
+static uint32_t license[4] = {0x00000000, 0x00000000, 0x00000000, 0x00000000};
+static uint8_t devEui[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
+static uint8_t appEui[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+static uint8_t appKey[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                           0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+/* Fake sensors, which stay attached across the boots */
+static SimBme280 bme280;
+static SimBme680 bme680;
+static SimGps gps;
+
+// Configuration of a sketch after the setup of the device, like the generated sketches
+typedef void (*sim_configure_t)(EspDevice* esp);
+
+/* Weather station: BME280, sound sensor and GPS, like the esp-example sketch */
+class WeatherStation : public SimSketch {
+
+	public:
+		WeatherStation(uint8_t period, uint8_t nMeasurements, uint8_t version, uint8_t profile,
+		               sim_configure_t configure = NULL)
+			: _esp(license, devEui, appEui, appKey),
+			  _bme280(SDA_PIN, SCL_PIN, 30, 102000, 80),
+			  _sound(SOUND_PIN, 4090),
+			  _gps(GPS_BAUD, GPS_RX, GPS_TX)
+		{
+			_period = period;
+			_nMeasurements = nMeasurements;
+			_version = version;
+			_profile = profile;
+			_configure = configure;
+		}
+
+		void setup() {
+			_esp.initPacket(_period, _nMeasurements, _version);
+			_esp.initWifi("SSID", "PASSWORD", "KEY", "https://influx.example/api", "TOKEN");
+			if (_profile > 0)
+				_esp.initProfiler(_profile);
+			_esp.setup();
+			if (_configure != NULL)
+				_configure(&_esp);
+			_esp.addSensor(&_bme280);
+			_esp.addSensor(&_sound);
+			_esp.addSensor(&_gps);
+		}
+
+		void loop() {
+			_esp.loop();
+		}
+
+	private:
+		EspDevice _esp;
+		Bme280Driver _bme280;
+		SoundSensorDriver _sound;
+		GpsDriver _gps;
+		uint8_t _period;
+		uint8_t _nMeasurements;
+		uint8_t _version;
+		uint8_t _profile;
+		sim_configure_t _configure;
+
+};
+
+/* Air quality station: BME680 and MQ135, in aggregation mode */
+class AirQualityStation : public SimSketch {
+
+	public:
+		AirQualityStation(uint8_t period, uint8_t samples)
+			: _esp(license, devEui, appEui, appKey),
+			  _bme680(SDA_PIN, SCL_PIN, 30, 102000, 80, 200),
+			  _gas(GAS_PIN, 5000)
+		{
+			_period = period;
+			_samples = samples;
+		}
+
+		void setup() {
+			_esp.initPacket(_period, 1, 4);
+			_esp.initWifi("SSID", "PASSWORD", "KEY", "https://influx.example/api", "TOKEN");
+			_esp.initAggregation(_samples);
+			_esp.setup();
+			_esp.addSensor(&_bme680);
+			_esp.addSensor(&_gas);
+		}
+
+		void loop() {
+			_esp.loop();
+		}
+
+	private:
+		EspDevice _esp;
+		Bme680Driver _bme680;
+		GasSensorDriver _gas;
+		uint8_t _period;
+		uint8_t _samples;
+
+};
+
+// File receiving the uplinks of the scenarios, with their decoding by PacketDecoder,
+// checked against the decoder of The Things Network by test/DecoderTest.js (none by default)
+static FILE* uplinksFile = NULL;
+
+// Writes the present fields of a decoded measurement as JSON members, with or without its location
+#define WRITE_FIELD(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	if (isPresentValue<type>(measurement->member) && (withLocation || !location)) \
+		fprintf(uplinksFile, ",\"%s\":%.9g", key, (double) measurement->member);
+
+// Writes the statistics of a field of a decoded aggregated payload as a JSON member
+#define WRITE_STATISTICS(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	if (!location && isPresentValue<type>(payload->measurements[AGGREGATE_MEAN].member)) { \
+		fprintf(uplinksFile, "%s\"%s\":{", separator, key); \
+		const char* statistic = ""; \
+		for (uint8_t i = AGGREGATE_MIN; i <= AGGREGATE_STDDEV; i++) { \
+			if (isPresentValue<type>(payload->measurements[i].member)) { \
+				fprintf(uplinksFile, "%s\"%s\":%.9g", statistic, STATISTICS[i], (double) payload->measurements[i].member); \
+				statistic = ","; \
+			} \
+		} \
+		fprintf(uplinksFile, "}"); \
+		separator = ","; \
+	}
+
+/**
+ * Writes a measurement of a decoded payload as a JSON object.
+ * @param measurement: decoded measurement
+ * @param timestamp: timestamp of the measurement in its batch
+ * @param withLocation: true to write the location with the measurement
+ */
+static void writeMeasurement(const measurement_t* measurement, uint8_t timestamp, bool withLocation) {
+	fprintf(uplinksFile, "{\"timestamp\":%u", timestamp);
+	PACKET_FIELDS(WRITE_FIELD)
+	fprintf(uplinksFile, "}");
+}
+
+/**
+ * Writes a payload decoded by PacketDecoder as a JSON object, like the TTN decoder,
+ * with the location of the batch in each measurement.
+ * @param payload: decoded payload
+ * @param stored: true if the payload was sent again after an outage
+ * @param fragment: true if the payload is a fragment, with some measurements of its batch
+ */
+static void writePayload(const decoded_payload_t* payload, bool stored, bool fragment) {
+	static const char* STATISTICS[] = {"min", "max", "mean", "stddev"};
+	fprintf(uplinksFile, "{\"version\":%u", payload->version);
+	if (payload->version >= 2)
+		fprintf(uplinksFile, ",\"interval\":%u", payload->interval);
+	if (stored)
+		fprintf(uplinksFile, ",\"age\":%u", payload->age);
+	if (fragment)
+		fprintf(uplinksFile, ",\"sequence\":%u,\"lastTimestamp\":%u", payload->sequence, payload->nMeasurements - 1);
+	fprintf(uplinksFile, ",\"measurements\":[");
+	if (payload->aggregate) {
+		writeMeasurement(&payload->measurements[AGGREGATE_MEAN], 0, true);
+		fprintf(uplinksFile, "],\"samples\":%u,\"statistics\":{", payload->samples);
+		const char* separator = "";
+		PACKET_FIELDS(WRITE_STATISTICS)
+		fprintf(uplinksFile, "}}");
+		return;
+	}
+	const char* separator = "";
+	for (uint8_t i = 0; i < payload->nMeasurements; i++) {
+		// Fragments: only the measurements of the fragment
+		if (!(payload->received & ((uint32_t) 1 << i)))
+			continue;
+		fprintf(uplinksFile, "%s", separator);
+		writeMeasurement(&payload->measurements[i], i, true);
+		separator = ",";
+	}
+	fprintf(uplinksFile, "]}");
+}
+
+/**
+ * Writes the uplinks of a scenario to uplinksFile, one JSON object per line:
+ * name of the scenario, port, payload, and payload decoded by PacketDecoder
+ * (null for the summaries of the profiler, which it does not decode).
+ * @param name: name of the scenario
+ */
+static void writeUplinks(const char* name) {
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		fprintf(uplinksFile, "{\"scenario\":\"%s\",\"fPort\":%u,\"bytes\":[", name, uplink.port);
+		for (size_t i = 0; i < uplink.payload.size(); i++)
+			fprintf(uplinksFile, "%s%u", i == 0 ? "" : ",", uplink.payload[i]);
+		fprintf(uplinksFile, "],\"expected\":");
+		PacketDecoder decoder;
+		decoded_payload_t payload;
+		payload.received = 0;
+		bool valid = false;
+		if (uplink.port == FRAGMENT_PORT)
+			valid = decoder.decodeFragment(uplink.payload.data(), uplink.payload.size(), &payload);
+		else if (uplink.port == STORED_PORT)
+			valid = decoder.decodeStored(uplink.payload.data(), uplink.payload.size(), &payload);
+		else if (uplink.port != PROFILE_PORT)
+			valid = decoder.decode(uplink.payload.data(), uplink.payload.size(), &payload);
+		bool stored = uplink.port == STORED_PORT;
+		bool fragment = uplink.port == FRAGMENT_PORT || (stored && uplink.payload[2] == FRAGMENT_PORT);
+		if (valid)
+			writePayload(&payload, stored, fragment);
+		else
+			fprintf(uplinksFile, "null");
+		fprintf(uplinksFile, "}\n");
+	}
+}
+
+/**
+ * Runs a scenario in a new process, so that the device starts from a power-on,
+ * with a clean RTC memory.
+ * @param name: name of the scenario
+ * @param scenario: function of the scenario
+ */
+static void runScenario(const char* name, void (*scenario)()) {
+	fflush(NULL);
+	pid_t pid = fork();
+	if (pid == 0) {
+		failures = 0;
+		Serial.setSilent(true);
+		SimHal::setAnalog(BATTERY_PIN, SimHal::constant(BATTERY_LEVEL));
+		Wire.attach(BME280_DRIVER_ADDRESS, &bme280);
+		Wire.attach(BME680_ADDRESS, &bme680);
+		HardwareSerial::attach(GPS_UART, &gps);
+		scenario();
+		if (uplinksFile != NULL) {
+			writeUplinks(name);
+			fflush(uplinksFile);
+		}
+		fflush(stdout);
+		_exit(failures > 0);
+	}
+	int status;
+	if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		printf("scenario %s failed\n", name);
+		failures++;
+	}
+}
+
+/**
+ * Decodes the uplinks of a port.
+ * @param port: LoRaWAN port
+ * @param decoded: decoded payloads, one per uplink
+ * @return: true if all the uplinks were decoded
+ */
+static bool decodeUplinks(uint8_t port, std::vector<decoded_payload_t>* decoded) {
+	PacketDecoder decoder;
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		if (uplink.port != port)
+			continue;
+		decoded_payload_t payload;
+		if (!decoder.decode(uplink.payload.data(), uplink.payload.size(), &payload))
+			return false;
+		decoded->push_back(payload);
+	}
+	return true;
+}
+
+/**
+ * Checks that the objects and the arrays of a JSON document are balanced,
+ * outside of its strings.
+ * @param json: JSON document
+ * @return: true if the document is balanced, false otherwise
+ */
+static bool isBalancedJson(const std::string& json) {
+	std::string open;
+	bool string = false;
+	for (char c : json) {
+		if (c == '"')
+			string = !string;
+		else if (string)
+			continue;
+		else if (c == '{' || c == '[')
+			open.push_back(c);
+		else if (c == '}' || c == ']') {
+			if (open.empty() || open.back() != (c == '}' ? '{' : '['))
+				return false;
+			open.pop_back();
+		}
+	}
+	return open.empty() && !string;
+}
+
+/**
+ * A month of a weather station waking up every 10 minutes: one join, then one uplink
+ * every 4 measurements, with the scripted values, each wake cycle bounded by the
+ * time to fix of the GPS and the receive windows.
+ */
+static void testWeatherStation() {
+	bme280.setTemperature([](uint64_t time) { return 15 + 5 * sin(2 * PI * time / 86400000.0); });
+	bme280.setPressure(SimHal::constant(100500));
+	bme280.setHumidity(SimHal::constant(65));
+	SimHal::setAnalog(SOUND_PIN, SimHal::constant(1200));
+	gps.setLocation(50.6681, 4.6118, 160);
+	gps.setFix(8000, 1.2);
+	SimWifi::setLocation(50.85, 4.35, 30);
+	Simulation simulation([]() { return new WeatherStation(10, 4, 3, 0); });
+	CHECK(simulation.run(SIM_DAYS(30)));
+
+	// The first wake cycle joins, the others measure
+	uint32_t cycles = simulation.getWakeups() - 1;
+	CHECK(SimLoRaWAN::getJoins() == 1);
+	CHECK(SimWifi::getLocations() == 1);
+	// The wake-up timer starts after the measurements
+	CHECK(cycles >= 30 * 24 * 6 * 0.97 && cycles <= 30 * 24 * 6);
+	CHECK(simulation.getUplinks(LORA_PORT) == cycles / 4);
+	CHECK(SimLoRaWAN::getUplinks().size() == cycles / 4);
+	CHECK(SimWifi::getPosts().empty());
+
+	std::vector<decoded_payload_t> decoded;
+	CHECK(decodeUplinks(LORA_PORT, &decoded));
+	CHECK(decoded.size() == cycles / 4);
+	for (const decoded_payload_t& payload : decoded) {
+		CHECK(payload.version == 3 && payload.nMeasurements == 4);
+		for (uint8_t i = 0; i < payload.nMeasurements; i++) {
+			const measurement_t* measurement = &payload.measurements[i];
+			CHECK(measurement->temperature >= 9.9 && measurement->temperature <= 20.1);
+			CHECK(fabs(measurement->pressure - 100500) < 2);
+			CHECK(fabs(measurement->humidity - 65) < 0.1);
+			CHECK(measurement->noise == 1200);
+			CHECK(fabs(measurement->latitude - 50.6681) < 0.0001);
+			CHECK(fabs(measurement->longitude - 4.6118) < 0.0001);
+			CHECK(fabs(measurement->altitude - 160) < 0.1);
+		}
+	}
+
+	// Awake: the time to fix of the GPS, the uplink and its receive windows
+	CHECK(simulation.getMeanAwakeTime() > SIM_SECONDS(8));
+	CHECK(simulation.getMaxAwakeTime() < SIM_SECONDS(11));
+	// Far below the duty cycle of the band (1 %)
+	CHECK(SimLoRaWAN::getAirtime() < SIM_DAYS(30) / 1000);
+	// Three acquisition tasks per wake cycle, without leaking their synchronization objects
+	CHECK(SimFreeRTOS::getTasks() == 3 * cycles);
+	CHECK(SimFreeRTOS::getLiveObjects() == 0);
+}
+
+/**
+ * Without a GPS fix, the warm-up ends at its timeout, and the location of the Wi-Fi
+ * geolocation is sent instead.
+ */
+static void testNoFix() {
+	gps.setFix(UINT32_MAX, 1.2);
+	SimWifi::setLocation(50.85, 4.35, 30);
+	Simulation simulation([]() { return new WeatherStation(15, 2, 3, 0); });
+	CHECK(simulation.run(SIM_DAYS(2)));
+	uint32_t cycles = simulation.getWakeups() - 1;
+	CHECK(simulation.getUplinks(LORA_PORT) == cycles / 2);
+	CHECK(simulation.getMaxAwakeTime() < SIM_SECONDS(VEXT_DELAY_SEC + 3));
+	CHECK(simulation.getMaxAwakeTime() > SIM_SECONDS(VEXT_DELAY_SEC));
+	std::vector<decoded_payload_t> decoded;
+	CHECK(decodeUplinks(LORA_PORT, &decoded));
+	CHECK(!decoded.empty());
+	for (const decoded_payload_t& payload : decoded) {
+		CHECK(fabs(payload.measurements[0].latitude - 50.85) < 0.0001);
+		CHECK(fabs(payload.measurements[0].longitude - 4.35) < 0.0001);
+	}
+	// The location is requested with the access points of a full scan, strongest first,
+	// and cached for the next power-on
+	CHECK(SimWifi::getLocations() == 1);
+	CHECK(SimWifi::getScans() == 1 && SimWifi::getScannedChannels() == SIM_SCAN_CHANNELS);
+	const std::string& body = SimWifi::getLocationBody();
+	CHECK(isBalancedJson(body));
+	CHECK(body.find("{\"wifiAccessPoints\":[{\"macAddress\":\"24:0A:C4:5E:1C:70\",\"signalStrength\":-55,\"channel\":6},") == 0);
+	CHECK(body.find("60:38:E0:11:22:05\",\"signalStrength\":-90,\"channel\":11}]}") != std::string::npos);
+	Preferences preferences;
+	location_table_t table;
+	CHECK(preferences.begin(WIFI_LOCATION_NAMESPACE, true));
+	CHECK(preferences.getBytes(WIFI_LOCATION_KEY, &table, sizeof(table)) == sizeof(table));
+	CHECK(table.count == 1 && table.entries[0].fingerprint.size == SimWifi::getAccessPoints().size());
+	CHECK(fabs(table.entries[0].latitude - 50.85) < 0.0001 && table.entries[0].accuracy == 30);
+	CHECK(preferences.getUShort(WIFI_LOCATION_CHANNELS_KEY) == ((1 << 1) | (1 << 6) | (1 << 11)));
+}
+
+/**
+ * Without a GPS fix, a scan similar to a fingerprint of the location cache reuses its
+ * location, without connection nor geolocation request.
+ */
+static void testLocationCache() {
+	gps.setFix(UINT32_MAX, 1.2);
+	SimWifi::setLocation(50.85, 4.35, 30);
+	// Cached at a previous power-on, with an access point since gone and one since added
+	std::vector<sim_access_point_t> accessPoints = SimWifi::getAccessPoints();
+	LocationCache cache;
+	location_fingerprint_t fingerprint;
+	LocationCache::initFingerprint(&fingerprint);
+	uint8_t gone[6] = {0x60, 0x38, 0xe0, 0x11, 0x22, 0xff};
+	LocationCache::addAccessPoint(&fingerprint, gone, -50);
+	for (size_t i = 0; i + 1 < accessPoints.size(); i++)
+		LocationCache::addAccessPoint(&fingerprint, accessPoints[i].bssid, accessPoints[i].rssi);
+	cache.add(&fingerprint, 50.6681, 4.6118, 20);
+	Preferences preferences;
+	preferences.begin(WIFI_LOCATION_NAMESPACE);
+	preferences.putBytes(WIFI_LOCATION_KEY, cache.getTable(), sizeof(location_table_t));
+	preferences.end();
+
+	Simulation simulation([]() { return new WeatherStation(15, 2, 3, 0); });
+	CHECK(simulation.run(SIM_DAYS(1)));
+	CHECK(SimWifi::getScans() == 1);
+	CHECK(SimWifi::getConnections() == 0);
+	CHECK(SimWifi::getLocations() == 0);
+	std::vector<decoded_payload_t> decoded;
+	CHECK(decodeUplinks(LORA_PORT, &decoded));
+	CHECK(!decoded.empty());
+	for (const decoded_payload_t& payload : decoded) {
+		CHECK(fabs(payload.measurements[0].latitude - 50.6681) < 0.0001);
+		CHECK(fabs(payload.measurements[0].longitude - 4.6118) < 0.0001);
+	}
+}
+
+/**
+ * The passive scans restricted to the channels seen by the last full scan of the
+ * access points find the same access points, in a few channels.
+ */
+static void testSeenChannels() {
+	gps.setFix(UINT32_MAX, 1.2);
+	SimWifi::setLocation(50.85, 4.35, 30);
+	Preferences preferences;
+	preferences.begin(WIFI_LOCATION_NAMESPACE);
+	preferences.putUShort(WIFI_LOCATION_CHANNELS_KEY, (1 << 1) | (1 << 6) | (1 << 11));
+	preferences.end();
+	Simulation simulation([]() {
+		return new WeatherStation(15, 2, 3, 0, [](EspDevice* esp) { esp->setWifiScan(true, true, 110); });
+	});
+	CHECK(simulation.run(SIM_HOURS(6)));
+	CHECK(SimWifi::getScans() == 3 && SimWifi::getScannedChannels() == 3);
+	CHECK(SimWifi::getLocations() == 1);
+	const std::string& body = SimWifi::getLocationBody();
+	size_t accessPoints = 0;
+	for (size_t i = body.find("macAddress"); i != std::string::npos; i = body.find("macAddress", i + 1))
+		accessPoints++;
+	CHECK(accessPoints == SimWifi::getAccessPoints().size());
+	std::vector<decoded_payload_t> decoded;
+	CHECK(decodeUplinks(LORA_PORT, &decoded));
+	CHECK(!decoded.empty() && fabs(decoded[0].measurements[0].latitude - 50.85) < 0.0001);
+}
+
+/**
+ * A temperature above the emergency threshold sends the measurements over Wi-Fi
+ * instead of LoRaWAN, once when the emergency is raised: the emergency is raised
+ * again only after the temperature went back below the threshold.
+ */
+static void testEmergency() {
+	// Two heat waves, on the second and on the third day
+	bme280.setTemperature([](uint64_t time) {
+		uint64_t hours = time / 3600000;
+		return (hours >= 30 && hours < 36) || (hours >= 54 && hours < 56) ? 35.0f : 20.0f;
+	});
+	gps.setFix(5000, 1.2);
+	Simulation simulation([]() { return new WeatherStation(10, 6, 3, 0); });
+	CHECK(simulation.run(SIM_DAYS(3)));
+	const std::vector<sim_post_t>& posts = SimWifi::getPosts();
+	CHECK(posts.size() == 2);
+	for (const sim_post_t& post : posts) {
+		CHECK(post.url == "https://influx.example/api");
+		CHECK(post.body.find("temperature") != std::string::npos);
+		// Each post with its own measurements array
+		CHECK(post.body.find("\"measurements\": [") != std::string::npos);
+		CHECK(isBalancedJson(post.body));
+	}
+	// Within a wake-up period of the start of the heat waves
+	CHECK(posts.size() < 1 || (posts[0].time >= SIM_HOURS(30) && posts[0].time < SIM_HOURS(30) + SIM_MINUTES(11)));
+	CHECK(posts.size() < 2 || (posts[1].time >= SIM_HOURS(54) && posts[1].time < SIM_HOURS(54) + SIM_MINUTES(11)));
+	// One connection for the location at the join, and one per post
+	CHECK(SimWifi::getConnections() == posts.size() + 1);
+	// TLS handshakes at full speed
+	CHECK(SimWifi::getHandshakeTime() == (posts.size() + 1) * (SIM_MS(500) * 80 / 240));
+}
+
+/**
+ * The binary Wi-Fi uplinks post the payload of the emergency measurements,
+ * with the DevEUI of the device and the LoRaWAN port of the payload.
+ */
+static void testBinaryEmergency() {
+	bme280.setTemperature([](uint64_t time) {
+		uint64_t hours = time / 3600000;
+		return (hours >= 30 && hours < 36) || (hours >= 54 && hours < 56) ? 35.0f : 20.0f;
+	});
+	gps.setFix(5000, 1.2);
+	Simulation simulation([]() {
+		return new WeatherStation(10, 6, 3, 0, [](EspDevice* esp) { esp->initWifiBinary(); });
+	});
+	CHECK(simulation.run(SIM_DAYS(3)));
+	const std::vector<sim_post_t>& posts = SimWifi::getPosts();
+	CHECK(posts.size() == 2);
+	PacketDecoder decoder;
+	for (const sim_post_t& post : posts) {
+		CHECK(post.headers.at("Content-Type") == "application/octet-stream");
+		CHECK(post.headers.at("x-dev-eui") == "0000000000000001");
+		CHECK(post.headers.at("x-f-port") == "2");
+		decoded_payload_t payload;
+		CHECK(decoder.decode((const uint8_t*) post.body.data(), post.body.size(), &payload));
+		CHECK(payload.version == 3);
+		CHECK(payload.nMeasurements >= 1);
+		CHECK(fabs(payload.measurements[payload.nMeasurements - 1].temperature - 35) < 0.01);
+	}
+}
+
+/**
+ * The Wi-Fi connections after the join go straight to the access point of the
+ * connection cache, without scan nor DHCP, and fall back to the full scan once
+ * the access point moved to another channel.
+ */
+static void testReconnect() {
+	// Three heat waves, on the second and on the third day
+	bme280.setTemperature([](uint64_t time) {
+		uint64_t hours = time / 3600000;
+		return (hours >= 30 && hours < 32) || (hours >= 54 && hours < 56) || (hours >= 60 && hours < 62) ? 35.0f : 20.0f;
+	});
+	SimWifi::setChannel([](uint64_t time) { return time < 50 * 3600000ULL ? 6 : 11; });
+	gps.setFix(5000, 1.2);
+	Simulation simulation([]() { return new WeatherStation(10, 6, 3, 0); });
+	CHECK(simulation.run(SIM_DAYS(3)));
+	CHECK(SimWifi::getPosts().size() == 3);
+	// Scans at the join and after the move of the access point
+	CHECK(SimWifi::getConnections() == 4);
+	CHECK(SimWifi::getReconnections() == 2);
+	CHECK(SimWifi::getStaticConnections() == 2);
+}
+
+/**
+ * With a static IP configuration, no connection waits for DHCP.
+ */
+static void testStaticIp() {
+	bme280.setTemperature([](uint64_t time) {
+		uint64_t hours = time / 3600000;
+		return hours >= 30 && hours < 32 ? 35.0f : 20.0f;
+	});
+	gps.setFix(5000, 1.2);
+	Simulation simulation([]() {
+		return new WeatherStation(10, 6, 3, 0, [](EspDevice* esp) {
+			esp->setWifiStaticIp("192.168.1.50", "192.168.1.1", "255.255.255.0", "192.168.1.1");
+		});
+	});
+	CHECK(simulation.run(SIM_DAYS(2)));
+	CHECK(SimWifi::getPosts().size() == 1);
+	CHECK(SimWifi::getConnections() == 2);
+	CHECK(SimWifi::getReconnections() == 1);
+	CHECK(SimWifi::getStaticConnections() == 2);
+}
+
+/**
+ * The summaries of the wake cycle profiler are sent in their own uplinks,
+ * on the profiler port.
+ */
+static void testProfiler() {
+	gps.setFix(5000, 1.2);
+	Simulation simulation([]() { return new WeatherStation(5, 3, 3, 144); });
+	CHECK(simulation.run(SIM_DAYS(7)));
+	uint32_t summaries = simulation.getUplinks(PROFILE_PORT);
+	CHECK(summaries >= 7 * 2 - 1 && summaries <= 7 * 2);
+	// The summaries are sent in wake cycles without measurements
+	CHECK(simulation.getUplinks(LORA_PORT) == (simulation.getWakeups() - 1 - summaries) / 3);
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		if (uplink.port == PROFILE_PORT)
+			CHECK(uplink.payload.size() > 0 && uplink.payload.size() <= SimLoRaWAN::getMaxPayload(5));
+	}
+}
+
+/**
+ * Ten days of a weather station with an adaptive sampling policy, while its battery drains:
+ * the wake-up period and the batches stretch with the battery steps, and shorten
+ * for a few wake-ups after a sudden rise of the temperature.
+ * The interval of each batch is sent in its preamble.
+ */
+static void testAdaptive() {
+	// From full to empty in 10 days
+	SimHal::setAnalog(BATTERY_PIN, [](uint64_t time) {
+		return MAX_ANALOG - (MAX_ANALOG - MIN_ANALOG) * (time / (10 * 86400000.0));
+	});
+	// Sudden rise of 8 degrees after 2 days
+	bme280.setTemperature([](uint64_t time) { return time < 48 * 3600000ULL ? 20.0f : 28.0f; });
+	gps.setFix(5000, 1.2);
+	Simulation simulation([]() {
+		return new WeatherStation(10, 4, 3, 0, [](EspDevice* esp) {
+			esp->addAdaptiveStep(50, 10, 4);
+			esp->addAdaptiveStep(20, 30, 6);
+			esp->addAdaptiveStep(0, 60, 8);
+			esp->setAdaptiveFast(30, 2, 1, 6);
+			esp->setAdaptiveRate(HEADER_TEMPERATURE, 0.2);
+		});
+	});
+	CHECK(simulation.run(SIM_DAYS(10)));
+	// Half of the time at 10 minutes, then 30 and 60 minutes
+	CHECK(simulation.getWakeups() < 5 * 24 * 6 + 3 * 24 * 2 + 2 * 24 + 20);
+
+	PacketDecoder decoder;
+	uint32_t fast = 0;
+	uint8_t lastInterval = 0;
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		decoded_payload_t payload;
+		CHECK(uplink.port == LORA_PORT);
+		CHECK(decoder.decode(uplink.payload.data(), uplink.payload.size(), &payload));
+		// Battery at the start of the batch, which selects its step
+		uint8_t battery = payload.measurements[0].battery;
+		switch (payload.interval) {
+		case 2:
+			fast++;
+			CHECK(payload.nMeasurements == 1);
+			CHECK(uplink.time >= SIM_HOURS(48) && uplink.time < SIM_HOURS(48) + SIM_MINUTES(30));
+			break;
+		case 10:
+			CHECK(payload.nMeasurements <= 4 && battery >= 49);
+			break;
+		case 30:
+			CHECK(payload.nMeasurements <= 6 && battery >= 19 && battery < 50);
+			break;
+		case 60:
+			CHECK(payload.nMeasurements <= 8 && battery < 20);
+			break;
+		default:
+			CHECK(false);
+		}
+		// The period only gets longer, except in the fast step
+		CHECK(payload.interval == 2 || payload.interval >= lastInterval);
+		if (payload.interval != 2)
+			lastInterval = payload.interval;
+	}
+	CHECK(fast == 6);
+	CHECK(lastInterval == 60);
+}
+
+/**
+ * Three days of a weather station with the store-and-forward, and an outage of the network
+ * of 12 hours on the second day: the batches of the outage are kept, then sent again
+ * between the measurements once the network is back, with the age of their measurements,
+ * so that every measurement is delivered once, at its time, and the period is kept.
+ */
+static void testOutage() {
+	// The pressure encodes the time of the measurement (4 Pa per minute), below its emergency threshold
+	bme280.setTemperature(SimHal::constant(20));
+	bme280.setPressure([](uint64_t time) { return 80000 + 4 * (time / 60000.0f); });
+	gps.setFix(5000, 1.2);
+	SimLoRaWAN::setCoverage([](uint64_t time) { return time < 24 * 3600000ULL || time >= 36 * 3600000ULL; });
+	Simulation simulation([]() {
+		return new WeatherStation(10, 4, 3, 0, [](EspDevice* esp) { esp->initStoreForward(); });
+	});
+	CHECK(simulation.run(SIM_DAYS(3)));
+
+	// Time of the measurements (in minutes), as computed by the backend from the reception time
+	std::vector<double> times;
+	PacketDecoder decoder;
+	uint32_t stored = 0;
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		CHECK(uplink.confirmed);
+		CHECK(uplink.port == LORA_PORT || uplink.port == STORED_PORT);
+		if (!uplink.delivered)
+			continue;
+		decoded_payload_t payload;
+		if (uplink.port == STORED_PORT) {
+			stored++;
+			CHECK(decoder.decodeStored(uplink.payload.data(), uplink.payload.size(), &payload));
+			// Sent again once the network is back, with the rest of the measurements
+			CHECK(uplink.time >= SIM_HOURS(36) && uplink.time < SIM_HOURS(38));
+		} else {
+			CHECK(decoder.decode(uplink.payload.data(), uplink.payload.size(), &payload));
+			CHECK(payload.age == 0);
+		}
+		for (uint8_t i = 0; i < payload.nMeasurements; i++) {
+			double time = uplink.time / 60e6 - payload.age - payload.interval * (payload.nMeasurements - 1 - i);
+			double measured = (payload.measurements[i].pressure - 80000) / 4;
+			CHECK(fabs(time - measured) < 3);
+			times.push_back(measured);
+		}
+	}
+	// Every batch of the outage, in the RTC memory and in the NVS flash
+	CHECK(stored >= 12 * 6 / 4);
+	CHECK(simulation.getUplinks(STORED_PORT) == stored);
+
+	// Every measurement delivered once, every 10 minutes
+	std::sort(times.begin(), times.end());
+	CHECK(!times.empty());
+	CHECK(times.size() < 2 || times[0] < 15);
+	CHECK(times.size() < 2 || times.back() > 3 * 24 * 60 - 60);
+	for (size_t i = 1; i < times.size(); i++)
+		CHECK(times[i] - times[i - 1] > 9 && times[i] - times[i - 1] < 12);
+	CHECK(SimWifi::getPosts().empty());
+	// Awake: the time to fix of the GPS, the uplink and its receive windows,
+	// after the Wi-Fi geolocation at the join
+	CHECK(simulation.getMaxAwakeTime() < SIM_SECONDS(10));
+}
+
+/**
+ * Three days of a weather station with the store-and-forward, an outage of the network
+ * of 12 hours on the second day, and the ADR lowering the data rate to DR0 after 6 hours
+ * of outage, until 4 hours after the network is back: the batches stored before the drop,
+ * too large for DR0, are kept until the data rate rises again, then sent in order with
+ * the fragments of the outage, so that every measurement is still delivered once.
+ */
+static void testOutageDataRate() {
+	bme280.setTemperature(SimHal::constant(20));
+	bme280.setPressure([](uint64_t time) { return 80000 + 4 * (time / 60000.0f); });
+	gps.setFix(5000, 1.2);
+	SimLoRaWAN::setCoverage([](uint64_t time) { return time < 24 * 3600000ULL || time >= 36 * 3600000ULL; });
+	SimLoRaWAN::setAdr([](uint64_t time) { return time >= 30 * 3600000ULL && time < 40 * 3600000ULL ? 0 : 5; });
+	Simulation simulation([]() {
+		return new WeatherStation(10, 4, 3, 0, [](EspDevice* esp) { esp->initStoreForward(); });
+	});
+	CHECK(simulation.run(SIM_DAYS(3)));
+
+	std::vector<double> times;
+	PacketDecoder decoder;
+	uint32_t stored = 0;
+	uint32_t large = 0;
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		if (!uplink.delivered)
+			continue;
+		decoded_payload_t payload;
+		// Each fragment decoded on its own
+		payload.received = 0;
+		if (uplink.port == STORED_PORT) {
+			stored++;
+			CHECK(decoder.decodeStored(uplink.payload.data(), uplink.payload.size(), &payload));
+			CHECK(uplink.time >= SIM_HOURS(36) && uplink.time < SIM_HOURS(42));
+			// Too large for DR0: sent once the data rate rises again
+			if (uplink.payload.size() > SimLoRaWAN::getMaxPayload(0)) {
+				large++;
+				CHECK(uplink.time >= SIM_HOURS(40));
+			}
+		} else if (uplink.port == FRAGMENT_PORT) {
+			CHECK(decoder.decodeFragment(uplink.payload.data(), uplink.payload.size(), &payload));
+		} else {
+			CHECK(uplink.port == LORA_PORT);
+			CHECK(decoder.decode(uplink.payload.data(), uplink.payload.size(), &payload));
+		}
+		for (uint8_t i = 0; i < payload.nMeasurements; i++) {
+			// Fragments: only the measurements of the fragment
+			if (!(payload.received & ((uint32_t) 1 << i)))
+				continue;
+			double time = uplink.time / 60e6 - payload.age - payload.interval * (payload.nMeasurements - 1 - i);
+			double measured = (payload.measurements[i].pressure - 80000) / 4;
+			CHECK(fabs(time - measured) < 3);
+			times.push_back(measured);
+		}
+	}
+	CHECK(large > 0);
+	CHECK(stored > large);
+
+	// Every measurement delivered once, every 10 minutes, none dropped with the data rate
+	std::sort(times.begin(), times.end());
+	CHECK(!times.empty());
+	CHECK(times.size() < 2 || times.back() > 3 * 24 * 60 - 60);
+	for (size_t i = 1; i < times.size(); i++)
+		CHECK(times[i] - times[i - 1] > 9 && times[i] - times[i - 1] < 12);
+	CHECK(simulation.getMaxAwakeTime() < SIM_SECONDS(10));
+}
+
+/**
+ * The outage of the store-and-forward, confirming one uplink out of 4 while the network is up:
+ * a quarter of the downlinks, the uplinks confirmed again during the outage,
+ * and every measurement still delivered, the last ones before the outage possibly twice.
+ */
+static void testConfirmEvery() {
+	bme280.setTemperature(SimHal::constant(20));
+	bme280.setPressure([](uint64_t time) { return 80000 + 4 * (time / 60000.0f); });
+	gps.setFix(5000, 1.2);
+	SimLoRaWAN::setCoverage([](uint64_t time) { return time < 24 * 3600000ULL || time >= 36 * 3600000ULL; });
+	Simulation simulation([]() {
+		return new WeatherStation(10, 4, 3, 0, [](EspDevice* esp) { esp->initStoreForward(4); });
+	});
+	CHECK(simulation.run(SIM_DAYS(3)));
+
+	std::vector<double> times;
+	PacketDecoder decoder;
+	uint32_t sent = 0;
+	uint32_t confirmed = 0;
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		if (uplink.port == LORA_PORT && uplink.time < SIM_HOURS(24)) {
+			sent++;
+			if (uplink.confirmed)
+				confirmed++;
+		}
+		// During the outage
+		if (uplink.time >= SIM_HOURS(25) && uplink.time < SIM_HOURS(36))
+			CHECK(uplink.confirmed);
+		if (!uplink.delivered)
+			continue;
+		decoded_payload_t payload;
+		if (uplink.port == STORED_PORT)
+			CHECK(decoder.decodeStored(uplink.payload.data(), uplink.payload.size(), &payload));
+		else
+			CHECK(decoder.decode(uplink.payload.data(), uplink.payload.size(), &payload));
+		for (uint8_t i = 0; i < payload.nMeasurements; i++)
+			times.push_back((payload.measurements[i].pressure - 80000) / 4);
+	}
+	CHECK(sent > 0 && confirmed == sent / 4);
+
+	// Every measurement delivered, at most 3 batches twice
+	std::sort(times.begin(), times.end());
+	size_t size = times.size();
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+	CHECK(size - times.size() <= 3 * 4);
+	CHECK(!times.empty());
+	CHECK(times.size() < 2 || times.back() > 3 * 24 * 60 - 60);
+	for (size_t i = 1; i < times.size(); i++)
+		CHECK(times[i] - times[i - 1] > 9 && times[i] - times[i - 1] < 12);
+}
+
+/**
+ * Decodes the delivered uplinks of the payloads, fragments and stored uplinks,
+ * each fragment on its own, with the time of their measurements encoded in the pressure
+ * (4 Pa per minute from 80000 Pa), checked against the reception time of the uplink.
+ * @param times: times of the measurements (in minutes)
+ * @param temperature: temperature of the measurements, checked against the decoded ones
+ * @return: true if all the uplinks were decoded
+ */
+static bool decodeTimes(std::vector<double>* times, float temperature) {
+	PacketDecoder decoder;
+	for (const sim_uplink_t& uplink : SimLoRaWAN::getUplinks()) {
+		if (!uplink.delivered)
+			continue;
+		decoded_payload_t payload;
+		payload.received = 0;
+		bool valid;
+		if (uplink.port == STORED_PORT)
+			valid = decoder.decodeStored(uplink.payload.data(), uplink.payload.size(), &payload);
+		else if (uplink.port == FRAGMENT_PORT)
+			valid = decoder.decodeFragment(uplink.payload.data(), uplink.payload.size(), &payload);
+		else
+			valid = decoder.decode(uplink.payload.data(), uplink.payload.size(), &payload);
+		if (!valid)
+			return false;
+		for (uint8_t i = 0; i < payload.nMeasurements; i++) {
+			if (!(payload.received & ((uint32_t) 1 << i)))
+				continue;
+			double time = uplink.time / 60e6 - payload.age - payload.interval * (payload.nMeasurements - 1 - i);
+			double measured = (payload.measurements[i].pressure - 80000) / 4;
+			CHECK(fabs(time - measured) < 3);
+			CHECK(fabs(payload.measurements[i].temperature - temperature) <= 0.05f);
+			times->push_back(measured);
+		}
+	}
+	return true;
+}
+
+/**
+ * A weather station sending batches of 12 measurements in the version 4, with a coarser
+ * temperature, and the ADR switching between DR5 and DR0 every hour: the batches built
+ * at DR5 are sent in fragments at DR0, with the quantization.
+ */
+static void testVersion4() {
+	bme280.setTemperature(SimHal::constant(20.04f));
+	bme280.setPressure([](uint64_t time) { return 80000 + 4 * (time / 60000.0f); });
+	gps.setFix(5000, 1.2);
+	SimLoRaWAN::setAdr([](uint64_t time) { return (time / 3600000) % 2 ? 0 : 5; });
+	Simulation simulation([]() {
+		return new WeatherStation(10, 12, 4, 0, [](EspDevice* esp) {
+			esp->setQuantization(HEADER_TEMPERATURE, -40, 0.1f, 2);
+		});
+	});
+	CHECK(simulation.run(SIM_DAYS(1)));
+	CHECK(simulation.getUplinks(FRAGMENT_PORT) > 0);
+
+	std::vector<double> times;
+	CHECK(decodeTimes(&times, 20.0f));
+	std::sort(times.begin(), times.end());
+	CHECK(times.size() > 6 * 20);
+	for (size_t i = 1; i < times.size(); i++)
+		CHECK(times[i] - times[i - 1] > 9 && times[i] - times[i - 1] < 12);
+}
+
+/**
+ * A weather station sending the deltas of the version 5, with the store-and-forward
+ * and an outage of 6 hours: the stored batches are decoded like the others.
+ */
+static void testVersion5() {
+	bme280.setTemperature(SimHal::constant(20));
+	bme280.setPressure([](uint64_t time) { return 80000 + 4 * (time / 60000.0f); });
+	gps.setFix(5000, 1.2);
+	SimLoRaWAN::setCoverage([](uint64_t time) { return time < 6 * 3600000ULL || time >= 12 * 3600000ULL; });
+	Simulation simulation([]() {
+		return new WeatherStation(10, 4, 5, 0, [](EspDevice* esp) { esp->initStoreForward(); });
+	});
+	CHECK(simulation.run(SIM_DAYS(1)));
+	CHECK(simulation.getUplinks(STORED_PORT) >= 6 * 6 / 4);
+
+	std::vector<double> times;
+	CHECK(decodeTimes(&times, 20));
+	std::sort(times.begin(), times.end());
+	CHECK(times.size() > 6 * 20);
+	for (size_t i = 1; i < times.size(); i++)
+		CHECK(times[i] - times[i - 1] > 9 && times[i] - times[i - 1] < 12);
+}
+
+/**
+ * An air quality station aggregating 12 samples (one uplink per hour at a 5 minutes period):
+ * the air quality index goes through the BME680 and the BSEC library.
+ */
+static void testAirQualityStation() {
+	bme680.setTemperature(SimHal::constant(22));
+	bme680.setPressure(SimHal::constant(101000));
+	bme680.setHumidity(SimHal::constant(45));
+	bme680.setAirQuality([](uint64_t time) { return 50 + 100 * (time / 3600000 / 3 % 2); });
+	SimHal::setAnalog(GAS_PIN, SimHal::constant(800));
+	Simulation simulation([]() { return new AirQualityStation(5, 12); });
+	CHECK(simulation.run(SIM_DAYS(10)));
+	uint32_t cycles = simulation.getWakeups() - 1;
+	CHECK(bme680.getMeasurements() == cycles);
+	CHECK(simulation.getUplinks(LORA_PORT) == cycles / 12);
+
+	std::vector<decoded_payload_t> decoded;
+	CHECK(decodeUplinks(LORA_PORT, &decoded));
+	CHECK(decoded.size() == cycles / 12);
+	uint32_t clean = 0;
+	uint32_t polluted = 0;
+	for (const decoded_payload_t& payload : decoded) {
+		CHECK(payload.aggregate && payload.samples == 12);
+		const measurement_t* mean = &payload.measurements[AGGREGATE_MEAN];
+		CHECK(fabs(mean->temperature - 22) < 0.1);
+		CHECK(fabs(mean->pressure - 101000) < 2);
+		CHECK(fabs(mean->humidity - 45) < 0.1);
+		CHECK(mean->co2 > 0);
+		const measurement_t* min = &payload.measurements[AGGREGATE_MIN];
+		const measurement_t* max = &payload.measurements[AGGREGATE_MAX];
+		if (fabs(max->airQuality - 50) < 1)
+			clean++;
+		if (fabs(min->airQuality - 150) < 1)
+			polluted++;
+	}
+	// Periods of 3 hours of clean and polluted air: a third of the reporting periods is within one of them
+	CHECK(clean > decoded.size() / 5);
+	CHECK(polluted > decoded.size() / 5);
+	// Awake: the minimum warm-up of the MQ135, during the measurement of the BME680,
+	// and the uplinks with their receive windows
+	CHECK(simulation.getMeanAwakeTime() < SIM_MS(GAS_WARMUP_MIN_MS) + SIM_SECONDS(1));
+	CHECK(simulation.getMaxAwakeTime() < SIM_SECONDS(VEXT_DELAY_SEC));
+}
+
+/**
+ * The heater of the MQ135 drifts after each power-on: its raw value rises by 6 counts
+ * per poll of the warm-up for 4 seconds, within the tolerance between two polls.
+ * The warm-up lasts until the value has settled, at the end of the drift.
+ */
+static void testGasWarmup() {
+	SimHal::setAnalog(GAS_PIN, [](uint64_t time) {
+		uint64_t elapsed = time - SimClock::getBootTime() / 1000;
+		return elapsed < 4000 ? 680 + 6 * (elapsed / WARMUP_POLL_MS) : 800;
+	});
+	Simulation simulation([]() { return new AirQualityStation(5, 12); });
+	CHECK(simulation.run(SIM_DAYS(1)));
+	std::vector<decoded_payload_t> decoded;
+	CHECK(decodeUplinks(LORA_PORT, &decoded));
+	CHECK(!decoded.empty());
+	// Awake: the drift, the readings of the settled value, and the uplinks
+	CHECK(simulation.getMeanAwakeTime() > SIM_SECONDS(4));
+	CHECK(simulation.getMaxAwakeTime() < SIM_SECONDS(VEXT_DELAY_SEC));
+}
+
+/**
+ * Runs the scenarios.
+ * @param argv: optional file receiving the uplinks of the scenarios
+ */
+int main(int argc, char* argv[]) {
+	if (argc > 1) {
+		uplinksFile = fopen(argv[1], "w");
+		if (uplinksFile == NULL) {
+			printf("SimulationTest: cannot write %s\n", argv[1]);
+			return 1;
+		}
+	}
+	runScenario("weather station", testWeatherStation);
+	runScenario("no fix", testNoFix);
+	runScenario("location cache", testLocationCache);
+	runScenario("seen channels", testSeenChannels);
+	runScenario("emergency", testEmergency);
+	runScenario("binary emergency", testBinaryEmergency);
+	runScenario("reconnect", testReconnect);
+	runScenario("static IP", testStaticIp);
+	runScenario("profiler", testProfiler);
+	runScenario("adaptive", testAdaptive);
+	runScenario("outage", testOutage);
+	runScenario("outage at DR0", testOutageDataRate);
+	runScenario("confirm every 4", testConfirmEvery);
+	runScenario("version 4", testVersion4);
+	runScenario("version 5", testVersion5);
+	runScenario("air quality station", testAirQualityStation);
+	runScenario("gas warm-up", testGasWarmup);
+
+	if (uplinksFile != NULL)
+		fclose(uplinksFile);
+	if (failures > 0) {
+		printf("SimulationTest: %d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("SimulationTest: all checks passed\n");
+	return 0;
+}
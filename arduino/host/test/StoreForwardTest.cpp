@@ -0,0 +1,246 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Host tests of the store-and-forward of the uplinks (StoreForward library).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+
+#include "StoreForward.h"
+#include "Check.h"
+
+/* Spill in memory, of a given capacity, like the NVS flash */
+class MemorySpill : public UplinkSpill {
+
+	public:
+		MemorySpill(uint16_t capacity) : _capacity(capacity) {}
+
+		bool push(const stored_uplink_t* uplink) {
+			bool lossless = _uplinks.size() < _capacity;
+			if (!lossless)
+				_uplinks.pop_front();
+			_uplinks.push_back(*uplink);
+			return lossless;
+		}
+
+		bool peek(stored_uplink_t* uplink) {
+			if (_uplinks.empty())
+				return false;
+			*uplink = _uplinks.front();
+			return true;
+		}
+
+		void drop() {
+			if (!_uplinks.empty())
+				_uplinks.pop_front();
+		}
+
+		uint16_t getCount() {
+			return _uplinks.size();
+		}
+
+	private:
+		uint16_t _capacity;
+		std::deque<stored_uplink_t> _uplinks;
+
+};
+
+/**
+ * Builds an uplink whose payload bytes follow its time.
+ */
+static stored_uplink_t makeUplink(uint32_t time, uint8_t size) {
+	stored_uplink_t uplink;
+	uplink.port = 2 + time % 2;
+	uplink.time = time;
+	uplink.size = size;
+	for (uint8_t i = 0; i < size; i++)
+		uplink.payload[i] = time + i;
+	return uplink;
+}
+
+/**
+ * Checks if an uplink is the one built by makeUplink.
+ */
+static bool isUplink(const stored_uplink_t* uplink, uint32_t time, uint8_t size) {
+	stored_uplink_t expected = makeUplink(time, size);
+	return uplink->port == expected.port && uplink->time == time && uplink->size == size &&
+	       memcmp(uplink->payload, expected.payload, size) == 0;
+}
+
+/**
+ * The uplinks are kept in order, the oldest one is sent again first,
+ * and the newest one is dropped once acknowledged.
+ */
+static void testOrder() {
+	uplink_ring_t ring;
+	memset(&ring, 0, sizeof(ring));
+	UplinkStore store;
+	stored_uplink_t uplink;
+	CHECK(!store.peekOldest(&ring, &uplink));
+	CHECK(store.getCount(&ring) == 0);
+
+	for (uint32_t time = 1; time <= 3; time++) {
+		uplink = makeUplink(time, 10 + time);
+		CHECK(store.push(&ring, &uplink));
+	}
+	CHECK(store.getCount(&ring) == 3);
+	// Acknowledged once only
+	store.dropNewest(&ring);
+	store.dropNewest(&ring);
+	CHECK(store.getCount(&ring) == 2);
+	CHECK(store.peekOldest(&ring, &uplink) && isUplink(&uplink, 1, 11));
+	store.dropOldest(&ring);
+	CHECK(store.peekOldest(&ring, &uplink) && isUplink(&uplink, 2, 12));
+
+	// The newest uplink, dropped as the oldest, is not dropped again
+	uplink = makeUplink(4, 14);
+	CHECK(store.push(&ring, &uplink));
+	store.dropOldest(&ring);
+	store.dropOldest(&ring);
+	store.dropNewest(&ring);
+	CHECK(store.getCount(&ring) == 0 && ring.used == 0);
+	store.dropOldest(&ring);
+	CHECK(store.getCount(&ring) == 0);
+
+	// Payload too large
+	uplink = makeUplink(5, 0);
+	uplink.size = STORE_PAYLOAD_MAX_SIZE + 1;
+	CHECK(!store.push(&ring, &uplink));
+	CHECK(store.getCount(&ring) == 0 && ring.dropped == 1);
+}
+
+/**
+ * The records wrap around the end of the ring buffer, and the oldest ones
+ * are dropped when it is full, without spill.
+ */
+static void testWrapAround() {
+	uplink_ring_t ring;
+	memset(&ring, 0, sizeof(ring));
+	UplinkStore store;
+	stored_uplink_t uplink;
+	const uint8_t size = 51;
+	// Records per ring buffer
+	const uint16_t capacity = STORE_RTC_SIZE / (STORE_RECORD_HEADER_SIZE + size);
+	uint32_t oldest = 1;
+	for (uint32_t time = 1; time <= 5 * capacity; time++) {
+		uplink = makeUplink(time, size);
+		bool full = store.getCount(&ring) == capacity;
+		CHECK(store.push(&ring, &uplink) == !full);
+		if (full)
+			oldest++;
+		CHECK(store.getCount(&ring) == time - oldest + 1);
+		CHECK(ring.used <= STORE_RTC_SIZE);
+		// Acknowledgement of one uplink out of three, sent again
+		if (time % 3 == 0) {
+			CHECK(store.peekOldest(&ring, &uplink) && isUplink(&uplink, oldest, size));
+			store.dropOldest(&ring);
+			oldest++;
+		}
+	}
+	CHECK(ring.dropped > 0);
+	for (; store.peekOldest(&ring, &uplink); oldest++) {
+		CHECK(isUplink(&uplink, oldest, size));
+		store.dropOldest(&ring);
+	}
+	CHECK(oldest == 5 * capacity + 1);
+	CHECK(ring.used == 0);
+}
+
+/**
+ * The oldest uplinks spill to the slower storage when the ring buffer is full,
+ * and they are sent again before the uplinks of the ring buffer.
+ */
+static void testSpill() {
+	uplink_ring_t ring;
+	memset(&ring, 0, sizeof(ring));
+	MemorySpill spill(8);
+	UplinkStore store;
+	store.setSpill(&spill);
+	stored_uplink_t uplink;
+	const uint8_t size = 100;
+	const uint16_t capacity = STORE_RTC_SIZE / (STORE_RECORD_HEADER_SIZE + size);
+	for (uint32_t time = 1; time <= capacity + 8; time++) {
+		uplink = makeUplink(time, size);
+		CHECK(store.push(&ring, &uplink));
+	}
+	CHECK(spill.getCount() == 8);
+	CHECK(store.getCount(&ring) == capacity + 8);
+	CHECK(ring.dropped == 0);
+
+	// Spill full: its oldest uplink is dropped
+	uplink = makeUplink(capacity + 9, size);
+	CHECK(!store.push(&ring, &uplink));
+	CHECK(ring.dropped == 1);
+	CHECK(store.getCount(&ring) == capacity + 8);
+	store.dropNewest(&ring);
+
+	uint32_t time = 2;
+	for (; store.peekOldest(&ring, &uplink); time++) {
+		CHECK(isUplink(&uplink, time, size));
+		store.dropOldest(&ring);
+	}
+	CHECK(time == capacity + 9);
+	CHECK(spill.getCount() == 0 && ring.count == 0);
+}
+
+/**
+ * The uplinks sent unconfirmed before an acknowledged one are dropped with it,
+ * across the end of the ring buffer, but not from the spill.
+ */
+static void testDropNewest() {
+	uplink_ring_t ring;
+	memset(&ring, 0, sizeof(ring));
+	MemorySpill spill(8);
+	UplinkStore store;
+	store.setSpill(&spill);
+	stored_uplink_t uplink;
+	const uint8_t size = 100;
+	const uint16_t capacity = STORE_RTC_SIZE / (STORE_RECORD_HEADER_SIZE + size);
+	// Backlog of 3 uplinks across the end of the ring buffer,
+	// then 3 uplinks acknowledged by the last one
+	for (uint32_t time = 1; time <= 13; time++) {
+		uplink = makeUplink(time, size);
+		CHECK(store.push(&ring, &uplink));
+		if (time == 9) {
+			for (uint8_t i = 0; i < 7; i++)
+				store.dropOldest(&ring);
+		}
+	}
+	store.dropNewest(&ring, 3);
+	CHECK(store.getCount(&ring) == 3);
+	CHECK(ring.used == 3 * (STORE_RECORD_HEADER_SIZE + size));
+	store.dropNewest(&ring, 3);
+	CHECK(store.getCount(&ring) == 3);
+
+	// More uplinks than the ring buffer holds: the spilled ones are kept
+	for (uint32_t time = 14; time <= capacity + 14; time++) {
+		uplink = makeUplink(time, size);
+		CHECK(store.push(&ring, &uplink));
+	}
+	CHECK(spill.getCount() == 4);
+	store.dropNewest(&ring, capacity + 1);
+	CHECK(ring.count == 0 && ring.used == 0);
+	uint32_t times[] = {8, 9, 10, 14};
+	for (uint8_t i = 0; i < 4; i++) {
+		CHECK(store.peekOldest(&ring, &uplink) && isUplink(&uplink, times[i], size));
+		store.dropOldest(&ring);
+	}
+	CHECK(store.getCount(&ring) == 0);
+}
+
+int main() {
+	testOrder();
+	testWrapAround();
+	testSpill();
+	testDropNewest();
+	if (failures > 0) {
+		printf("StoreForwardTest: %d check(s) failed\n", failures);
+		return 1;
+	}
+	printf("StoreForwardTest: all checks passed\n");
+	return 0;
+}
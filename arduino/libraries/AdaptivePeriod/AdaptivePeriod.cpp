@@ -0,0 +1,131 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Adaptive sampling policy of the ESP32 devices.
+ * The battery steps stretch the wake-up period and the batches as the battery drains,
+ * and the fast step shortens them for a few wake-ups when a reading changes quickly.
+ * The policy only selects a step: the device applies it between its batches,
+ * so that all the measurements of a batch share the interval sent in its preamble.
+ */
+
+#include "AdaptivePeriod.h"
+
+/* No-arg constructor: disabled policy */
+AdaptivePeriod::AdaptivePeriod() {
+	_nSteps = 0;
+	_fast = adaptive_step_t{0, 0, 0};
+	_hold = 0;
+	for (uint8_t i = 0; i < ADAPTIVE_FIELDS; i++)
+		_rates[i] = 0;
+}
+
+/**
+ * Adds a battery step to the policy.
+ * @param battery: minimum battery level of the step (%)
+ * @param wakeupPeriod: wake-up period at or above this level (in minutes)
+ * @param nMeasurements: number of measurements per batch at or above this level
+ * @return: true if the step was added, false if the step is invalid or if there are too many steps
+ */
+bool AdaptivePeriod::addStep(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements) {
+	if (_nSteps >= MAX_ADAPTIVE_STEPS || battery > 100 || wakeupPeriod == 0 || nMeasurements == 0)
+		return false;
+	// Insertion by decreasing battery level
+	uint8_t i = _nSteps++;
+	for (; i > 0 && _steps[i - 1].battery < battery; i--)
+		_steps[i] = _steps[i - 1];
+	_steps[i] = adaptive_step_t{battery, wakeupPeriod, nMeasurements};
+	return true;
+}
+
+/**
+ * Sets the fast step of the policy, applied when a reading changes quickly.
+ * @param battery: minimum battery level for the fast step (%)
+ * @param wakeupPeriod: wake-up period of the fast step (in minutes)
+ * @param nMeasurements: number of measurements per batch of the fast step
+ * @param hold: number of wake-ups in the fast step after the last fast change
+ * @return: true if the fast step was set, false if it is invalid
+ */
+bool AdaptivePeriod::setFastStep(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements, uint8_t hold) {
+	if (battery > 100 || wakeupPeriod == 0 || nMeasurements == 0 || hold == 0)
+		return false;
+	_fast = adaptive_step_t{battery, wakeupPeriod, nMeasurements};
+	_hold = hold;
+	return true;
+}
+
+/**
+ * Sets the change rate of a field switching the policy to the fast step.
+ * @param header: header of the field
+ * @param rate: change of the value per minute, up or down, or 0 to ignore the field
+ * @return: true if the rate was set, false if the header is invalid
+ */
+bool AdaptivePeriod::setChangeRate(uint8_t header, float rate) {
+	if (header < 1 || header > ADAPTIVE_FIELDS)
+		return false;
+	_rates[header - 1] = rate > 0 ? rate : 0;
+	return true;
+}
+
+/**
+ * Checks if the policy is enabled.
+ * @return: true if the policy has a battery step or a fast step, false otherwise
+ */
+bool AdaptivePeriod::isEnabled() {
+	return _nSteps > 0 || _hold > 0;
+}
+
+/**
+ * Updates the state of the policy with a new value of a field.
+ * @param state: state of the policy, updated
+ * @param header: header of the field
+ * @param value: new value of the field
+ * @param minutes: time since the previous value (in minutes)
+ * @return: true if the field changes quickly, false otherwise
+ */
+bool AdaptivePeriod::update(adaptive_state_t* state, uint8_t header, float value, float minutes) {
+	if (header < 1 || header > ADAPTIVE_FIELDS || _rates[header - 1] == 0)
+		return false;
+	uint16_t bit = (uint16_t) 1 << (header - 1);
+	float* last = state->last + header - 1;
+	bool fast = _hold > 0 && (state->hasLast & bit) && minutes > 0 &&
+	            fabs(value - *last) / minutes >= _rates[header - 1];
+	*last = value;
+	state->hasLast |= bit;
+	if (fast)
+		state->fastCycles = _hold;
+	return fast;
+}
+
+/**
+ * Starts a wake cycle, before the updates of its values:
+ * the fast step is held for one wake-up less.
+ * @param state: state of the policy, updated
+ */
+void AdaptivePeriod::startCycle(adaptive_state_t* state) {
+	if (state->fastCycles > 0)
+		state->fastCycles--;
+}
+
+/**
+ * Selects the step of the next batch.
+ * The fast step applies during its hold time, unless the battery is below its level.
+ * Otherwise, the battery step of the highest level at or below the battery applies,
+ * or the lowest step if the battery is below all of them.
+ * @param state: state of the policy
+ * @param battery: battery level (%)
+ * @param base: step without policy, i.e. the configuration of the device
+ * @return: the selected step
+ */
+adaptive_step_t AdaptivePeriod::select(const adaptive_state_t* state, uint8_t battery, adaptive_step_t base) {
+	if (state->fastCycles > 0 && battery >= _fast.battery)
+		return _fast;
+	if (_nSteps == 0)
+		return base;
+	for (uint8_t i = 0; i < _nSteps; i++) {
+		if (battery >= _steps[i].battery)
+			return _steps[i];
+	}
+	return _steps[_nSteps - 1];
+}
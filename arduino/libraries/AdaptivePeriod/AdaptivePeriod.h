@@ -0,0 +1,67 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Adaptive sampling policy of the ESP32 devices: wake-up period and number
+ * of measurements per batch, depending on the battery level and on how fast
+ * the readings change.
+ */
+
+#ifndef AdaptivePeriod_h
+#define AdaptivePeriod_h
+
+#include <Arduino.h>
+
+// Maximum number of battery steps of the policy
+#define MAX_ADAPTIVE_STEPS 8
+// Number of fields whose change rate can be checked, indexed by header - 1
+#define ADAPTIVE_FIELDS 16
+
+// Step of the policy: wake-up period and number of measurements per batch,
+// applied at or above a battery level
+typedef struct adaptiveStep {
+	uint8_t battery;       // Minimum battery level (%)
+	uint8_t wakeupPeriod;  // Wake-up period (in minutes)
+	uint8_t nMeasurements; // Number of measurements per batch
+} adaptive_step_t;
+
+// State of the policy, meant to be kept in RTC memory between the wake-ups.
+// Zeroed memory is a policy without previous values, out of the fast step.
+typedef struct adaptiveState {
+	// Bitmap of the fields with a previous value
+	uint16_t hasLast;
+	// Remaining wake-ups in the fast step
+	uint8_t fastCycles;
+	// Previous values of the fields
+	float last[ADAPTIVE_FIELDS];
+} adaptive_state_t;
+
+/* AdaptivePeriod class */
+class AdaptivePeriod {
+
+	public:
+		AdaptivePeriod();
+
+		bool addStep(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements);
+		bool setFastStep(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements, uint8_t hold);
+		bool setChangeRate(uint8_t header, float rate);
+		bool isEnabled();
+
+		bool update(adaptive_state_t* state, uint8_t header, float value, float minutes);
+		void startCycle(adaptive_state_t* state);
+		adaptive_step_t select(const adaptive_state_t* state, uint8_t battery, adaptive_step_t base);
+
+	private:
+		// Battery steps, by decreasing battery level
+		adaptive_step_t _steps[MAX_ADAPTIVE_STEPS];
+		uint8_t _nSteps;
+		// Fast step, applied for _hold wake-ups after a fast change, if the battery allows it
+		adaptive_step_t _fast;
+		uint8_t _hold;
+		// Change per minute of each field switching to the fast step, 0 to ignore the field
+		float _rates[ADAPTIVE_FIELDS];
+
+};
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the BME280 (temperature/pressure/humidity).
+ */
+
+#include "Bme280Driver.h"
+
+/**
+ * Constructor
+ * Creates the driver of a BME280 sensor,
+ * with the specified SDA and SCL GPIO pins and emergency thresholds.
+ */
+Bme280Driver::Bme280Driver(uint8_t sda, uint8_t scl,
+                           int temperatureThreshold,
+                           int pressureThreshold,
+                           int humidityThreshold)
+{
+	_sda = sda;
+	_scl = scl;
+	setDefaultEmergency(HEADER_TEMPERATURE, temperatureThreshold);
+	setDefaultEmergency(HEADER_PRESSURE, pressureThreshold);
+	setDefaultEmergency(HEADER_HUMIDITY, humidityThreshold);
+}
+
+/**
+ * Retrieves the fields measured by the sensor.
+ * @return: presence bitmap of the fields
+ */
+uint16_t Bme280Driver::getFields()
+{
+	return PRESENCE_BIT(HEADER_TEMPERATURE) | PRESENCE_BIT(HEADER_PRESSURE) |
+	       PRESENCE_BIT(HEADER_HUMIDITY);
+}
+
+/**
+ * Retrieves the acquisition task of the sensor.
+ * @return: ACQUISITION_I2C
+ */
+uint8_t Bme280Driver::getAcquisition()
+{
+	return ACQUISITION_I2C;
+}
+
+/**
+ * Starts the I2C bus of the sensor.
+ */
+void Bme280Driver::setup()
+{
+	Wire.begin(_sda, _scl);
+}
+
+/**
+ * Starts the sensor.
+ * @return: true if the sensor was successfully started, false otherwise
+ */
+bool Bme280Driver::warmup()
+{
+	return _bme280.begin(BME280_DRIVER_ADDRESS);
+}
+
+/**
+ * Retrieves the values from the sensor (temperature, pressure, humidity),
+ * and the barometric altitude if the GPS does not give it.
+ * @param packet: packet in which the values are recorded
+ * @param index: index of the measurement
+ * @param location: location of the device
+ * @return: true if a value raises an emergency, false otherwise
+ */
+bool Bme280Driver::read(Packet* packet, uint8_t index, device_location_t* location)
+{
+	// Read values
+	float temperature = _bme280.readTemperature();
+	packet->addTemperature(temperature, index);
+	float pressure = _bme280.readPressure();
+	packet->addPressure(pressure, index);
+	float humidity = _bme280.readHumidity();
+	packet->addHumidity(humidity, index);
+#if DEBUG
+	printValue("Temperature", temperature);
+	printValue("Pressure", pressure);
+	printValue("Humidity", humidity);
+#endif
+	if (!location->isAltitudeGps)
+	{
+		location->altitude = _bme280.readAltitude(SEALEVELPRESSURE_HPA);
+#if DEBUG
+		printValue("Altitude (BME280)", location->altitude);
+#endif
+	}
+	// Update emergency, for all the values
+	bool emergency = checkEmergency(HEADER_TEMPERATURE, temperature, packet);
+	emergency |= checkEmergency(HEADER_PRESSURE, pressure, packet);
+	emergency |= checkEmergency(HEADER_HUMIDITY, humidity, packet);
+	return emergency;
+}
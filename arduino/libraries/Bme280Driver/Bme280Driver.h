@@ -0,0 +1,43 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the BME280 (temperature/pressure/humidity).
+ */
+
+#ifndef Bme280Driver_h
+#define Bme280Driver_h
+
+#include "Arduino.h"
+#include <Wire.h>
+#include <Adafruit_Sensor.h>
+#include <Adafruit_BME280.h>
+#include "SensorDriver.h"
+
+// I2C address of the sensor (0x76, SDO to ground)
+#define BME280_DRIVER_ADDRESS BME280_ADDRESS_ALTERNATE
+
+/* Bme280Driver class */
+class Bme280Driver : public SensorDriver {
+
+	public:
+		Bme280Driver(uint8_t sda, uint8_t scl,
+		             int temperatureThreshold,
+		             int pressureThreshold,
+		             int humidityThreshold);
+
+		uint16_t getFields();
+		uint8_t getAcquisition();
+		void setup();
+		bool warmup();
+		bool read(Packet* packet, uint8_t index, device_location_t* location);
+
+	private:
+		Adafruit_BME280 _bme280;
+		uint8_t _sda;
+		uint8_t _scl;
+
+};
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the BME680 (temperature/pressure/humidity/air quality),
+ * with the BSEC library.
+ */
+
+#include "Bme680Driver.h"
+
+// State of the BSEC library, kept in memory between the wake-ups
+RTC_DATA_ATTR uint8_t bme680State[BSEC_MAX_STATE_BLOB_SIZE] = {0};
+RTC_DATA_ATTR bool bme680StateSaved = false;
+
+// BME680 configuration for the least power consumption
+const uint8_t bsec_config_iaq[] = {
+#include "config/generic_33v_300s_28d/bsec_iaq.txt"
+};
+// BME680 virtual sensors list
+bsec_virtual_sensor_t bme680SensorList[BME680_SENSORS] = {
+	BSEC_OUTPUT_RAW_TEMPERATURE,
+	BSEC_OUTPUT_RAW_PRESSURE,
+	BSEC_OUTPUT_RAW_HUMIDITY,
+	BSEC_OUTPUT_RAW_GAS,
+	BSEC_OUTPUT_IAQ,
+	BSEC_OUTPUT_STATIC_IAQ,
+	BSEC_OUTPUT_CO2_EQUIVALENT,
+	BSEC_OUTPUT_BREATH_VOC_EQUIVALENT,
+	BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE,
+	BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY,
+};
+
+/**
+ * Constructor
+ * Creates the driver of a BME680 sensor,
+ * with the specified SDA and SCL GPIO pins and emergency thresholds.
+ */
+Bme680Driver::Bme680Driver(uint8_t sda, uint8_t scl,
+                           int temperatureThreshold,
+                           int pressureThreshold,
+                           int humidityThreshold,
+                           int airQualityThreshold)
+{
+	_sda = sda;
+	_scl = scl;
+	setDefaultEmergency(HEADER_TEMPERATURE, temperatureThreshold);
+	setDefaultEmergency(HEADER_PRESSURE, pressureThreshold);
+	setDefaultEmergency(HEADER_HUMIDITY, humidityThreshold);
+	setDefaultEmergency(HEADER_AIR_QUALITY, airQualityThreshold);
+}
+
+/**
+ * Retrieves the fields measured by the sensor.
+ * @return: presence bitmap of the fields
+ */
+uint16_t Bme680Driver::getFields()
+{
+	return PRESENCE_BIT(HEADER_TEMPERATURE) | PRESENCE_BIT(HEADER_PRESSURE) |
+	       PRESENCE_BIT(HEADER_HUMIDITY) | PRESENCE_BIT(HEADER_AIR_QUALITY);
+}
+
+/**
+ * Retrieves the acquisition task of the sensor.
+ * @return: ACQUISITION_I2C
+ */
+uint8_t Bme680Driver::getAcquisition()
+{
+	return ACQUISITION_I2C;
+}
+
+/**
+ * The BME680 is not powered by Vext.
+ * @return: false
+ */
+bool Bme680Driver::needsVext()
+{
+	return false;
+}
+
+/**
+ * Starts the I2C bus of the sensor.
+ */
+void Bme680Driver::setup()
+{
+	Wire.begin(_sda, _scl);
+}
+
+/**
+ * Starts the sensor, restoring the state of the BSEC library,
+ * and runs the BSEC library.
+ * @return: true if the sensor was successfully started and had new data,
+ *          false otherwise
+ */
+bool Bme680Driver::warmup()
+{
+	_bme680.begin(BME680_I2C_ADDR_SECONDARY, Wire);
+	_bme680.setConfig(bsec_config_iaq);
+	if (bme680StateSaved)
+		_bme680.setState(bme680State);
+	_bme680.updateSubscription(bme680SensorList, BME680_SENSORS, BSEC_SAMPLE_RATE_ULP);
+	return _bme680.status == BSEC_OK && _bme680.bme680Status == BME680_OK && _bme680.run();
+}
+
+/**
+ * Retrieves the values from the sensor (temperature, pressure, humidity, air quality),
+ * and the barometric altitude if the GPS does not give it.
+ * Saves the state of the BSEC library for the next wake-up.
+ * @param packet: packet in which the values are recorded
+ * @param index: index of the measurement
+ * @param location: location of the device
+ * @return: true if a value raises an emergency, false otherwise
+ */
+bool Bme680Driver::read(Packet* packet, uint8_t index, device_location_t* location)
+{
+	// Read values
+	float temperature = _bme680.temperature;
+	packet->addTemperature(temperature, index);
+	float pressure = _bme680.pressure;
+	packet->addPressure(pressure, index);
+	float humidity = _bme680.humidity;
+	packet->addHumidity(humidity, index);
+	float airQuality = _bme680.iaq;
+	packet->addAirQuality(airQuality, index);
+#if DEBUG
+	printValue("Temperature", temperature);
+	printValue("Pressure", pressure);
+	printValue("Humidity", humidity);
+	printValue("Air quality", airQuality);
+#endif
+	if (!location->isAltitudeGps)
+	{
+		location->altitude = computeAltitude(temperature, pressure);
+#if DEBUG
+		printValue("Altitude (BME680)", location->altitude);
+#endif
+	}
+	_bme680.getState(bme680State);
+	bme680StateSaved = true;
+	// Update emergency, for all the values
+	bool emergency = checkEmergency(HEADER_TEMPERATURE, temperature, packet);
+	emergency |= checkEmergency(HEADER_PRESSURE, pressure, packet);
+	emergency |= checkEmergency(HEADER_HUMIDITY, humidity, packet);
+	emergency |= checkEmergency(HEADER_AIR_QUALITY, airQuality, packet);
+	return emergency;
+}
+
+/**
+ * Computes the approximate altitude based on the measured pressure and temperature.
+ * @param temperature: temperature (in °C)
+ * @param pressure: pressure (in Pa)
+ * @return: the altitude (in m)
+ */
+float Bme680Driver::computeAltitude(float temperature, float pressure)
+{
+	float seaLevelPressure = SEALEVELPRESSURE_HPA * 100.0;
+	float altitude = pow((seaLevelPressure/pressure), (1/5.257)) - 1;
+	return (altitude * (temperature + 273.15)) / 0.0065;
+}
@@ -0,0 +1,47 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the BME680 (temperature/pressure/humidity/air quality),
+ * with the BSEC library.
+ */
+
+#ifndef Bme680Driver_h
+#define Bme680Driver_h
+
+#include "Arduino.h"
+#include <Wire.h>
+#include <bsec.h>
+#include "SensorDriver.h"
+
+// BME680 virtual sensors list
+#define BME680_SENSORS 10
+
+/* Bme680Driver class */
+class Bme680Driver : public SensorDriver {
+
+	public:
+		Bme680Driver(uint8_t sda, uint8_t scl,
+		             int temperatureThreshold,
+		             int pressureThreshold,
+		             int humidityThreshold,
+		             int airQualityThreshold);
+
+		uint16_t getFields();
+		uint8_t getAcquisition();
+		bool needsVext();
+		void setup();
+		bool warmup();
+		bool read(Packet* packet, uint8_t index, device_location_t* location);
+
+	private:
+		Bsec _bme680;
+		uint8_t _sda;
+		uint8_t _scl;
+
+		static float computeAltitude(float temperature, float pressure);
+
+};
+
+#endif
@@ -143,6 +143,16 @@ static void OnTxNextPacketTimerEvent( void )
 	}
 }
 
+/*!
+ * \brief   Uplink confirm handler, called once the receive windows of an uplink are over:
+ *          redefine it to check if a confirmed uplink was acknowledged (AckReceived)
+ *
+ * \param   [IN] mcpsConfirm - Pointer to the confirm structure
+ */
+void __attribute__((weak)) uplinkConfirmHandle(McpsConfirm_t *mcpsConfirm)
+{
+}
+
 /*!
  * \brief   MCPS-Confirm event function
  *
@@ -177,6 +187,7 @@ static void McpsConfirm( McpsConfirm_t *mcpsConfirm )
 				break;
 		}
 	}
+	uplinkConfirmHandle(mcpsConfirm);
 	NextTx = true;
 }
 
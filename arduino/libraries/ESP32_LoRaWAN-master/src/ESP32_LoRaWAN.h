@@ -67,6 +67,8 @@ extern uint16_t userChannelsMask[6];
 extern LoRaWanClass LoRaWAN;
 extern SSD1306 Display;
 
+void uplinkConfirmHandle(McpsConfirm_t *mcpsConfirm);
+
 #ifdef __cplusplus
 extern "C"{
 #endif
@@ -0,0 +1,90 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Emergency detector of a sensor value, with a hysteresis band,
+ * a minimum dwell time and a rate-of-change trigger.
+ * The emergency is reported once, when it is raised: the noise of a value
+ * close to its threshold does not trigger a Wi-Fi transmission at every wake-up.
+ */
+
+#include "EmergencyDetector.h"
+
+/* No-arg constructor: disabled detector */
+EmergencyDetector::EmergencyDetector() {
+	_raise = 0;
+	_clear = 0;
+	_dwell = 1;
+	_slope = 0;
+	_enabled = false;
+}
+
+/**
+ * CONSTRUCTOR
+ * Creates an emergency detector. The state is kept by the caller.
+ * @param raise: threshold at or above which the emergency is raised
+ * @param clear: threshold below which the emergency is cleared, at most raise
+ * @param dwell: number of consecutive samples at or above raise to raise the emergency,
+ *               and below clear to clear it
+ * @param slope: rise of the value per minute raising the emergency at once,
+ *               even below the threshold, or 0 to disable the rate-of-change trigger
+ */
+EmergencyDetector::EmergencyDetector(float raise, float clear, uint8_t dwell, float slope) {
+	_raise = raise;
+	_clear = clear <= raise ? clear : raise;
+	_dwell = dwell > 0 ? dwell : 1;
+	_slope = slope > 0 ? slope : 0;
+	_enabled = true;
+}
+
+/**
+ * Checks if the detector is enabled.
+ * @return: true if the detector has thresholds, false otherwise
+ */
+bool EmergencyDetector::isEnabled() {
+	return _enabled;
+}
+
+/**
+ * Checks if an emergency is ongoing.
+ * @param state: state of the detector
+ * @return: true if the emergency was raised and not cleared yet, false otherwise
+ */
+bool EmergencyDetector::isActive(const emergency_state_t* state) {
+	return state->flags & EMERGENCY_ACTIVE;
+}
+
+/**
+ * Updates the state of the detector with a new sample of the value.
+ * @param state: state of the detector, updated
+ * @param value: new sample of the value
+ * @param minutes: time since the previous sample (in minutes)
+ * @return: true if the emergency is raised by this sample, false otherwise,
+ *          including while the emergency is ongoing
+ */
+bool EmergencyDetector::update(emergency_state_t* state, float value, float minutes) {
+	if (!_enabled)
+		return false;
+	bool steep = _slope > 0 && (state->flags & EMERGENCY_HAS_LAST) && minutes > 0 &&
+	             (value - state->last) / minutes >= _slope;
+	state->last = value;
+	state->flags |= EMERGENCY_HAS_LAST;
+
+	if (!(state->flags & EMERGENCY_ACTIVE)) {
+		state->dwell = value >= _raise ? state->dwell + 1 : 0;
+		if (!steep && state->dwell < _dwell)
+			return false;
+		state->flags |= EMERGENCY_ACTIVE;
+		state->dwell = 0;
+		return true;
+	}
+
+	// Ongoing emergency, cleared after enough samples below the band
+	state->dwell = (value < _clear && !steep) ? state->dwell + 1 : 0;
+	if (state->dwell >= _dwell) {
+		state->flags &= ~EMERGENCY_ACTIVE;
+		state->dwell = 0;
+	}
+	return false;
+}
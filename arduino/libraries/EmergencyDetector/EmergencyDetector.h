@@ -0,0 +1,52 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Emergency detector of a sensor value, with a hysteresis band,
+ * a minimum dwell time and a rate-of-change trigger.
+ */
+
+#ifndef EmergencyDetector_h
+#define EmergencyDetector_h
+
+#include <Arduino.h>
+
+// Flags of the state of a detector
+#define EMERGENCY_ACTIVE   0x01
+#define EMERGENCY_HAS_LAST 0x02
+
+// State of a detector, meant to be kept in RTC memory between the wake-ups.
+// Zeroed memory is an idle detector without previous value.
+typedef struct emergencyState {
+	uint8_t flags;
+	// Number of consecutive samples on the other side of the band
+	uint8_t dwell;
+	// Previous value, for the rate of change
+	float last;
+} emergency_state_t;
+
+/* EmergencyDetector class */
+class EmergencyDetector {
+
+	public:
+		EmergencyDetector();
+		EmergencyDetector(float raise, float clear, uint8_t dwell = 1, float slope = 0);
+
+		bool isEnabled();
+		bool update(emergency_state_t* state, float value, float minutes);
+		static bool isActive(const emergency_state_t* state);
+
+	private:
+		// The emergency is raised at or above _raise, and cleared below _clear
+		float _raise;
+		float _clear;
+		// Number of consecutive samples needed to raise or clear the emergency
+		uint8_t _dwell;
+		// Rise per minute raising the emergency at once, 0 to disable
+		float _slope;
+		bool _enabled;
+
+};
+
+#endif
@@ -24,7 +24,7 @@ bool loraWanAdr = true;
 /* Indicates if the node is sending confirmed or unconfirmed messages */
 bool isTxConfirmed = false;
 /* Application port */
-uint8_t appPort = 2;
+uint8_t appPort = LORA_PORT;
 /* Number of send trials */
 uint8_t confirmedNbTrials = 1;
 /* LoRaWAN debug level, set in Arduino settings */
@@ -32,36 +32,57 @@ uint8_t debugLevel = LoRaWAN_DEBUG_LEVEL;
 /*LoraWan region, select in arduino IDE tools*/
 LoRaMacRegion_t loraWanRegion = ACTIVE_REGION;
 
-// GPS serial
-HardwareSerial gpsSerial(1);
-
 // Variables stored in memory
 RTC_DATA_ATTR bool _startup = true;
 RTC_DATA_ATTR uint8_t _count;
-RTC_DATA_ATTR float _latitude = DEFAULT_FLOAT;
-RTC_DATA_ATTR float _longitude = DEFAULT_FLOAT;
-RTC_DATA_ATTR float _altitude = DEFAULT_FLOAT;
-RTC_DATA_ATTR measurement_t _measurementsArray[MAX_MEASUREMENTS];
+RTC_DATA_ATTR device_location_t _location = {DEFAULT_FLOAT, DEFAULT_FLOAT, DEFAULT_FLOAT, false};
+RTC_DATA_ATTR MeasurementStore _measurementStore;
+// Statistics of the samples of the reporting period, in aggregation mode
+RTC_DATA_ATTR Aggregator _aggregator;
+// Fragmented batch: sequence number, pending fragments, index of the first and last measurements to send
+RTC_DATA_ATTR uint8_t _batchSequence = 0;
+RTC_DATA_ATTR bool _fragmentPending = false;
+RTC_DATA_ATTR uint8_t _fragmentFirst;
+RTC_DATA_ATTR uint8_t _fragmentLast;
 RTC_DATA_ATTR Packet packet;
-RTC_DATA_ATTR uint8_t bme680state[BSEC_MAX_STATE_BLOB_SIZE] = {0};
-
-// BME680 configuration for the least power consumption
-const uint8_t bsec_config_iaq[] = {
-#include "config/generic_33v_300s_28d/bsec_iaq.txt"
-};
-// BME680 virtual sensors list
-bsec_virtual_sensor_t bme680SensorList[BME680_SENSORS] = {
-	BSEC_OUTPUT_RAW_TEMPERATURE,
-	BSEC_OUTPUT_RAW_PRESSURE,
-	BSEC_OUTPUT_RAW_HUMIDITY,
-	BSEC_OUTPUT_RAW_GAS,
-	BSEC_OUTPUT_IAQ,
-	BSEC_OUTPUT_STATIC_IAQ,
-	BSEC_OUTPUT_CO2_EQUIVALENT,
-	BSEC_OUTPUT_BREATH_VOC_EQUIVALENT,
-	BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE,
-	BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY,
-};
+// Wake cycle profiler: statistics, pending summary, and radio phase of the last uplink,
+// whose receive windows end while the device goes to sleep
+RTC_DATA_ATTR WakeProfiler _profiler;
+RTC_DATA_ATTR bool _profilePending = false;
+RTC_DATA_ATTR uint8_t _radioPhase = RADIO_IDLE;
+RTC_DATA_ATTR uint32_t _rxWindowsDuration;
+// Adaptive sampling policy: step of the current batch (none before the first batch),
+// state of the policy, and last battery level
+RTC_DATA_ATTR adaptive_step_t _adaptiveStep = {0, 0, 0};
+RTC_DATA_ATTR adaptive_state_t _adaptiveState;
+RTC_DATA_ATTR uint8_t _battery = 100;
+// Store-and-forward: uplinks not acknowledged yet, uplink whose acknowledgement is awaited
+// and its acknowledgement, received in its receive windows while the device goes to sleep,
+// newest uplinks sent unconfirmed since the last confirmed one,
+// state of the network at the last acknowledgement, and time of the last measurement of the batch
+RTC_DATA_ATTR uplink_ring_t _uplinkRing;
+RTC_DATA_ATTR uint8_t _storeAck = STORE_ACK_NONE;
+RTC_DATA_ATTR bool _uplinkAcked = false;
+RTC_DATA_ATTR uint8_t _storeUnconfirmed = 0;
+RTC_DATA_ATTR bool _storeLinkUp = true;
+RTC_DATA_ATTR uint32_t _batchTime;
+// Clock of the device across the deep sleeps, at the last boot, and time of the next measurement (in ms)
+RTC_DATA_ATTR uint64_t _bootClock = 0;
+RTC_DATA_ATTR uint64_t _nextMeasurementTime = 0;
+
+// Acquisition tasks: names, and cores on which they run
+const char* ACQUISITION_NAMES[N_ACQUISITIONS] = {"uart", "i2c", "analog"};
+const BaseType_t ACQUISITION_CORES[N_ACQUISITIONS] = {0, 1, 0};
+
+/**
+ * Receives the confirmation of the last uplink from the LoRaWAN library,
+ * once its receive windows are over.
+ * @param mcpsConfirm: confirmation of the uplink
+ */
+void uplinkConfirmHandle(McpsConfirm_t *mcpsConfirm)
+{
+	_uplinkAcked = mcpsConfirm->McpsRequest == MCPS_CONFIRMED && mcpsConfirm->AckReceived;
+}
 
 /*
  * Constructor
@@ -84,15 +105,22 @@ EspDevice::EspDevice(uint32_t license[4], uint8_t DevEui[8], uint8_t AppEui[8],
 		_AppKey[i] = AppKey[i];
 	}
 
-	// Initialize connection to sensors
-	_bme280Connected = false;
-	_bme680Connected = false;
-	_gasSensorConnected = false;
-	_gpsConnected = false;
-	_soundSensorConnected = false;
-	_isAltitudeGps = false;
+	// No sensors until they are added
+	_nSensors = 0;
 
 	_emergency = false;
+	_aggregationSamples = 0;
+	_profileCycles = 0;
+	_storeForward = false;
+	_storeConfirmEvery = 1;
+	_wifiBinary = false;
+	_measured = false;
+
+	_acquisitionDone = NULL;
+	_valuesMutex = NULL;
+
+	// Battery and location are always measured
+	_fields = PRESENCE_BIT(HEADER_BATTERY) | LOCATION_FIELDS;
 
 	appDataSize = 1;
 }
@@ -100,7 +128,8 @@ EspDevice::EspDevice(uint32_t license[4], uint8_t DevEui[8], uint8_t AppEui[8],
 /**
  * Initializes the packet object associated to this device.
  * @param wakeupPeriod: time interval between successive wakeups
- * @param nMeasurements: number of measurements before sending packet
+ * @param nMeasurements: maximum number of measurements before sending packet
+ *                       (sent earlier if the next one does not fit at the current data rate)
  * @param version: packet format version
  */
 void EspDevice::initPacket(uint8_t wakeupPeriod, uint8_t nMeasurements, uint8_t version)
@@ -108,7 +137,137 @@ void EspDevice::initPacket(uint8_t wakeupPeriod, uint8_t nMeasurements, uint8_t
 	_wakeupPeriod = wakeupPeriod;
 	_nMeasurements = nMeasurements;
 	packet.init(wakeupPeriod, nMeasurements, version);
-	packet.setMeasurementsArray(_measurementsArray);
+	packet.setMeasurementStore(&_measurementStore);
+	packet.setFields(_fields);
+}
+
+/**
+ * Adds fields to the measurement store of the packet, for a new sensor.
+ * @param fields: bitmap of the fields measured by the sensor
+ */
+void EspDevice::addFields(uint16_t fields)
+{
+	_fields |= fields;
+	packet.setFields(_fields);
+}
+
+/**
+ * Overrides the quantization of a field in the packet (versions 4 and 5).
+ * Must be called after initPacket. Ignored by the versions 1 to 3.
+ * @param header: header of the field
+ * @param min: minimum value of the field
+ * @param resolution: resolution of the field, 1, 2 or 5 times a power of 10
+ * @param width: size of the field in bytes, from 1 to 4
+ */
+void EspDevice::setQuantization(uint8_t header, float min, float resolution, uint8_t width)
+{
+	if (!packet.setQuantization(header, min, resolution, width))
+	{
+#if DEBUG
+		Serial.print("Invalid quantization, or version below 4, for header ");
+		Serial.println(header);
+#endif
+	}
+}
+
+/**
+ * Switches the packet to the aggregation mode (versions 4 and 5):
+ * the device still measures at each wake-up, but sends only the minimum, maximum,
+ * mean and standard deviation of each field once per reporting period,
+ * i.e. every samples wake-ups, instead of the measurements.
+ * The statistics are kept in RTC memory between the wake-ups.
+ * Must be called after initPacket.
+ * @param samples: number of samples per reporting period
+ * @return: true if the aggregation mode is set, false if the version does not support it
+ */
+bool EspDevice::initAggregation(uint8_t samples)
+{
+	if (samples == 0 || !packet.setAggregator(&_aggregator))
+	{
+#if DEBUG
+		Serial.println("Aggregation needs a packet format version 4 or 5.");
+#endif
+		_aggregationSamples = 0;
+		return false;
+	}
+	_aggregationSamples = samples;
+	return true;
+}
+
+/**
+ * Enables the uplink of the summaries of the wake cycle profiler, on the PROFILE_PORT port:
+ * the durations of the phases of the wake cycles (setup, join, warm-up, reading of each sensor,
+ * payload build, LoRaWAN transmission and receive windows, Wi-Fi transmission)
+ * are sent every cycles wake cycles, in a separate uplink.
+ * @param cycles: number of wake cycles between the summaries, 0 to disable them
+ */
+void EspDevice::initProfiler(uint8_t cycles)
+{
+	_profileCycles = cycles;
+}
+
+/**
+ * Adds a battery step to the adaptive sampling policy: below the battery level of the
+ * previous step, the device wakes up every wakeupPeriod minutes and sends its measurements
+ * by batches of nMeasurements. The steps apply from the next batch, and the interval
+ * of the batches is sent in their preamble (versions 2 and above).
+ * Without steps, the wake-up period and the number of measurements of initPacket apply.
+ * @param battery: minimum battery level of the step (%)
+ * @param wakeupPeriod: wake-up period of the step (in minutes)
+ * @param nMeasurements: maximum number of measurements per batch of the step
+ * @return: true if the step was added, false otherwise
+ */
+bool EspDevice::addAdaptiveStep(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements)
+{
+	return _adaptive.addStep(battery, wakeupPeriod, nMeasurements);
+}
+
+/**
+ * Sets the fast step of the adaptive sampling policy: when a reading changes quickly
+ * (see setAdaptiveRate), the current batch is sent at once, and the next batches use the
+ * fast step for hold wake-ups, if the battery is at or above the given level.
+ * @param battery: minimum battery level of the fast step (%)
+ * @param wakeupPeriod: wake-up period of the fast step (in minutes)
+ * @param nMeasurements: maximum number of measurements per batch of the fast step
+ * @param hold: number of wake-ups in the fast step after the last fast change
+ * @return: true if the fast step was set, false otherwise
+ */
+bool EspDevice::setAdaptiveFast(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements, uint8_t hold)
+{
+	return _adaptive.setFastStep(battery, wakeupPeriod, nMeasurements, hold);
+}
+
+/**
+ * Sets the change rate of a field switching the adaptive sampling policy to its fast step.
+ * @param header: header of the field
+ * @param rate: change of the value per minute, up or down
+ * @return: true if the rate was set, false if the header is invalid
+ */
+bool EspDevice::setAdaptiveRate(uint8_t header, float rate)
+{
+	return _adaptive.setChangeRate(header, rate);
+}
+
+/**
+ * Enables the store-and-forward of the uplinks: the payloads and the fragments are kept
+ * until they are acknowledged, in RTC memory, then in the NVS flash when the RTC memory is full.
+ * Once the network acknowledges an uplink again, the uplinks kept during the outage are sent
+ * again, oldest first, on the STORED_PORT port, with the age of their last measurement,
+ * between the regular measurements. The frames leave room for the header of the STORED_PORT port.
+ * Each acknowledgement is a downlink, which takes the airtime of the gateway, shared by all
+ * the devices, and counts towards its duty cycle: while the network is up, only one uplink
+ * out of confirmEvery is confirmed, and its acknowledgement also acknowledges the uplinks
+ * sent unconfirmed before it. The uplinks are confirmed until the network is back.
+ * With confirmEvery above 1, up to confirmEvery - 1 uplinks received before an outage
+ * may be sent again after it, as duplicates of the same measurements.
+ * @param confirmEvery: one confirmed uplink out of confirmEvery while the network is up (1 by default)
+ */
+void EspDevice::initStoreForward(uint8_t confirmEvery)
+{
+	_storeForward = true;
+	_storeConfirmEvery = confirmEvery > 0 ? confirmEvery : 1;
+	if (_spill.begin())
+		_store.setSpill(&_spill);
 }
 
 /**
@@ -124,6 +283,42 @@ void EspDevice::initWifi(const char *ssid, const char *password, const char *goo
 	wifi.init(ssid, password, googleKey, urlInflux, token, devEUI_string());
 }
 
+/**
+ * Enables the binary Wi-Fi uplinks: the emergency measurements are posted to InfluxDB
+ * as the payload of a LoRaWAN uplink, decoded by the cloud function, instead of JSON.
+ * The batches that do not fit in a payload are still sent as JSON.
+ */
+void EspDevice::initWifiBinary()
+{
+	_wifiBinary = true;
+}
+
+/**
+ * Sets a static IP configuration for the Wi-Fi, instead of DHCP.
+ * @param ip: IP address of the device
+ * @param gateway: IP address of the gateway
+ * @param subnet: subnet mask
+ * @param dns: IP address of the DNS server
+ * @return: true if the addresses are valid, false otherwise
+ */
+bool EspDevice::setWifiStaticIp(const char* ip, const char* gateway, const char* subnet, const char* dns)
+{
+	return wifi.setStaticIp(ip, gateway, subnet, dns);
+}
+
+/**
+ * Sets the scans of the access points for the Wi-Fi geolocation at start-up.
+ * @param passive: true to listen to the beacons of the access points, false to probe them
+ * @param seenChannels: true to scan only the channels of the access points seen by the last
+ *                      full scan, kept in the NVS flash, false to scan all the channels
+ * @param channelTime: time of the scan per channel (in ms), at least a beacon interval
+ *                     (102.4 ms) for the passive scans
+ */
+void EspDevice::setWifiScan(bool passive, bool seenChannels, uint16_t channelTime)
+{
+	wifi.setScan(passive, seenChannels, channelTime);
+}
+
 /**
  * Applies all the battery-saving features.
  */
@@ -145,6 +340,8 @@ void EspDevice::setup()
 {
 	// Battery saving
 	saveBattery();
+	// After the change of the CPU frequency, which scales the cycle counter
+	profile_timer_t timer = WakeProfiler::start();
 
 #if DEBUG
 	// Start serial ports
@@ -167,6 +364,12 @@ void EspDevice::setup()
 	SPI.begin(SCK, MISO, MOSI, SS);
 	Mcu.init(SS, RST_LoRa, DIO0, DIO1, _license);
 	deviceState = DEVICE_STATE_INIT;
+
+	// Receive windows of the last uplink, until the device went to sleep
+	if (_radioPhase == RADIO_RX)
+		_profiler.record(PROFILE_RX_WINDOWS, _rxWindowsDuration);
+	_radioPhase = RADIO_IDLE;
+	_profiler.stop(PROFILE_SETUP, &timer);
 }
 
 /**
@@ -187,398 +390,623 @@ void EspDevice::stopVext()
 }
 
 /**
- * Adds the BME280 sensor (temperature/pressure/humidity),
- * with the specified SDA and SCL GPIO pins.
+ * Adds a sensor to the device, whose values are read at each wake-up.
+ * The driver must stay valid while the device is running (e.g. a global variable).
+ * @param sensor: driver of the sensor
+ * @return: true if the sensor was added, false if there are too many sensors
+ */
+bool EspDevice::addSensor(SensorDriver* sensor)
+{
+	if (_nSensors >= MAX_SENSORS)
+	{
+#if DEBUG
+		Serial.println("Too many sensors.");
+#endif
+		return false;
+	}
+	_sensors[_nSensors++] = sensor;
+	sensor->setup();
+	addFields(sensor->getFields());
+	return true;
+}
+
+/**
+ * Retrieves device location with Google Geolocation API.
  */
-void EspDevice::addBme280(uint8_t sda, uint8_t scl,
-					   int temperatureThreshold,
-					   int pressureThreshold,
-					   int humidityThreshold)
+void EspDevice::getWifiLocation()
 {
-	Wire.begin(sda, scl);
-	_bme280Connected = true;
-	_temperatureThreshold = temperatureThreshold;
-	_pressureThreshold = pressureThreshold;
-	_humidityThreshold = humidityThreshold;
+	location_t location = wifi.getLocation();
+	if (location.accuracy < MAX_LOC_ACCURACY) {
+		_location.latitude = location.lat;
+		_location.longitude = location.lon;
+#if DEBUG
+		printValue("Latitude (Wi-Fi)", _location.latitude);
+		printValue("Longitude (Wi-Fi)", _location.longitude);
+#endif
+	}
 }
 
 /**
- * Starts the BME280 sensor (temperature/pressure/humidity).
- * @returns: true if the sensor was successfully started, false otherwise
+ * Warm-up with Vext on before reading the values of a sensor,
+ * until the sensor is ready or the timeout expires.
+ * @param sensor: driver of the sensor
+ * @param timeout: maximum duration of the warm-up (in ms)
  */
-bool EspDevice::startBme280()
+void EspDevice::warmup(SensorDriver* sensor, uint32_t timeout)
 {
-	return bme280.begin(0x76);
+	uint32_t start = millis();
+	while (!sensor->isReady() && millis() - start < timeout)
+	{
+		delay(WARMUP_POLL_MS);
+	}
+#if DEBUG
+	printValue("Warm-up [ms]", millis() - start);
+#endif
 }
 
 /**
- * Adds the gas sensor (MQ-135) on the specified analog pin.
- * @param gpio: analog pin where the sensor is wired
+ * Retrieves the percentage of remaining battery.
  */
-void EspDevice::addGasSensor(uint8_t gpio, int co2Threshold)
+void EspDevice::getBattery()
 {
-	gasSensor.setPin(gpio);
-	_gasSensorConnected = true;
-	_co2Threshold = co2Threshold;
+	// First measurement is always buggy
+	float analog = analogRead(BATTERY_PIN);
+	analog = analogRead(BATTERY_PIN);
+	float m = 100.0 / (((float) MAX_ANALOG) - ((float) MIN_ANALOG));
+	float p = -m * ((float) MIN_ANALOG);
+	float percentage = m * analog + p;
+	uint8_t battery;
+	if (percentage >= 100.0)
+		battery = 100;
+	else if (percentage <= 1.0)
+		battery = 1;
+	else
+		battery = (uint8_t) percentage;
+	packet.addBattery(battery, _count);
+	_battery = battery;
+
+	#if DEBUG
+	printValue("Battery [%]", battery);
+	#endif
 }
 
 /**
- * Adds the GPS module.
- * @param gpsSerialBaud: serial baud rate for communication with the GPS
- * @param gpsRx: GPIO pin used as serial RX for communication with the GPS
- * @param gpsRx: GPIO pin used as serial TX for communication with the GPS
+ * Adds the location data (latitude, longitude) to the Packet object.
  */
-void EspDevice::addGPS(uint32_t gpsSerialBaud, uint8_t gpsRx, uint8_t gpsTx)
+void EspDevice::addLocationData()
 {
-	_gpsSerialBaud = gpsSerialBaud;
-	_gpsRx = gpsRx;
-	_gpsTx = gpsTx;
-	_gpsConnected = true;
+	packet.addLatitude(_location.latitude, _count);
+	packet.addLongitude(_location.longitude, _count);
+	packet.addAltitude(_location.altitude, _count);
 }
 
 /**
- * Adds the sound sensor on the specified ADC GPIO pin.
- * @param gpio: ADC GPIO pin where the sound sensor is wired
+ * Locks the measured values (packet, location and emergency),
+ * shared by the acquisition tasks.
  */
-void EspDevice::addSoundSensor(uint8_t gpio, int noiseThreshold)
+void EspDevice::lockValues()
 {
-	soundSensor.setAnalogPin(gpio);
-	_soundSensorConnected = true;
-	_noiseThreshold = noiseThreshold;
+	if (_valuesMutex != NULL)
+		xSemaphoreTake(_valuesMutex, portMAX_DELAY);
 }
 
 /**
- * Adds the BME680 sensor (temperature/pressure/humidity/air quality),
- * with the specified SDA and SCL GPIO pins,
- * and the specified threshold values.
+ * Unlocks the measured values, shared by the acquisition tasks.
  */
-void EspDevice::addBme680(uint8_t sda, uint8_t scl,
-                          int temperatureThreshold,
-												  int pressureThreshold,
-												  int humidityThreshold,
-												  int airQualityThreshold)
+void EspDevice::unlockValues()
 {
-	Wire.begin(sda, scl);
-	_bme680Connected = true;
-	_temperatureThreshold = temperatureThreshold;
-	_pressureThreshold = pressureThreshold;
-	_humidityThreshold = humidityThreshold;
-	_airQualityThreshold = airQualityThreshold;
+	if (_valuesMutex != NULL)
+		xSemaphoreGive(_valuesMutex);
 }
 
 /**
- * Starts the BME680 sensor (temperature/pressure/humidity/air quality).
- * @returns: true if the sensor was successfully started and had new data,
- *           false otherwise
+ * Reads the sensors of an acquisition task, one after the other.
+ * The sensors are warmed up and read without holding the lock,
+ * which is only taken to record their values and their profile.
+ * @param acquisition: acquisition task (ACQUISITION_UART, ACQUISITION_I2C or ACQUISITION_ANALOG)
  */
-bool EspDevice::startBme680()
+void EspDevice::acquire(uint8_t acquisition)
 {
-	bme680.begin(BME680_I2C_ADDR_SECONDARY, Wire);
-	bme680.setConfig(bsec_config_iaq);
-	if (!_startup)
-		bme680.setState(bme680state);
-	bme680.updateSubscription(bme680SensorList, BME680_SENSORS, BSEC_SAMPLE_RATE_ULP);
-	return bme680.status == BSEC_OK && bme680.bme680Status == BME680_OK && bme680.run();
+	for (uint8_t i = 0; i < _nSensors; i++)
+	{
+		SensorDriver* sensor = _sensors[i];
+		if (sensor->getAcquisition() != acquisition)
+			continue;
+		if (sensor->warmup())
+		{
+			profile_timer_t timer = WakeProfiler::start();
+			warmup(sensor, VEXT_DELAY_SEC * 1000);
+			uint32_t warmupDuration = WakeProfiler::elapsed(&timer);
+			lockValues();
+			_profiler.record(PROFILE_WARMUP, warmupDuration);
+			timer = WakeProfiler::start();
+			if (sensor->read(&packet, _count, &_location))
+				_emergency = true;
+			_profiler.stop(PROFILE_READ + i, &timer);
+			unlockValues();
+		}
+		sensor->shutdown();
+	}
 }
 
 /**
- * Retrieves device location with Google Geolocation API.
+ * FreeRTOS task reading the sensors of an acquisition,
+ * which signals its end in the event group of the device.
+ * @param parameters: acquisition_task_t of the task
  */
-void EspDevice::getWifiLocation()
+void EspDevice::acquisitionTask(void* parameters)
 {
-	location_t location = wifi.getLocation();
-	if (location.accuracy < MAX_LOC_ACCURACY) {
-		_latitude = location.lat;
-		_longitude = location.lon;
+	acquisition_task_t* task = (acquisition_task_t*) parameters;
+	task->device->acquire(task->acquisition);
+	xEventGroupSetBits(task->device->_acquisitionDone, ACQUISITION_BIT(task->acquisition));
+	vTaskDelete(NULL);
+}
+
+/**
+ * Starts an acquisition task, pinned to its core.
+ * If the task cannot be created, the sensors are read in the calling task.
+ * @param acquisition: acquisition task (ACQUISITION_UART, ACQUISITION_I2C or ACQUISITION_ANALOG)
+ * @return: the bit of the task in the event group, or 0 if the sensors were already read
+ */
+EventBits_t EspDevice::startAcquisition(uint8_t acquisition)
+{
+	_acquisitionTasks[acquisition].device = this;
+	_acquisitionTasks[acquisition].acquisition = acquisition;
+	if (_acquisitionDone != NULL && _valuesMutex != NULL &&
+	    xTaskCreatePinnedToCore(acquisitionTask, ACQUISITION_NAMES[acquisition], ACQUISITION_STACK_SIZE,
+	                            &_acquisitionTasks[acquisition], ACQUISITION_PRIORITY, NULL,
+	                            ACQUISITION_CORES[acquisition]) == pdPASS)
+		return ACQUISITION_BIT(acquisition);
 #if DEBUG
-		printValue("Latitude (Wi-Fi)", _latitude);
-		printValue("Longitude (Wi-Fi)", _longitude);
+	Serial.print("Cannot start acquisition task ");
+	Serial.println(ACQUISITION_NAMES[acquisition]);
 #endif
-	}
+	acquire(acquisition);
+	return 0;
 }
 
-/**
- * Warm-up delay with Vext on before reading sensor values.
- * If the GPS is connected, warm up the serial connection with it.
- * If not, simply wait with Vext on.
- * @param time: duration of the warm-up (in ms)
+/*
+ * Retrieves values from the connected sensors.
+ * The sensors of each acquisition task (UART, e.g. the GPS NMEA ingestion,
+ * I2C and analog sensors) are read concurrently with the other tasks, pinned
+ * to both cores, so that the device stays awake for the longest of them
+ * instead of their sum. The location is added once all the tasks have ended.
  */
-void EspDevice::warmupSensors(uint32_t time)
+void EspDevice::getValues()
 {
-	if (_gpsConnected)
+	profile_timer_t timer = WakeProfiler::start();
+	// Battery level
+	getBattery();
+
+	// Sensors powered by Vext, and acquisition tasks with sensors
+	bool vext = false;
+	bool acquisitions[N_ACQUISITIONS] = {false};
+	for (uint8_t i = 0; i < _nSensors; i++)
 	{
-		gpsSerial.begin(_gpsSerialBaud, SERIAL_8N1, _gpsRx, _gpsTx);
-		for (int i = 0; i < 10; i++)
-		{
-			while (gpsSerial.available())
-			{
-				gps.encode(gpsSerial.read());
-			}
-			delay(time / 10);
-		}
+		vext |= _sensors[i]->needsVext();
+		acquisitions[_sensors[i]->getAcquisition()] = true;
 	}
-	else
+	if (vext)
+		startVext();
+
+	_location.isAltitudeGps = false;
+	_valuesMutex = xSemaphoreCreateMutex();
+	_acquisitionDone = xEventGroupCreate();
+	EventBits_t running = 0;
+	for (uint8_t acquisition = 0; acquisition < N_ACQUISITIONS; acquisition++)
 	{
-		delay(time);
+		if (acquisitions[acquisition])
+			running |= startAcquisition(acquisition);
 	}
+
+	// Join the acquisition tasks
+	if (running != 0)
+		xEventGroupWaitBits(_acquisitionDone, running, pdTRUE, pdTRUE, portMAX_DELAY);
+	if (_acquisitionDone != NULL)
+		vEventGroupDelete(_acquisitionDone);
+	if (_valuesMutex != NULL)
+		vSemaphoreDelete(_valuesMutex);
+	_acquisitionDone = NULL;
+	_valuesMutex = NULL;
+
+	addLocationData();
+
+	stopVext();
+	_profiler.stop(PROFILE_ACQUISITION, &timer);
 }
 
 /**
- * Retrieves the percentage of remaining battery.
+ * Applies the step of the adaptive sampling policy to the packet, at each wake-up,
+ * as the packet is initialized with the configuration of the device.
  */
-void EspDevice::getBattery()
+void EspDevice::applyAdaptiveStep()
 {
-	// First measurement is always buggy
-	float analog = analogRead(BATTERY_PIN);
-	analog = analogRead(BATTERY_PIN);
-	float m = 100.0 / (((float) MAX_ANALOG) - ((float) MIN_ANALOG));
-	float p = -m * ((float) MIN_ANALOG);
-	float percentage = m * analog + p;
-	uint8_t battery;
-	if (percentage >= 100.0)
-		battery = 100;
-	else if (percentage <= 1.0)
-		battery = 1;
-	else
-		battery = (uint8_t) percentage;
-	packet.addBattery(battery, _count);
+	if (_adaptive.isEnabled() && _adaptiveStep.wakeupPeriod > 0)
+		packet.setBatch(_adaptiveStep.wakeupPeriod, _adaptiveStep.nMeasurements);
+}
 
-	#if DEBUG
-	printValue("Battery [%]", battery);
-	#endif
+/**
+ * Updates the adaptive sampling policy with the last measurement.
+ * @return: true if the policy switches to a shorter wake-up period, false otherwise
+ */
+bool EspDevice::updateAdaptive()
+{
+	if (!_adaptive.isEnabled())
+		return false;
+	_adaptive.startCycle(&_adaptiveState);
+	measurement_t measurement = packet.getMeasurement(_count);
+	// Change of each present value, over the interval of the batch
+#define ESP_FIELD_UPDATE(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	if (isPresentValue<type>(measurement.member)) \
+		_adaptive.update(&_adaptiveState, header, measurement.member, packet.getInterval());
+	PACKET_FIELDS(ESP_FIELD_UPDATE)
+	adaptive_step_t base = {0, _wakeupPeriod, _nMeasurements};
+	adaptive_step_t step = _adaptive.select(&_adaptiveState, _battery, base);
+	return step.wakeupPeriod < packet.getInterval();
 }
 
 /**
- * Retrieves the values from the BME280 sensor
- * (temperature, pressure, humidity).
+ * Selects the step of the adaptive sampling policy for the next batch,
+ * once the current batch (or reporting period) and its fragments are sent.
  */
-void EspDevice::getBme280Values()
+void EspDevice::selectAdaptiveStep()
 {
-	// Read values
-	float temperature = bme280.readTemperature();
-	packet.addTemperature(temperature, _count);
-	float pressure = bme280.readPressure();
-	packet.addPressure(pressure, _count);
-	float humidity = bme280.readHumidity();
-	packet.addHumidity(humidity, _count);
-#if DEBUG
-	printValue("Temperature", temperature);
-	printValue("Pressure", pressure);
-	printValue("Humidity", humidity);
-#endif
-	if (!_isAltitudeGps)
+	if (!_adaptive.isEnabled())
+		return;
+	bool empty = packet.isAggregating() ? _aggregator.getSamples() == 0 : _count == 0;
+	if (empty && !_fragmentPending)
 	{
-		_altitude = bme280.readAltitude(SEALEVELPRESSURE_HPA);
+		adaptive_step_t base = {0, _wakeupPeriod, _nMeasurements};
+		_adaptiveStep = _adaptive.select(&_adaptiveState, _battery, base);
+		applyAdaptiveStep();
 #if DEBUG
-		printValue("Altitude (BME280)", _altitude);
+		printValue("Wake-up period [min]", _adaptiveStep.wakeupPeriod);
+		printValue("Measurements per batch", _adaptiveStep.nMeasurements);
 #endif
 	}
-	// Update emergency
-	if (temperature >= _temperatureThreshold ||
-		pressure >= _pressureThreshold ||
-		humidity >= _humidityThreshold)
-		_emergency = true;
 }
 
 /**
- * Retrieves the noise value from the sound sensor.
+ * Retrieves the clock of the device, kept across the deep sleeps.
+ * @return: the time since the first boot (in ms)
  */
-void EspDevice::getSoundValue()
+uint64_t EspDevice::getClock()
 {
-	uint16_t noise = soundSensor.readAnalogNoise();
-	if (noise == 0)
-		_soundSensorConnected = false;
-	else
+	return _bootClock + millis();
+}
+
+/**
+ * Processes the acknowledgement of the last uplink of the store-and-forward, at the wake-up:
+ * the uplink is removed from the store once acknowledged, with the uplinks sent unconfirmed
+ * before it. Without acknowledgement, these are kept to be sent again.
+ */
+void EspDevice::processStoreAck()
+{
+	if (!_storeForward || _storeAck == STORE_ACK_NONE)
+		return;
+	if (_uplinkAcked)
 	{
-		packet.addNoise(noise, _count);
-		if (noise >= _noiseThreshold)
-			_emergency = true;
+		if (_storeAck == STORE_ACK_NEWEST)
+			_store.dropNewest(&_uplinkRing, _storeUnconfirmed + 1);
+		else
+			_store.dropOldest(&_uplinkRing);
 	}
-
+	if (_storeAck == STORE_ACK_NEWEST)
+		_storeUnconfirmed = 0;
+	_storeLinkUp = _uplinkAcked;
+	_storeAck = STORE_ACK_NONE;
 #if DEBUG
-	printValue("Noise", noise);
+	printValue("Uplink acknowledged", _uplinkAcked);
+	printValue("Stored uplinks", _store.getCount(&_uplinkRing));
+	printValue("Dropped uplinks", _uplinkRing.dropped);
 #endif
 }
 
 /**
- * Retrieves the gas concentration value from the MQ135 gas sensor.
+ * Retrieves the number of uplinks to send again, i.e. the uplinks of the store
+ * except the one whose acknowledgement is awaited, and the ones sent unconfirmed since.
+ * @return: the number of uplinks to send again
  */
-void EspDevice::getGasValue()
+uint16_t EspDevice::getBacklog()
 {
-	if (gasSensor.getRawValue() == 0)
-	{
-		_gasSensorConnected = false;
-#if DEBUG
-		Serial.println("Cannot read analog value from gas sensor.");
-#endif
-	}
-	else
-	{
-		float co2 = gasSensor.getPPM();
-		packet.addCO2(co2, _count);
-		if (co2 >= _co2Threshold)
-			_emergency = true;
+	if (!_storeForward)
+		return 0;
+	uint16_t count = _store.getCount(&_uplinkRing);
+	uint16_t pending = _storeUnconfirmed + (_storeAck != STORE_ACK_NONE ? 1 : 0);
+	return count > pending ? count - pending : 0;
+}
 
-#if DEBUG
-		printValue("CO2", co2);
-#endif
-	}
+/**
+ * Checks if the device must measure in this wake cycle. With the store-and-forward,
+ * the device also wakes up between the measurements to send the stored uplinks.
+ * @return: true if the measurement is due, false otherwise
+ */
+bool EspDevice::isMeasurementDue()
+{
+	return !_storeForward || getClock() + FRAGMENT_DELAY_SEC * 1000 >= _nextMeasurementTime;
 }
 
 /**
- * Retrieves the location values from the GPS.
+ * Retrieves the delay until the next wake-up, which sends a stored uplink
+ * if the network is up, if the uplink fits at the current data rate,
+ * and if there is time before the next measurement.
+ * @param remaining: time until the next measurement (in ms)
+ * @return: the delay until the next wake-up (in ms)
  */
-void EspDevice::getGpsValues()
+uint32_t EspDevice::getStoreDelay(uint64_t remaining)
 {
-	while (gpsSerial.available())
-	{
-		gps.encode(gpsSerial.read());
-	}
-	float latitude = gps.location.lat();
-	float longitude = gps.location.lng();
-	float altitude = gps.altitude.meters();
-	if (latitude != 0.0 || longitude != 0.0)
+	if (_storeLinkUp && getBacklog() > 0 && remaining > 2 * FRAGMENT_DELAY_SEC * 1000 && isStoredSendable())
+		return FRAGMENT_DELAY_SEC * 1000;
+	return remaining;
+}
+
+/**
+ * Pushes the frame in appData to the store before it is sent, if it is a payload or a fragment,
+ * and confirms the uplinks sent again, and the payloads and fragments whose turn has come,
+ * i.e. one out of _storeConfirmEvery while the network is up, all of them otherwise.
+ */
+void EspDevice::storeFrame()
+{
+	_uplinkAcked = false;
+	_storeAck = STORE_ACK_NONE;
+	if (_storeForward && (appPort == LORA_PORT || appPort == FRAGMENT_PORT))
 	{
-		_latitude = latitude;
-		_longitude = longitude;
-#if DEBUG
-		printValue("Latitude (GPS)", _latitude);
-		printValue("Longitude (GPS)", _longitude);
-#endif
+		stored_uplink_t uplink;
+		uplink.port = appPort;
+		uplink.time = _batchTime;
+		uplink.size = appDataSize;
+		memcpy(uplink.payload, appData, appDataSize);
+		_store.push(&_uplinkRing, &uplink);
+		if (!_storeLinkUp || _storeUnconfirmed + 1 >= _storeConfirmEvery)
+			_storeAck = STORE_ACK_NEWEST;
+		else
+			_storeUnconfirmed++;
 	}
-	if (altitude > 0)
+	else if (_storeForward && appPort == STORED_PORT)
 	{
-		_isAltitudeGps = true;
-		_altitude = altitude;
-#if DEBUG
-		printValue("Altitude (GPS)", _altitude);
-#endif
+		_storeAck = STORE_ACK_OLDEST;
 	}
-	gpsSerial.end();
+	isTxConfirmed = _storeAck != STORE_ACK_NONE;
 }
 
 /**
- * Adds the location data (latitude, longitude) to the Packet object.
+ * Checks if the oldest uplink of the store fits in a frame of the STORED_PORT port
+ * at the current data rate, which the ADR may have lowered during the outage.
+ * @return: true if the oldest uplink can be sent again, false otherwise
  */
-void EspDevice::addLocationData()
+bool EspDevice::isStoredSendable()
 {
-	packet.addLatitude(_latitude, _count);
-	packet.addLongitude(_longitude, _count);
-	packet.addAltitude(_altitude, _count);
+	stored_uplink_t uplink;
+	return _store.peekOldest(&_uplinkRing, &uplink) && uplink.size + STORED_HEADER_SIZE <= getMaxPayloadSize();
 }
 
 /**
- * Retrieves the values from the BME280 sensor
- * (temperature, pressure, humidity).
+ * Sends the oldest uplink of the store again, on the STORED_PORT port, preceded by
+ * the age of its last measurement and its original port.
+ * An uplink too large for the current data rate is kept, and sent once the ADR
+ * raises the data rate again: the next uplinks wait for it, so that they stay in order.
  */
-void EspDevice::getBme680Values() {
-	// Read values
-	float temperature = bme680.temperature;
-	packet.addTemperature(temperature, _count);
-	float pressure = bme680.pressure;
-	packet.addPressure(pressure, _count);
-	float humidity = bme680.humidity;
-	packet.addHumidity(humidity, _count);
-	float airQuality = bme680.iaq;
-	packet.addAirQuality(airQuality, _count);
+void EspDevice::sendStored()
+{
+	stored_uplink_t uplink;
+	if (!_store.peekOldest(&_uplinkRing, &uplink))
+		return;
+	if (uplink.size + STORED_HEADER_SIZE > getMaxPayloadSize())
+	{
 #if DEBUG
-	printValue("Temperature", temperature);
-	printValue("Pressure", pressure);
-	printValue("Humidity", humidity);
-	printValue("Air quality", airQuality);
+		Serial.println("Stored uplink does not fit in a LoRaWAN frame, keeping it.");
 #endif
-	if (!_isAltitudeGps)
-	{
-		computeAltitude(temperature, pressure);
-	#if DEBUG
-		printValue("Altitude (BME680)", _altitude);
-	#endif
+		return;
 	}
-	// Update emergency
-	if (temperature >= _temperatureThreshold ||
-		pressure >= _pressureThreshold ||
-		humidity >= _humidityThreshold ||
-	  airQuality >= _airQualityThreshold)
-		_emergency = true;
-	bme680.getState(bme680state);
+	uint32_t now = getClock() / 1000;
+	uint32_t age = now > uplink.time ? (now - uplink.time) / 60 : 0;
+	if (age > UINT16_MAX)
+		age = UINT16_MAX;
+	appPort = STORED_PORT;
+	appData[0] = age >> 8;
+	appData[1] = age;
+	appData[2] = uplink.port;
+	memcpy(appData + STORED_HEADER_SIZE, uplink.payload, uplink.size);
+	appDataSize = uplink.size + STORED_HEADER_SIZE;
+#if DEBUG
+	printValue("Stored uplink age [min]", age);
+	printValue("Stored uplink size", appDataSize);
+#endif
+	sendFrame();
 }
 
 /**
- * Computes the approximate altitude based on the measured pressure and temperature.
+ * Retrieves the maximum size of the application payload at the current data rate,
+ * as computed by the LoRaWAN MAC layer, which accounts for the pending MAC commands.
+ * @return: the maximum payload size (in bytes), bounded by the size of appData
  */
-void EspDevice::computeAltitude(float temperature, float pressure) {
-	float seaLevelPressure = SEALEVELPRESSURE_HPA * 100.0;
-	float altitude = pow((seaLevelPressure/pressure), (1/5.257)) - 1;
-	altitude = (altitude * (temperature + 273.15)) / 0.0065;
-	_altitude = altitude;
+uint8_t EspDevice::getMaxPayloadSize()
+{
+	LoRaMacTxInfo_t txInfo;
+	LoRaMacQueryTxPossible(0, &txInfo);
+	return txInfo.MaxPossiblePayload < sizeof(appData) ? txInfo.MaxPossiblePayload : sizeof(appData);
 }
 
-/*
- * Retrieves values from the connected sensors.
+/**
+ * Retrieves the maximum size of the payloads and fragments of the batches at the current data rate,
+ * which leave room for the header of the STORED_PORT port with the store-and-forward.
+ * @return: the maximum size of the batch payloads (in bytes)
  */
-void EspDevice::getValues()
+uint8_t EspDevice::getBatchPayloadSize()
 {
-	// Battery level
-	getBattery();
-
-	if (_bme280Connected || _soundSensorConnected || _gpsConnected || _gasSensorConnected)
-		startVext();
-	if (_gpsConnected || _gasSensorConnected)
-		warmupSensors(VEXT_DELAY_SEC * 1000);
-
-	// Sound sensor
-	if (_soundSensorConnected)
-		getSoundValue();
-
-	// GPS
-	if (_gpsConnected) {
-		getGpsValues();
-	}
-
-	// BME280
-	if (_bme280Connected && startBme280())
-		getBme280Values();
-
-	// BME680
-	if (_bme680Connected && startBme680())
-		getBme680Values();
-
-	addLocationData();
-
-	// MQ135 (gas concentration)
-	if (_gasSensorConnected)
-		getGasValue();
+	uint8_t maxSize = getMaxPayloadSize();
+	if (_storeForward)
+		return maxSize - STORED_HEADER_SIZE;
+	return maxSize;
+}
 
-	stopVext();
+/**
+ * Checks if the batch of measurements must be sent now.
+ * The number of measurements per batch adapts to the data rate: the batch is sent
+ * when the next measurement would not fit in a frame at the current data rate
+ * (assuming it repeats the last one), so that each uplink, with its MAC overhead
+ * and its receive windows, carries as many measurements as possible.
+ * The number of measurements given to initPacket is the maximum size of a batch.
+ * In aggregation mode, the statistics are sent at the end of the reporting period.
+ * @return: true if the batch must be sent, false otherwise
+ */
+bool EspDevice::isBatchComplete()
+{
+	if (packet.isAggregating())
+		return _aggregator.getSamples() >= _aggregationSamples;
+	uint8_t maxSize = getBatchPayloadSize();
+	uint8_t nextSize = packet.getNextBatchPayloadSize(_count);
+#if DEBUG
+	printValue("Max payload size", maxSize);
+	printValue("Next batch size", nextSize);
+#endif
+	return nextSize == 0 || nextSize > maxSize;
 }
 
 /**
  * Encodes and sends the LoRa packet, based on the measured values.
+ * If the batch does not fit in one frame at the current data rate,
+ * it is sent in fragments, one per cycle, on the FRAGMENT_PORT port.
  */
 void EspDevice::sendLora()
 {
-	packet.buildLoraPayload(appData, &appDataSize);
+	uint8_t maxSize = getBatchPayloadSize();
+	if (!_fragmentPending)
+	{
+		// Time of the last measurement of the batch, kept with its stored frames
+		_batchTime = getClock() / 1000;
+		appPort = LORA_PORT;
+		profile_timer_t timer = WakeProfiler::start();
+		uint8_t* payload = packet.buildLoraPayload(appData, &appDataSize, maxSize);
+		_profiler.stop(PROFILE_BUILD, &timer);
+		if (payload != NULL)
+		{
+#if DEBUG
+			printValue("appDataSize", appDataSize);
+			packet.printPayload();
+#endif
+			//LoRaWAN.displaySending();
+			sendFrame();
+			return;
+		}
+		if (packet.isAggregating())
+		{
+			// The statistics keep accumulating until the next wake-up
+#if DEBUG
+			Serial.println("Aggregate does not fit in a LoRaWAN frame, extending the reporting period.");
+#endif
+			return;
+		}
+		// New fragmented batch
+		_batchSequence++;
+		_fragmentFirst = 0;
+		_fragmentLast = packet.getIndex();
+	}
+
+	appPort = FRAGMENT_PORT;
+	profile_timer_t timer = WakeProfiler::start();
+	uint8_t* fragment = packet.buildLoraFragment(appData, &appDataSize, maxSize, _batchSequence,
+	                                             &_fragmentFirst, _fragmentLast);
+	_profiler.stop(PROFILE_BUILD, &timer);
+	if (fragment == NULL)
+	{
+#if DEBUG
+		Serial.println("Measurement does not fit in a LoRaWAN frame, dropping measurements.");
+#endif
+		_fragmentPending = false;
+		packet.clearArray();
+		return;
+	}
+	_fragmentPending = _fragmentFirst <= _fragmentLast;
 
 #if DEBUG
-	printValue("appDataSize", appDataSize);
+	printValue("Fragment size", appDataSize);
 	packet.printPayload();
 #endif
 
 	//LoRaWAN.displaySending();
+	sendFrame();
+}
+
+/**
+ * Sends the summary of the wake cycle profiler, on the PROFILE_PORT port.
+ * The phases that do not fit in a frame at the current data rate are sent in the next summary.
+ */
+void EspDevice::sendProfile()
+{
+	_profilePending = false;
+	appPort = PROFILE_PORT;
+	appDataSize = _profiler.buildSummary(appData, getMaxPayloadSize());
+	if (appDataSize == 0)
+	{
+#if DEBUG
+		Serial.println("No profile to send.");
+#endif
+		return;
+	}
+#if DEBUG
+	printValue("Profile size", appDataSize);
+#endif
+	sendFrame();
+}
+
+/**
+ * Sends the frame in appData, and starts profiling its transmission.
+ */
+void EspDevice::sendFrame()
+{
+	storeFrame();
+	_radioTimer = WakeProfiler::start();
+	_radioPhase = RADIO_TX;
 	LoRaWAN.send(loraWanClass);
 }
 
+/**
+ * Profiles the transmission of the last uplink, polled while the device waits for the radio:
+ * the transmission ends when the radio leaves the TX state, and the receive windows
+ * last until the device goes to sleep. Their duration is recorded at the next wake-up.
+ */
+void EspDevice::profileRadio()
+{
+	if (_radioPhase == RADIO_TX && Radio.GetStatus() != RF_TX_RUNNING)
+	{
+		_profiler.stop(PROFILE_LORA_TX, &_radioTimer);
+		_radioTimer = WakeProfiler::start();
+		_radioPhase = RADIO_RX;
+		_rxWindowsDuration = 0;
+	}
+	else if (_radioPhase == RADIO_RX)
+	{
+		_rxWindowsDuration = WakeProfiler::elapsed(&_radioTimer);
+	}
+}
+
 /*
- * Encodes the JSON object based on the measured values,
+ * Encodes the JSON object based on the measured values, or their binary payload,
  * and sends it over Wi-Fi to InfluxDB.
+ * The measurements are kept if they were not delivered.
+ * @return: true if InfluxDB received the measurements, false otherwise
  */
-void EspDevice::sendWifi()
+bool EspDevice::sendWifi()
 {
-	uint8_t version = packet.getVersion();
-	measurement_t *measurementsArray = packet.getMeasurementsArray();
-	uint8_t size = packet.getIndex();
-	wifi.sendData(version, _wakeupPeriod, measurementsArray, size);
-	packet.clearArray();
+	profile_timer_t timer = WakeProfiler::start();
+	bool sent;
+	uint8_t payload[PAYLOAD_MAX_SIZE];
+	uint8_t payloadSize;
+	if (_wifiBinary && packet.buildPayload(payload, &payloadSize, sizeof(payload)) != NULL)
+	{
+		sent = wifi.sendPayload(LORA_PORT, payload, payloadSize);
+	}
+	else
+	{
+		uint8_t version = packet.getVersion();
+		uint8_t size = packet.getIndex();
+		sent = wifi.sendData(version, packet.getInterval(), &packet, size);
+	}
+	if (sent)
+		packet.clearArray();
+	_profiler.stop(PROFILE_WIFI, &timer);
+	return sent;
 }
 
 /**
@@ -597,36 +1025,69 @@ void EspDevice::loop()
 	{
 		// Code to be run only when the device starts for the first time
 		packet.clearArray();
+		_aggregator.clear();
+		_profiler.clear();
+		// The clock of the device restarts: the uplinks spilled before cannot be dated anymore
+		if (_storeForward)
+			_spill.clear();
 		getWifiLocation();
 		//LoRaWAN.displayJoining();
+		profile_timer_t timer = WakeProfiler::start();
 		LoRaWAN.join();
+		_profiler.stop(PROFILE_JOIN, &timer);
 		break;
 	}
 	case DEVICE_STATE_SEND:
 	{
+		applyAdaptiveStep();
+		processStoreAck();
 		if (_startup) {
 			_startup = false;
 		}
+		else if (_fragmentPending)
+		{
+			// Next fragment of the batch, before measuring again
+			sendLora();
+		}
+		else if (_profilePending)
+		{
+			sendProfile();
+		}
+		else if (!isMeasurementDue())
+		{
+			// Stored uplinks, sent between the measurements while the network is up
+			if (_storeLinkUp && getBacklog() > 0)
+				sendStored();
+		}
 		else
 		{
+			_measured = true;
 			getValues();
 	#if DEBUG
 			packet.printArray();
 	#endif
+			// A reading changing quickly ends the batch, to shorten the next ones
+			bool faster = updateAdaptive();
 			if (_emergency) {
-				sendWifi();
+				// Over LoRaWAN if the measurements cannot be delivered over Wi-Fi
+				if (!sendWifi())
+					sendLora();
 				_count = 0;
 			}
-			else if (_count >= _nMeasurements - 1)
+			else if (isBatchComplete() || faster)
 			{
 				sendLora();
 				_count = 0;
 			}
-			else
+			else if (!packet.isAggregating())
 			{
 				_count++;
 			}
+			// Summary of the profiler, sent in its own cycle
+			_profiler.endCycle();
+			_profilePending = _profileCycles > 0 && _profiler.getCycles() >= _profileCycles;
 		}
+		selectAdaptiveStep();
 
 		deviceState = DEVICE_STATE_CYCLE;
 		break;
@@ -634,7 +1095,25 @@ void EspDevice::loop()
 	case DEVICE_STATE_CYCLE:
 	{
 		// Schedule next packet transmission
-		txDutyCycleTime = _wakeupPeriod * 60000 + randr(-APP_TX_DUTYCYCLE_RND, APP_TX_DUTYCYCLE_RND);
+		uint64_t now = getClock();
+		if (_fragmentPending || _profilePending)
+		{
+			txDutyCycleTime = FRAGMENT_DELAY_SEC * 1000;
+		}
+		else if (_storeForward && !_measured && now < _nextMeasurementTime)
+		{
+			// Between the measurements, after a stored uplink: the measurements keep their period
+			txDutyCycleTime = getStoreDelay(_nextMeasurementTime - now);
+		}
+		else
+		{
+			txDutyCycleTime = packet.getInterval() * 60000 + randr(-APP_TX_DUTYCYCLE_RND, APP_TX_DUTYCYCLE_RND);
+			_nextMeasurementTime = now + txDutyCycleTime;
+			if (_storeForward)
+				txDutyCycleTime = getStoreDelay(txDutyCycleTime);
+		}
+		// The next boot starts when the timer expires
+		_bootClock = now + txDutyCycleTime;
 		LoRaWAN.cycle(txDutyCycleTime);
 		deviceState = DEVICE_STATE_SLEEP;
 		break;
@@ -642,6 +1121,7 @@ void EspDevice::loop()
 	case DEVICE_STATE_SLEEP:
 	{
 		//LoRaWAN.displayAck();
+		profileRadio();
 		LoRaWAN.sleep(loraWanClass, debugLevel);
 		break;
 	}
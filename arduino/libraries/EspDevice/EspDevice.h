@@ -13,65 +13,90 @@
 #include "Arduino.h"
 // LoRaWAN
 #include <ESP32_LoRaWAN.h>
-// BME280/680
-#include <Wire.h>
-#include <Adafruit_Sensor.h>
-#include <Adafruit_BME280.h>
-#include <bsec.h>
-// Gas sensor
-#include "MQ135.h"
-// Location / GPS
-#include "HardwareSerial.h"
-#include "TinyGPS++.h"
+// Concurrent acquisition
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 // Custom
 #include "Packet.h"
 #include "WifiSender.h"
-#include "SoundSensor.h"
+#include "SensorDriver.h"
+#include "WakeProfiler.h"
+#include "AdaptivePeriod.h"
+#include "StoreForward.h"
+#include "NvsSpill.h"
 
-// Debug messages
-#define DEBUG 1
-// Default pressure value
-#define SEALEVELPRESSURE_HPA (1013.25)
 // Vext control GPIO
 #define VEXT_GPIO 21
 // Battery-related constants
 #define BATTERY_PIN  36
 #define MAX_ANALOG   2127
 #define MIN_ANALOG   1606
-// Delay after powering Vext
+// Maximum warm-up delay after powering Vext, if the sensors are not ready before
 #define VEXT_DELAY_SEC 10
+// Period of the readiness checks during the warm-up
+#define WARMUP_POLL_MS 200
 // Serial output constants
 #define SERIAL_BAUD 115200
-// BME680 virtual sensors list
-#define BME680_SENSORS 10
+// Maximum number of sensors
+#define MAX_SENSORS 8
+// LoRaWAN port of the payloads (the fragments use FRAGMENT_PORT)
+#define LORA_PORT 2
+// LoRaWAN port of the summaries of the wake cycle profiler
+#define PROFILE_PORT 4
+// Radio phase of the last uplink being profiled
+#define RADIO_IDLE 0
+#define RADIO_TX   1
+#define RADIO_RX   2
+// Delay between the fragments of a batch too large for the data rate,
+// and before the summaries of the profiler.
+// The LoRaWAN MAC layer still enforces the duty cycle of the region on each fragment.
+#define FRAGMENT_DELAY_SEC 30
+// Uplink of the store-and-forward whose acknowledgement is awaited:
+// none, the last uplink pushed to the store, or the oldest one, sent again
+#define STORE_ACK_NONE   0
+#define STORE_ACK_NEWEST 1
+#define STORE_ACK_OLDEST 2
+// Bit of an acquisition task in the event group set when the tasks end
+#define ACQUISITION_BIT(acquisition) ((EventBits_t) 1 << (acquisition))
+// Stack size (in bytes) and priority of the acquisition tasks (BSEC needs a large stack)
+#define ACQUISITION_STACK_SIZE 8192
+#define ACQUISITION_PRIORITY   1
+
+class EspDevice;
+
+// Parameters of an acquisition task
+typedef struct acquisitionTask {
+	EspDevice* device;
+	uint8_t acquisition;
+} acquisition_task_t;
 
 class EspDevice {
 
 	public:
 			EspDevice(uint32_t license[4], uint8_t DevEui[8], uint8_t AppEui[8], uint8_t AppKey[16]);
 			void initPacket(uint8_t wakeupPeriod, uint8_t nMeasurements = 1, uint8_t version = 1);
+			void setQuantization(uint8_t header, float min, float resolution, uint8_t width);
+			bool initAggregation(uint8_t samples);
+			void initProfiler(uint8_t cycles);
+			// Adaptive sampling policy
+			bool addAdaptiveStep(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements);
+			bool setAdaptiveFast(uint8_t battery, uint8_t wakeupPeriod, uint8_t nMeasurements, uint8_t hold);
+			bool setAdaptiveRate(uint8_t header, float rate);
+			void initStoreForward(uint8_t confirmEvery = 1);
+			void initWifiBinary();
 	    void initWifi(const char* ssid,
 										const char* password,
 										const char* googleKey,
 										const char* urlInflux,
 										const char* token);
+			bool setWifiStaticIp(const char* ip, const char* gateway, const char* subnet, const char* dns);
+			void setWifiScan(bool passive, bool seenChannels, uint16_t channelTime);
 	    void setup();
 
 			// Adding sensors
-			void addBme280(uint8_t sda, uint8_t scl,
-                  	 int temperatureThreshold,
-                     int pressureThreshold,
-                     int humidityThreshold);
-			bool startBme280();
-	    void addGasSensor(uint8_t gpio, int co2Threshold);
-	    void addGPS(uint32_t gpsSerialBaud, uint8_t gpsRx, uint8_t gpsTx);
-			void addSoundSensor(uint8_t gpio, int noiseThreshold);
-			void addBme680(uint8_t sda, uint8_t scl,
-                  	 int temperatureThreshold,
-                     int pressureThreshold,
-                     int humidityThreshold,
-									 	 int airQualityThreshold);
-			bool startBme680();
+			bool addSensor(SensorDriver* sensor);
 
 	    void loop();
 
@@ -84,43 +109,52 @@ class EspDevice {
 
 			uint8_t _wakeupPeriod;
 			uint8_t _nMeasurements;
+			// Number of samples per reporting period in aggregation mode, 0 otherwise
+			uint8_t _aggregationSamples;
+			// Fields measured by the sensors, kept in the measurement store
+			uint16_t _fields;
 
 			WifiSender wifi;
 
 			// GPIO alim pin
 			uint8_t _gpioAlimPin;
-    	// BME280
-    	Adafruit_BME280 bme280;
-	    bool _bme280Connected;
-			int _temperatureThreshold;
-			int _pressureThreshold;
-			int _humidityThreshold;
-	    // Gas sensor
-	    MQ135 gasSensor;
-	    bool _gasSensorConnected;
-			int _co2Threshold;
-	    // Location / GPS
+			// Sensors, read at each wake-up
+			SensorDriver* _sensors[MAX_SENSORS];
+			uint8_t _nSensors;
+			// Wi-Fi credentials
 			const char* _ssid;
 			const char* _password;
-	    TinyGPSPlus gps;
-			uint32_t _gpsSerialBaud;
-			uint8_t _gpsRx;
-			uint8_t _gpsTx;
-	    bool _gpsConnected;
-			bool _isAltitudeGps;
-			// Sound sensor
-			SoundSensor soundSensor;
-			bool _soundSensorConnected;
-			int _noiseThreshold;
-			// BME680
-			Bsec bme680;
-			bool _bme680Connected;
-			int _airQualityThreshold;
 
 			// Emergency
 			bool _emergency;
 
+			// Number of wake cycles between the profiler summaries, 0 if they are not sent
+			uint8_t _profileCycles;
+			// Start of the radio phase being profiled
+			profile_timer_t _radioTimer;
+
+			// Adaptive sampling policy, disabled without steps
+			AdaptivePeriod _adaptive;
+
+			// Store-and-forward of the uplinks, with its spill in the NVS flash,
+			// and one uplink confirmed out of _storeConfirmEvery while the network is up
+			bool _storeForward;
+			uint8_t _storeConfirmEvery;
+			UplinkStore _store;
+			NvsSpill _spill;
+			// Measurement made in this wake cycle
+			bool _measured;
+
+			// Emergency measurements sent over Wi-Fi as binary payloads, JSON otherwise
+			bool _wifiBinary;
+
+			// Concurrent acquisition
+			acquisition_task_t _acquisitionTasks[N_ACQUISITIONS];
+			EventGroupHandle_t _acquisitionDone;
+			SemaphoreHandle_t _valuesMutex;
+
 			// Misc
+			void addFields(uint16_t fields);
 			void initStorage();
 			void saveBattery();
 			void printValue(char *name, float value);
@@ -132,22 +166,46 @@ class EspDevice {
 			void stopVext();
 
 			void getWifiLocation();
-			void warmupSensors(uint32_t time);
+
+			// Warm-up
+			void warmup(SensorDriver* sensor, uint32_t timeout);
+
+			// Concurrent acquisition
+			static void acquisitionTask(void* parameters);
+			EventBits_t startAcquisition(uint8_t acquisition);
+			void acquire(uint8_t acquisition);
+			void lockValues();
+			void unlockValues();
 
 			// Getting sensor values
 			void getBattery();
-			void getBme280Values();
-			void getSoundValue();
-			void getGasValue();
-			void getGpsValues();
 			void addLocationData();
-			void getBme680Values();
-			void computeAltitude(float temperature, float pressure);
 			void getValues();
 
+			// Adaptive sampling policy
+			void applyAdaptiveStep();
+			bool updateAdaptive();
+			void selectAdaptiveStep();
+
+			// Store-and-forward
+			uint64_t getClock();
+			void processStoreAck();
+			uint16_t getBacklog();
+			bool isMeasurementDue();
+			uint32_t getStoreDelay(uint64_t remaining);
+			void storeFrame();
+			bool isStoredSendable();
+			void sendStored();
+
 			// Encode and send
+			uint8_t getMaxPayloadSize();
+			uint8_t getBatchPayloadSize();
+			bool isBatchComplete();
 			void sendLora();
-			void sendWifi();
+			bool sendWifi();
+			void sendProfile();
+			void sendFrame();
+			void profileRadio();
 
 };
 
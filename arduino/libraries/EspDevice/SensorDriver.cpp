@@ -0,0 +1,62 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Interface of the sensor drivers of the ESP32 devices:
+ * emergency detection shared by the drivers.
+ */
+
+#include "SensorDriver.h"
+
+RTC_DATA_ATTR emergency_state_t SensorDriver::_emergencyStates[N_HEADERS];
+
+/**
+ * Sets the emergency detection of a field measured by the sensor.
+ * @param header: header of the field
+ * @param raise: threshold at or above which the emergency is raised
+ * @param clear: threshold below which the emergency is cleared (hysteresis)
+ * @param dwell: number of consecutive samples needed to raise or clear the emergency
+ * @param slope: rise per minute raising the emergency at once, 0 to disable
+ * @return: true if the emergency detection was set, false if the header is invalid
+ */
+bool SensorDriver::setEmergency(uint8_t header, float raise, float clear, uint8_t dwell, float slope)
+{
+	if (header < 1 || header > N_HEADERS)
+		return false;
+	_emergencyDetectors[header - 1] = EmergencyDetector(raise, clear, dwell, slope);
+	return true;
+}
+
+/**
+ * Sets the default emergency detection of a field, from its threshold.
+ * @param header: header of the field
+ * @param raise: threshold at or above which the emergency is raised
+ */
+void SensorDriver::setDefaultEmergency(uint8_t header, float raise)
+{
+	setEmergency(header, raise, raise - EMERGENCY_HYSTERESIS * fabs(raise));
+}
+
+/**
+ * Updates the emergency detection of a field with a new value.
+ * @param header: header of the field
+ * @param value: new value of the field
+ * @param packet: packet in which the values are recorded, giving the interval between the values
+ * @return: true if the value raises an emergency, false otherwise
+ */
+bool SensorDriver::checkEmergency(uint8_t header, float value, Packet* packet)
+{
+	if (header < 1 || header > N_HEADERS)
+		return false;
+	bool raised = _emergencyDetectors[header - 1].update(_emergencyStates + header - 1,
+	                                                      value, packet->getInterval());
+#if DEBUG
+	if (raised)
+	{
+		Serial.print("Emergency raised by header ");
+		Serial.println(header);
+	}
+#endif
+	return raised;
+}
@@ -0,0 +1,99 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Interface of the sensor drivers of the ESP32 devices.
+ * Each driver is a separate library, so that a sketch only links
+ * the drivers of the sensors it registers with EspDevice::addSensor.
+ */
+
+#ifndef SensorDriver_h
+#define SensorDriver_h
+
+#include "Arduino.h"
+#include "Packet.h"
+#include "EmergencyDetector.h"
+
+// Debug messages
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+// Default pressure value
+#define SEALEVELPRESSURE_HPA (1013.25)
+// Default emergency detection: the emergency is cleared below the threshold minus
+// EMERGENCY_HYSTERESIS times its absolute value, after EMERGENCY_DWELL samples
+#define EMERGENCY_HYSTERESIS 0.05
+#define EMERGENCY_DWELL      1
+
+// Acquisition tasks, in which the sensors are read concurrently:
+// UART sensors (GPS NMEA ingestion), I2C sensors, analog sensors
+#define ACQUISITION_UART   0
+#define ACQUISITION_I2C    1
+#define ACQUISITION_ANALOG 2
+#define N_ACQUISITIONS     3
+
+// Location of the device, shared by the sensors
+typedef struct deviceLocation {
+	float latitude;
+	float longitude;
+	float altitude;
+	// True if the altitude comes from the GPS, which takes precedence over the barometric altitude
+	bool isAltitudeGps;
+} device_location_t;
+
+/* SensorDriver interface */
+class SensorDriver {
+
+	public:
+		virtual ~SensorDriver() {}
+
+		// Overrides the emergency detection of a field: hysteresis band, dwell and rate of change
+		bool setEmergency(uint8_t header, float raise, float clear,
+		                  uint8_t dwell = EMERGENCY_DWELL, float slope = 0);
+
+		// Fields of the measurements given by the sensor, as a presence bitmap
+		virtual uint16_t getFields() = 0;
+		// Acquisition task of the sensor (ACQUISITION_UART, ACQUISITION_I2C or ACQUISITION_ANALOG)
+		virtual uint8_t getAcquisition() = 0;
+		// True if the sensor is powered by Vext
+		virtual bool needsVext() { return true; }
+
+		// Called once, when the sensor is added to the device
+		virtual void setup() {}
+		// Called at each wake-up, with Vext on: starts the sensor,
+		// returns false if the sensor is not available
+		virtual bool warmup() { return true; }
+		// Polled until the sensor is ready, or until the warm-up timeout
+		virtual bool isReady() { return true; }
+		// Records the values of the sensor in the packet, and updates the location,
+		// returns true if a value raises an emergency
+		virtual bool read(Packet* packet, uint8_t index, device_location_t* location) = 0;
+		// Called after reading the sensor, or if it is not available
+		virtual void shutdown() {}
+
+	protected:
+		// Emergency detection of the fields, with their state in RTC memory
+		void setDefaultEmergency(uint8_t header, float raise);
+		bool checkEmergency(uint8_t header, float value, Packet* packet);
+
+		/**
+		 * Prints a value on the serial port.
+		 * @param name: name of the value to print, will be printed before the value
+		 * @param value: value to be printed
+		 */
+		static void printValue(const char* name, float value) {
+			Serial.print(name);
+			Serial.print(": ");
+			Serial.println(value);
+		}
+
+	private:
+		// Emergency detectors of the fields, indexed by header - 1
+		EmergencyDetector _emergencyDetectors[N_HEADERS];
+		// State of the detectors, kept in RTC memory. Each field is measured by one sensor.
+		static emergency_state_t _emergencyStates[N_HEADERS];
+
+};
+
+#endif
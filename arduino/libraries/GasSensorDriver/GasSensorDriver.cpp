@@ -0,0 +1,88 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the MQ-135 gas sensor (CO2 concentration).
+ */
+
+#include "GasSensorDriver.h"
+
+/**
+ * Constructor
+ * Creates the driver of a gas sensor (MQ-135) on the specified analog pin.
+ * @param gpio: analog pin where the sensor is wired
+ * @param co2Threshold: emergency threshold of the CO2 concentration
+ */
+GasSensorDriver::GasSensorDriver(uint8_t gpio, int co2Threshold) : _gasSensor(gpio)
+{
+	_connected = true;
+	_warmupStart = 0;
+	setDefaultEmergency(HEADER_CO2, co2Threshold);
+}
+
+/**
+ * Retrieves the fields measured by the sensor.
+ * @return: presence bitmap of the fields
+ */
+uint16_t GasSensorDriver::getFields()
+{
+	return PRESENCE_BIT(HEADER_CO2);
+}
+
+/**
+ * Retrieves the acquisition task of the sensor.
+ * @return: ACQUISITION_ANALOG
+ */
+uint8_t GasSensorDriver::getAcquisition()
+{
+	return ACQUISITION_ANALOG;
+}
+
+/**
+ * Starts the warm-up of the sensor, just powered on, and checks if it is available.
+ * @return: false if the sensor could not be read before, true otherwise
+ */
+bool GasSensorDriver::warmup()
+{
+	_gasSensor.resetSettling();
+	_warmupStart = millis();
+	return _connected;
+}
+
+/**
+ * Checks if the sensor is ready, i.e. if its analog value has settled,
+ * after the minimum warm-up of its heater.
+ * @return: true if the sensor is ready, false otherwise
+ */
+bool GasSensorDriver::isReady()
+{
+	// Read at each poll, so that the readings of the window are ready at the end of the minimum warm-up
+	bool settled = _gasSensor.isSettled(GAS_SETTLED_TOLERANCE, GAS_SETTLED_READINGS);
+	return settled && millis() - _warmupStart >= GAS_WARMUP_MIN_MS;
+}
+
+/**
+ * Retrieves the gas concentration value from the sensor.
+ * @param packet: packet in which the values are recorded
+ * @param index: index of the measurement
+ * @param location: location of the device
+ * @return: true if the value raises an emergency, false otherwise
+ */
+bool GasSensorDriver::read(Packet* packet, uint8_t index, device_location_t* location)
+{
+	if (_gasSensor.getRawValue() == 0)
+	{
+		_connected = false;
+#if DEBUG
+		Serial.println("Cannot read analog value from gas sensor.");
+#endif
+		return false;
+	}
+	float co2 = _gasSensor.getPPM();
+	packet->addCO2(co2, index);
+#if DEBUG
+	printValue("CO2", co2);
+#endif
+	return checkEmergency(HEADER_CO2, co2, packet);
+}
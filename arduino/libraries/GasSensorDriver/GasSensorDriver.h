@@ -0,0 +1,42 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the MQ-135 gas sensor (CO2 concentration).
+ */
+
+#ifndef GasSensorDriver_h
+#define GasSensorDriver_h
+
+#include "Arduino.h"
+#include "MQ135.h"
+#include "SensorDriver.h"
+
+// Readiness: minimum warm-up of the heater once powered on (in ms),
+// then maximum difference between the raw values of a number of successive readings
+#define GAS_WARMUP_MIN_MS     2000
+#define GAS_SETTLED_TOLERANCE 8
+#define GAS_SETTLED_READINGS  3
+
+/* GasSensorDriver class */
+class GasSensorDriver : public SensorDriver {
+
+	public:
+		GasSensorDriver(uint8_t gpio, int co2Threshold);
+
+		uint16_t getFields();
+		uint8_t getAcquisition();
+		bool warmup();
+		bool isReady();
+		bool read(Packet* packet, uint8_t index, device_location_t* location);
+
+	private:
+		MQ135 _gasSensor;
+		bool _connected;
+		// Start of the warm-up (in ms)
+		uint32_t _warmupStart;
+
+};
+
+#endif
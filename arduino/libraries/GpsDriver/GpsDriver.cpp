@@ -0,0 +1,115 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of a GPS module, decoding its NMEA sentences with TinyGPS++.
+ */
+
+#include "GpsDriver.h"
+
+/**
+ * Constructor
+ * Creates the driver of a GPS module.
+ * @param serialBaud: serial baud rate for communication with the GPS
+ * @param rx: GPIO pin used as serial RX for communication with the GPS
+ * @param tx: GPIO pin used as serial TX for communication with the GPS
+ */
+GpsDriver::GpsDriver(uint32_t serialBaud, uint8_t rx, uint8_t tx) : _serial(GPS_UART)
+{
+	_serialBaud = serialBaud;
+	_rx = rx;
+	_tx = tx;
+}
+
+/**
+ * Retrieves the fields measured by the sensor.
+ * @return: presence bitmap of the fields
+ */
+uint16_t GpsDriver::getFields()
+{
+	return LOCATION_FIELDS;
+}
+
+/**
+ * Retrieves the acquisition task of the sensor.
+ * @return: ACQUISITION_UART
+ */
+uint8_t GpsDriver::getAcquisition()
+{
+	return ACQUISITION_UART;
+}
+
+/**
+ * Starts the serial connection with the GPS.
+ * @return: true
+ */
+bool GpsDriver::warmup()
+{
+	_serial.begin(_serialBaud, SERIAL_8N1, _rx, _tx);
+	return true;
+}
+
+/**
+ * Decodes the NMEA sentences received so far.
+ */
+void GpsDriver::ingest()
+{
+	while (_serial.available())
+	{
+		_gps.encode(_serial.read());
+	}
+}
+
+/**
+ * Checks if the GPS is ready, i.e. if it has a precise enough fix,
+ * after ingesting the NMEA sentences received so far.
+ * @return: true if the GPS is ready, false otherwise
+ */
+bool GpsDriver::isReady()
+{
+	ingest();
+	return _gps.location.isValid() && _gps.hdop.isValid() && _gps.hdop.hdop() < GPS_MAX_HDOP;
+}
+
+/**
+ * Retrieves the location values from the GPS.
+ * The packet is left unchanged: the location is added by the device.
+ * @param packet: packet in which the values are recorded
+ * @param index: index of the measurement
+ * @param location: location of the device
+ * @return: false, the location has no emergency threshold
+ */
+bool GpsDriver::read(Packet* packet, uint8_t index, device_location_t* location)
+{
+	ingest();
+	float latitude = _gps.location.lat();
+	float longitude = _gps.location.lng();
+	float altitude = _gps.altitude.meters();
+	if (latitude != 0.0 || longitude != 0.0)
+	{
+		location->latitude = latitude;
+		location->longitude = longitude;
+#if DEBUG
+		printValue("Latitude (GPS)", location->latitude);
+		printValue("Longitude (GPS)", location->longitude);
+#endif
+	}
+	if (altitude > 0)
+	{
+		location->isAltitudeGps = true;
+		location->altitude = altitude;
+#if DEBUG
+		printValue("Altitude (GPS)", location->altitude);
+#endif
+	}
+	return false;
+}
+
+/**
+ * Stops the serial connection with the GPS.
+ */
+void GpsDriver::shutdown()
+{
+	_serial.end();
+}
@@ -0,0 +1,46 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of a GPS module, decoding its NMEA sentences with TinyGPS++.
+ */
+
+#ifndef GpsDriver_h
+#define GpsDriver_h
+
+#include "Arduino.h"
+#include "HardwareSerial.h"
+#include "TinyGPS++.h"
+#include "SensorDriver.h"
+
+// UART connected to the GPS
+#define GPS_UART 1
+// Readiness: maximum horizontal dilution of precision of the fix
+#define GPS_MAX_HDOP 2.0
+
+/* GpsDriver class */
+class GpsDriver : public SensorDriver {
+
+	public:
+		GpsDriver(uint32_t serialBaud, uint8_t rx, uint8_t tx);
+
+		uint16_t getFields();
+		uint8_t getAcquisition();
+		bool warmup();
+		bool isReady();
+		bool read(Packet* packet, uint8_t index, device_location_t* location);
+		void shutdown();
+
+	private:
+		HardwareSerial _serial;
+		TinyGPSPlus _gps;
+		uint32_t _serialBaud;
+		uint8_t _rx;
+		uint8_t _tx;
+
+		void ingest();
+
+};
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Cache of the Wi-Fi geolocations of the ESP32 devices.
+ * Two scans at the same place rarely see exactly the same access points, nor in the
+ * same order of signal strength: the fingerprints are compared as sets of BSSIDs,
+ * with their Jaccard similarity (size of the intersection over size of the union).
+ */
+
+#include "LocationCache.h"
+
+/* No-arg constructor: empty cache */
+LocationCache::LocationCache() {
+	clear();
+}
+
+/**
+ * Retrieves the table of the locations, to load it or to save it.
+ * @return: the table of the locations
+ */
+location_table_t* LocationCache::getTable() {
+	return &_table;
+}
+
+/**
+ * Removes all the locations of the cache.
+ */
+void LocationCache::clear() {
+	memset(&_table, 0, sizeof(_table));
+}
+
+/**
+ * Hashes a BSSID (32-bit FNV-1a).
+ * @param bssid: BSSID of an access point (LOCATION_BSSID_SIZE bytes)
+ * @return: the hash of the BSSID
+ */
+uint32_t LocationCache::hashBssid(const uint8_t* bssid) {
+	uint32_t hash = 2166136261u;
+	for (uint8_t i = 0; i < LOCATION_BSSID_SIZE; i++) {
+		hash ^= bssid[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * Initializes an empty fingerprint.
+ * @param fingerprint: fingerprint to initialize
+ */
+void LocationCache::initFingerprint(location_fingerprint_t* fingerprint) {
+	memset(fingerprint, 0, sizeof(*fingerprint));
+}
+
+/**
+ * Adds an access point of a scan to a fingerprint, if it is among the strongest ones.
+ * @param fingerprint: fingerprint of the scan
+ * @param bssid: BSSID of the access point (LOCATION_BSSID_SIZE bytes)
+ * @param rssi: signal strength of the access point (in dBm)
+ */
+void LocationCache::addAccessPoint(location_fingerprint_t* fingerprint, const uint8_t* bssid, int32_t rssi) {
+	uint32_t hash = hashBssid(bssid);
+	int8_t strength = rssi < INT8_MIN ? INT8_MIN : (rssi > INT8_MAX ? INT8_MAX : rssi);
+	uint8_t weakest = 0;
+	for (uint8_t i = 0; i < fingerprint->size; i++) {
+		// Access point seen on several bands: kept once
+		if (fingerprint->hashes[i] == hash)
+			return;
+		if (fingerprint->rssi[i] < fingerprint->rssi[weakest])
+			weakest = i;
+	}
+	if (fingerprint->size < LOCATION_FINGERPRINT_SIZE) {
+		weakest = fingerprint->size++;
+	} else if (strength <= fingerprint->rssi[weakest]) {
+		return;
+	}
+	fingerprint->hashes[weakest] = hash;
+	fingerprint->rssi[weakest] = strength;
+}
+
+/**
+ * Computes the Jaccard similarity of two fingerprints.
+ * @param first: first fingerprint
+ * @param second: second fingerprint
+ * @return: the similarity, from 0 (no common access point, or empty fingerprints) to 1
+ */
+float LocationCache::getSimilarity(const location_fingerprint_t* first, const location_fingerprint_t* second) {
+	uint8_t common = 0;
+	for (uint8_t i = 0; i < first->size; i++) {
+		for (uint8_t j = 0; j < second->size; j++) {
+			if (first->hashes[i] == second->hashes[j]) {
+				common++;
+				break;
+			}
+		}
+	}
+	uint8_t all = first->size + second->size - common;
+	return all > 0 ? (float) common / all : 0;
+}
+
+/**
+ * Finds the entry whose fingerprint is the most similar to a fingerprint.
+ * @param fingerprint: fingerprint of a scan
+ * @return: the index of the entry, or -1 if no fingerprint is similar enough
+ */
+int8_t LocationCache::findEntry(const location_fingerprint_t* fingerprint) {
+	int8_t best = -1;
+	float bestSimilarity = LOCATION_MATCH_THRESHOLD;
+	for (uint8_t i = 0; i < _table.count && i < LOCATION_CACHE_ENTRIES; i++) {
+		float similarity = getSimilarity(fingerprint, &_table.entries[i].fingerprint);
+		if (similarity >= bestSimilarity) {
+			best = i;
+			bestSimilarity = similarity;
+		}
+	}
+	return best;
+}
+
+/**
+ * Finds the location of a fingerprint.
+ * @param fingerprint: fingerprint of a scan
+ * @param location: location of the most similar fingerprint
+ * @return: true if a fingerprint of the cache is similar enough, false otherwise
+ */
+bool LocationCache::find(const location_fingerprint_t* fingerprint, cached_location_t* location) {
+	int8_t entry = findEntry(fingerprint);
+	if (entry < 0)
+		return false;
+	*location = _table.entries[entry];
+	return true;
+}
+
+/**
+ * Adds the location of a fingerprint, as the newest entry. It replaces the entry of
+ * a similar fingerprint, or the oldest entry when the cache is full.
+ * @param fingerprint: fingerprint of a scan
+ * @param latitude: latitude of the location (in degrees)
+ * @param longitude: longitude of the location (in degrees)
+ * @param accuracy: accuracy of the location (in m)
+ */
+void LocationCache::add(const location_fingerprint_t* fingerprint, float latitude, float longitude, int32_t accuracy) {
+	if (fingerprint->size == 0)
+		return;
+	int8_t entry = findEntry(fingerprint);
+	if (_table.count > LOCATION_CACHE_ENTRIES)
+		_table.count = LOCATION_CACHE_ENTRIES;
+	// Entries shifted to make room at the start
+	uint8_t last = entry >= 0 ? entry : (_table.count < LOCATION_CACHE_ENTRIES ? _table.count++ : _table.count - 1);
+	for (uint8_t i = last; i > 0; i--)
+		_table.entries[i] = _table.entries[i - 1];
+	_table.entries[0].fingerprint = *fingerprint;
+	_table.entries[0].latitude = latitude;
+	_table.entries[0].longitude = longitude;
+	_table.entries[0].accuracy = accuracy;
+}
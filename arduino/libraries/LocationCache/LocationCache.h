@@ -0,0 +1,73 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Cache of the Wi-Fi geolocations of the ESP32 devices, keyed by the fingerprint
+ * of the strongest access points in range: a scan similar enough to a known
+ * fingerprint reuses its location, without querying the geolocation API.
+ */
+
+#ifndef LocationCache_h
+#define LocationCache_h
+
+#include <Arduino.h>
+
+// Number of strongest access points in a fingerprint
+#define LOCATION_FINGERPRINT_SIZE 8
+// Number of locations in the cache
+#define LOCATION_CACHE_ENTRIES 4
+// Minimum Jaccard similarity of the fingerprints of the same location
+#define LOCATION_MATCH_THRESHOLD 0.5f
+// Size of a BSSID (MAC address of an access point)
+#define LOCATION_BSSID_SIZE 6
+
+// Fingerprint of a location: hashes of the BSSIDs of the strongest access points in range,
+// with their signal strength
+typedef struct locationFingerprint {
+	uint8_t size;
+	uint32_t hashes[LOCATION_FINGERPRINT_SIZE];
+	int8_t rssi[LOCATION_FINGERPRINT_SIZE];
+} location_fingerprint_t;
+
+// Location of a fingerprint
+typedef struct cachedLocation {
+	location_fingerprint_t fingerprint;
+	float latitude;
+	float longitude;
+	// Accuracy of the location (in m)
+	int32_t accuracy;
+} cached_location_t;
+
+// Locations of the cache, newest first, meant to be saved in the NVS flash.
+// Zeroed memory is an empty cache.
+typedef struct locationTable {
+	uint8_t count;
+	cached_location_t entries[LOCATION_CACHE_ENTRIES];
+} location_table_t;
+
+/* LocationCache class */
+class LocationCache {
+
+	public:
+		LocationCache();
+
+		location_table_t* getTable();
+		void clear();
+
+		static uint32_t hashBssid(const uint8_t* bssid);
+		static void initFingerprint(location_fingerprint_t* fingerprint);
+		static void addAccessPoint(location_fingerprint_t* fingerprint, const uint8_t* bssid, int32_t rssi);
+		static float getSimilarity(const location_fingerprint_t* first, const location_fingerprint_t* second);
+
+		bool find(const location_fingerprint_t* fingerprint, cached_location_t* location);
+		void add(const location_fingerprint_t* fingerprint, float latitude, float longitude, int32_t accuracy);
+
+	private:
+		location_table_t _table;
+
+		int8_t findEntry(const location_fingerprint_t* fingerprint);
+
+};
+
+#endif
@@ -17,7 +17,9 @@ v1.0 - First release
 #include "MQ135.h"
 
 // No-arg constructor
-MQ135::MQ135() {}
+MQ135::MQ135() {
+  resetSettling();
+}
 
 /**************************************************************************/
 /*!
@@ -28,6 +30,7 @@ MQ135::MQ135() {}
 /**************************************************************************/
 MQ135::MQ135(uint8_t pin) {
   _pin = pin;
+  resetSettling();
 }
 
 /**
@@ -36,6 +39,7 @@ MQ135::MQ135(uint8_t pin) {
  */
 void MQ135::setPin(uint8_t pin) {
   _pin = pin;
+  resetSettling();
 }
 
 /**
@@ -46,6 +50,40 @@ uint16_t MQ135::getRawValue() {
   return analogRead(_pin);
 }
 
+/**
+ * Restarts the check of the warm-up, when the sensor is powered on.
+ */
+void MQ135::resetSettling() {
+  _minRawValue = 0;
+  _maxRawValue = 0;
+  _settledReadings = 0;
+}
+
+/**
+ * Checks if the sensor has warmed up, i.e. if its raw value has settled: the last readings
+ * must all lie within the tolerance of each other, so that a heater drifting by small steps
+ * does not pass for settled. A reading out of the tolerance starts a new window of readings.
+ * Must be called periodically during the warm-up, after resetSettling: each call reads the sensor.
+ * @param tolerance: maximum difference between the raw values of the last readings
+ * @param readings: number of successive readings within the tolerance
+ * @return: true if the last readings were all within the tolerance, false otherwise
+ */
+bool MQ135::isSettled(uint16_t tolerance, uint8_t readings) {
+  uint16_t value = getRawValue();
+  uint16_t minValue = (_settledReadings > 0 && _minRawValue < value) ? _minRawValue : value;
+  uint16_t maxValue = (_settledReadings > 0 && _maxRawValue > value) ? _maxRawValue : value;
+  if (maxValue - minValue > tolerance) {
+    minValue = value;
+    maxValue = value;
+    _settledReadings = 0;
+  }
+  _minRawValue = minValue;
+  _maxRawValue = maxValue;
+  if (_settledReadings < readings)
+    _settledReadings++;
+  return _settledReadings >= readings;
+}
+
 
 /**************************************************************************/
 /*!
@@ -39,12 +39,19 @@ v1.0 - First release
 class MQ135 {
  private:
   uint8_t _pin;
+  // Readiness: range of the raw values of the last successive readings within the tolerance,
+  // and number of these readings
+  uint16_t _minRawValue;
+  uint16_t _maxRawValue;
+  uint8_t _settledReadings;
 
  public:
   MQ135();
   MQ135(uint8_t pin);
   void setPin(uint8_t pin);
   uint16_t getRawValue();
+  void resetSettling();
+  bool isSettled(uint16_t tolerance, uint8_t readings);
   float getCorrectionFactor(float t, float h);
   float getResistance();
   float getCorrectedResistance(float t, float h);
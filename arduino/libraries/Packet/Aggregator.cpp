@@ -0,0 +1,118 @@
+/**
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Running statistics of the fields of the measurements, meant to be kept in RTC memory,
+ * for the aggregation mode of the packets.
+ * Each field keeps its number of samples, minimum, maximum, mean and the sum of
+ * the squared differences with the mean (Welford's algorithm), so that the
+ * samples themselves do not need to be kept. Zeroed memory is an empty aggregator.
+ */
+
+#include "Aggregator.h"
+
+/**
+ * CONSTRUCTOR
+ * Does not touch the statistics, as it runs at every wake-up,
+ * while the statistics must persist in RTC memory during deep sleep.
+ */
+Aggregator::Aggregator() {}
+
+/**
+ * Adds a sample of a field to its statistics.
+ * Samples over AGGREGATOR_MAX_SAMPLES are dropped.
+ * @param field: index of the field (header - 1)
+ * @param value: value of the sample
+ */
+void Aggregator::add(uint8_t field, float value) {
+	if (field >= AGGREGATOR_FIELDS)
+		return;
+	field_statistics_t* statistics = _statistics + field;
+	if (statistics->count == AGGREGATOR_MAX_SAMPLES)
+		return;
+	if (statistics->count == 0) {
+		statistics->min = value;
+		statistics->max = value;
+	} else {
+		if (value < statistics->min)
+			statistics->min = value;
+		if (value > statistics->max)
+			statistics->max = value;
+	}
+	statistics->count++;
+	float delta = value - statistics->mean;
+	statistics->mean += delta / statistics->count;
+	statistics->m2 += delta * (value - statistics->mean);
+}
+
+/**
+ * Retrieves the number of samples of a field.
+ * @param field: index of the field (header - 1)
+ * @return: the number of samples, 0 if the field has no statistics
+ */
+uint16_t Aggregator::getCount(uint8_t field) {
+	if (field >= AGGREGATOR_FIELDS)
+		return 0;
+	return _statistics[field].count;
+}
+
+/**
+ * Retrieves the number of samples of the aggregation,
+ * i.e. the number of samples of the most sampled field.
+ * @return: the number of samples
+ */
+uint16_t Aggregator::getSamples() {
+	uint16_t samples = 0;
+	for (uint8_t field = 0; field < AGGREGATOR_FIELDS; field++) {
+		if (_statistics[field].count > samples)
+			samples = _statistics[field].count;
+	}
+	return samples;
+}
+
+/**
+ * Retrieves the minimum value of a field.
+ * @param field: index of the field (header - 1), with at least one sample
+ * @return: the minimum value
+ */
+float Aggregator::getMin(uint8_t field) {
+	return _statistics[field].min;
+}
+
+/**
+ * Retrieves the maximum value of a field.
+ * @param field: index of the field (header - 1), with at least one sample
+ * @return: the maximum value
+ */
+float Aggregator::getMax(uint8_t field) {
+	return _statistics[field].max;
+}
+
+/**
+ * Retrieves the mean value of a field.
+ * @param field: index of the field (header - 1), with at least one sample
+ * @return: the mean value
+ */
+float Aggregator::getMean(uint8_t field) {
+	return _statistics[field].mean;
+}
+
+/**
+ * Retrieves the sample standard deviation of a field.
+ * @param field: index of the field (header - 1), with at least one sample
+ * @return: the standard deviation, 0 if the field has only one sample
+ */
+float Aggregator::getStddev(uint8_t field) {
+	field_statistics_t* statistics = _statistics + field;
+	if (statistics->count < 2 || statistics->m2 <= 0)
+		return 0;
+	return sqrtf(statistics->m2 / (statistics->count - 1));
+}
+
+/**
+ * Clears the statistics of all the fields.
+ */
+void Aggregator::clear() {
+	memset(_statistics, 0, sizeof(_statistics));
+}
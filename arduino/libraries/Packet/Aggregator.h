@@ -0,0 +1,50 @@
+/**
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Running statistics of the fields of the measurements, meant to be kept in RTC memory,
+ * for the aggregation mode of the packets.
+ */
+
+#ifndef Aggregator_h
+#define Aggregator_h
+
+#include <Arduino.h>
+
+// Number of fields, one per header
+#define AGGREGATOR_FIELDS 11
+// Maximum number of samples of a field
+#define AGGREGATOR_MAX_SAMPLES UINT16_MAX
+
+// Running statistics of a field, with Welford's algorithm
+typedef struct fieldStatistics {
+	uint16_t count;
+	float mean;
+	// Sum of the squared differences with the mean
+	float m2;
+	float min;
+	float max;
+} field_statistics_t;
+
+/* Aggregator class */
+class Aggregator {
+
+	public:
+		Aggregator();
+
+		void add(uint8_t field, float value);
+		uint16_t getCount(uint8_t field);
+		uint16_t getSamples();
+		float getMin(uint8_t field);
+		float getMax(uint8_t field);
+		float getMean(uint8_t field);
+		float getStddev(uint8_t field);
+		void clear();
+
+	private:
+		field_statistics_t _statistics[AGGREGATOR_FIELDS];
+
+};
+
+#endif
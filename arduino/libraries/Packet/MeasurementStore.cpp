@@ -0,0 +1,135 @@
+/**
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Columnar store of quantized measurements, meant to be kept in RTC memory.
+ * Each column holds the quantized values of one field, on a fixed number of bytes,
+ * and only the columns of the fields measured by the device take memory.
+ * The number of measurements that fit in the store depends on the stored columns.
+ */
+
+#include "MeasurementStore.h"
+
+/**
+ * CONSTRUCTOR
+ * Does not touch the stored data, as it runs at every wake-up,
+ * while the data must persist in RTC memory during deep sleep.
+ */
+MeasurementStore::MeasurementStore() {}
+
+/**
+ * Sets the layout of the store.
+ * The layout depends only on its parameters: with the same parameters
+ * at every wake-up, the data stored before deep sleep stays valid.
+ * @param widths: size in bytes of the values of each column (0 to 4), 0 if not stored
+ * @param onceColumns: bitmap of the columns holding one value for all the measurements
+ */
+void MeasurementStore::setColumns(const uint8_t widths[MEASUREMENT_STORE_COLUMNS], uint16_t onceColumns) {
+	uint16_t onceWidth = 0;
+	uint16_t rowWidth = 0;
+	for (uint8_t column = 0; column < MEASUREMENT_STORE_COLUMNS; column++) {
+		_widths[column] = widths[column];
+		if (onceColumns & (1 << column))
+			onceWidth += widths[column];
+		else
+			rowWidth += widths[column];
+	}
+	_onceColumns = onceColumns;
+
+	// Number of measurements
+	uint16_t capacity = MEASUREMENT_STORE_MAX;
+	if (onceWidth > MEASUREMENT_STORE_SIZE)
+		capacity = 0;
+	else if (rowWidth > 0)
+		capacity = (MEASUREMENT_STORE_SIZE - onceWidth) / rowWidth;
+	_capacity = capacity < MEASUREMENT_STORE_MAX ? capacity : MEASUREMENT_STORE_MAX;
+
+	// Columns holding one value first, then one column after the other
+	uint16_t offset = 0;
+	for (uint8_t column = 0; column < MEASUREMENT_STORE_COLUMNS; column++) {
+		if (onceColumns & (1 << column)) {
+			_offsets[column] = offset;
+			offset += _widths[column];
+		}
+	}
+	for (uint8_t column = 0; column < MEASUREMENT_STORE_COLUMNS; column++) {
+		if (!(onceColumns & (1 << column))) {
+			_offsets[column] = offset;
+			offset += _widths[column] * _capacity;
+		}
+	}
+}
+
+/**
+ * Retrieves the number of measurements that fit in the store.
+ * @return: the number of measurements that fit in the store
+ */
+uint8_t MeasurementStore::getCapacity() {
+	return _capacity;
+}
+
+/**
+ * Retrieves the size of the values of a column.
+ * @param column: index of the column
+ * @return: size in bytes of the values of the column, 0 if it is not stored
+ */
+uint8_t MeasurementStore::getWidth(uint8_t column) {
+	return _widths[column];
+}
+
+/**
+ * Retrieves the location of a value in the data.
+ * @param column: index of the column
+ * @param index: index of the measurement
+ * @return: pointer to the first byte of the value,
+ *          or NULL if the value is not stored
+ */
+uint8_t* MeasurementStore::getCell(uint8_t column, uint8_t index) {
+	if (column >= MEASUREMENT_STORE_COLUMNS || _widths[column] == 0 || index >= _capacity)
+		return NULL;
+	if (_onceColumns & (1 << column))
+		return _data + _offsets[column];
+	return _data + _offsets[column] + index * _widths[column];
+}
+
+/**
+ * Stores a quantized value, in little-endian byte order.
+ * The value is ignored if its column is not stored or the store is full.
+ * @param column: index of the column
+ * @param index: index of the measurement
+ * @param code: quantized value, lower than 2^(8*width) - 1, or ABSENT_CODE
+ */
+void MeasurementStore::set(uint8_t column, uint8_t index, uint32_t code) {
+	uint8_t* cell = getCell(column, index);
+	if (cell == NULL)
+		return;
+	for (uint8_t i = 0; i < _widths[column]; i++)
+		cell[i] = (code >> (8 * i)) & 0xFF;
+}
+
+/**
+ * Retrieves a quantized value.
+ * @param column: index of the column
+ * @param index: index of the measurement
+ * @return: the quantized value, or ABSENT_CODE if it is absent or not stored
+ */
+uint32_t MeasurementStore::get(uint8_t column, uint8_t index) {
+	uint8_t* cell = getCell(column, index);
+	if (cell == NULL)
+		return ABSENT_CODE;
+	uint8_t width = _widths[column];
+	uint32_t code = 0;
+	for (uint8_t i = 0; i < width; i++)
+		code |= (uint32_t) cell[i] << (8 * i);
+	if (width < sizeof(uint32_t) && code == ((uint32_t) 1 << (8 * width)) - 1)
+		return ABSENT_CODE;
+	return code;
+}
+
+/**
+ * Clears the store, by marking all the values as absent.
+ */
+void MeasurementStore::clear() {
+	memset(_data, 0xFF, sizeof(_data));
+}
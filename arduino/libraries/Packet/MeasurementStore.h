@@ -0,0 +1,59 @@
+/**
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Columnar store of quantized measurements, meant to be kept in RTC memory.
+ */
+
+#ifndef MeasurementStore_h
+#define MeasurementStore_h
+
+#include <Arduino.h>
+
+// Size of the store, i.e. the RTC memory of the former array of 8 measurements (44 bytes each).
+// On AVR boards (The Things Node), the location and 3 measurements of all the fields (12 + 3 * 25 bytes).
+// Can be set with a compiler flag, the library being compiled apart from the sketch.
+#ifndef MEASUREMENT_STORE_SIZE
+#ifdef __AVR__
+#define MEASUREMENT_STORE_SIZE    87
+#else
+#define MEASUREMENT_STORE_SIZE    352
+#endif
+#endif
+// Number of columns, one per field
+#define MEASUREMENT_STORE_COLUMNS 11
+// Maximum number of measurements, limited by the 8-bit indexes
+#define MEASUREMENT_STORE_MAX     UINT8_MAX
+// Code of an absent value, stored with all bits set
+#define ABSENT_CODE               0xFFFFFFFF
+
+/* MeasurementStore class */
+class MeasurementStore {
+
+	public:
+		MeasurementStore();
+
+		void setColumns(const uint8_t widths[MEASUREMENT_STORE_COLUMNS], uint16_t onceColumns);
+		uint8_t getCapacity();
+		uint8_t getWidth(uint8_t column);
+
+		void set(uint8_t column, uint8_t index, uint32_t code);
+		uint32_t get(uint8_t column, uint8_t index);
+		void clear();
+
+	private:
+		// Size in bytes of the values of each column, 0 if the column is not stored
+		uint8_t _widths[MEASUREMENT_STORE_COLUMNS];
+		// Offset of each column in the data
+		uint16_t _offsets[MEASUREMENT_STORE_COLUMNS];
+		// Bitmap of the columns holding one value for all the measurements
+		uint16_t _onceColumns;
+		uint8_t _capacity;
+		uint8_t _data[MEASUREMENT_STORE_SIZE];
+
+		uint8_t* getCell(uint8_t column, uint8_t index);
+
+};
+
+#endif
@@ -8,8 +8,14 @@
 
 #include "Packet.h"
 
+uint8_t Packet::_payloadBuffer[PAYLOAD_MAX_SIZE];
+
 /* No-arg constructor */
-Packet::Packet() {}
+Packet::Packet() {
+	_store = NULL;
+	_aggregator = NULL;
+	_fields = ALL_FIELDS & PACKET_ENABLED_FIELDS;
+}
 
 /**
  * CONSTRUCTOR
@@ -19,27 +25,54 @@ Packet::Packet() {}
  * @param version: packet format version
  */
 Packet::Packet(uint8_t interval, uint8_t nMeasurements, uint8_t version) {
+	_store = NULL;
+	_aggregator = NULL;
 	init(interval, nMeasurements, version);
 }
 
 /**
- * Initializes the measurements array of the Packet object.
+ * Initializes the Packet object.
+ * All the fields are kept in the measurement store, until setFields is called.
  * @param interval: time interval between measurements (in minutes)
  * @param nMeasurements: number of measurements to store in the array
  * @param version: packet format version
  */
 void Packet::init(uint8_t interval, uint8_t nMeasurements, uint8_t version) {
 	_index = 0;
+	_first = 0;
+	_last = 0;
 	_interval = interval;
-	// Set version
-	if (nMeasurements == 1)
+	// Set version: a single measurement uses the version 1, except for the versions 4 and 5,
+	// whose aggregation mode does not depend on the number of measurements
+	if (nMeasurements == 1 && version < 4)
 		_version = 1;
 	else if (nMeasurements > 1 && version == 1)
 		_version = 2;
 	else
 		_version = version;
 	// Set number of measurements
-	uint8_t maxMeasurements = MAX_MEASUREMENTS_VERSION[_version];
+	uint8_t maxMeasurements = MAX_MEASUREMENTS_VERSION[_version - 1];
+	_nMeasurements = (nMeasurements <= maxMeasurements) ? nMeasurements : maxMeasurements;
+	// Set default quantization
+	for (uint8_t header = 1; header <= N_HEADERS; header++)
+		_quantization[header - 1] = defaultQuantization(header);
+	_quantizationOverrides = 0;
+	_fields = ALL_FIELDS & PACKET_ENABLED_FIELDS;
+	updateStoreColumns();
+}
+
+/**
+ * Changes the time interval and the number of measurements of the next batches,
+ * keeping the version. Must be called between two batches, as all the measurements
+ * of a batch share the interval of the preamble.
+ * @param interval: time interval between measurements (in minutes)
+ * @param nMeasurements: number of measurements per batch, bounded by the version
+ */
+void Packet::setBatch(uint8_t interval, uint8_t nMeasurements) {
+	_interval = interval;
+	uint8_t maxMeasurements = MAX_MEASUREMENTS_VERSION[_version - 1];
+	if (nMeasurements == 0)
+		nMeasurements = 1;
 	_nMeasurements = (nMeasurements <= maxMeasurements) ? nMeasurements : maxMeasurements;
 }
 
@@ -51,6 +84,14 @@ uint8_t Packet::getVersion() {
 	return _version;
 }
 
+/**
+ * Retrieves the time interval between measurements.
+ * @return: the time interval between measurements (in minutes)
+ */
+uint8_t Packet::getInterval() {
+	return _interval;
+}
+
 /**
  * Retrieves the current index in the measurements array.
  * @return: the current index in the measurements array
@@ -59,6 +100,17 @@ uint8_t Packet::getIndex() {
 	return _index;
 }
 
+/**
+ * Retrieves the number of measurements per batch,
+ * bounded by the number of measurements that fit in the measurement store.
+ * @return: the number of measurements per batch
+ */
+uint8_t Packet::getNMeasurements() {
+	if (_store != NULL && _store->getCapacity() < _nMeasurements)
+		return _store->getCapacity();
+	return _nMeasurements;
+}
+
 /**
  * Retrieves the current size of the LoRaWAN payload.
  * @return: the current size of the LoRaWAN payload
@@ -68,19 +120,133 @@ uint8_t Packet::getPayloadSize() {
 }
 
 /**
- * Retrieves a pointer to the measurements array.
- * @return: a pointer to the measurements array
+ * Retrieves the quantized value of a field from the measurement store.
+ * @param header: header of the field
+ * @param index: index of the measurement
+ * @return: the quantized value, or ABSENT_CODE if there is no measurement store
+ */
+uint32_t Packet::getCode(uint8_t header, uint8_t index) {
+	if (_store == NULL)
+		return ABSENT_CODE;
+	return _store->get(header - 1, index);
+}
+
+/**
+ * Retrieves a measurement from the measurement store.
+ * The location is the same for all the measurements of a batch.
+ * @param index: index of the measurement
+ * @return: the measurement, with default values for the absent fields
+ */
+measurement_t Packet::getMeasurement(uint8_t index) {
+	measurement_t measurement;
+	uint32_t code;
+#define PACKET_FIELD_GET(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	code = FIELD_ENABLED(header) ? getCode(header, index) : ABSENT_CODE; \
+	measurement.member = (code == ABSENT_CODE) ? absentValue<type>() : \
+	                     (type) dequantize(_quantization + header - 1, code);
+	PACKET_FIELDS(PACKET_FIELD_GET)
+	return measurement;
+}
+
+/**
+ * Sets the measurement store, in which the measurements are recorded.
+ * @param store: pointer to the measurement store
  */
-measurement_t* Packet::getMeasurementsArray() {
-	return _measurementsArray;
+void Packet::setMeasurementStore(MeasurementStore* store) {
+	_store = store;
+	updateStoreColumns();
 }
 
 /**
- * Sets the measurements array.
- * @param measurementsArray: pointer to the measurements array
+ * Sets the aggregator, which switches the packet to the aggregation mode:
+ * the values of the fields are added to the statistics of the aggregator,
+ * and the payload contains these statistics instead of the measurements.
+ * Each value added is a sample: the fields must be added once per wake-up.
+ * The measurement store still keeps the measurements, e.g. the location,
+ * and the last measurement for the emergency messages.
+ * Only versions 4 and 5 support the aggregation mode: must be called after init.
+ * @param aggregator: pointer to the aggregator, or NULL to leave the aggregation mode
+ * @return: true if the aggregation mode is set, false if the version does not support it
+ */
+bool Packet::setAggregator(Aggregator* aggregator) {
+	if (aggregator != NULL && _version < 4) {
+		_aggregator = NULL;
+		return false;
+	}
+	_aggregator = aggregator;
+	return true;
+}
+
+/**
+ * Checks if the packet is in aggregation mode.
+ * @return: true if the packet is in aggregation mode, false otherwise
  */
-void Packet::setMeasurementsArray(measurement_t* measurementsArray) {
-	_measurementsArray = measurementsArray;
+bool Packet::isAggregating() {
+	return _aggregator != NULL;
+}
+
+/**
+ * Sets the fields kept in the measurement store, i.e. the fields measured by the device.
+ * The values of the other fields are dropped.
+ * Like the quantization, must be the same at every wake-up.
+ * @param fields: bitmap of the fields, with one bit per header
+ */
+void Packet::setFields(uint16_t fields) {
+	_fields = fields & PACKET_ENABLED_FIELDS;
+	updateStoreColumns();
+}
+
+/**
+ * Sets the layout of the measurement store,
+ * with one column per kept field, as wide as its quantized values.
+ */
+void Packet::updateStoreColumns() {
+	if (_store == NULL)
+		return;
+	uint8_t widths[MEASUREMENT_STORE_COLUMNS];
+	for (uint8_t header = 1; header <= N_HEADERS; header++)
+		widths[header - 1] = (_fields & PRESENCE_BIT(header)) ? _quantization[header - 1].width : 0;
+	_store->setColumns(widths, LOCATION_FIELDS);
+}
+
+/**
+ * Overrides the quantization of a field, for versions 4 and 5.
+ * The value range is [min, min + (2^(8*width) - 2) * resolution].
+ * Must be called after init, which restores the default quantization,
+ * and with the same parameters at every wake-up, as the measurement store
+ * keeps the quantized values.
+ * The versions 1 to 3 do not announce the quantizations: they keep the default one.
+ * @param header: header of the field
+ * @param min: minimum value of the field, rounded to a multiple of the resolution
+ * @param resolution: resolution of the field, 1, 2 or 5 times a power of 10
+ * @param width: size of the field in bytes, from 1 to 4
+ * @return: true if the quantization was set, false if it is invalid or the version is below 4
+ */
+bool Packet::setQuantization(uint8_t header, float min, float resolution, uint8_t width) {
+	if (_version < 4 || header < 1 || header > N_HEADERS || width < 1 || width > 4 || resolution <= 0)
+		return false;
+	const uint8_t mantissas[3] = {1, 2, 5};
+	for (int8_t exponent = -8; exponent <= 7; exponent++) {
+		for (uint8_t m = 0; m < 3; m++) {
+			double step = mantissas[m] * pow(10.0, (double) exponent);
+			if (fabs(step - resolution) > 1e-6 * step)
+				continue;
+			quantization_t* quantization = _quantization + header - 1;
+			quantization->min = (int32_t) round(min / step);
+			quantization->exponent = exponent;
+			quantization->mantissa = mantissas[m];
+			quantization->width = width;
+			const quantization_t defaults = defaultQuantization(header);
+			if (quantization->min != defaults.min || quantization->exponent != defaults.exponent ||
+			    quantization->mantissa != defaults.mantissa || quantization->width != defaults.width)
+				_quantizationOverrides |= PRESENCE_BIT(header);
+			else
+				_quantizationOverrides &= ~PRESENCE_BIT(header);
+			updateStoreColumns();
+			return true;
+		}
+	}
+	return false;
 }
 
 /**
@@ -101,18 +267,12 @@ void Packet::printValue(char *name, float value)
 void Packet::printArray() {
 	Serial.println("PRINTING MEASUREMENTS ARRAY");
 	for (uint8_t i = 0; i <= _index; i++) {
+		measurement_t measurement = getMeasurement(i);
 		printValue("TIMESTAMP", i);
-		printValue("	Battery [%]", _measurementsArray[i].battery);
-		printValue("	Temperature", _measurementsArray[i].temperature);
-		printValue("	Pressure", _measurementsArray[i].pressure);
-		printValue("	Humidity", _measurementsArray[i].humidity);
-		printValue("	Light", _measurementsArray[i].light);
-		printValue("	Latitude", _measurementsArray[i].latitude);
-		printValue("	Longitude", _measurementsArray[i].longitude);
-		printValue("	Altitude", _measurementsArray[i].altitude);
-		printValue("	CO2", _measurementsArray[i].co2);
-		printValue("	Noise", _measurementsArray[i].noise);
-		printValue("	Air quality", _measurementsArray[i].airQuality);
+#define PACKET_FIELD_PRINT(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		if (FIELD_ENABLED(header)) \
+			printValue("	" key, measurement.member);
+		PACKET_FIELDS(PACKET_FIELD_PRINT)
 	}
 	Serial.println("---------------------------");
 }
@@ -133,150 +293,245 @@ void Packet::printPayload() {
 }
 
 /**
- * Appends the battery percentage data to the measurements.
- * @param battery: battery percentage value
- */
-void Packet::addBattery(uint8_t battery, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].battery = battery;
+ * Appends the data of a field to the measurements: addBattery, addTemperature, ...
+ * one method per field of the schema (see PacketFields.h).
+ * Default values are recorded as absent, and the values of the fields
+ * that are not compiled (see PACKET_ENABLED_FIELDS) are dropped.
+ * @param member: value of the field
+ * @param index: index of the measurement
+ */
+#define PACKET_FIELD_ADD(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+void Packet::add##Name(type member, uint8_t index) { \
+	if (FIELD_ENABLED(header)) \
+		addValue(header, isPresentValue<type>(member), member, index); \
 }
+PACKET_FIELDS(PACKET_FIELD_ADD)
 
 /**
- * Appends the temperature data to the payload.
- * @param temperature: temperature value
- */
-void Packet::addTemperature(float temperature, uint8_t index) {
+ * Records a value in the measurement store, quantized.
+ * Values of measurements that do not fit in the store are dropped.
+ * @param header: header of the field
+ * @param present: true if the value is present, false if it is the default value
+ * @param data: value of the field
+ * @param index: index of the measurement
+ */
+void Packet::addValue(uint8_t header, bool present, float data, uint8_t index) {
+	// Statistics of the samples, except for the location, sent as is
+	if (_aggregator != NULL && present && (_fields & PRESENCE_BIT(header)) &&
+	    !(PRESENCE_BIT(header) & LOCATION_FIELDS))
+		_aggregator->add(header - 1, data);
+	if (_store == NULL || index >= _store->getCapacity())
+		return;
 	_index = index;
-	_measurementsArray[index].temperature = temperature;
+	_store->set(header - 1, index, present ? quantize(header, data) : ABSENT_CODE);
 }
 
 /**
- * Appends the pressure data to the payload.
- * @param pressure: pressure value
+ * Builds the LoRaWAN payload with the recorded measurements,
+ * in the internal payload buffer of the class.
+ * The payload is valid until the next call to this method.
+ * @return: pointer to the start of the payload,
+ *          or NULL if the payload does not fit in the buffer
  */
-void Packet::addPressure(float pressure, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].pressure = pressure;
-}
-
-/**
- * Appends the humidity data to the payload.
- * @param humidity: humidity value
- */
-void Packet::addHumidity(float humidity, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].humidity = humidity;
-}
-
-/**
- * Appends the altitude data to the payload.
- * @param altitude: altitude value
- */
-void Packet::addAltitude(float altitude, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].altitude = altitude;
-}
-
-/**
- * Appends the light data to the payload.
- * @param light: light value
- */
-void Packet::addLight(uint16_t light, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].light = light;
+uint8_t* Packet::buildLoraPayload() {
+	return buildLoraPayload(_payloadBuffer, &_size, sizeof(_payloadBuffer));
 }
 
 /**
- * Appends the latitude data to the payload.
- * @param latitude: latitude value
+ * Builds the LoRaWAN payload with the recorded measurements,
+ * in a buffer provided by the caller.
+ * If the payload does not fit in the buffer, nothing is written past its end,
+ * the size is set to 0 and the measurements are kept.
+ * @param payload: pointer to the start payload
+ * @param size_ptr: pointer to an integer containing the size of the payload
+ * @param capacity: size of the payload buffer (in bytes)
+ * @return: pointer to the start of the payload,
+ *          or NULL if the payload does not fit in the buffer
  */
-void Packet::addLatitude(float latitude, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].latitude = latitude;
+uint8_t* Packet::buildLoraPayload(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity) {
+	if (!encodeMeasurements(payload, size_ptr, capacity, 0, _index))
+		return NULL;
+	clearArray();
+	if (_aggregator != NULL)
+		_aggregator->clear();
+	return _payload;
 }
 
 /**
- * Appends the longitude data to the payload.
- * @param longitude: longitude value
- */
- void Packet::addLongitude(float longitude, uint8_t index) {
-	 _index = index;
- 	_measurementsArray[index].longitude = longitude;
- }
-
-/**
- * Appends the CO2 concentration data to the payload.
- * @param co2: CO2 concentration value
+ * Builds the payload of the recorded measurements, in a buffer provided by the caller,
+ * without clearing them: they are kept until the payload is delivered.
+ * @param payload: pointer to the start payload
+ * @param size_ptr: pointer to an integer containing the size of the payload
+ * @param capacity: size of the payload buffer (in bytes)
+ * @return: pointer to the start of the payload,
+ *          or NULL if the payload does not fit in the buffer
  */
-void Packet::addCO2(float co2, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].co2 = co2;
+uint8_t* Packet::buildPayload(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity) {
+	if (!encodeMeasurements(payload, size_ptr, capacity, 0, _index))
+		return NULL;
+	return _payload;
 }
 
 /**
- * Appends the noise data to the payload.
- * @param noise: noise value
- */
-void Packet::addNoise(uint16_t noise, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].noise = noise;
+ * Computes the size of the LoRaWAN payload of the first measurements,
+ * without sending them: they are encoded in the internal payload buffer,
+ * and kept in the measurement store.
+ * @param last: index of the last measurement to encode
+ * @return: the size of the payload, or 0 if it does not fit in the internal buffer
+ */
+uint8_t Packet::getBatchPayloadSize(uint8_t last) {
+	encodeMeasurements(_payloadBuffer, &_size, sizeof(_payloadBuffer), 0, last);
+	return _size;
 }
 
 /**
- * Appends the air quality data to the payload.
- * @param noise: air quality value
- */
-void Packet::addAirQuality(float airQuality, uint8_t index) {
-	_index = index;
-	_measurementsArray[index].airQuality = airQuality;
+ * Estimates the size of the LoRaWAN payload of the first measurements
+ * if one more measurement was recorded, assuming it repeats the last one.
+ * The measurement store is left unchanged.
+ * @param last: index of the last recorded measurement
+ * @return: the estimated size of the payload, or 0 if there is no room for
+ *          another measurement or if the payload does not fit in the internal buffer
+ */
+uint8_t Packet::getNextBatchPayloadSize(uint8_t last) {
+	if (_store == NULL || last + 1 >= getNMeasurements())
+		return 0;
+	uint32_t saved[N_HEADERS];
+	for (uint8_t i = 0; i < N_HEADERS; i++) {
+		saved[i] = _store->get(i, last + 1);
+		_store->set(i, last + 1, _store->get(i, last));
+	}
+	uint8_t size = getBatchPayloadSize(last + 1);
+	for (uint8_t i = 0; i < N_HEADERS; i++)
+		_store->set(i, last + 1, saved[i]);
+	return size;
 }
 
 /**
- * Builds the LoRaWAN payload with the recorded measurements.
- * @param size: size (in bytes) of the LoRaWAN payload
- * @return: pointer to the start of the payload
- */
-uint8_t* Packet::buildLoraPayload() {
-	// Initialize payload
-	uint8_t size = 2 + (_index + 2) * (sizeof(measurement_t));
-	_payload = (uint8_t*) malloc(size);
-	_size_ptr = (uint8_t*) malloc(sizeof(uint8_t));
-	addPreamble();
-	// Populate payload
-	populateLoraPayload();
-	clearArray();
-	return _payload;
+ * Builds the next fragment of the LoRaWAN payload, in a buffer provided by the caller,
+ * for batches that do not fit in one frame at the current data rate.
+ * A fragment is a payload of the same version containing as many measurements
+ * as fit in the buffer, from the first one not sent yet, preceded by a fragment header:
+ * the sequence number of the batch, the timestamp of the first measurement of the fragment,
+ * and the timestamp of the last measurement of the batch.
+ * The timestamps of the fragment payload start at 0,
+ * and every fragment contains the location, so that it can be decoded alone.
+ * The measurements are cleared after the last fragment.
+ * The aggregates are not fragmented: they have a fixed size.
+ * @param payload: pointer to the start payload
+ * @param size_ptr: pointer to an integer containing the size of the payload
+ * @param capacity: size of the payload buffer (in bytes)
+ * @param sequence: sequence number of the batch
+ * @param first: pointer to the index of the first measurement not sent yet,
+ *               updated to the index of the first measurement of the next fragment
+ * @param last: index of the last measurement of the batch
+ * @return: pointer to the start of the payload,
+ *          or NULL if not even one measurement fits in the buffer
+ */
+uint8_t* Packet::buildLoraFragment(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity,
+                                   uint8_t sequence, uint8_t* first, uint8_t last) {
+	if (_aggregator != NULL || *first > last || capacity <= FRAGMENT_HEADER_SIZE) {
+		*size_ptr = 0;
+		return NULL;
+	}
+	uint8_t* fragment = payload + FRAGMENT_HEADER_SIZE;
+	uint8_t fragmentCapacity = capacity - FRAGMENT_HEADER_SIZE;
+	// Largest number of measurements fitting in the buffer
+	uint8_t fragmentLast = *first;
+	if (!encodeMeasurements(fragment, size_ptr, fragmentCapacity, *first, fragmentLast))
+		return NULL;
+	while (fragmentLast < last &&
+	       encodeMeasurements(fragment, size_ptr, fragmentCapacity, *first, fragmentLast + 1))
+		fragmentLast++;
+	if (fragmentLast < last)
+		encodeMeasurements(fragment, size_ptr, fragmentCapacity, *first, fragmentLast);
+
+	// Fragment header
+	payload[0] = sequence;
+	payload[1] = *first;
+	payload[2] = last;
+	*size_ptr += FRAGMENT_HEADER_SIZE;
+	_payload = payload;
+	*first = fragmentLast + 1;
+	if (*first > last)
+		clearArray();
+	return payload;
 }
 
 /**
- * Builds the LoRaWAN payload with the recorded measurements.
+ * Encodes a range of the recorded measurements in a buffer,
+ * with timestamps relative to the first measurement of the range.
+ * If the payload does not fit in the buffer, nothing is written past its end
+ * and the size is set to 0.
  * @param payload: pointer to the start payload
  * @param size_ptr: pointer to an integer containing the size of the payload
- * @return: pointer to the start of the payload
+ * @param capacity: size of the payload buffer (in bytes)
+ * @param first: index of the first measurement to encode
+ * @param last: index of the last measurement to encode
+ * @return: true if the payload fits in the buffer, false otherwise
  */
-uint8_t* Packet::buildLoraPayload(uint8_t* payload, uint8_t* size_ptr) {
+bool Packet::encodeMeasurements(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity,
+                                uint8_t first, uint8_t last) {
 	// Initialize payload
 	_payload = payload;
 	_size_ptr = size_ptr;
+	_capacity = capacity;
+	_overflow = false;
+	_first = first;
+	_last = last;
 	addPreamble();
 	// Populate payload
 	populateLoraPayload();
-	clearArray();
-	return _payload;
+	if (_overflow) {
+		*_size_ptr = 0;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Reserves space at the end of the payload.
+ * If the space is not available, the payload is marked as overflowed.
+ * @param size: number of bytes to reserve
+ * @return: true if the bytes can be written, false otherwise
+ */
+bool Packet::reserve(uint8_t size) {
+	if (_overflow || (uint16_t) *_size_ptr + size > _capacity)
+		_overflow = true;
+	return !_overflow;
 }
 
 /**
  * Adds the preamble at the beginning of the payload,
- * i.e. the version number and, if version is 2,
+ * i.e. the version number and, if version is 2 or more,
  * the time interval between measurements.
+ * For versions 4 and 5, the preamble also contains the number of measurements
+ * and the presence bitmap of the fields, and the version byte is flagged
+ * if a present field has a non-default quantization.
  */
 void Packet::addPreamble() {
+	*_size_ptr = 0;
+	if (!reserve(_version >= 4 ? 5 : (_version > 1 ? 2 : 1)))
+		return;
 	*_payload = _version;
 	*_size_ptr = 1;
 	if (_version > 1) {
 		*(_payload + 1) = _interval;
 		*_size_ptr = 2;
 	}
+	if (_version >= 4) {
+		uint16_t bitmap = getPresenceBitmap();
+		if (bitmap & _quantizationOverrides)
+			*_payload |= QUANTIZATION_FLAG;
+		*(_payload + 2) = _last - _first + 1;
+		if (_aggregator != NULL) {
+			uint16_t samples = _aggregator->getSamples();
+			*_payload |= AGGREGATE_FLAG;
+			*(_payload + 2) = samples < UINT8_MAX ? samples : UINT8_MAX;
+		}
+		*(_payload + 3) = bitmap >> 8;
+		*(_payload + 4) = bitmap & 0xFF;
+		*_size_ptr = 5;
+	}
 }
 
 /**
@@ -284,10 +539,30 @@ void Packet::addPreamble() {
  * @param timestamp: timestamp to append to the payload
  */
 void Packet::appendTimestamp(uint8_t timestamp) {
+	if (!reserve(sizeof(uint8_t)))
+		return;
 	*(_payload + *_size_ptr) = timestamp;
 	*_size_ptr += sizeof(uint8_t);
 }
 
+/**
+ * Appends the specified data to the LoRaWAN payload, without header.
+ * Warning: the byte order is inverted when copying !
+ * @param data_ptr: pointer to the data
+ * @param size: size of the data in bytes
+ */
+void Packet::appendBytesToPayload(uint8_t* data_ptr, uint8_t size) {
+	if (!reserve(size))
+		return;
+
+	// Copy data, inverting the byte order
+	for (int i = 0; i < size; i++) {
+		*(_payload + *_size_ptr + i) = *(data_ptr + size - 1 - i);
+	}
+
+	*_size_ptr += size;
+}
+
 /**
  * Appends the specified data to the LoRaWAN payload,
  * with the header specifying its type.
@@ -297,15 +572,14 @@ void Packet::appendTimestamp(uint8_t timestamp) {
  * @param size: size of the data in bytes
  */
 void Packet::appendDataToPayload(uint8_t header, uint8_t* data_ptr, uint8_t size) {
+	if (!reserve(size + 1))
+		return;
+
 	// Copy header
 	*(_payload + *_size_ptr) = header;
+	*_size_ptr += 1;
 
-	// Copy data, inverting the byte order
-	for (int i = 1; i <= size; i++) {
-		*(_payload + *_size_ptr + i) = *(data_ptr + size - i);
-	}
-
-	*_size_ptr += size + 1;
+	appendBytesToPayload(data_ptr, size);
 }
 
 /**
@@ -330,18 +604,38 @@ void Packet::appendIntToPayload(uint8_t header, uint32_t data, uint8_t* data_ptr
  */
 void Packet::appendFloatToPayload(uint8_t header, float data, uint8_t precision) {
 	if (data > DEFAULT_FLOAT) {
-		double factor = pow(10.0, (double) precision);
-		uint32_t data_int = (uint32_t) round(data*factor);
+		uint32_t data_int = (uint32_t) scaleFloat(data, precision);
 		uint8_t* data_ptr = (uint8_t*) &data_int;
 		uint8_t size = sizeof(data_int);
 		appendDataToPayload(header, data_ptr, size);
 	}
 }
 
+/**
+ * Appends the specified value of a field to the payload,
+ * with the header specifying its type, if it is present.
+ * @param header: header of the field
+ * @param data: value of the field
+ * @param precision: number of decimal places, for floats
+ */
+void Packet::appendValueToPayload(uint8_t header, uint8_t data, uint8_t precision) {
+	appendIntToPayload(header, data, &data, sizeof(data));
+}
+
+void Packet::appendValueToPayload(uint8_t header, uint16_t data, uint8_t precision) {
+	appendIntToPayload(header, data, (uint8_t*) &data, sizeof(data));
+}
+
+void Packet::appendValueToPayload(uint8_t header, float data, uint8_t precision) {
+	appendFloatToPayload(header, data, precision);
+}
+
 /**
  * Close a measurement in the payload by appending a terminating null byte.
  */
 void Packet::closeMeasurement() {
+	if (!reserve(1))
+		return;
 	*(_payload + *_size_ptr) = 0;
 	*_size_ptr += 1;
 }
@@ -350,69 +644,312 @@ void Packet::closeMeasurement() {
  * Populates the LoRaWAN payload with recorded measurements.
  */
 void Packet::populateLoraPayload() {
+	if (_version >= 4) {
+		populateBitmapPayload();
+		return;
+	}
+
 	// Geolocation data
 	if (_version == 3) {
-		appendFloatToPayload(HEADER_LATITUDE, _measurementsArray[_index].latitude, 6);
-		appendFloatToPayload(HEADER_LONGITUDE, _measurementsArray[_index].longitude, 6);
-		appendFloatToPayload(HEADER_ALTITUDE, _measurementsArray[_index].altitude, 2);
+		measurement_t last = getMeasurement(_last);
+#define PACKET_FIELD_APPEND_LOCATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		if (FIELD_ENABLED(header) && (location)) \
+			appendValueToPayload(header, last.member, precision);
+		PACKET_FIELDS(PACKET_FIELD_APPEND_LOCATION)
 	}
 
-	for (uint8_t i = 0; i <= _index; i++) {
+	for (uint8_t i = _first; i <= _last; i++) {
+		measurement_t measurement = getMeasurement(i);
 		// Timestamp
 		if (_version > 1)
-			appendTimestamp(i);
-		// Battery [%]
-		uint8_t battery = _measurementsArray[i].battery;
-		appendIntToPayload(HEADER_BATTERY, battery, &battery, sizeof(uint8_t));
-		// Temperature
-		float temperature = _measurementsArray[i].temperature;
-		appendFloatToPayload(HEADER_TEMPERATURE, temperature, 2);
-		// Pressure
-		float pressure = _measurementsArray[i].pressure;
-		appendFloatToPayload(HEADER_PRESSURE, pressure, 2);
-		// Humidity
-		float humidity = _measurementsArray[i].humidity;
-		appendFloatToPayload(HEADER_HUMIDITY, humidity, 2);
-		// Light
-		uint16_t light = _measurementsArray[i].light;
-		appendIntToPayload(HEADER_LIGHT, light, (uint8_t*) (&light), sizeof(uint16_t));
-		// Geolocation data
-		if (_version <= 2) {
-			appendFloatToPayload(HEADER_LATITUDE, _measurementsArray[i].latitude, 6);
-			appendFloatToPayload(HEADER_LONGITUDE, _measurementsArray[i].longitude, 6);
-			appendFloatToPayload(HEADER_ALTITUDE, _measurementsArray[i].altitude, 2);
-		}
-		// CO2
-		float co2 = _measurementsArray[i].co2;
-		appendFloatToPayload(HEADER_CO2, co2, 2);
-		// Noise
-		uint16_t noise = _measurementsArray[i].noise;
-		appendIntToPayload(HEADER_NOISE, noise, (uint8_t*) (&noise), sizeof(uint16_t));
-		// Air quality
-		float airQuality = _measurementsArray[i].airQuality;
-		appendFloatToPayload(HEADER_AIR_QUALITY, airQuality, 2);
+			appendTimestamp(i - _first);
+		// Fields, in the order of the schema, with the location from version 3
+#define PACKET_FIELD_APPEND(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		if (FIELD_ENABLED(header) && (!(location) || _version <= 2)) \
+			appendValueToPayload(header, measurement.member, precision);
+		PACKET_FIELDS(PACKET_FIELD_APPEND)
 		// Close measurement
 		if (_version > 1)
 			closeMeasurement();
 	}
 }
 
+/**
+ * Computes the presence bitmap of the fields for versions 4 and 5.
+ * A field is present if at least one of the measurements contains it,
+ * or in aggregation mode, if it has statistics.
+ * The location fields are stored once per batch.
+ * @return: the presence bitmap, with one bit per header
+ */
+uint16_t Packet::getPresenceBitmap() {
+	uint16_t bitmap = 0;
+	for (uint8_t header = 1; header <= N_HEADERS; header++) {
+		// Aggregation mode: fields with statistics
+		if (_aggregator != NULL && !(PRESENCE_BIT(header) & LOCATION_FIELDS)) {
+			if (_aggregator->getCount(header - 1) > 0)
+				bitmap |= PRESENCE_BIT(header);
+			continue;
+		}
+		// The location is stored once per batch
+		uint8_t first = (PRESENCE_BIT(header) & LOCATION_FIELDS) ? 0 : _first;
+		uint8_t last = (PRESENCE_BIT(header) & LOCATION_FIELDS) ? 0 : _last;
+		for (uint8_t i = first; i <= last; i++) {
+			if (getCode(header, i) != ABSENT_CODE) {
+				bitmap |= PRESENCE_BIT(header);
+				break;
+			}
+		}
+	}
+	return bitmap;
+}
+
+/**
+ * Converts a float value to an int, by multiplying it by a power of 10,
+ * and rounding half away from zero.
+ * The ESP32 has no double-precision FPU: the integer part is scaled with integers,
+ * and only the fractional part is scaled and rounded in single precision.
+ * @param data: data value, saturated to the range of a 32-bit signed int
+ * @param precision: number of decimal places, lower than POW10_SIZE
+ * @return: the scaled value
+ */
+int64_t Packet::scaleFloat(float data, uint8_t precision) {
+	int32_t factor = POW10[precision];
+	if (data >= 2147483648.0f)
+		return (int64_t) INT32_MAX * factor;
+	if (data < -2147483648.0f)
+		return (int64_t) INT32_MIN * factor;
+	int32_t integer = (int32_t) data;
+	// Exact: the difference between a float and its truncation is a float
+	float fraction = data - (float) integer;
+	return (int64_t) integer * factor + (int32_t) roundf(fraction * (float) factor);
+}
+
+/**
+ * Appends an unsigned int to the payload as a varint,
+ * i.e. 7 bits per byte, least significant first,
+ * with the most significant bit set on all bytes but the last.
+ * @param data: value to append
+ */
+void Packet::appendVarint(uint64_t data) {
+	do {
+		uint8_t byte = data & 0x7F;
+		data >>= 7;
+		if (data != 0)
+			byte |= 0x80;
+		appendBytesToPayload(&byte, sizeof(byte));
+	} while (data != 0);
+}
+
+/**
+ * Converts an int value back to a float, by dividing it by a power of 10,
+ * without double-precision arithmetic.
+ * @param data: scaled value
+ * @param precision: number of decimal places, lower than POW10_SIZE
+ * @return: the float value
+ */
+float Packet::unscaleInt(int64_t data, uint8_t precision) {
+	int32_t factor = POW10[precision];
+	int64_t integer = data / factor;
+	int32_t fraction = data % factor;
+	return (float) integer + (float) fraction / (float) factor;
+}
+
+/**
+ * Converts a value to a number of resolution steps of its field.
+ * @param header: header of the field
+ * @param data: value of the field
+ * @return: the number of resolution steps, rounded half away from zero
+ */
+int64_t Packet::quantizeSteps(uint8_t header, float data) {
+	quantization_t* quantization = _quantization + header - 1;
+	// Value in units of 10^exponent
+	int64_t units;
+	if (quantization->exponent <= 0) {
+		units = scaleFloat(data, -quantization->exponent);
+	} else {
+		units = scaleFloat(data, 0);
+		units = (units >= 0 ? units + POW10[quantization->exponent] / 2 :
+		                      units - POW10[quantization->exponent] / 2) / POW10[quantization->exponent];
+	}
+	// Value in resolution steps, rounded half away from zero
+	int64_t steps = units;
+	if (quantization->mantissa > 1)
+		steps = (units >= 0 ? units + quantization->mantissa / 2 :
+		                      units - quantization->mantissa / 2) / quantization->mantissa;
+	return steps;
+}
+
+/**
+ * Quantizes a value, according to the quantization of its field.
+ * @param header: header of the field
+ * @param data: value of the field
+ * @return: number of resolution steps above the minimum of the field,
+ *          clamped to the range of the field
+ */
+uint32_t Packet::quantize(uint8_t header, float data) {
+	quantization_t* quantization = _quantization + header - 1;
+	int64_t code = quantizeSteps(header, data) - quantization->min;
+	// All bits set is reserved for absent values
+	int64_t maxCode = ((int64_t) 1 << (8 * quantization->width)) - 2;
+	if (code < 0)
+		return 0;
+	if (code > maxCode)
+		return (uint32_t) maxCode;
+	return (uint32_t) code;
+}
+
+/**
+ * Quantizes a spread of the values of a field, e.g. a standard deviation,
+ * with the resolution and width of the field but without its minimum.
+ * @param header: header of the field
+ * @param data: spread of the values, non-negative
+ * @return: number of resolution steps, clamped to the width of the field
+ */
+uint32_t Packet::quantizeSpread(uint8_t header, float data) {
+	int64_t code = quantizeSteps(header, data);
+	int64_t maxCode = ((int64_t) 1 << (8 * _quantization[header - 1].width)) - 2;
+	if (code < 0)
+		return 0;
+	if (code > maxCode)
+		return (uint32_t) maxCode;
+	return (uint32_t) code;
+}
+
+/**
+ * Converts a quantized value back to the value of its field.
+ * @param quantization: quantization of the field
+ * @param code: quantized value
+ * @return: the value of the field, at the resolution of the field
+ */
+float Packet::dequantize(const quantization_t* quantization, uint32_t code) {
+	int64_t units = ((int64_t) quantization->min + code) * quantization->mantissa;
+	if (quantization->exponent < 0)
+		return unscaleInt(units, -quantization->exponent);
+	return (float) (units * POW10[quantization->exponent]);
+}
+
+/**
+ * Converts a quantized spread back to the spread of the values of its field.
+ * @param quantization: quantization of the field
+ * @param code: quantized spread
+ * @return: the spread, at the resolution of the field
+ */
+float Packet::dequantizeSpread(const quantization_t* quantization, uint32_t code) {
+	quantization_t spread = *quantization;
+	spread.min = 0;
+	return dequantize(&spread, code);
+}
+
+/**
+ * Appends the non-default quantizations of the present fields to the payload,
+ * i.e. their bitmap followed by one descriptor per field, in the order of their headers.
+ * A descriptor contains the width - 1 (2 bits), the index of the mantissa in {1, 2, 5} (2 bits),
+ * the exponent (4 bits, signed), and the minimum value in resolution steps (4 bytes, signed).
+ * @param bitmap: presence bitmap of the fields
+ */
+void Packet::appendQuantization(uint16_t bitmap) {
+	uint16_t overrides = bitmap & _quantizationOverrides;
+	if (overrides == 0)
+		return;
+	appendBytesToPayload((uint8_t*) &overrides, sizeof(overrides));
+	for (uint8_t header = 1; header <= N_HEADERS; header++) {
+		if (!(overrides & PRESENCE_BIT(header)))
+			continue;
+		quantization_t* quantization = _quantization + header - 1;
+		uint8_t mantissaIndex = quantization->mantissa == 1 ? 0 : (quantization->mantissa == 2 ? 1 : 2);
+		uint8_t descriptor = ((quantization->width - 1) << 6) | (mantissaIndex << 4) |
+		                     (quantization->exponent & 0x0F);
+		appendBytesToPayload(&descriptor, sizeof(descriptor));
+		appendBytesToPayload((uint8_t*) &quantization->min, sizeof(quantization->min));
+	}
+}
+
+/**
+ * Appends a quantized value to the payload, without header (versions 4 and 5).
+ * Absolute values are written on the width of their field.
+ * Deltas are written as zig-zag varints, shifted by one
+ * to keep the code ABSENT_DELTA for absent values.
+ * @param header: header of the field
+ * @param code: quantized value, or ABSENT_CODE
+ * @param delta: true to write the delta with the reference value
+ * @param reference: reference value of the delta, updated with the quantized value if present
+ */
+void Packet::appendQuantizedValue(uint8_t header, uint32_t code, bool delta, uint32_t* reference) {
+	bool present = code != ABSENT_CODE;
+	if (delta) {
+		if (present) {
+			int32_t diff = (int32_t) (code - *reference);
+			uint32_t zigzag = ((uint32_t) diff << 1) ^ (uint32_t) (diff >> 31);
+			appendVarint((uint64_t) zigzag + 1);
+		} else {
+			appendVarint(ABSENT_DELTA);
+		}
+	} else {
+		appendBytesToPayload((uint8_t*) &code, _quantization[header - 1].width);
+	}
+	if (present && reference != NULL)
+		*reference = code;
+}
+
+/**
+ * Populates the LoRaWAN payload with recorded measurements, for versions 4 and 5.
+ * Only the fields present in the bitmap are written, without headers,
+ * in the order of their headers, with the quantization of their field.
+ * The non-default quantizations come first. The location is written once,
+ * and the timestamps are implicit (index of the measurement).
+ * For version 5, the measurements after the first one are written
+ * as deltas with the previous value of the same field.
+ */
+void Packet::populateBitmapPayload() {
+	uint16_t bitmap = getPresenceBitmap();
+	appendQuantization(bitmap);
+
+	// Geolocation data, in the order of the schema
+#define PACKET_FIELD_APPEND_QUANTIZED_LOCATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	if ((location) && (bitmap & PRESENCE_BIT(header))) \
+		appendQuantizedValue(header, getCode(header, 0), false, NULL);
+	PACKET_FIELDS(PACKET_FIELD_APPEND_QUANTIZED_LOCATION)
+
+	if (_aggregator != NULL) {
+		populateAggregatePayload(bitmap);
+		return;
+	}
+
+	// Measurements, in the order of their headers
+	// Reference values of the deltas, indexed by header - 1
+	uint32_t references[N_HEADERS] = {0};
+	for (uint8_t i = _first; i <= _last; i++) {
+		bool delta = _version == 5 && i > _first;
+		for (uint8_t header = 1; header <= N_HEADERS; header++) {
+			if ((bitmap & PRESENCE_BIT(header)) && !(PRESENCE_BIT(header) & LOCATION_FIELDS))
+				appendQuantizedValue(header, getCode(header, i), delta, references + header - 1);
+		}
+	}
+}
+
+/**
+ * Populates the LoRaWAN payload with the statistics of the samples, in aggregation mode.
+ * Each present field is written as its minimum, maximum, mean and standard deviation,
+ * in the order of their headers, with the quantization of their field.
+ * @param bitmap: presence bitmap of the fields
+ */
+void Packet::populateAggregatePayload(uint16_t bitmap) {
+	for (uint8_t header = 1; header <= N_HEADERS; header++) {
+		if (!(bitmap & PRESENCE_BIT(header)) || (PRESENCE_BIT(header) & LOCATION_FIELDS))
+			continue;
+		uint8_t field = header - 1;
+		appendQuantizedValue(header, quantize(header, _aggregator->getMin(field)), false, NULL);
+		appendQuantizedValue(header, quantize(header, _aggregator->getMax(field)), false, NULL);
+		appendQuantizedValue(header, quantize(header, _aggregator->getMean(field)), false, NULL);
+		appendQuantizedValue(header, quantizeSpread(header, _aggregator->getStddev(field)), false, NULL);
+	}
+}
+
 /**
  * Clears the measurements array,
- * by setting all its values to 0.
+ * by marking all the values of the measurement store as absent.
  */
 void Packet::clearArray() {
-	for (uint8_t i = 0; i < _nMeasurements; i++) {
-		_measurementsArray[i].battery = DEFAULT_INT;
-		_measurementsArray[i].temperature = DEFAULT_FLOAT;
-		_measurementsArray[i].pressure = DEFAULT_FLOAT;
-		_measurementsArray[i].humidity = DEFAULT_FLOAT;
-		_measurementsArray[i].light = DEFAULT_INT;
-		_measurementsArray[i].latitude = DEFAULT_FLOAT;
-		_measurementsArray[i].longitude = DEFAULT_FLOAT;
-		_measurementsArray[i].altitude = DEFAULT_FLOAT;
-		_measurementsArray[i].co2 = DEFAULT_FLOAT;
-		_measurementsArray[i].noise = DEFAULT_INT;
-		_measurementsArray[i].airQuality = DEFAULT_FLOAT;
-	}
+	if (_store != NULL)
+		_store->clear();
 }
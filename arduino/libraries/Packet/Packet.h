@@ -10,42 +10,156 @@
 #define Packet_h
 
 #include <Arduino.h>
+#include "MeasurementStore.h"
+#include "Aggregator.h"
+#include "PacketFields.h"
 
 // Default values
 #define DEFAULT_INT   0
 #define DEFAULT_FLOAT -200
 // Maximum number of measurements for each version
-const uint8_t MAX_MEASUREMENTS_VERSION[3] = {1, 5, 8};
-#define MAX_MEASUREMENTS 8
-
-// Header values definitions
-const uint8_t HEADER_BATTERY     = 0x01;
-const uint8_t HEADER_TEMPERATURE = 0x02;
-const uint8_t HEADER_PRESSURE    = 0x03;
-const uint8_t HEADER_HUMIDITY    = 0x04;
-const uint8_t HEADER_ALTITUDE    = 0x05;
-const uint8_t HEADER_LIGHT       = 0x06;
-const uint8_t HEADER_LATITUDE    = 0x07;
-const uint8_t HEADER_LONGITUDE   = 0x08;
-const uint8_t HEADER_CO2         = 0x09;
-const uint8_t HEADER_NOISE       = 0x0A;
-const uint8_t HEADER_AIR_QUALITY = 0x0B;
-
-// Structure for one measurement
+#define MAX_MEASUREMENTS_V1 1
+#define MAX_MEASUREMENTS_V2 5
+#define MAX_MEASUREMENTS_V3 8
+#define MAX_MEASUREMENTS_V4 8
+#define MAX_MEASUREMENTS_V5 32
+const uint8_t MAX_MEASUREMENTS_VERSION[5] = {MAX_MEASUREMENTS_V1, MAX_MEASUREMENTS_V2,
+                                             MAX_MEASUREMENTS_V3, MAX_MEASUREMENTS_V4,
+                                             MAX_MEASUREMENTS_V5};
+#define MAX_MEASUREMENTS 32
+
+// Sizes (in bytes) of the encoded fields, header included
+#define FIELD_SIZE_UINT8  (1 + sizeof(uint8_t))
+#define FIELD_SIZE_UINT16 (1 + sizeof(uint16_t))
+#define FIELD_SIZE_FLOAT  (1 + sizeof(uint32_t))
+// Size of the location fields (latitude, longitude, altitude)
+#define LOCATION_PAYLOAD_SIZE (3 * FIELD_SIZE_FLOAT)
+// Size of the other fields of one measurement
+// (battery, temperature, pressure, humidity, light, CO2, noise, air quality)
+#define MEASUREMENT_PAYLOAD_SIZE (FIELD_SIZE_UINT8 + 5 * FIELD_SIZE_FLOAT + 2 * FIELD_SIZE_UINT16)
+// Sizes of the same fields, without header and with the default quantization (versions 4 and 5)
+#define LOCATION_DATA_SIZE    (3 * sizeof(uint32_t))
+#define MEASUREMENT_DATA_SIZE (sizeof(uint8_t) + 5 * sizeof(uint32_t) + 2 * sizeof(uint16_t))
+// Maximum size of a varint-encoded delta (33 bits), and of a delta-encoded measurement (version 5)
+#define VARINT_MAX_SIZE        5
+#define MEASUREMENT_DELTA_SIZE (8 * VARINT_MAX_SIZE)
+// Maximum payload size for each version, when all fields are present.
+// Version 1: version byte, one measurement with its location.
+// Version 2: version and interval bytes, measurements with their location,
+//            each with a timestamp and a terminating byte.
+// Version 3: version and interval bytes, location once,
+//            measurements with a timestamp and a terminating byte.
+// Version 4: version, interval and measurements count bytes, 16-bit presence bitmap,
+//            location once, measurements without headers, timestamps nor terminating bytes.
+// Version 5: as version 4, but only the first measurement is absolute,
+//            the next ones are varint-encoded deltas with the previous measurement.
+#define PAYLOAD_SIZE_V1 (1 + MEASUREMENT_PAYLOAD_SIZE + LOCATION_PAYLOAD_SIZE)
+#define PAYLOAD_SIZE_V2 (2 + MAX_MEASUREMENTS_V2 * (2 + MEASUREMENT_PAYLOAD_SIZE + LOCATION_PAYLOAD_SIZE))
+#define PAYLOAD_SIZE_V3 (2 + LOCATION_PAYLOAD_SIZE + MAX_MEASUREMENTS_V3 * (2 + MEASUREMENT_PAYLOAD_SIZE))
+#define MAX_SIZE(a, b) ((a) > (b) ? (a) : (b))
+#define PAYLOAD_SIZE_V4 (5 + LOCATION_DATA_SIZE + MAX_MEASUREMENTS_V4 * MEASUREMENT_DATA_SIZE)
+#define PAYLOAD_SIZE_V5 (5 + LOCATION_DATA_SIZE + MEASUREMENT_DATA_SIZE + \
+                         (MAX_MEASUREMENTS_V5 - 1) * MEASUREMENT_DELTA_SIZE)
+#define PAYLOAD_SIZE_ALL_VERSIONS MAX_SIZE(MAX_SIZE(MAX_SIZE(PAYLOAD_SIZE_V1, PAYLOAD_SIZE_V2), \
+                                                    MAX_SIZE(PAYLOAD_SIZE_V3, PAYLOAD_SIZE_V4)), \
+                                           PAYLOAD_SIZE_V5)
+// Size of the internal payload buffer, bounded by the 8-bit payload size.
+// On AVR boards (The Things Node), a version 1 payload.
+// Can be set with a compiler flag, like MEASUREMENT_STORE_SIZE.
+#ifndef PAYLOAD_MAX_SIZE
+#ifdef __AVR__
+#define PAYLOAD_MAX_SIZE PAYLOAD_SIZE_V1
+#else
+#define PAYLOAD_MAX_SIZE (PAYLOAD_SIZE_ALL_VERSIONS < UINT8_MAX ? PAYLOAD_SIZE_ALL_VERSIONS : UINT8_MAX)
+#endif
+#endif
+
+// Fragments of a batch that does not fit in one frame at the current data rate,
+// sent on their own LoRaWAN port, with a header of 3 bytes:
+// sequence number of the batch, timestamp of the first measurement of the fragment,
+// and timestamp of the last measurement of the batch
+#define FRAGMENT_PORT        3
+#define FRAGMENT_HEADER_SIZE 3
+
+// Uplinks sent again after an outage of the network (store-and-forward of the ESP32 devices),
+// on their own LoRaWAN port, with a header of 3 bytes: age of the last measurement
+// of the uplink when it is sent again (in minutes, 2 bytes), and port of the original uplink
+#define STORED_PORT        5
+#define STORED_HEADER_SIZE 3
+
+// Powers of 10, to scale the float values to ints without double-precision arithmetic
+#define POW10_SIZE 10
+const int32_t POW10[POW10_SIZE] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+                                   10000000, 100000000, 1000000000};
+
+// Header values definitions, from the field schema
+#define PACKET_FIELD_HEADER(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	const uint8_t id = header;
+PACKET_FIELDS(PACKET_FIELD_HEADER)
+
+// Number of header values
+#define N_HEADERS 11
+#define PACKET_FIELD_COUNT(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) + 1
+static_assert(0 PACKET_FIELDS(PACKET_FIELD_COUNT) == N_HEADERS, "N_HEADERS must match the field schema");
+static_assert(AGGREGATOR_FIELDS == N_HEADERS, "AGGREGATOR_FIELDS must match the field schema");
+
+// Versions 4 and 5: bit of a field in the presence bitmap
+#define PRESENCE_BIT(header) ((uint16_t) 1 << ((header) - 1))
+// Fields of the location, measured once per batch, and of all fields
+#define PACKET_FIELD_LOCATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	| ((location) ? PRESENCE_BIT(header) : 0)
+#define LOCATION_FIELDS ((uint16_t) (0 PACKET_FIELDS(PACKET_FIELD_LOCATION)))
+#define ALL_FIELDS      ((uint16_t) (1 << N_HEADERS) - 1)
+// True if the code of a field is compiled, see PACKET_ENABLED_FIELDS
+#define FIELD_ENABLED(header) ((PACKET_ENABLED_FIELDS & PRESENCE_BIT(header)) != 0)
+// Version 5: varint code of a field absent from one measurement
+#define ABSENT_DELTA 0
+
+// Versions 4 and 5: quantization of the fields.
+// A value is sent as its number of resolution steps above the minimum of its range,
+// in an unsigned int of 1 to 4 bytes. All bits set marks an absent value,
+// values out of range are clamped.
+// The resolution is a mantissa (1, 2 or 5) multiplied by a power of 10.
+typedef struct quantization {
+	int32_t min;      // Minimum value, in resolution steps
+	int8_t exponent;  // Power of 10 of the resolution, from -8 to 7
+	uint8_t mantissa; // Mantissa of the resolution
+	uint8_t width;    // Size in bytes
+} quantization_t;
+// Default quantization of a field, from the field schema.
+// Same resolution and size as versions 1 to 3, and minimum DEFAULT_FLOAT for floats.
+#define PACKET_FIELD_QUANTIZATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	(h) == (header) ? quantization_t{min, exponent, mantissa, width} :
+constexpr quantization_t defaultQuantization(uint8_t h) {
+	return PACKET_FIELDS(PACKET_FIELD_QUANTIZATION) quantization_t{0, 0, 1, 0};
+}
+// Flag set on the version byte when the payload announces non-default quantizations,
+// each one with a descriptor of 1 byte (width, mantissa and exponent) and a 4-byte minimum
+#define QUANTIZATION_FLAG            0x80
+#define QUANTIZATION_DESCRIPTOR_SIZE 5
+// Flag set on the version byte of aggregated payloads (versions 4 and 5):
+// the count byte is the number of samples, and each present field is written as
+// its minimum, maximum, mean and standard deviation, with the quantization of the field
+// (the standard deviation as a number of resolution steps, without minimum)
+#define AGGREGATE_FLAG 0x40
+#define N_AGGREGATES   4
+// Flags of the version byte
+#define VERSION_FLAGS (QUANTIZATION_FLAG | AGGREGATE_FLAG)
+
+// Structure for one measurement, as read from the measurement store
+#define PACKET_FIELD_MEMBER(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	type member;
 typedef struct measurement {
-	uint8_t battery;
-	float temperature;
-	float pressure;
-	float humidity;
-	uint16_t light;
-	float latitude;
-	float longitude;
-	float altitude;
-	float co2;
-	uint16_t noise;
-	float airQuality;
+	PACKET_FIELDS(PACKET_FIELD_MEMBER)
 } measurement_t;
 
+// Presence of a value: ints are absent if equal to DEFAULT_INT, floats if not above DEFAULT_FLOAT
+template<typename T> inline bool isPresentValue(T data) { return data != DEFAULT_INT; }
+template<> inline bool isPresentValue<float>(float data) { return data > DEFAULT_FLOAT; }
+// Value of an absent field
+template<typename T> inline T absentValue() { return DEFAULT_INT; }
+template<> inline float absentValue<float>() { return DEFAULT_FLOAT; }
+
 /* Packet class */
 class Packet {
 
@@ -53,50 +167,97 @@ class Packet {
 		Packet();
 		Packet(uint8_t interval, uint8_t nMeasurements = 1, uint8_t version = 1);
 		void init(uint8_t interval, uint8_t nMeasurements = 1, uint8_t version = 1);
+		void setBatch(uint8_t interval, uint8_t nMeasurements);
 
 		uint8_t getVersion();
+		uint8_t getInterval();
 		uint8_t getIndex();
+		uint8_t getNMeasurements();
 		uint8_t getPayloadSize();
-		measurement_t* getMeasurementsArray();
+		uint8_t getBatchPayloadSize(uint8_t last);
+		uint8_t getNextBatchPayloadSize(uint8_t last);
+		measurement_t getMeasurement(uint8_t index);
 
-		void setMeasurementsArray(measurement_t* measurementsArray);
+		void setMeasurementStore(MeasurementStore* store);
+		bool setAggregator(Aggregator* aggregator);
+		bool isAggregating();
+		void setFields(uint16_t fields);
+		bool setQuantization(uint8_t header, float min, float resolution, uint8_t width);
 
 		void printValue(char* name, float value);
 		void printArray();
 		void printPayload();
 
-		void addBattery(uint8_t battery, uint8_t index);
-		void addTemperature(float temperature, uint8_t index);
-		void addPressure(float pressure, uint8_t index);
-		void addHumidity(float humidity, uint8_t index);
-		void addAltitude(float altitude, uint8_t index);
-		void addLight(uint16_t light, uint8_t index);
-		void addLatitude(float latitude, uint8_t index);
-		void addLongitude(float longitude, uint8_t index);
-		void addCO2(float co2, uint8_t index);
-		void addNoise(uint16_t noise, uint8_t index);
-		void addAirQuality(float airQuality, uint8_t index);
+		// addBattery, addTemperature, ... one per field of the schema
+#define PACKET_FIELD_ADD_DECLARATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		void add##Name(type member, uint8_t index);
+		PACKET_FIELDS(PACKET_FIELD_ADD_DECLARATION)
+
+		static int64_t scaleFloat(float data, uint8_t precision);
+		static float unscaleInt(int64_t data, uint8_t precision);
+		static float dequantize(const quantization_t* quantization, uint32_t code);
+		static float dequantizeSpread(const quantization_t* quantization, uint32_t code);
 
 		uint8_t* buildLoraPayload();
-		uint8_t* buildLoraPayload(uint8_t* payload, uint8_t* size_ptr);
+		uint8_t* buildLoraPayload(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity);
+		uint8_t* buildPayload(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity);
+		uint8_t* buildLoraFragment(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity,
+		                           uint8_t sequence, uint8_t* first, uint8_t last);
 		void clearArray();
 
 	private:
 		uint8_t _version;
 		uint8_t _interval;
 		uint8_t _nMeasurements;
-		measurement_t* _measurementsArray;
+		MeasurementStore* _store;
+		// Statistics of the samples in aggregation mode, NULL otherwise
+		Aggregator* _aggregator;
+		// Bitmap of the fields kept in the store
+		uint16_t _fields;
 		uint8_t _index;
+		// Range of the measurements being encoded
+		uint8_t _first;
+		uint8_t _last;
 		uint8_t* _payload;
 		uint8_t* _size_ptr;
+		uint8_t _size;
+		uint8_t _capacity;
+		bool _overflow;
+		// Quantization of the fields (versions 4 and 5), indexed by header - 1
+		quantization_t _quantization[N_HEADERS];
+		uint16_t _quantizationOverrides;
+
+		// Internal payload buffer, used when no buffer is provided by the caller
+		static uint8_t _payloadBuffer[PAYLOAD_MAX_SIZE];
+
+		void updateStoreColumns();
+		void addValue(uint8_t header, bool present, float data, uint8_t index);
+		uint32_t getCode(uint8_t header, uint8_t index);
 
+		bool encodeMeasurements(uint8_t* payload, uint8_t* size_ptr, uint8_t capacity,
+		                        uint8_t first, uint8_t last);
+		bool reserve(uint8_t size);
 		void addPreamble();
 		void appendTimestamp(uint8_t timestamp);
+		void appendBytesToPayload(uint8_t* data_ptr, uint8_t size);
 		void appendDataToPayload(uint8_t header, uint8_t* data_ptr, uint8_t size);
 		void appendIntToPayload(uint8_t header, uint32_t data, uint8_t* data_ptr, uint8_t size);
 		void appendFloatToPayload(uint8_t header, float data, uint8_t precision);
+		void appendValueToPayload(uint8_t header, uint8_t data, uint8_t precision);
+		void appendValueToPayload(uint8_t header, uint16_t data, uint8_t precision);
+		void appendValueToPayload(uint8_t header, float data, uint8_t precision);
 		void closeMeasurement();
 		void populateLoraPayload();
+		// Versions 4 and 5
+		uint16_t getPresenceBitmap();
+		int64_t quantizeSteps(uint8_t header, float data);
+		uint32_t quantize(uint8_t header, float data);
+		uint32_t quantizeSpread(uint8_t header, float data);
+		void appendQuantization(uint16_t bitmap);
+		void appendVarint(uint64_t data);
+		void appendQuantizedValue(uint8_t header, uint32_t code, bool delta, uint32_t* reference);
+		void populateBitmapPayload();
+		void populateAggregatePayload(uint16_t bitmap);
 
 };
 
@@ -0,0 +1,445 @@
+/**
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Class for decoding LoRaWAN data packets, all versions,
+ * generated from the field schema like the encoder.
+ * Mirrors the TTN decoder (the-things-network/decoder.js),
+ * to check the payloads of the encoder without the network.
+ */
+
+#include "PacketDecoder.h"
+
+/* No-arg constructor */
+PacketDecoder::PacketDecoder() {
+	_payload = NULL;
+	_size = 0;
+	_offset = 0;
+	_error = false;
+	_first = 0;
+}
+
+/**
+ * Decodes a LoRaWAN payload.
+ * @param payload: pointer to the start of the payload
+ * @param size: size of the payload (in bytes)
+ * @param decoded: pointer to the structure receiving the decoded payload
+ * @return: true if the payload was decoded, false if it is truncated,
+ *          malformed, or of an unknown version
+ */
+bool PacketDecoder::decode(const uint8_t* payload, uint8_t size, decoded_payload_t* decoded) {
+	_payload = payload;
+	_size = size;
+	_first = 0;
+	clearPayload(decoded);
+	if (!decodePayload(decoded))
+		return false;
+	if (decoded->nMeasurements > 0)
+		decoded->received = 0xFFFFFFFF >> (32 - decoded->nMeasurements);
+	return true;
+}
+
+/**
+ * Decodes a fragment of a batch (see Packet::buildLoraFragment),
+ * and adds its measurements to the batch, at their timestamp.
+ * A fragment of another batch than the one being reassembled starts a new batch.
+ * @param payload: pointer to the start of the fragment
+ * @param size: size of the fragment (in bytes)
+ * @param batch: pointer to the structure receiving the reassembled batch
+ * @return: true if the fragment was decoded, false otherwise
+ */
+bool PacketDecoder::decodeFragment(const uint8_t* payload, uint8_t size, decoded_payload_t* batch) {
+	if (size <= FRAGMENT_HEADER_SIZE || (payload[FRAGMENT_HEADER_SIZE] & AGGREGATE_FLAG))
+		return false;
+	uint8_t sequence = payload[0];
+	uint8_t first = payload[1];
+	uint8_t last = payload[2];
+	if (first > last || last >= MAX_MEASUREMENTS)
+		return false;
+	if (batch->received == 0 || batch->sequence != sequence)
+		clearPayload(batch);
+
+	_payload = payload + FRAGMENT_HEADER_SIZE;
+	_size = size - FRAGMENT_HEADER_SIZE;
+	_first = first;
+	uint8_t nMeasurements = batch->nMeasurements;
+	if (!decodePayload(batch) || first + batch->nMeasurements > last + 1) {
+		batch->nMeasurements = nMeasurements;
+		return false;
+	}
+	for (uint8_t i = first; i < first + batch->nMeasurements; i++)
+		batch->received |= (uint32_t) 1 << i;
+	batch->sequence = sequence;
+	batch->nMeasurements = last + 1;
+	return true;
+}
+
+/**
+ * Decodes an uplink sent again after an outage of the network (STORED_PORT port),
+ * i.e. a payload or a fragment preceded by its age and its original port.
+ * A fragment is added to the batch being reassembled, like with decodeFragment.
+ * @param payload: pointer to the start of the stored uplink
+ * @param size: size of the stored uplink (in bytes)
+ * @param decoded: pointer to the structure receiving the decoded payload, or the reassembled batch
+ * @return: true if the uplink was decoded, false otherwise
+ */
+bool PacketDecoder::decodeStored(const uint8_t* payload, uint8_t size, decoded_payload_t* decoded) {
+	if (size <= STORED_HEADER_SIZE)
+		return false;
+	uint16_t age = ((uint16_t) payload[0] << 8) | payload[1];
+	bool valid = payload[2] == FRAGMENT_PORT
+	             ? decodeFragment(payload + STORED_HEADER_SIZE, size - STORED_HEADER_SIZE, decoded)
+	             : decode(payload + STORED_HEADER_SIZE, size - STORED_HEADER_SIZE, decoded);
+	if (valid)
+		decoded->age = age;
+	return valid;
+}
+
+/**
+ * Checks if all the measurements of a fragmented batch were received.
+ * @param batch: pointer to the reassembled batch
+ * @return: true if the batch is complete, false otherwise
+ */
+bool PacketDecoder::isComplete(const decoded_payload_t* batch) {
+	if (batch->nMeasurements == 0)
+		return false;
+	return batch->received == 0xFFFFFFFF >> (32 - batch->nMeasurements);
+}
+
+/**
+ * Clears a decoded payload, with default values for all the measurements.
+ * @param decoded: pointer to the decoded payload
+ */
+void PacketDecoder::clearPayload(decoded_payload_t* decoded) {
+	decoded->version = 0;
+	decoded->interval = 0;
+	decoded->nMeasurements = 0;
+	decoded->aggregate = false;
+	decoded->samples = 0;
+	decoded->sequence = 0;
+	decoded->received = 0;
+	decoded->age = 0;
+	for (uint8_t i = 0; i < MAX_MEASUREMENTS; i++)
+		clearMeasurement(decoded->measurements + i);
+}
+
+/**
+ * Decodes the payload set in _payload and _size.
+ * The measurements are written from the index _first,
+ * and their number is set in nMeasurements.
+ * @param decoded: pointer to the structure receiving the decoded payload
+ * @return: true if the payload was decoded, false if it is truncated,
+ *          malformed, or of an unknown version
+ */
+bool PacketDecoder::decodePayload(decoded_payload_t* decoded) {
+	_offset = 0;
+	_error = false;
+	if (_size == 0)
+		return false;
+
+	decoded->version = _payload[0] & ~VERSION_FLAGS;
+	switch (decoded->version) {
+		case 1:
+		case 2:
+		case 3:
+			if (_payload[0] & VERSION_FLAGS)
+				return false;
+			decoded->nMeasurements = decodeTaggedPayload(decoded);
+			break;
+		case 4:
+		case 5:
+			decoded->nMeasurements = decodeBitmapPayload(decoded);
+			break;
+		default:
+			// Unknown version
+			return false;
+	}
+	return !_error;
+}
+
+/**
+ * Reads an unsigned int from the payload, most significant byte first.
+ * If the payload is too short, the decoding fails.
+ * @param size: size of the int (in bytes), from 1 to 4
+ * @return: the int, or 0 if the payload is too short
+ */
+uint32_t PacketDecoder::readInt(uint8_t size) {
+	if (_error || (uint16_t) _offset + size > _size) {
+		_error = true;
+		return 0;
+	}
+	uint32_t data = 0;
+	for (uint8_t i = 0; i < size; i++)
+		data = (data << 8) | _payload[_offset + i];
+	_offset += size;
+	return data;
+}
+
+/**
+ * Reads a quantized value from the payload, on the width of its field (versions 4 and 5).
+ * @param header: header of the field
+ * @return: the quantized value, or ABSENT_CODE if all its bits are set
+ */
+uint32_t PacketDecoder::readQuantizedInt(uint8_t header) {
+	uint8_t width = _quantization[header - 1].width;
+	uint32_t code = readInt(width);
+	if (width < sizeof(uint32_t) && code == ((uint32_t) 1 << (8 * width)) - 1)
+		return ABSENT_CODE;
+	return code;
+}
+
+/**
+ * Reads a varint from the payload,
+ * i.e. 7 bits per byte, least significant first,
+ * with the most significant bit set on all bytes but the last.
+ * @return: the value of the varint
+ */
+uint64_t PacketDecoder::readVarint() {
+	uint64_t data = 0;
+	for (uint8_t i = 0; i < VARINT_MAX_SIZE; i++) {
+		uint8_t byte = readInt(1);
+		data |= (uint64_t) (byte & 0x7F) << (7 * i);
+		if (!(byte & 0x80))
+			return data;
+	}
+	_error = true;
+	return 0;
+}
+
+/**
+ * Reads the value of a field from the payload, for versions 1 to 3.
+ * Floats are sent as ints, multiplied by a power of 10.
+ * @param data: pointer to the value of the field
+ * @param precision: number of decimal places, for floats
+ */
+void PacketDecoder::readValue(uint8_t* data, uint8_t precision) {
+	*data = readInt(sizeof(uint8_t));
+}
+
+void PacketDecoder::readValue(uint16_t* data, uint8_t precision) {
+	*data = readInt(sizeof(uint16_t));
+}
+
+void PacketDecoder::readValue(float* data, uint8_t precision) {
+	*data = Packet::unscaleInt((int32_t) readInt(sizeof(uint32_t)), precision);
+}
+
+/**
+ * Reads a field with its header from the payload, for versions 1 to 3.
+ * An unknown header makes the decoding fail.
+ * @param measurement: measurement receiving the value of the field
+ * @return: true if the field was read, false otherwise
+ */
+bool PacketDecoder::readField(measurement_t* measurement) {
+	uint8_t fieldHeader = readInt(1);
+	switch (fieldHeader) {
+#define PACKET_DECODER_READ(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		case header: \
+			readValue(&measurement->member, precision); \
+			return !_error;
+		PACKET_FIELDS(PACKET_DECODER_READ)
+	}
+	_error = true;
+	return false;
+}
+
+/**
+ * Sets the value of a field from its quantized value, for versions 4 and 5.
+ * @param measurement: measurement receiving the value of the field
+ * @param fieldHeader: header of the field
+ * @param code: quantized value
+ * @param spread: true if the value is a spread, quantized without the minimum of the field
+ */
+void PacketDecoder::setQuantizedValue(measurement_t* measurement, uint8_t fieldHeader, uint32_t code, bool spread) {
+	switch (fieldHeader) {
+#define PACKET_DECODER_SET(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		case header: \
+			measurement->member = (type) (spread ? Packet::dequantizeSpread(_quantization + header - 1, code) : \
+			                                       Packet::dequantize(_quantization + header - 1, code)); \
+			break;
+		PACKET_FIELDS(PACKET_DECODER_SET)
+	}
+}
+
+/**
+ * Sets all the fields of a measurement to their default value.
+ * @param measurement: measurement to clear
+ */
+void PacketDecoder::clearMeasurement(measurement_t* measurement) {
+#define PACKET_DECODER_CLEAR(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	measurement->member = absentValue<type>();
+	PACKET_FIELDS(PACKET_DECODER_CLEAR)
+}
+
+/**
+ * Copies the location fields from a measurement to another.
+ * @param from: measurement containing the location
+ * @param to: measurement receiving the location
+ */
+void PacketDecoder::copyLocation(const measurement_t* from, measurement_t* to) {
+#define PACKET_DECODER_COPY_LOCATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	if (location) \
+		to->member = from->member;
+	PACKET_FIELDS(PACKET_DECODER_COPY_LOCATION)
+}
+
+/**
+ * Decodes a payload of version 1 to 3, with a header before each field.
+ * Version 1 contains one measurement.
+ * Versions 2 and 3 contain measurements, each one starting with a timestamp
+ * and closed by a null byte. In version 3, the location comes first, once.
+ * @param decoded: pointer to the structure receiving the decoded payload
+ * @return: the number of measurements of the payload
+ */
+uint8_t PacketDecoder::decodeTaggedPayload(decoded_payload_t* decoded) {
+	_offset = 1;
+	if (decoded->version == 1) {
+		clearMeasurement(decoded->measurements + _first);
+		while (_offset < _size && readField(decoded->measurements + _first));
+		return 1;
+	}
+
+	decoded->interval = readInt(1);
+	// Geolocation data
+	measurement_t location;
+	clearMeasurement(&location);
+	if (decoded->version == 3) {
+		while (_offset < _size && _payload[_offset] >= 1 && _payload[_offset] <= N_HEADERS &&
+		       (PRESENCE_BIT(_payload[_offset]) & LOCATION_FIELDS))
+			readField(&location);
+	}
+
+	// Measurements
+	uint8_t count = 0;
+	while (_offset < _size && !_error) {
+		if (_first + count >= MAX_MEASUREMENTS) {
+			_error = true;
+			break;
+		}
+		measurement_t* measurement = decoded->measurements + _first + count;
+		clearMeasurement(measurement);
+		count++;
+		// Timestamp
+		readInt(1);
+		while (_offset < _size && _payload[_offset] != 0 && readField(measurement));
+		// Terminating byte
+		readInt(1);
+		if (decoded->version == 3)
+			copyLocation(&location, measurement);
+	}
+	return count;
+}
+
+/**
+ * Decodes a payload of version 4 or 5, with a presence bitmap
+ * and quantized fields without header.
+ * In version 5, the measurements after the first one are
+ * zig-zag varint deltas with the previous value of the same field.
+ * @param decoded: pointer to the structure receiving the decoded payload
+ * @return: the number of measurements of the payload
+ */
+uint8_t PacketDecoder::decodeBitmapPayload(decoded_payload_t* decoded) {
+	_offset = 1;
+	decoded->interval = readInt(1);
+	uint8_t count = readInt(1);
+	uint16_t bitmap = readInt(2);
+	if (!(_payload[0] & AGGREGATE_FLAG) && _first + count > MAX_MEASUREMENTS) {
+		_error = true;
+		return 0;
+	}
+
+	// Quantization of the fields, announced if not the default one
+	for (uint8_t header = 1; header <= N_HEADERS; header++)
+		_quantization[header - 1] = defaultQuantization(header);
+	if (_payload[0] & QUANTIZATION_FLAG) {
+		const uint8_t mantissas[4] = {1, 2, 5, 1};
+		uint16_t overrides = readInt(2);
+		for (uint8_t header = 1; header <= N_HEADERS; header++) {
+			if (!(overrides & PRESENCE_BIT(header)))
+				continue;
+			uint8_t descriptor = readInt(1);
+			quantization_t* quantization = _quantization + header - 1;
+			quantization->width = (descriptor >> 6) + 1;
+			quantization->mantissa = mantissas[(descriptor >> 4) & 0x03];
+			quantization->exponent = (descriptor & 0x08) ? (int8_t) (descriptor & 0x0F) - 16 : descriptor & 0x0F;
+			quantization->min = (int32_t) readInt(4);
+		}
+	}
+
+	// Geolocation data, in the order of the schema
+	measurement_t batchLocation;
+	clearMeasurement(&batchLocation);
+	uint32_t code;
+#define PACKET_DECODER_LOCATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+	if ((location) && (bitmap & PRESENCE_BIT(header))) { \
+		code = readQuantizedInt(header); \
+		if (code != ABSENT_CODE) \
+			setQuantizedValue(&batchLocation, header, code); \
+	}
+	PACKET_FIELDS(PACKET_DECODER_LOCATION)
+
+	if (_payload[0] & AGGREGATE_FLAG) {
+		decoded->aggregate = true;
+		decoded->samples = count;
+		return decodeAggregatePayload(decoded, bitmap, &batchLocation);
+	}
+
+	// Measurements, in the order of their headers
+	uint32_t references[N_HEADERS] = {0};
+	for (uint8_t i = 0; i < count && !_error; i++) {
+		measurement_t* measurement = decoded->measurements + _first + i;
+		clearMeasurement(measurement);
+		for (uint8_t header = 1; header <= N_HEADERS; header++) {
+			if (!(bitmap & PRESENCE_BIT(header)) || (PRESENCE_BIT(header) & LOCATION_FIELDS))
+				continue;
+			if (decoded->version == 5 && i > 0) {
+				uint64_t varint = readVarint();
+				if (varint == ABSENT_DELTA)
+					continue;
+				uint32_t zigzag = (uint32_t) (varint - 1);
+				int32_t diff = (int32_t) (zigzag >> 1) ^ -(int32_t) (zigzag & 1);
+				code = references[header - 1] + diff;
+			} else {
+				code = readQuantizedInt(header);
+				if (code == ABSENT_CODE)
+					continue;
+			}
+			references[header - 1] = code;
+			setQuantizedValue(measurement, header, code);
+		}
+		copyLocation(&batchLocation, measurement);
+	}
+	if (_offset != _size)
+		_error = true;
+	return count;
+}
+
+/**
+ * Decodes the statistics of an aggregated payload (versions 4 and 5),
+ * i.e. the minimum, maximum, mean and standard deviation of each present field,
+ * in the order of their headers, after the location.
+ * @param decoded: pointer to the structure receiving the decoded payload
+ * @param bitmap: presence bitmap of the fields
+ * @param batchLocation: location of the payload, copied in each statistic
+ * @return: the number of statistics, N_AGGREGATES
+ */
+uint8_t PacketDecoder::decodeAggregatePayload(decoded_payload_t* decoded, uint16_t bitmap,
+                                              const measurement_t* batchLocation) {
+	for (uint8_t i = 0; i < N_AGGREGATES; i++)
+		clearMeasurement(decoded->measurements + i);
+	for (uint8_t header = 1; header <= N_HEADERS && !_error; header++) {
+		if (!(bitmap & PRESENCE_BIT(header)) || (PRESENCE_BIT(header) & LOCATION_FIELDS))
+			continue;
+		for (uint8_t i = 0; i < N_AGGREGATES; i++) {
+			uint32_t code = readQuantizedInt(header);
+			if (code != ABSENT_CODE)
+				setQuantizedValue(decoded->measurements + i, header, code, i == AGGREGATE_STDDEV);
+		}
+	}
+	for (uint8_t i = 0; i < N_AGGREGATES; i++)
+		copyLocation(batchLocation, decoded->measurements + i);
+	if (_offset != _size)
+		_error = true;
+	return N_AGGREGATES;
+}
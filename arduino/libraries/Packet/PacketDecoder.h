@@ -0,0 +1,82 @@
+/**
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Class for decoding LoRaWAN data packets, all versions,
+ * generated from the field schema like the encoder.
+ */
+
+#ifndef PacketDecoder_h
+#define PacketDecoder_h
+
+#include <Arduino.h>
+#include "Packet.h"
+
+// Rows of the measurements of an aggregated payload
+#define AGGREGATE_MIN    0
+#define AGGREGATE_MAX    1
+#define AGGREGATE_MEAN   2
+#define AGGREGATE_STDDEV 3
+
+// Structure for a decoded payload
+typedef struct decodedPayload {
+	uint8_t version;
+	uint8_t interval;
+	uint8_t nMeasurements;
+	// Aggregated payloads: number of samples, and one measurement per statistic
+	// (AGGREGATE_MIN, AGGREGATE_MAX, AGGREGATE_MEAN and AGGREGATE_STDDEV)
+	bool aggregate;
+	uint8_t samples;
+	// Fragmented batches: sequence number of the batch,
+	// and bitmap of the measurements received (one bit per timestamp)
+	uint8_t sequence;
+	uint32_t received;
+	// Uplinks sent again after an outage: age of the last measurement when sent (in minutes)
+	uint16_t age;
+	// Measurements, with default values for the absent fields,
+	// and the location of the batch copied in each measurement
+	measurement_t measurements[MAX_MEASUREMENTS];
+} decoded_payload_t;
+
+/* PacketDecoder class */
+class PacketDecoder {
+
+	public:
+		PacketDecoder();
+
+		bool decode(const uint8_t* payload, uint8_t size, decoded_payload_t* decoded);
+		bool decodeFragment(const uint8_t* payload, uint8_t size, decoded_payload_t* batch);
+		bool decodeStored(const uint8_t* payload, uint8_t size, decoded_payload_t* decoded);
+		bool isComplete(const decoded_payload_t* batch);
+
+	private:
+		const uint8_t* _payload;
+		uint8_t _size;
+		uint8_t _offset;
+		bool _error;
+		// Index of the first measurement of the payload in the batch
+		uint8_t _first;
+		// Quantization of the fields (versions 4 and 5), indexed by header - 1
+		quantization_t _quantization[N_HEADERS];
+
+		uint32_t readInt(uint8_t size);
+		uint32_t readQuantizedInt(uint8_t header);
+		uint64_t readVarint();
+		void readValue(uint8_t* data, uint8_t precision);
+		void readValue(uint16_t* data, uint8_t precision);
+		void readValue(float* data, uint8_t precision);
+		bool readField(measurement_t* measurement);
+		void setQuantizedValue(measurement_t* measurement, uint8_t header, uint32_t code, bool spread = false);
+		void clearMeasurement(measurement_t* measurement);
+		void copyLocation(const measurement_t* from, measurement_t* to);
+		void clearPayload(decoded_payload_t* decoded);
+		bool decodePayload(decoded_payload_t* decoded);
+		uint8_t decodeTaggedPayload(decoded_payload_t* decoded);
+		uint8_t decodeBitmapPayload(decoded_payload_t* decoded);
+		uint8_t decodeAggregatePayload(decoded_payload_t* decoded, uint16_t bitmap,
+		                               const measurement_t* batchLocation);
+
+};
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Schema of the fields of the measurements.
+ * The encoder, the measurement store, the Wi-Fi JSON sender and the decoders
+ * (PacketDecoder, and the TTN decoder generated by the-things-network/generate-decoder.py)
+ * are all generated from this list: to add a field, add a line here.
+ */
+
+#ifndef PacketFields_h
+#define PacketFields_h
+
+// Fields, in the order of the payload for versions 1 to 3 and of the JSON object.
+// Versions 4 and 5 write the fields in the order of their headers.
+// Columns:
+// - id: name of the header constant
+// - header: header of the field, from 1 to N_HEADERS, which is also its bit in the presence bitmap
+// - Name: suffix of the Packet::add method
+// - member: member of the measurement_t struct
+// - type: type of the value (uint8_t, uint16_t or float)
+// - precision: number of decimal places of floats, for versions 1 to 3
+// - key: key of the field in the JSON object and in the decoded payloads
+// - location: true if the field is part of the location, sent once per batch from version 3
+// - min, exponent, mantissa, width: default quantization (versions 4 and 5),
+//   see quantization_t in Packet.h
+#define PACKET_FIELDS(X) \
+	X(HEADER_BATTERY,     0x01, Battery,     battery,     uint8_t,  0, "battery",     false, 0,          0,  1, 1) \
+	X(HEADER_TEMPERATURE, 0x02, Temperature, temperature, float,    2, "temperature", false, -20000,     -2, 1, 4) \
+	X(HEADER_PRESSURE,    0x03, Pressure,    pressure,    float,    2, "pressure",    false, -20000,     -2, 1, 4) \
+	X(HEADER_HUMIDITY,    0x04, Humidity,    humidity,    float,    2, "humidity",    false, -20000,     -2, 1, 4) \
+	X(HEADER_LIGHT,       0x06, Light,       light,       uint16_t, 0, "light",       false, 0,          0,  1, 2) \
+	X(HEADER_LATITUDE,    0x07, Latitude,    latitude,    float,    6, "latitude",    true,  -200000000, -6, 1, 4) \
+	X(HEADER_LONGITUDE,   0x08, Longitude,   longitude,   float,    6, "longitude",   true,  -200000000, -6, 1, 4) \
+	X(HEADER_ALTITUDE,    0x05, Altitude,    altitude,    float,    2, "altitude",    true,  -20000,     -2, 1, 4) \
+	X(HEADER_CO2,         0x09, CO2,         co2,         float,    2, "co2",         false, -20000,     -2, 1, 4) \
+	X(HEADER_NOISE,       0x0A, Noise,       noise,       uint16_t, 0, "noise",       false, 0,          0,  1, 2) \
+	X(HEADER_AIR_QUALITY, 0x0B, AirQuality,  airQuality,  float,    2, "airQuality",  false, -20000,     -2, 1, 4)
+
+// Fields compiled in the libraries, as a bitmap with one bit per header (all by default).
+// The code of the other fields is removed at compile time, and their values are dropped.
+// Can be set with a build flag, e.g. -DPACKET_ENABLED_FIELDS=0x01FF.
+#ifndef PACKET_ENABLED_FIELDS
+#define PACKET_ENABLED_FIELDS 0x07FF
+#endif
+
+#endif
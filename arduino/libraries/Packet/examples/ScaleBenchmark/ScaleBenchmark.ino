@@ -0,0 +1,93 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Measures, with the ESP32 cycle counter, the cost of the float scaling
+ * of the payload encoder: former double-precision pow/round conversion
+ * against Packet::scaleFloat, and a full encoding of a batch.
+ * Results are printed on the serial port.
+ */
+
+#include <Packet.h>
+
+#define SERIAL_BAUD  115200
+#define N_VALUES     256
+#define N_RUNS       20
+#define INTERVAL     10
+#define MEASUREMENTS 8
+
+float values[N_VALUES];
+volatile int64_t sink;
+MeasurementStore store;
+
+/**
+ * Former conversion of the float values, in double precision.
+ * @param data: data value
+ * @param precision: number of decimal places
+ * @return: the scaled value
+ */
+int64_t scaleDouble(float data, uint8_t precision) {
+	double factor = pow(10.0, (double) precision);
+	return (int64_t) round(data*factor);
+}
+
+/**
+ * Measures the mean number of cycles of a scaling function.
+ * @param scale: scaling function
+ * @param precision: number of decimal places
+ * @return: mean number of cycles per conversion
+ */
+uint32_t measureScaling(int64_t (*scale)(float, uint8_t), uint8_t precision) {
+	uint32_t start = ESP.getCycleCount();
+	for (uint8_t r = 0; r < N_RUNS; r++) {
+		for (uint16_t i = 0; i < N_VALUES; i++)
+			sink = scale(values[i], precision);
+	}
+	return (ESP.getCycleCount() - start) / (N_RUNS * N_VALUES);
+}
+
+/**
+ * Measures the mean number of cycles to fill and encode a batch.
+ * @param version: packet format version
+ * @return: mean number of cycles per batch
+ */
+uint32_t measureEncoding(uint8_t version) {
+	Packet packet(INTERVAL, MEASUREMENTS, version);
+	packet.setMeasurementStore(&store);
+	packet.clearArray();
+	uint32_t start = ESP.getCycleCount();
+	for (uint8_t r = 0; r < N_RUNS; r++) {
+		for (uint8_t i = 0; i < MEASUREMENTS; i++) {
+			packet.addBattery(87 - i, i);
+			packet.addTemperature(values[i], i);
+			packet.addPressure(101325.42 - 3 * i, i);
+			packet.addHumidity(45.5 + 0.2 * i, i);
+			packet.addCO2(412.2 + i, i);
+			packet.addLatitude(50.668081, i);
+			packet.addLongitude(4.611562, i);
+		}
+		packet.buildLoraPayload();
+	}
+	return (ESP.getCycleCount() - start) / N_RUNS;
+}
+
+void setup() {
+	Serial.begin(SERIAL_BAUD);
+	for (uint16_t i = 0; i < N_VALUES; i++)
+		values[i] = -40.0 + i * 0.137;
+
+	Serial.printf("CPU frequency: %u MHz\n", getCpuFrequencyMhz());
+	for (uint8_t precision = 2; precision <= 6; precision += 4) {
+		Serial.printf("Precision %u: pow/round (double) %u cycles, Packet::scaleFloat %u cycles\n",
+			precision, measureScaling(scaleDouble, precision),
+			measureScaling(Packet::scaleFloat, precision));
+	}
+	for (uint8_t version = 3; version <= 5; version++) {
+		Serial.printf("Version %u, %u measurements: %u cycles per batch\n",
+			version, MEASUREMENTS, measureEncoding(version));
+	}
+}
+
+void loop() {
+}
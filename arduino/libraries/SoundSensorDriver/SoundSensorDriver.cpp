@@ -0,0 +1,70 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the KY-037 sound sensor (noise).
+ */
+
+#include "SoundSensorDriver.h"
+
+/**
+ * Constructor
+ * Creates the driver of a sound sensor on the specified ADC GPIO pin.
+ * @param gpio: ADC GPIO pin where the sound sensor is wired
+ * @param noiseThreshold: emergency threshold of the noise
+ */
+SoundSensorDriver::SoundSensorDriver(uint8_t gpio, int noiseThreshold) : _soundSensor(gpio)
+{
+	_connected = true;
+	setDefaultEmergency(HEADER_NOISE, noiseThreshold);
+}
+
+/**
+ * Retrieves the fields measured by the sensor.
+ * @return: presence bitmap of the fields
+ */
+uint16_t SoundSensorDriver::getFields()
+{
+	return PRESENCE_BIT(HEADER_NOISE);
+}
+
+/**
+ * Retrieves the acquisition task of the sensor.
+ * @return: ACQUISITION_ANALOG
+ */
+uint8_t SoundSensorDriver::getAcquisition()
+{
+	return ACQUISITION_ANALOG;
+}
+
+/**
+ * Checks if the sensor is available.
+ * @return: false if the sensor could not be read before, true otherwise
+ */
+bool SoundSensorDriver::warmup()
+{
+	return _connected;
+}
+
+/**
+ * Retrieves the noise value from the sound sensor.
+ * @param packet: packet in which the values are recorded
+ * @param index: index of the measurement
+ * @param location: location of the device
+ * @return: true if the value raises an emergency, false otherwise
+ */
+bool SoundSensorDriver::read(Packet* packet, uint8_t index, device_location_t* location)
+{
+	uint16_t noise = _soundSensor.readAnalogNoise();
+#if DEBUG
+	printValue("Noise", noise);
+#endif
+	if (noise == 0)
+	{
+		_connected = false;
+		return false;
+	}
+	packet->addNoise(noise, index);
+	return checkEmergency(HEADER_NOISE, noise, packet);
+}
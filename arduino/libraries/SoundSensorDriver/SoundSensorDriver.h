@@ -0,0 +1,33 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Sensor driver of the KY-037 sound sensor (noise).
+ */
+
+#ifndef SoundSensorDriver_h
+#define SoundSensorDriver_h
+
+#include "Arduino.h"
+#include "SoundSensor.h"
+#include "SensorDriver.h"
+
+/* SoundSensorDriver class */
+class SoundSensorDriver : public SensorDriver {
+
+	public:
+		SoundSensorDriver(uint8_t gpio, int noiseThreshold);
+
+		uint16_t getFields();
+		uint8_t getAcquisition();
+		bool warmup();
+		bool read(Packet* packet, uint8_t index, device_location_t* location);
+
+	private:
+		SoundSensor _soundSensor;
+		bool _connected;
+
+};
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Spill of the uplink store in the NVS flash of the ESP32.
+ * The uplinks are kept in a ring of NVS_SPILL_RECORDS blobs, whose head and count
+ * are saved with them. The flash is only written when the ring buffer in RTC memory
+ * is full, i.e. during the long outages of the network.
+ */
+
+#include "NvsSpill.h"
+
+/* No-arg constructor: spill not started */
+NvsSpill::NvsSpill() {
+	_started = false;
+	_head = 0;
+	_count = 0;
+}
+
+/**
+ * Opens the spill in the NVS flash, and reads its head and count.
+ * Must be called at each wake-up, before using the spill.
+ * @return: true if the NVS flash is available, false otherwise (the spill stays empty)
+ */
+bool NvsSpill::begin() {
+	_started = _preferences.begin(NVS_SPILL_NAMESPACE, false);
+	if (!_started)
+		return false;
+	_head = _preferences.getUShort("head", 0) % NVS_SPILL_RECORDS;
+	_count = _preferences.getUShort("count", 0);
+	if (_count > NVS_SPILL_RECORDS)
+		_count = 0;
+	return true;
+}
+
+/**
+ * Removes all the uplinks of the spill.
+ */
+void NvsSpill::clear() {
+	if (!_started)
+		return;
+	_preferences.clear();
+	_head = 0;
+	_count = 0;
+}
+
+/**
+ * Formats the key of the blob of a slot.
+ * @param slot: slot of the blob
+ * @param key: buffer receiving the key (NVS_SPILL_KEY_SIZE bytes)
+ */
+void NvsSpill::getKey(uint16_t slot, char* key) {
+	snprintf(key, NVS_SPILL_KEY_SIZE, "r%u", slot);
+}
+
+/**
+ * Saves the head and the count of the spill.
+ */
+void NvsSpill::save() {
+	_preferences.putUShort("head", _head);
+	_preferences.putUShort("count", _count);
+}
+
+/**
+ * Appends an uplink to the spill, dropping the oldest one if the spill is full.
+ * @param uplink: uplink to append
+ * @return: true if the uplink was appended without dropping another one, false otherwise
+ */
+bool NvsSpill::push(const stored_uplink_t* uplink) {
+	if (!_started)
+		return false;
+	bool lossless = true;
+	if (_count >= NVS_SPILL_RECORDS) {
+		_head = (_head + 1) % NVS_SPILL_RECORDS;
+		_count--;
+		lossless = false;
+	}
+	uint8_t blob[NVS_SPILL_HEADER_SIZE + STORE_PAYLOAD_MAX_SIZE];
+	blob[0] = uplink->port;
+	blob[1] = uplink->time >> 24;
+	blob[2] = uplink->time >> 16;
+	blob[3] = uplink->time >> 8;
+	blob[4] = uplink->time;
+	memcpy(blob + NVS_SPILL_HEADER_SIZE, uplink->payload, uplink->size);
+	char key[NVS_SPILL_KEY_SIZE];
+	getKey((_head + _count) % NVS_SPILL_RECORDS, key);
+	if (_preferences.putBytes(key, blob, NVS_SPILL_HEADER_SIZE + uplink->size) == 0)
+		return false;
+	_count++;
+	save();
+	return lossless;
+}
+
+/**
+ * Reads the oldest uplink of the spill.
+ * @param uplink: oldest uplink
+ * @return: true if the spill is not empty, false otherwise
+ */
+bool NvsSpill::peek(stored_uplink_t* uplink) {
+	if (!_started || _count == 0)
+		return false;
+	uint8_t blob[NVS_SPILL_HEADER_SIZE + STORE_PAYLOAD_MAX_SIZE];
+	char key[NVS_SPILL_KEY_SIZE];
+	getKey(_head, key);
+	size_t size = _preferences.getBytes(key, blob, sizeof(blob));
+	if (size < NVS_SPILL_HEADER_SIZE)
+		return false;
+	uplink->port = blob[0];
+	uplink->time = ((uint32_t) blob[1] << 24) | ((uint32_t) blob[2] << 16) | ((uint32_t) blob[3] << 8) | blob[4];
+	uplink->size = size - NVS_SPILL_HEADER_SIZE;
+	memcpy(uplink->payload, blob + NVS_SPILL_HEADER_SIZE, uplink->size);
+	return true;
+}
+
+/**
+ * Removes the oldest uplink of the spill.
+ */
+void NvsSpill::drop() {
+	if (!_started || _count == 0)
+		return;
+	char key[NVS_SPILL_KEY_SIZE];
+	getKey(_head, key);
+	_preferences.remove(key);
+	_head = (_head + 1) % NVS_SPILL_RECORDS;
+	_count--;
+	save();
+}
+
+/**
+ * Retrieves the number of uplinks in the spill.
+ * @return: the number of uplinks
+ */
+uint16_t NvsSpill::getCount() {
+	return _count;
+}
@@ -0,0 +1,52 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Spill of the uplink store in the NVS flash of the ESP32 (Preferences library),
+ * receiving the oldest uplinks when the ring buffer in RTC memory is full.
+ */
+
+#ifndef NvsSpill_h
+#define NvsSpill_h
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "StoreForward.h"
+
+// Namespace of the spill in the NVS flash
+#define NVS_SPILL_NAMESPACE "storefwd"
+// Maximum number of uplinks in the NVS flash, one blob per uplink
+#define NVS_SPILL_RECORDS 32
+// Header of a blob: port, and time of the last measurement of the payload (4 bytes)
+#define NVS_SPILL_HEADER_SIZE 5
+// Size of the key of a blob: "r" and its slot
+#define NVS_SPILL_KEY_SIZE 8
+
+/* NvsSpill class */
+class NvsSpill : public UplinkSpill {
+
+	public:
+		NvsSpill();
+
+		bool begin();
+		void clear();
+
+		bool push(const stored_uplink_t* uplink);
+		bool peek(stored_uplink_t* uplink);
+		void drop();
+		uint16_t getCount();
+
+	private:
+		Preferences _preferences;
+		bool _started;
+		// Slot of the oldest uplink, and number of uplinks
+		uint16_t _head;
+		uint16_t _count;
+
+		void getKey(uint16_t slot, char* key);
+		void save();
+
+};
+
+#endif
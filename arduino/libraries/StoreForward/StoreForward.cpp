@@ -0,0 +1,164 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Store-and-forward of the LoRaWAN uplinks of the ESP32 devices.
+ * Each uplink is pushed before its transmission, and dropped once acknowledged,
+ * so that the uplinks lost during an outage of the gateways are kept,
+ * oldest first, until they can be sent again.
+ * The records are written in the ring buffer byte per byte, wrapping around its end:
+ * payload size, port, time of the last measurement (big endian), then the payload.
+ */
+
+#include "StoreForward.h"
+
+/* No-arg constructor: store without spill */
+UplinkStore::UplinkStore() {
+	_spill = NULL;
+}
+
+/**
+ * Sets the slower storage receiving the oldest uplinks when the ring buffer is full.
+ * @param spill: storage of the spilled uplinks, or NULL to drop them
+ */
+void UplinkStore::setSpill(UplinkSpill* spill) {
+	_spill = spill;
+}
+
+/**
+ * Reads a record of the ring buffer.
+ * @param ring: ring buffer
+ * @param offset: offset of the record
+ * @param uplink: uplink of the record
+ */
+void UplinkStore::readRecord(const uplink_ring_t* ring, uint16_t offset, stored_uplink_t* uplink) {
+	uint8_t header[STORE_RECORD_HEADER_SIZE];
+	for (uint8_t i = 0; i < STORE_RECORD_HEADER_SIZE; i++)
+		header[i] = ring->data[(offset + i) % STORE_RTC_SIZE];
+	uplink->size = header[0];
+	uplink->port = header[1];
+	uplink->time = ((uint32_t) header[2] << 24) | ((uint32_t) header[3] << 16) |
+	               ((uint32_t) header[4] << 8) | header[5];
+	offset += STORE_RECORD_HEADER_SIZE;
+	for (uint8_t i = 0; i < uplink->size; i++)
+		uplink->payload[i] = ring->data[(offset + i) % STORE_RTC_SIZE];
+}
+
+/**
+ * Removes the oldest record of the ring buffer.
+ * @param ring: ring buffer, not empty
+ */
+void UplinkStore::popRecord(uplink_ring_t* ring) {
+	if (ring->newestValid && ring->newest == ring->head)
+		ring->newestValid = false;
+	uint16_t size = STORE_RECORD_HEADER_SIZE + ring->data[ring->head];
+	ring->head = (ring->head + size) % STORE_RTC_SIZE;
+	ring->used -= size;
+	ring->count--;
+}
+
+/**
+ * Appends an uplink to the store. If the ring buffer is full, its oldest uplinks
+ * are moved to the spill, or dropped without spill.
+ * @param ring: ring buffer, updated
+ * @param uplink: uplink to store
+ * @return: true if the uplink was stored without dropping any other, false otherwise
+ */
+bool UplinkStore::push(uplink_ring_t* ring, const stored_uplink_t* uplink) {
+	if (uplink->size > STORE_PAYLOAD_MAX_SIZE) {
+		ring->dropped++;
+		return false;
+	}
+	uint16_t size = STORE_RECORD_HEADER_SIZE + uplink->size;
+	bool lossless = true;
+	while (ring->count > 0 && ring->used + size > STORE_RTC_SIZE) {
+		stored_uplink_t oldest;
+		readRecord(ring, ring->head, &oldest);
+		if (_spill == NULL || !_spill->push(&oldest)) {
+			ring->dropped++;
+			lossless = false;
+		}
+		popRecord(ring);
+	}
+	uint16_t offset = (ring->head + ring->used) % STORE_RTC_SIZE;
+	uint8_t header[STORE_RECORD_HEADER_SIZE] = {
+		uplink->size, uplink->port,
+		(uint8_t) (uplink->time >> 24), (uint8_t) (uplink->time >> 16),
+		(uint8_t) (uplink->time >> 8), (uint8_t) uplink->time
+	};
+	for (uint8_t i = 0; i < STORE_RECORD_HEADER_SIZE; i++)
+		ring->data[(offset + i) % STORE_RTC_SIZE] = header[i];
+	for (uint8_t i = 0; i < uplink->size; i++)
+		ring->data[(offset + STORE_RECORD_HEADER_SIZE + i) % STORE_RTC_SIZE] = uplink->payload[i];
+	ring->used += size;
+	ring->count++;
+	ring->newest = offset;
+	ring->newestValid = true;
+	return lossless;
+}
+
+/**
+ * Reads the oldest uplink of the store, from the spill first.
+ * The uplinks that cannot be read from the spill are dropped.
+ * @param ring: ring buffer, updated if uplinks are dropped
+ * @param uplink: oldest uplink
+ * @return: true if the store is not empty, false otherwise
+ */
+bool UplinkStore::peekOldest(uplink_ring_t* ring, stored_uplink_t* uplink) {
+	while (_spill != NULL && _spill->getCount() > 0) {
+		if (_spill->peek(uplink))
+			return true;
+		_spill->drop();
+		ring->dropped++;
+	}
+	if (ring->count == 0)
+		return false;
+	readRecord(ring, ring->head, uplink);
+	return true;
+}
+
+/**
+ * Removes the oldest uplink of the store, once acknowledged.
+ * @param ring: ring buffer, updated
+ */
+void UplinkStore::dropOldest(uplink_ring_t* ring) {
+	if (_spill != NULL && _spill->getCount() > 0)
+		_spill->drop();
+	else if (ring->count > 0)
+		popRecord(ring);
+}
+
+/**
+ * Removes the last uplinks pushed to the store, once acknowledged, from the ring buffer:
+ * the uplinks already moved to the spill are kept.
+ * Does nothing if the last uplink was already removed.
+ * @param ring: ring buffer, updated
+ * @param count: number of uplinks to remove, the last one and the ones pushed before it
+ */
+void UplinkStore::dropNewest(uplink_ring_t* ring, uint8_t count) {
+	if (!ring->newestValid)
+		return;
+	if (count == 1) {
+		ring->used -= STORE_RECORD_HEADER_SIZE + ring->data[ring->newest];
+		ring->count--;
+	} else {
+		// The records are only linked from the oldest one
+		uint8_t kept = count < ring->count ? ring->count - count : 0;
+		uint16_t used = 0;
+		for (uint8_t i = 0; i < kept; i++)
+			used += STORE_RECORD_HEADER_SIZE + ring->data[(ring->head + used) % STORE_RTC_SIZE];
+		ring->used = used;
+		ring->count = kept;
+	}
+	ring->newestValid = false;
+}
+
+/**
+ * Retrieves the number of uplinks in the store.
+ * @param ring: ring buffer
+ * @return: the number of uplinks, in the ring buffer and in the spill
+ */
+uint16_t UplinkStore::getCount(uplink_ring_t* ring) {
+	return ring->count + (_spill != NULL ? _spill->getCount() : 0);
+}
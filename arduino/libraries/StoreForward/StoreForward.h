@@ -0,0 +1,87 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Store-and-forward of the LoRaWAN uplinks of the ESP32 devices:
+ * ring buffer of the uplinks not acknowledged yet, in RTC memory,
+ * spilling its oldest uplinks to a slower storage (the NVS flash) when it is full.
+ */
+
+#ifndef StoreForward_h
+#define StoreForward_h
+
+#include <Arduino.h>
+
+// Size of the ring buffer in RTC memory (in bytes)
+#define STORE_RTC_SIZE 1024
+// Maximum size of a stored payload (in bytes)
+#define STORE_PAYLOAD_MAX_SIZE 222
+// Header of a record in the ring buffer: payload size, port,
+// and time of the last measurement of the payload (4 bytes)
+#define STORE_RECORD_HEADER_SIZE 6
+
+// Uplink kept until it is acknowledged
+typedef struct storedUplink {
+	// LoRaWAN port of the uplink
+	uint8_t port;
+	// Time of the last measurement of the payload (in s, on the clock of the device)
+	uint32_t time;
+	uint8_t size;
+	uint8_t payload[STORE_PAYLOAD_MAX_SIZE];
+} stored_uplink_t;
+
+// Ring buffer of records, meant to be kept in RTC memory between the wake-ups.
+// Zeroed memory is an empty ring buffer.
+typedef struct uplinkRing {
+	// Offset of the oldest record, and number of bytes used by the records
+	uint16_t head;
+	uint16_t used;
+	// Number of records, and offset of the newest one (valid if newestValid)
+	uint8_t count;
+	uint16_t newest;
+	bool newestValid;
+	// Uplinks dropped because the storage was full
+	uint16_t dropped;
+	uint8_t data[STORE_RTC_SIZE];
+} uplink_ring_t;
+
+/* Slower storage of the uplinks, receiving the oldest ones when the ring buffer is full */
+class UplinkSpill {
+
+	public:
+		virtual ~UplinkSpill() {}
+
+		// Appends an uplink, dropping the oldest one if the storage is full
+		virtual bool push(const stored_uplink_t* uplink) = 0;
+		// Reads the oldest uplink
+		virtual bool peek(stored_uplink_t* uplink) = 0;
+		// Removes the oldest uplink
+		virtual void drop() = 0;
+		virtual uint16_t getCount() = 0;
+
+};
+
+/* UplinkStore class */
+class UplinkStore {
+
+	public:
+		UplinkStore();
+
+		void setSpill(UplinkSpill* spill);
+
+		bool push(uplink_ring_t* ring, const stored_uplink_t* uplink);
+		bool peekOldest(uplink_ring_t* ring, stored_uplink_t* uplink);
+		void dropOldest(uplink_ring_t* ring);
+		void dropNewest(uplink_ring_t* ring, uint8_t count = 1);
+		uint16_t getCount(uplink_ring_t* ring);
+
+	private:
+		UplinkSpill* _spill;
+
+		void readRecord(const uplink_ring_t* ring, uint16_t offset, stored_uplink_t* uplink);
+		void popRecord(uplink_ring_t* ring);
+
+};
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Profiler of the phases of the wake cycles, meant to be kept in RTC memory,
+ * with a compact summary to uplink on its own LoRaWAN port.
+ * The phases are timed with the cycle counter of the CPU, so a phase must start
+ * and stop on the same core. Zeroed memory is an empty profiler.
+ */
+
+#include "WakeProfiler.h"
+
+/**
+ * CONSTRUCTOR
+ * Does not touch the statistics, as it runs at every wake-up,
+ * while the statistics must persist in RTC memory during deep sleep.
+ */
+WakeProfiler::WakeProfiler() {}
+
+/**
+ * Starts measuring a phase.
+ * @return: the start of the phase
+ */
+profile_timer_t WakeProfiler::start() {
+	profile_timer_t timer;
+#ifdef ESP32
+	timer.cycles = ESP.getCycleCount();
+#else
+	timer.cycles = micros();
+#endif
+	timer.millis = millis();
+	return timer;
+}
+
+/**
+ * Computes the time elapsed since the start of a phase.
+ * @param timer: start of the phase
+ * @return: the elapsed time (in microseconds)
+ */
+uint32_t WakeProfiler::elapsed(const profile_timer_t* timer) {
+	uint32_t ms = millis() - timer->millis;
+	if (ms > PROFILE_CYCLES_MAX_MS)
+		return ms * 1000;
+#ifdef ESP32
+	return (ESP.getCycleCount() - timer->cycles) / ESP.getCpuFreqMHz();
+#else
+	return micros() - timer->cycles;
+#endif
+}
+
+/**
+ * Records the duration of a phase.
+ * @param phase: phase of the wake cycle (PROFILE_SETUP, ...)
+ * @param duration: duration of the phase (in microseconds)
+ */
+void WakeProfiler::record(uint8_t phase, uint32_t duration) {
+	if (phase >= PROFILE_PHASES)
+		return;
+	phase_profile_t* profile = _phases + phase;
+	if (profile->count == UINT16_MAX)
+		return;
+	profile->count++;
+	profile->total += duration;
+	if (duration > profile->max)
+		profile->max = duration;
+	uint8_t bucket = 0;
+	uint32_t bound = PROFILE_BUCKET_BASE_US;
+	while (bucket < PROFILE_BUCKETS - 1 && duration >= bound) {
+		bucket++;
+		bound *= 4;
+	}
+	if (profile->histogram[bucket] < UINT16_MAX)
+		profile->histogram[bucket]++;
+}
+
+/**
+ * Records the duration of a phase, from its start to now.
+ * @param phase: phase of the wake cycle (PROFILE_SETUP, ...)
+ * @param timer: start of the phase
+ */
+void WakeProfiler::stop(uint8_t phase, const profile_timer_t* timer) {
+	record(phase, elapsed(timer));
+}
+
+/**
+ * Counts the end of a wake cycle.
+ */
+void WakeProfiler::endCycle() {
+	if (_cycles < UINT16_MAX)
+		_cycles++;
+}
+
+/**
+ * Clears the statistics of all the phases, and the number of wake cycles.
+ */
+void WakeProfiler::clear() {
+	_cycles = 0;
+	_nextPhase = 0;
+	memset(_phases, 0, sizeof(_phases));
+}
+
+/**
+ * Retrieves the number of wake cycles since the previous summary.
+ * @return: the number of wake cycles
+ */
+uint16_t WakeProfiler::getCycles() {
+	return _cycles;
+}
+
+/**
+ * Retrieves the number of durations recorded for a phase.
+ * @param phase: phase of the wake cycle
+ * @return: the number of durations, 0 if the phase is invalid
+ */
+uint16_t WakeProfiler::getCount(uint8_t phase) {
+	if (phase >= PROFILE_PHASES)
+		return 0;
+	return _phases[phase].count;
+}
+
+/**
+ * Retrieves the mean duration of a phase.
+ * @param phase: phase of the wake cycle
+ * @return: the mean duration (in microseconds), 0 if the phase has no durations
+ */
+uint32_t WakeProfiler::getMean(uint8_t phase) {
+	if (getCount(phase) == 0)
+		return 0;
+	return _phases[phase].total / _phases[phase].count;
+}
+
+/**
+ * Retrieves the maximum duration of a phase.
+ * @param phase: phase of the wake cycle
+ * @return: the maximum duration (in microseconds), 0 if the phase has no durations
+ */
+uint32_t WakeProfiler::getMax(uint8_t phase) {
+	if (getCount(phase) == 0)
+		return 0;
+	return _phases[phase].max;
+}
+
+/**
+ * Retrieves the number of durations of a phase in a bucket of the histogram.
+ * @param phase: phase of the wake cycle
+ * @param bucket: index of the bucket
+ * @return: the number of durations in the bucket
+ */
+uint16_t WakeProfiler::getBucket(uint8_t phase, uint8_t bucket) {
+	if (phase >= PROFILE_PHASES || bucket >= PROFILE_BUCKETS)
+		return 0;
+	return _phases[phase].histogram[bucket];
+}
+
+/**
+ * Checks if no duration is recorded.
+ * @return: true if no phase has durations, false otherwise
+ */
+bool WakeProfiler::isEmpty() {
+	for (uint8_t phase = 0; phase < PROFILE_PHASES; phase++) {
+		if (_phases[phase].count > 0)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Writes a varint, i.e. 7 bits per byte, least significant first,
+ * with the most significant bit set on all bytes but the last.
+ * @param payload: pointer to the buffer receiving the varint
+ * @param data: value of the varint
+ * @return: the size of the varint (in bytes)
+ */
+uint8_t WakeProfiler::writeVarint(uint8_t* payload, uint32_t data) {
+	uint8_t size = 0;
+	do {
+		payload[size] = (data & 0x7F) | (data > 0x7F ? 0x80 : 0);
+		data >>= 7;
+		size++;
+	} while (data > 0);
+	return size;
+}
+
+/**
+ * Writes the statistics of a phase in a summary:
+ * count, mean and maximum as varints, then the histogram.
+ * @param payload: pointer to the buffer receiving the statistics,
+ *                 of at least PROFILE_RECORD_MAX_SIZE bytes
+ * @param phase: phase of the wake cycle
+ * @return: the size of the statistics (in bytes)
+ */
+uint8_t WakeProfiler::writePhase(uint8_t* payload, uint8_t phase) {
+	phase_profile_t* profile = _phases + phase;
+	uint8_t size = writeVarint(payload, profile->count);
+	size += writeVarint(payload + size, getMean(phase));
+	size += writeVarint(payload + size, profile->max);
+	for (uint8_t bucket = 0; bucket < PROFILE_BUCKETS; bucket += 2) {
+		uint8_t high = profile->histogram[bucket] < 15 ? profile->histogram[bucket] : 15;
+		uint8_t low = profile->histogram[bucket + 1] < 15 ? profile->histogram[bucket + 1] : 15;
+		payload[size++] = (high << 4) | low;
+	}
+	return size;
+}
+
+/**
+ * Builds the summary of the profiled phases, in a buffer provided by the caller.
+ * The phases fitting in the buffer are selected in turn, from the one following
+ * the last phase of the previous summary, and written in the order of their index.
+ * Their statistics are cleared, the other phases are kept for the next summary.
+ * @param payload: pointer to the start of the summary
+ * @param capacity: size of the buffer (in bytes)
+ * @return: the size of the summary, or 0 if no phase fits in the buffer
+ */
+uint8_t WakeProfiler::buildSummary(uint8_t* payload, uint8_t capacity) {
+	if (capacity < PROFILE_SUMMARY_HEADER_SIZE)
+		return 0;
+	// Selection of the phases
+	uint8_t record[PROFILE_RECORD_MAX_SIZE];
+	uint16_t size = PROFILE_SUMMARY_HEADER_SIZE;
+	uint16_t bitmap = 0;
+	uint8_t first = _nextPhase < PROFILE_PHASES ? _nextPhase : 0;
+	for (uint8_t i = 0; i < PROFILE_PHASES; i++) {
+		uint8_t phase = (first + i) % PROFILE_PHASES;
+		if (_phases[phase].count == 0)
+			continue;
+		uint8_t recordSize = writePhase(record, phase);
+		if (size + recordSize > capacity)
+			break;
+		size += recordSize;
+		bitmap |= (uint16_t) 1 << phase;
+		_nextPhase = (phase + 1) % PROFILE_PHASES;
+	}
+	if (bitmap == 0)
+		return 0;
+
+	// Summary, in the order of the phases
+	payload[0] = PROFILE_SUMMARY_VERSION;
+	payload[1] = _cycles < UINT8_MAX ? _cycles : UINT8_MAX;
+	payload[2] = bitmap >> 8;
+	payload[3] = bitmap & 0xFF;
+	size = PROFILE_SUMMARY_HEADER_SIZE;
+	for (uint8_t phase = 0; phase < PROFILE_PHASES; phase++) {
+		if (!(bitmap & ((uint16_t) 1 << phase)))
+			continue;
+		size += writePhase(payload + size, phase);
+		memset(_phases + phase, 0, sizeof(phase_profile_t));
+	}
+	_cycles = 0;
+	return size;
+}
@@ -0,0 +1,92 @@
+/**
+ * Louvain-la-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Profiler of the phases of the wake cycles, meant to be kept in RTC memory,
+ * with a compact summary to uplink on its own LoRaWAN port.
+ */
+
+#ifndef WakeProfiler_h
+#define WakeProfiler_h
+
+#include <Arduino.h>
+
+// Phases of a wake cycle
+#define PROFILE_SETUP       0
+#define PROFILE_JOIN        1
+#define PROFILE_ACQUISITION 2
+#define PROFILE_WARMUP      3
+#define PROFILE_BUILD       4
+#define PROFILE_LORA_TX     5
+#define PROFILE_RX_WINDOWS  6
+#define PROFILE_WIFI        7
+// Reading of a sensor: PROFILE_READ + index of the sensor
+#define PROFILE_READ        8
+#define PROFILE_MAX_SENSORS 8
+#define PROFILE_PHASES      (PROFILE_READ + PROFILE_MAX_SENSORS)
+// Histogram of the durations: the upper bound of the first bucket is
+// PROFILE_BUCKET_BASE_US, multiplied by 4 for each bucket, the last one is unbounded
+#define PROFILE_BUCKETS        8
+#define PROFILE_BUCKET_BASE_US 1000
+// Durations longer than this are measured with millis, as the cycle counter wraps around
+// after 17 seconds at 240 MHz
+#define PROFILE_CYCLES_MAX_MS 10000
+// Summary: version, number of wake cycles since the previous summary, bitmap of the
+// phases (2 bytes), then for each phase of the bitmap: count, mean and maximum
+// (in microseconds) as varints, and the histogram, one count per nibble, saturated at 15
+#define PROFILE_SUMMARY_VERSION     1
+#define PROFILE_SUMMARY_HEADER_SIZE 4
+#define PROFILE_HISTOGRAM_SIZE      (PROFILE_BUCKETS / 2)
+#define PROFILE_VARINT_MAX_SIZE     5
+#define PROFILE_RECORD_MAX_SIZE     (3 * PROFILE_VARINT_MAX_SIZE + PROFILE_HISTOGRAM_SIZE)
+
+// Statistics of the durations of a phase (in microseconds)
+typedef struct phaseProfile {
+	uint16_t count;
+	uint32_t max;
+	uint64_t total;
+	uint16_t histogram[PROFILE_BUCKETS];
+} phase_profile_t;
+
+// Start of a measured phase
+typedef struct profileTimer {
+	uint32_t cycles;
+	uint32_t millis;
+} profile_timer_t;
+
+/* WakeProfiler class */
+class WakeProfiler {
+
+	public:
+		WakeProfiler();
+
+		static profile_timer_t start();
+		static uint32_t elapsed(const profile_timer_t* timer);
+
+		void record(uint8_t phase, uint32_t duration);
+		void stop(uint8_t phase, const profile_timer_t* timer);
+		void endCycle();
+		void clear();
+
+		uint16_t getCycles();
+		uint16_t getCount(uint8_t phase);
+		uint32_t getMean(uint8_t phase);
+		uint32_t getMax(uint8_t phase);
+		uint16_t getBucket(uint8_t phase, uint8_t bucket);
+		bool isEmpty();
+
+		uint8_t buildSummary(uint8_t* payload, uint8_t capacity);
+
+	private:
+		uint16_t _cycles;
+		// First phase of the next summary, so that all the phases are sent in turn
+		uint8_t _nextPhase;
+		phase_profile_t _phases[PROFILE_PHASES];
+
+		static uint8_t writeVarint(uint8_t* payload, uint32_t data);
+		uint8_t writePhase(uint8_t* payload, uint8_t phase);
+
+};
+
+#endif
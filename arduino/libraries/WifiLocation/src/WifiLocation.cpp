@@ -62,7 +62,10 @@ void WifiLocation::setKey(String googleKey) {
 String WifiLocation::getSurroundingWiFiJson() {
     String wifiArray = "[\n";
 
-    int8_t numWifi = WiFi.scanNetworks();
+    // Results of a previous scan, if any
+    int16_t numWifi = WiFi.scanComplete();
+    if (numWifi < 0)
+        numWifi = WiFi.scanNetworks();
     if(numWifi > MAX_WIFI_SCAN) {
         numWifi = MAX_WIFI_SCAN;
     }
@@ -126,11 +129,20 @@ void setClock () {
 
 // Calls Google Location API to get current location using surrounding WiFi signals inf
 location_t WifiLocation::getGeoFromWiFi() {
+    String body = "{\"wifiAccessPoints\":" + getSurroundingWiFiJson() + "}";
+    return getGeoFromWiFi(body.c_str(), body.length());
+}
+
+// Calls Google Location API with a request body already written by the caller
+// ({"wifiAccessPoints":[...]}), sent as is without building the request in a String
+location_t WifiLocation::getGeoFromWiFi(const char* body, size_t size) {
 
     location_t location;
     String response = "";
 #if defined ARDUINO_ARCH_ESP8266 || defined ARDUINO_ARCH_ESP32
-	setClock ();
+	// The system time of the ESP32 is kept across deep sleep: sync it only once
+	if (time (nullptr) < 8 * 3600 * 2)
+		setClock ();
 #ifdef ARDUINO_ARCH_ESP8266
 #if (defined BR_BEARSSL_H__ && not defined USE_CORE_PRE_2_5_0)
 	BearSSL::X509List cert (GlobalSignCA);
@@ -154,25 +166,33 @@ location_t WifiLocation::getGeoFromWiFi() {
         return location;
     }
 
-    String body = "{\"wifiAccessPoints\":" + getSurroundingWiFiJson() + "}";
 #ifdef DEBUG_WIFI_LOCATION
     Serial.println("requesting URL: " + String(googleApiUrl) + "?key=" + _googleApiKey);
 #endif // DEBUG_WIFI_LOCATION
-    String request = String("POST ") + String(googleApiUrl);
-    if (_googleApiKey != "")
-        request += "?key=" + _googleApiKey;
-    request += " HTTP/1.1\r\n";
-    request += "Host: " + String(googleApisHost) + "\r\n";
-    request += "User-Agent: ESP8266\r\n";
-    request += "Content-Type:application/json\r\n";
-    request += "Content-Length:" + String(body.length()) + "\r\n";
-    request += "Connection: close\r\n\r\n";
-    request += body;
-#ifdef DEBUG_WIFI_LOCATION
-    Serial.println("request: \n" + request);
+    // Headers written at once, each write being a TLS record
+    char header[MAX_HEADER_SIZE];
+    int headerSize = snprintf(header, sizeof(header),
+        "POST %s%s%s HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "User-Agent: ESP8266\r\n"
+        "Content-Type:application/json\r\n"
+        "Content-Length:%u\r\n"
+        "Connection: close\r\n\r\n",
+        googleApiUrl, _googleApiKey != "" ? "?key=" : "", _googleApiKey.c_str(),
+        googleApisHost, (unsigned int) size);
+    if (headerSize < 0 || headerSize >= (int) sizeof(header)) {
+        _client.stop();
+        return location;
+    }
+#ifdef DEBUG_WIFI_LOCATION
+    Serial.print("request: \n");
+    Serial.print(header);
+    Serial.write((const uint8_t*) body, size);
+    Serial.println();
 #endif // DEBUG_WIFI_LOCATION
 
-    _client.println(request);
+    _client.write((const uint8_t*) header, headerSize);
+    _client.write((const uint8_t*) body, size);
 #ifdef DEBUG_WIFI_LOCATION
     Serial.println("request sent");
     Serial.print("Free heap: ");
@@ -25,6 +25,7 @@
 
 #define MAX_CONNECTION_TIMEOUT 5000
 #define MAX_WIFI_SCAN 127
+#define MAX_HEADER_SIZE 256
 
 typedef struct {
     float lat = 0;
@@ -37,6 +38,7 @@ public:
     WifiLocation(String googleKey = "");
     void setKey(String googleKey);
     location_t getGeoFromWiFi();
+    location_t getGeoFromWiFi(const char* body, size_t size);
     static String getSurroundingWiFiJson();
 
 protected:
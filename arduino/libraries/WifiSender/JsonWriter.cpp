@@ -0,0 +1,81 @@
+/*
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Streaming writer of JSON documents into a fixed buffer, without heap allocation.
+ */
+
+#include <stdio.h>
+#include "JsonWriter.h"
+
+/**
+ * Constructor.
+ * @param buffer: buffer of the document, NULL to count its size only
+ * @param capacity: size of the buffer, terminating null character included
+ */
+JsonWriter::JsonWriter(char* buffer, size_t capacity) {
+	_buffer = buffer;
+	_capacity = capacity;
+	_size = 0;
+	if (_buffer != NULL && _capacity > 0)
+		_buffer[0] = '\0';
+}
+
+/**
+ * Appends bytes to the document. The bytes beyond the capacity of the buffer
+ * are counted, but not written.
+ * @param bytes: bytes to append
+ * @param size: number of bytes
+ */
+void JsonWriter::writeBytes(const char* bytes, size_t size) {
+	if (_buffer != NULL && _size + size < _capacity) {
+		memcpy(_buffer + _size, bytes, size);
+		_buffer[_size + size] = '\0';
+	}
+	_size += size;
+}
+
+/**
+ * Appends a string to the document, as is.
+ * @param str: null-terminated string
+ */
+void JsonWriter::write(const char* str) {
+	writeBytes(str, strlen(str));
+}
+
+/**
+ * Appends a float to the document, with 2 decimals like String(float).
+ * @param value: value to append
+ */
+void JsonWriter::writeFloat(float value) {
+	char number[JSON_NUMBER_SIZE];
+	int size = snprintf(number, JSON_NUMBER_SIZE, "%.2f", value);
+	writeBytes(number, size < JSON_NUMBER_SIZE ? size : JSON_NUMBER_SIZE - 1);
+}
+
+/**
+ * Appends an int to the document.
+ * @param value: value to append
+ */
+void JsonWriter::writeInt(int32_t value) {
+	char number[JSON_NUMBER_SIZE];
+	int size = snprintf(number, JSON_NUMBER_SIZE, "%ld", (long) value);
+	writeBytes(number, size);
+}
+
+/**
+ * Retrieves the size of the document.
+ * @return: the size of the document, terminating null character excluded
+ */
+size_t JsonWriter::getSize() {
+	return _size;
+}
+
+/**
+ * Checks if the whole document was written in the buffer.
+ * @return: true if the document fits in the buffer, false otherwise
+ */
+bool JsonWriter::fits() {
+	return _buffer != NULL && _size < _capacity;
+}
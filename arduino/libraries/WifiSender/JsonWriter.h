@@ -0,0 +1,39 @@
+/*
+ * Louvain-La-Neuve: a smart city
+ * DE KEERSMAEKER François
+ * VAN DE WALLE Nicolas
+ *
+ * Streaming writer of JSON documents into a fixed buffer, without heap allocation.
+ * Without buffer, the writer only counts the size of the document,
+ * so that it is known before the document is written.
+ */
+
+#ifndef JsonWriter_h
+#define JsonWriter_h
+
+#include "Arduino.h"
+
+// Maximum size of a number written by the writer (largest float with 2 decimals)
+#define JSON_NUMBER_SIZE 48
+
+class JsonWriter {
+
+	public:
+		JsonWriter(char* buffer = NULL, size_t capacity = 0);
+		void write(const char* str);
+		void writeFloat(float value);
+		void writeInt(int32_t value);
+		size_t getSize();
+		bool fits();
+
+	private:
+		// Buffer of the document, NULL to count its size only
+		char* _buffer;
+		size_t _capacity;
+		// Size of the document, written or not
+		size_t _size;
+
+		void writeBytes(const char* bytes, size_t size);
+};
+
+#endif
@@ -9,8 +9,19 @@
 #include "Arduino.h"
 #include "WifiSender.h"
 
+// Connection cache, invalid after a cold boot
+RTC_DATA_ATTR wifi_cache_t _wifiCache = {false};
+
 // No-arg constructor
-WifiSender::WifiSender() {}
+WifiSender::WifiSender() {
+	_staticIp = false;
+	_locationCacheLoaded = false;
+	_passiveScan = false;
+	_seenChannelsScan = false;
+	_scanChannelTime = WIFI_SCAN_CHANNEL_MS;
+	_accessPointCount = 0;
+	_scanChannels = 0;
+}
 
 // Constructor
 WifiSender::WifiSender(const char* ssid,
@@ -19,6 +30,13 @@ WifiSender::WifiSender(const char* ssid,
 											 const char* urlInflux,
 											 const char* token,
 											 String devEUI) {
+	_staticIp = false;
+	_locationCacheLoaded = false;
+	_passiveScan = false;
+	_seenChannelsScan = false;
+	_scanChannelTime = WIFI_SCAN_CHANNEL_MS;
+	_accessPointCount = 0;
+	_scanChannels = 0;
 	init(ssid, password, googleKey, urlInflux, token, devEUI);
 }
 
@@ -37,27 +55,116 @@ void WifiSender::init(const char* ssid,
 	_urlInflux = urlInflux;
 	_token = token;
 	_devEUI = devEUI;
-	_timestamp = -1;
-	resetJson();
+}
+
+/**
+ * Sets the scans of the access points for the geolocation.
+ * @param passive: true to listen to the beacons of the access points, false to probe them
+ * @param seenChannels: true to scan only the channels of the access points seen
+ *                      by the last full scan, false to scan all the channels
+ * @param channelTime: time of the scan per channel (in ms)
+ */
+void WifiSender::setScan(bool passive, bool seenChannels, uint16_t channelTime) {
+	_passiveScan = passive;
+	_seenChannelsScan = seenChannels;
+	_scanChannelTime = channelTime;
+}
+
+/**
+ * Sets a static IP configuration, used instead of DHCP.
+ * @param ip: IP address of the device
+ * @param gateway: IP address of the gateway
+ * @param subnet: subnet mask
+ * @param dns: IP address of the DNS server
+ * @return: true if the addresses are valid, false otherwise (DHCP is kept)
+ */
+bool WifiSender::setStaticIp(const char* ip, const char* gateway, const char* subnet, const char* dns) {
+	_staticIp = _ip.fromString(ip) && _gateway.fromString(gateway) &&
+	            _subnet.fromString(subnet) && _dns.fromString(dns);
+	return _staticIp;
+}
+
+/**
+ * Invalidates the connection cache: the next connection scans for the access point.
+ */
+void WifiSender::clearCache() {
+	_wifiCache.valid = false;
 }
 
 /*
  * Connects to a WiFi access point, with the ssid and password attributes.
+ * Goes straight to the access point of the last connection, without scan nor DHCP,
+ * and falls back to the full scan if it cannot be reached.
  * @returns: true if successfully connected, false otherwise
  */
 bool WifiSender::connect() {
 	WiFi.mode(WIFI_STA);
+	if (_wifiCache.valid) {
+		if (connectCached())
+			return true;
+		// Access point moved or replaced
+		clearCache();
+		WiFi.disconnect();
+	}
+
+	// Static IP configuration, or DHCP with null addresses
+	if (_staticIp)
+		WiFi.config(_ip, _gateway, _subnet, _dns);
+	else
+		WiFi.config(IPAddress(), IPAddress(), IPAddress());
 	WiFi.begin(_ssid, _password);
 
 	// Try to connect to WiFi with a timeout
+	if (!waitConnection(WIFI_TIMEOUT_SEC * 1000))
+		return false;
+	saveCache();
+	return true;
+}
+
+/**
+ * Connects to the access point of the connection cache, on its channel,
+ * with the IP configuration of the last connection.
+ * @return: true if successfully connected, false otherwise
+ */
+bool WifiSender::connectCached() {
+	WiFi.config(IPAddress(_wifiCache.ip), IPAddress(_wifiCache.gateway),
+	            IPAddress(_wifiCache.subnet), IPAddress(_wifiCache.dns));
+	WiFi.begin(_ssid, _password, _wifiCache.channel, _wifiCache.bssid);
+	return waitConnection(WIFI_FAST_TIMEOUT_MS);
+}
+
+/**
+ * Waits for the connection to the access point, until it fails, the access point
+ * is not found, or the timeout expires.
+ * @param timeout: timeout of the connection (in ms)
+ * @return: true if connected, false otherwise
+ */
+bool WifiSender::waitConnection(uint32_t timeout) {
 	uint32_t start = millis();
-	while(WiFi.status() != WL_CONNECTED &&
-				millis() - start < WIFI_TIMEOUT_SEC * 1000)
+	wl_status_t status = WiFi.status();
+	while (status != WL_CONNECTED && status != WL_CONNECT_FAILED &&
+	       status != WL_NO_SSID_AVAIL && millis() - start < timeout)
 	{
 		delay(10);
+		status = WiFi.status();
 	}
+	return status == WL_CONNECTED;
+}
 
-	return WiFi.status() == WL_CONNECTED;
+/**
+ * Saves the access point and the IP configuration of the current connection to the cache.
+ */
+void WifiSender::saveCache() {
+	uint8_t* bssid = WiFi.BSSID();
+	if (bssid == NULL)
+		return;
+	memcpy(_wifiCache.bssid, bssid, WIFI_BSSID_SIZE);
+	_wifiCache.channel = WiFi.channel();
+	_wifiCache.ip = WiFi.localIP();
+	_wifiCache.gateway = WiFi.gatewayIP();
+	_wifiCache.subnet = WiFi.subnetMask();
+	_wifiCache.dns = WiFi.dnsIP();
+	_wifiCache.valid = true;
 }
 
 /*
@@ -70,12 +177,35 @@ void WifiSender::disconnect() {
 
 /**
  * Gets device location via Wi-Fi with Google Geolocation API.
+ * The location of a known set of access points is taken from the location cache,
+ * without connecting to Wi-Fi.
  * @returns: location struct containing location data
  */
 location_t WifiSender::getLocation() {
 	location_t location;
-	if (connect()) {
-		location = _wifiLocation.getGeoFromWiFi();
+	loadLocationCache();
+	scanAccessPoints();
+	location_fingerprint_t fingerprint;
+	LocationCache::initFingerprint(&fingerprint);
+	for (uint8_t i = 0; i < _accessPointCount; i++)
+		LocationCache::addAccessPoint(&fingerprint, _accessPoints[i].bssid, _accessPoints[i].rssi);
+	cached_location_t cached;
+	if (_locationCache.find(&fingerprint, &cached)) {
+		location.lat = cached.latitude;
+		location.lon = cached.longitude;
+		location.accuracy = cached.accuracy;
+	} else if (_accessPointCount > 0 && connect()) {
+		// The access points are written in the buffer of the JSON objects, unused until the emergencies
+		JsonWriter json(_json, WIFI_JSON_SIZE);
+		writeAccessPoints(&json);
+		uint32_t frequency = boostCpu();
+		if (json.fits())
+			location = _wifiLocation.getGeoFromWiFi(_json, json.getSize());
+		restoreCpu(frequency);
+		if (location.accuracy < MAX_LOC_ACCURACY) {
+			_locationCache.add(&fingerprint, location.lat, location.lon, location.accuracy);
+			saveLocationCache();
+		}
 	} else {
 		location.lat = 0;
 		location.lon = 0;
@@ -85,34 +215,193 @@ location_t WifiSender::getLocation() {
 	return location;
 }
 
+/**
+ * Scans the access points in range, and keeps the strongest ones.
+ * With the scans restricted to the channels seen before, a full scan is made
+ * only the first time, or when no access point is found on these channels.
+ */
+void WifiSender::scanAccessPoints() {
+	_accessPointCount = 0;
+	WiFi.mode(WIFI_STA);
+	if (_seenChannelsScan) {
+		for (uint8_t channel = 1; channel <= WIFI_SCAN_CHANNELS; channel++) {
+			if (_scanChannels & (1 << channel))
+				addAccessPoints(scanChannel(channel));
+		}
+	}
+	if (_accessPointCount == 0) {
+		addAccessPoints(scanChannel(0));
+		uint16_t channels = 0;
+		for (uint8_t i = 0; i < _accessPointCount; i++)
+			channels |= 1 << _accessPoints[i].channel;
+		if (channels != _scanChannels)
+			saveScanChannels(channels);
+	}
+}
+
+/**
+ * Scans the access points of a channel.
+ * @param channel: channel to scan, 0 for all the channels
+ * @return: the number of access points found, negative if the scan failed
+ */
+int16_t WifiSender::scanChannel(uint8_t channel) {
+	return WiFi.scanNetworks(false, false, _passiveScan, _scanChannelTime, channel);
+}
+
+/**
+ * Adds the results of a scan to the strongest access points, kept sorted
+ * from the strongest one, and deletes them.
+ * @param count: number of access points found by the scan
+ */
+void WifiSender::addAccessPoints(int16_t count) {
+	for (int16_t i = 0; i < count; i++) {
+		int32_t rssi = WiFi.RSSI(i);
+		int8_t strength = rssi < INT8_MIN ? INT8_MIN : (rssi > INT8_MAX ? INT8_MAX : rssi);
+		uint8_t position = _accessPointCount;
+		while (position > 0 && _accessPoints[position - 1].rssi < strength)
+			position--;
+		if (position >= WIFI_SCAN_ACCESS_POINTS)
+			continue;
+		uint8_t last = _accessPointCount < WIFI_SCAN_ACCESS_POINTS ? _accessPointCount++ : WIFI_SCAN_ACCESS_POINTS - 1;
+		for (uint8_t j = last; j > position; j--)
+			_accessPoints[j] = _accessPoints[j - 1];
+		memcpy(_accessPoints[position].bssid, WiFi.BSSID(i), WIFI_BSSID_SIZE);
+		_accessPoints[position].rssi = strength;
+		_accessPoints[position].channel = WiFi.channel(i);
+	}
+	WiFi.scanDelete();
+}
+
+/**
+ * Writes the request body of the geolocation API: the strongest access points, strongest first.
+ * @param json: writer of the body
+ */
+void WifiSender::writeAccessPoints(JsonWriter* json) {
+	char mac[3 * WIFI_BSSID_SIZE];
+	json->write("{\"wifiAccessPoints\":[");
+	for (uint8_t i = 0; i < _accessPointCount; i++) {
+		const uint8_t* bssid = _accessPoints[i].bssid;
+		snprintf(mac, sizeof(mac), "%02X:%02X:%02X:%02X:%02X:%02X",
+		         bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+		json->write(i == 0 ? "{\"macAddress\":\"" : ",{\"macAddress\":\"");
+		json->write(mac);
+		json->write("\",\"signalStrength\":");
+		json->writeInt(_accessPoints[i].rssi);
+		json->write(",\"channel\":");
+		json->writeInt(_accessPoints[i].channel);
+		json->write("}");
+	}
+	json->write("]}");
+}
+
+/**
+ * Loads the location cache and the channels of the last full scan from the NVS flash, once.
+ */
+void WifiSender::loadLocationCache() {
+	if (_locationCacheLoaded)
+		return;
+	_locationCacheLoaded = true;
+	_scanChannels = 0;
+	if (!_preferences.begin(WIFI_LOCATION_NAMESPACE, true))
+		return;
+	_scanChannels = _preferences.getUShort(WIFI_LOCATION_CHANNELS_KEY, 0);
+	location_table_t* table = _locationCache.getTable();
+	if (_preferences.getBytesLength(WIFI_LOCATION_KEY) != sizeof(location_table_t) ||
+	    _preferences.getBytes(WIFI_LOCATION_KEY, table, sizeof(location_table_t)) != sizeof(location_table_t))
+		_locationCache.clear();
+	_preferences.end();
+}
+
+/**
+ * Saves the location cache to the NVS flash.
+ */
+void WifiSender::saveLocationCache() {
+	if (!_preferences.begin(WIFI_LOCATION_NAMESPACE, false))
+		return;
+	_preferences.putBytes(WIFI_LOCATION_KEY, _locationCache.getTable(), sizeof(location_table_t));
+	_preferences.end();
+}
+
+/**
+ * Saves the channels of the access points of a full scan to the NVS flash.
+ * @param channels: channels of the access points (bit per channel)
+ */
+void WifiSender::saveScanChannels(uint16_t channels) {
+	_scanChannels = channels;
+	if (!_preferences.begin(WIFI_LOCATION_NAMESPACE, false))
+		return;
+	_preferences.putUShort(WIFI_LOCATION_CHANNELS_KEY, channels);
+	_preferences.end();
+}
+
 /*
- * Sends the JSON object containing the data to InfluxDB,
- * then resets JSON object.
+ * Sends the JSON object containing the data to InfluxDB.
+ * Its size is counted first, then it is written in its preallocated buffer,
+ * and sent with this size as content length.
  * @param version: version of the packet encoding
  * @param interval: time interval between two measurements
- * @param measurementsArray: array containing the recorded measurements
- * @param size: number of measurements to consider
+ * @param packet: packet containing the recorded measurements
+ * @param size: index of the last measurement to consider
  * @returns: true if packet was successfully sent over Wi-Fi, false otherwise
  */
-bool WifiSender::sendData(uint8_t version, uint8_t interval, measurement_t* measurementsArray, uint8_t size) {
-	_version = version;
+bool WifiSender::sendData(uint8_t version, uint8_t interval, Packet* packet, uint8_t size) {
+	// Size of the JSON object
+	JsonWriter counter;
+	writeJson(&counter, version, interval, packet, size);
+	if (counter.getSize() >= WIFI_JSON_SIZE) {
+		Serial.println("JSON object too large for Wi-Fi.");
+		return false;
+	}
 	// Populates the JSON object with measurements
-	populateJson(version, interval, measurementsArray, size);
-	// Close JSON object to send
-	closeJson();
-	printJson();
+	JsonWriter json(_json, WIFI_JSON_SIZE);
+	writeJson(&json, version, interval, packet, size);
+	Serial.println(_json);
+
+	return post("application/json", (uint8_t*) _json, json.getSize(), -1);
+}
 
+/**
+ * Sends a binary payload to InfluxDB, encoded like the LoRaWAN payloads,
+ * with the DevEUI of the device and the LoRaWAN port of the payload.
+ * @param port: LoRaWAN port of the payload, selecting its decoder
+ * @param payload: payload to send
+ * @param size: size of the payload (in bytes)
+ * @return: true if the payload was successfully sent over Wi-Fi, false otherwise
+ */
+bool WifiSender::sendPayload(uint8_t port, uint8_t* payload, uint8_t size) {
+	return post("application/octet-stream", payload, size, port);
+}
+
+/**
+ * Connects to Wi-Fi, and posts a body to InfluxDB.
+ * @param contentType: content type of the body
+ * @param body: body of the request
+ * @param size: size of the body (in bytes)
+ * @param port: LoRaWAN port of a binary body, sent with the DevEUI, -1 otherwise
+ * @return: true if the body was successfully sent, false otherwise
+ */
+bool WifiSender::post(const char* contentType, uint8_t* body, size_t size, int16_t port) {
 	// Connect to Wi-Fi
-	bool connected = connect();
-	if (connected) {
-		// Send JSON object to InfluxDB
+	bool sent = false;
+	if (connect()) {
+		// Send the body to InfluxDB
+		uint32_t frequency = boostCpu();
 		_http.begin(_urlInflux, certificate);
-		_http.addHeader("Content-Type", "application/json");
+		_http.addHeader("Content-Type", contentType);
 		_http.addHeader("authorization", _token);
-		int httpResponseCode = _http.POST(_json);
+		if (port >= 0) {
+			_http.addHeader("x-dev-eui", _devEUI);
+			_http.addHeader("x-f-port", String(port));
+		}
+		int httpResponseCode = _http.POST(body, size);
 		Serial.print("HTTP response code: ");
 		Serial.println(httpResponseCode);
 		_http.end();
+		restoreCpu(frequency);
+		sent = httpResponseCode >= 200 && httpResponseCode < 300;
+		// Connection error: the lease of the cache may have expired
+		if (httpResponseCode < 0)
+			clearCache();
 	} else {
 		Serial.print("Could not connect to Wi-Fi.");
 	}
@@ -120,251 +409,175 @@ bool WifiSender::sendData(uint8_t version, uint8_t interval, measurement_t* meas
 	// Disconnect from Wi-Fi
 	disconnect();
 
-	// Reset JSON object
-	resetJson();
+	return sent;
+}
+
+/**
+ * Raises the CPU frequency for an HTTPS request.
+ * @return: the CPU frequency before the request (in MHz)
+ */
+uint32_t WifiSender::boostCpu() {
+	uint32_t frequency = getCpuFrequencyMhz();
+	if (frequency < WIFI_TLS_CPU_MHZ)
+		setCpuFrequencyMhz(WIFI_TLS_CPU_MHZ);
+	return frequency;
+}
 
-	return connected;
+/**
+ * Restores the CPU frequency after an HTTPS request.
+ * @param frequency: CPU frequency before the request (in MHz)
+ */
+void WifiSender::restoreCpu(uint32_t frequency) {
+	if (frequency < WIFI_TLS_CPU_MHZ)
+		setCpuFrequencyMhz(frequency);
 }
 
 /**
- * Populates the JSON object with the recorded measurements.
+ * Writes the JSON object with the recorded measurements.
+ * @param json: writer of the JSON object
  * @param version: version of the packet encoding
  * @param interval: time interval between two measurements
- * @param measurementsArray: array containing the recorded measurements
- * @param size: number of measurements to consider
+ * @param packet: packet containing the recorded measurements
+ * @param size: index of the last measurement to consider
  */
-void WifiSender::populateJson(uint8_t version, uint8_t interval, measurement_t* measurementsArray, uint8_t size) {
+void WifiSender::writeJson(JsonWriter* json, uint8_t version, uint8_t interval, Packet* packet, uint8_t size) {
+	_version = version;
+	_jsonStarted = false;
+	_timestamp = -1;
+	// Device
+	json->write("{\n\"end_device_ids\": {\n\"dev_eui\": \"");
+	json->write(_devEUI.c_str());
+	json->write("\"\n},\n\"uplink_message\": {\n\"decoded_payload\": {\n");
 	// Premable: version and interval
-	addData("version", version);
+	addData(json, "version", version);
 	if (version != 1)
-		addData("interval", interval);
+		addData(json, "interval", interval);
 	// Geolocation data
-	if (version == 3) {
-		addData("latitude", measurementsArray[size].latitude);
-		addData("longitude", measurementsArray[size].longitude);
-		addData("altitude", measurementsArray[size].altitude);
+	if (version >= 3) {
+		measurement_t last = packet->getMeasurement(size);
+#define WIFI_FIELD_ADD_LOCATION(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		if (FIELD_ENABLED(header) && (location)) \
+			addData(json, key, last.member);
+		PACKET_FIELDS(WIFI_FIELD_ADD_LOCATION)
 	}
 	// Measurements
 	for (uint8_t i = 0; i <= size; i++) {
+		measurement_t measurement = packet->getMeasurement(i);
 		// Timestamp
 		if (version != 1)
-			newMeasurement(i);
-		// Battery [%]
-		appendBattery(measurementsArray[i].battery);
-		// Temperature
-		appendTemperature(measurementsArray[i].temperature);
-		// Pressure
-		appendPressure(measurementsArray[i].pressure);
-		// Humidity
-		appendHumidity(measurementsArray[i].humidity);
-		// Light
-		appendLight(measurementsArray[i].light);
-		// Geolocation data
-		if (version <= 2) {
-			appendLatitude(measurementsArray[i].latitude);
-			appendLongitude(measurementsArray[i].longitude);
-			appendAltitude(measurementsArray[i].altitude);
-		}
-		// CO2
-		appendCO2(measurementsArray[i].co2);
-		// Noise
-		appendNoise(measurementsArray[i].noise);
-		// Air quality
-		appendAirQuality(measurementsArray[i].airQuality);
+			newMeasurement(json, i);
+		// Fields, in the order of the schema, with the location up to version 2
+#define WIFI_FIELD_APPEND(id, header, Name, member, type, precision, key, location, min, exponent, mantissa, width) \
+		if (FIELD_ENABLED(header) && (!(location) || version <= 2)) \
+			appendValue(json, key, measurement.member);
+		PACKET_FIELDS(WIFI_FIELD_APPEND)
 	}
+	// Closing
+	if (version > 1)
+		json->write("\n}\n]");
+	json->write("\n}\n}\n}");
 }
 
 /*
  * Adds data to the JSON object.
+ * @param json: writer of the JSON object
  * @param type: type of the data to add
  * @param data: data to add
  */
-void WifiSender::addData(String type, float data) {
+void WifiSender::addData(JsonWriter* json, const char* type, float data) {
 	if (_jsonStarted)
-		_json += ",\n";
+		json->write(",\n");
 
-	_json += "\"";
-	_json += type;
-	_json += "\": ";
-	_json += String(data);
+	json->write("\"");
+	json->write(type);
+	json->write("\": ");
+	json->writeFloat(data);
 	_jsonStarted = true;
 }
 
 /**
  * Initializes the measurements array.
+ * @param json: writer of the JSON object
  */
-void WifiSender::startMeasurements() {
+void WifiSender::startMeasurements(JsonWriter* json) {
 	if (_jsonStarted)
-		_json += ",\n";
+		json->write(",\n");
 
-	_json += "\"measurements\": [\n";
+	json->write("\"measurements\": [\n");
 }
 
 /**
  * Initializes a new measurement, with the specified timestamp.
- * @param data: value of the timestamp
+ * @param json: writer of the JSON object
+ * @param timestamp: value of the timestamp
  */
-void WifiSender::newMeasurement(uint8_t timestamp) {
+void WifiSender::newMeasurement(JsonWriter* json, uint8_t timestamp) {
 	if (timestamp > _timestamp) {
 		if (_timestamp == -1) {
-			startMeasurements();
+			startMeasurements(json);
 		} else {
-			_json += "},\n";
+			json->write("},\n");
 		}
-		_json += 	"{";
-		_json += "\"timestamp\": ";
-		_json += String(timestamp);
+		json->write("{\"timestamp\": ");
+		json->writeInt(timestamp);
 		_timestamp = timestamp;
 	}
 }
 
 /**
  * Appends data to the measurements array in the JSON object.
+ * @param json: writer of the JSON object
  * @param type: type of the data
  * @param data: value of the data
  */
-void WifiSender::appendData(String type, float data) {
-	if (_version == 2) {
-		_json += ",\n\"";
-		_json += type;
-		_json += "\": ";
-		_json += String(data);
+void WifiSender::appendData(JsonWriter* json, const char* type, float data) {
+	if (_version > 1) {
+		json->write(",\n\"");
+		json->write(type);
+		json->write("\": ");
+		json->writeFloat(data);
 	} else {
-		addData(type, data);
+		addData(json, type, data);
 	}
 }
 
 /**
  * Appends an int value to the measurements array in the JSON object.
+ * @param json: writer of the JSON object
  * @param type: type of the data
  * @param data: value of the data
  */
-void WifiSender::appendInt(String type, float data) {
+void WifiSender::appendInt(JsonWriter* json, const char* type, float data) {
 	if (data != DEFAULT_INT)
-		appendData(type, data);
+		appendData(json, type, data);
 }
 
 /**
  * Appends a float value to the measurements array in the JSON object.
+ * @param json: writer of the JSON object
  * @param type: type of the data
  * @param data: value of the data
  */
-void WifiSender::appendFloat(String type, float data) {
+void WifiSender::appendFloat(JsonWriter* json, const char* type, float data) {
 	if (data != DEFAULT_FLOAT)
-		appendData(type, data);
+		appendData(json, type, data);
 }
 
 /**
- * Appends battery percentage data to the measurements array.
- * @param battery: battery percentage data
+ * Appends the value of a field to the measurements array in the JSON object,
+ * if it is present.
+ * @param json: writer of the JSON object
+ * @param type: key of the field
+ * @param data: value of the field
  */
-void WifiSender::appendBattery(uint8_t battery) {
-	appendInt("battery", (float) battery);
+void WifiSender::appendValue(JsonWriter* json, const char* type, uint8_t data) {
+	appendInt(json, type, (float) data);
 }
 
-/**
- * Appends temperature data to the measurements array.
- * @param temperature: temperature data
- */
-void WifiSender::appendTemperature(float temperature) {
-	appendFloat("temperature", temperature);
+void WifiSender::appendValue(JsonWriter* json, const char* type, uint16_t data) {
+	appendInt(json, type, (float) data);
 }
 
-/**
- * Appends pressure data to the measurements array.
- * @param pressure: pressure data
- */
-void WifiSender::appendPressure(float pressure) {
-	appendFloat("pressure", pressure);
-}
-
-/**
- * Appends humidity data to the measurements array.
- * @param humidity: humidity data
- */
-void WifiSender::appendHumidity(float humidity) {
-	appendFloat("humidity", humidity);
-}
-
-/**
- * Appends altitude data to the measurements array.
- * @param altitude: altitude data
- */
-void WifiSender::appendAltitude(float altitude) {
-	appendFloat("altitude", altitude);
-}
-
-/**
- * Appends light data to the measurements array.
- * @param light: light data
- */
-void WifiSender::appendLight(uint16_t light) {
-	appendInt("light", (float) light);
-}
-
-/**
- * Appends latitude data to the measurements array.
- * @param latitude: latitude data
- */
-void WifiSender::appendLatitude(float latitude) {
-	appendFloat("latitude", latitude);
-}
-
-/**
- * Appends longitude data to the measurements array.
- * @param longitude: longitude data
- */
-void WifiSender::appendLongitude(float longitude) {
-	appendFloat("longitude", longitude);
-}
-
-/**
- * Appends CO2 concentration data to the measurements array.
- * @param co2: CO2 concentration data
- */
-void WifiSender::appendCO2(float co2) {
-	appendFloat("co2", co2);
-}
-
-/**
- * Appends noise data to the measurements array.
- * @param noise: noise data
- */
-void WifiSender::appendNoise(uint16_t noise) {
-	appendInt("noise", (float) noise);
-}
-
-/**
- * Appends air quality data to the measurements array.
- * @param noise: air quality data
- */
-void WifiSender::appendAirQuality(float airQuality) {
-	appendFloat("airQuality", airQuality);
-}
-
-/**
- * Prints the JSON object on the serial output.
- */
-void WifiSender::printJson() {
-	Serial.println(_json);
-}
-
-/*
- * Closes the JSON object.
- */
-void WifiSender::closeJson() {
-	if (_version == 2)
-		_json += "\n}\n]";
-	_json += "\n}\n}\n}";
-}
-
-/*
- * Resets the JSON object.
- */
-void WifiSender::resetJson() {
-	_json = "{\n\"end_device_ids\": {\n\"dev_eui\": \"";
-	_json += _devEUI;
-	_json += "\"\n},\n";
-	_json += "\"uplink_message\": {\n\"decoded_payload\": {\n";
-	_jsonStarted = false;
+void WifiSender::appendValue(JsonWriter* json, const char* type, float data) {
+	appendFloat(json, type, data);
 }
@@ -13,10 +13,55 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <WifiLocation.h>
+#include <Preferences.h>
 #include <Packet.h>
+#include <LocationCache.h>
+#include "JsonWriter.h"
 
 #define WIFI_TIMEOUT_SEC 20
 #define MAX_LOC_ACCURACY 500
+// Timeout of the reconnection to the cached access point, before falling back to the full scan
+#define WIFI_FAST_TIMEOUT_MS 3000
+// Size of a BSSID (MAC address of the access point)
+#define WIFI_BSSID_SIZE 6
+// Strongest access points of the scans, sent to the geolocation API
+#define WIFI_SCAN_ACCESS_POINTS 12
+// Wi-Fi channels of the scans (2.4 GHz band, channels 1 to 13)
+#define WIFI_SCAN_CHANNELS 13
+// Default time of a scan per channel (in ms), the default of the active scans of ESP-IDF.
+// A passive scan needs at least a beacon interval (102.4 ms) to see the access points.
+#define WIFI_SCAN_CHANNEL_MS 120
+// Cache of the geolocations in the NVS flash: namespace and key of its table,
+// and key of the channels of the access points of the last full scan
+#define WIFI_LOCATION_NAMESPACE    "location"
+#define WIFI_LOCATION_KEY          "table"
+#define WIFI_LOCATION_CHANNELS_KEY "channels"
+// CPU frequency during the HTTPS requests (in MHz): the TLS handshakes are CPU-bound,
+// and much shorter at full speed than at the frequency of the wake cycles
+#define WIFI_TLS_CPU_MHZ 240
+// Size of the buffer of the JSON object sent to InfluxDB, preallocated
+// to keep the heap for TLS. Larger batches are not sent over Wi-Fi.
+#define WIFI_JSON_SIZE 8192
+
+// Connection cache, kept in RTC memory across the deep sleeps:
+// access point of the last connection, with its channel, and the IP configuration
+// obtained from its DHCP server (or the static one), reused without DHCP
+typedef struct wifiCache {
+	bool valid;
+	uint8_t bssid[WIFI_BSSID_SIZE];
+	int32_t channel;
+	uint32_t ip;
+	uint32_t gateway;
+	uint32_t subnet;
+	uint32_t dns;
+} wifi_cache_t;
+
+// Access point found by a scan
+typedef struct wifiAccessPoint {
+	uint8_t bssid[WIFI_BSSID_SIZE];
+	int8_t rssi;
+	uint8_t channel;
+} wifi_access_point_t;
 
 // Microsoft certificate to authentify our cloud function URL
 static const char certificate[] PROGMEM = R"EOF(
@@ -69,48 +114,74 @@ class WifiSender {
 							const char* urlInflux,
 							const char* token,
 							String devEUI);
+		bool setStaticIp(const char* ip, const char* gateway, const char* subnet, const char* dns);
+		void setScan(bool passive, bool seenChannels, uint16_t channelTime = WIFI_SCAN_CHANNEL_MS);
+		void clearCache();
 		bool connect();
 		void disconnect();
 		location_t getLocation();
-		bool sendData(uint8_t version, uint8_t interval, measurement_t* measurementsArray, uint8_t size);
-		void addData(String type, float data);
-		void newMeasurement(uint8_t timestamp);
-		void appendData(String type, float data);
-		void appendInt(String type, float data);
-		void appendFloat(String type, float data);
-		void appendBattery(uint8_t battery);
-		void appendTemperature(float temperature);
-		void appendPressure(float pressure);
-		void appendHumidity(float humidity);
-		void appendAltitude(float altitude);
-		void appendLight(uint16_t light);
-		void appendLatitude(float latitude);
-		void appendLongitude(float longitude);
-		void appendCO2(float co2);
-		void appendNoise(uint16_t noise);
-		void appendAirQuality(float airQuality);
-		void closeJson();
-		void printJson();
+		bool sendData(uint8_t version, uint8_t interval, Packet* packet, uint8_t size);
+		bool sendPayload(uint8_t port, uint8_t* payload, uint8_t size);
 
 	private:
 		// Wi-Fi parameters
 		const char* _ssid;
 		const char* _password;
+		// Static IP configuration, DHCP otherwise
+		bool _staticIp;
+		IPAddress _ip;
+		IPAddress _gateway;
+		IPAddress _subnet;
+		IPAddress _dns;
 		// InfluxDB parameters
 		const char* _urlInflux;
 		const char* _token;
 
 		String _devEUI;
 		WifiLocation _wifiLocation;
+		// Scans: passive, restricted to the channels of the last full scan, and time per channel
+		bool _passiveScan;
+		bool _seenChannelsScan;
+		uint16_t _scanChannelTime;
+		// Strongest access points of the last scan, strongest first
+		wifi_access_point_t _accessPoints[WIFI_SCAN_ACCESS_POINTS];
+		uint8_t _accessPointCount;
+		// Cache of the geolocations, and channels of the access points of the last full scan
+		// (bit per channel), loaded from the NVS flash
+		LocationCache _locationCache;
+		uint16_t _scanChannels;
+		Preferences _preferences;
+		bool _locationCacheLoaded;
 		HTTPClient _http;
-		String _json;
+		// JSON object, written in its buffer after its size is counted
+		char _json[WIFI_JSON_SIZE];
 		bool _jsonStarted;
 		uint8_t _version;
 		int8_t _timestamp;
 
-		void populateJson(uint8_t version, uint8_t interval, measurement_t* measurementsArray, uint8_t size);
-		void startMeasurements();
-		void resetJson();
+		bool connectCached();
+		bool waitConnection(uint32_t timeout);
+		void saveCache();
+		void scanAccessPoints();
+		int16_t scanChannel(uint8_t channel);
+		void addAccessPoints(int16_t count);
+		void writeAccessPoints(JsonWriter* json);
+		void loadLocationCache();
+		void saveLocationCache();
+		void saveScanChannels(uint16_t channels);
+		bool post(const char* contentType, uint8_t* body, size_t size, int16_t port);
+		uint32_t boostCpu();
+		void restoreCpu(uint32_t frequency);
+		void writeJson(JsonWriter* json, uint8_t version, uint8_t interval, Packet* packet, uint8_t size);
+		void addData(JsonWriter* json, const char* type, float data);
+		void startMeasurements(JsonWriter* json);
+		void newMeasurement(JsonWriter* json, uint8_t timestamp);
+		void appendData(JsonWriter* json, const char* type, float data);
+		void appendInt(JsonWriter* json, const char* type, float data);
+		void appendFloat(JsonWriter* json, const char* type, float data);
+		void appendValue(JsonWriter* json, const char* type, uint8_t data);
+		void appendValue(JsonWriter* json, const char* type, uint16_t data);
+		void appendValue(JsonWriter* json, const char* type, float data);
 };
 
 #endif
@@ -9,6 +9,9 @@ const {
     AbortError,
     RequestTimedOutError,
 } = require('@influxdata/influxdb-client');
+// Decoder of the LoRaWAN payloads, shared with The Things Network
+// (copy of the-things-network/decoder.js, written by generate-decoder.py)
+const { decodeUplink } = require('../shared/decoder.js');
 
 const tokenValidationSecret = 'Insert secret here';
 
@@ -71,7 +74,20 @@ const getRequestData = (context, req) => {
     let deviceId;
     let payload;
     let metadata;
-    if ('hardware_serial' in req.body) {
+    if (Buffer.isBuffer(req.body) && 'x-dev-eui' in req.headers) {
+        // Binary payload, sent by the devices over Wi-Fi
+        context.log('Payload version: binary');
+        deviceId = req.headers['x-dev-eui'].toLowerCase();
+        const decoded = decodeUplink({
+            bytes: Array.from(req.body),
+            fPort: parseInt(req.headers['x-f-port'], 10),
+        });
+        if (!decoded.data) {
+            throw Error('Malformed binary payload');
+        }
+        payload = decoded.data;
+        metadata = {};
+    } else if ('hardware_serial' in req.body) {
         // TTNv2
         context.log('Payload version: TTNv2');
         context.log(
@@ -232,10 +248,14 @@ const processBatchMeasurements = (
     payload,
     firebaseLocation,
 ) => {
-    const maxTimestamp = Math.max.apply(
-        Math,
-        payload.measurements.map((o) => o.timestamp),
-    );
+    // Fragments of a batch carry the last timestamp of the whole batch
+    const maxTimestamp =
+        'lastTimestamp' in payload
+            ? payload.lastTimestamp
+            : Math.max.apply(
+                  Math,
+                  payload.measurements.map((o) => o.timestamp),
+              );
 
     context.log('Inserting data from batch into influxDB at :', influxDBURL);
 
@@ -246,10 +266,14 @@ const processBatchMeasurements = (
     }
     context.log('Batch Location', batchLocation);
 
+    // Uplinks sent again after an outage carry the age of their last measurement
+    const age = payload.age || 0;
+
     payload.measurements.forEach((measurement) => {
         const timestamp = new Date();
         timestamp.setMinutes(
             timestamp.getMinutes() -
+                age -
                 payload.interval * (maxTimestamp - measurement.timestamp),
         );
 
@@ -291,10 +315,36 @@ const processSingleMeasurement = (
         firebaseLocation,
     );
 
+    // Uplinks sent again after an outage carry the age of their measurement
+    const timestamp = new Date();
+    timestamp.setMinutes(timestamp.getMinutes() - (payload.age || 0));
+
     context.log('Inserting data into influxDB at :', influxDBURL);
     context.log(`Location from ${locationSource}: ${latitude},${longitude}`);
 
-    writeData(context, writeApi, payload, longitude, latitude);
+    writeData(context, writeApi, payload, longitude, latitude, timestamp);
+};
+
+const processProfile = (context, writeApi, payload) => {
+    context.log('Inserting wake cycle profile into influxDB at :', influxDBURL);
+    const timestamp = new Date();
+    Object.keys(payload.phases).forEach((phase) => {
+        const statistics = payload.phases[phase];
+        context.log('Adding profile of phase [' + phase + ']');
+
+        const point = new Point('profile')
+            .tag('phase', phase)
+            .intField('cycles', payload.cycles)
+            .intField('count', statistics.count)
+            .floatField('mean', statistics.mean)
+            .floatField('max', statistics.max);
+        statistics.histogram.forEach((count, bucket) => {
+            point.intField('bucket' + bucket, count);
+        });
+
+        point.timestamp(timestamp);
+        writeApi.writePoint(point);
+    });
 };
 
 module.exports = async function (context, req) {
@@ -323,7 +373,10 @@ module.exports = async function (context, req) {
         }).getWriteApi(influxDBOrg, influxDBBucket);
         writeApi.useDefaultTags({ deviceId, deviceDisplayName });
 
-        if (version === 1) {
+        if ('phases' in payload) {
+            context.log('Wake cycle profile');
+            processProfile(context, writeApi, payload);
+        } else if (version === 1) {
             context.log('Payload version', version, '(single measurement)');
             processSingleMeasurement(
                 context,
@@ -341,7 +394,7 @@ module.exports = async function (context, req) {
                 payload,
                 firebaseLocation,
             );
-        } else if (version === 3) {
+        } else if (version >= 3 && version <= 5) {
             context.log(
                 'Payload version',
                 version,
@@ -14,6 +14,8 @@ ARRAY_KEYS = [
     "appEui",
     "appKey"
 ]
+# Field schema of the Packet library, relative to this folder
+SCHEMA_PATH = "../arduino/libraries/Packet/PacketFields.h"
 
 def deep_get(dict_in, key):
     """
@@ -80,6 +82,69 @@ def populate_template(filename, dictionary, array):
             array.append(line)
 
 
+def read_field_headers(path):
+    """
+    Reads the header constants of the fields in the field schema of the Packet library.
+    :param path: path to the PacketFields.h file
+    :return: dictionary mapping field names to their header constant
+    """
+    headers = {}
+    with open(path, 'r') as schema_file:
+        for line in schema_file:
+            match = re.match(r'\s*X\((\w+),[^"]*"(\w+)"', line)
+            if match is not None:
+                headers[match.group(2)] = match.group(1)
+    return headers
+
+
+QUANTIZATION_HEADERS = read_field_headers(SCHEMA_PATH)
+
+
+def quantization_lines(quantization, version):
+    """
+    Creates the lines of code overriding the quantization of the fields.
+    :param quantization: dictionary mapping field names to their quantization
+                         (min, resolution and width)
+    :param version: packet format version, at least 4 with a quantization
+    :return: the lines of code
+    """
+    lines = []
+    if quantization and version < 4:
+        sys.stderr.write("The quantization needs the packet format version 4 or 5.\n")
+        exit(-1)
+    for field, params in quantization.items():
+        if field not in QUANTIZATION_HEADERS:
+            sys.stderr.write(f"Unknown field in quantization: {field}\n")
+            exit(-1)
+        lines.append(f"    esp.setQuantization({QUANTIZATION_HEADERS[field]}, "
+                     f"{params['min']}, {params['resolution']}, {params['width']});\n")
+    return lines
+
+
+def adaptive_lines(adaptive):
+    """
+    Creates the lines of code of the adaptive sampling policy.
+    :param adaptive: dictionary with the battery steps (list of level, wakeupPeriod
+                     and nMeasurements) and the fast step (level, wakeupPeriod,
+                     nMeasurements, hold and change rates of the fields)
+    :return: the lines of code
+    """
+    lines = []
+    for step in adaptive.get('battery', []):
+        lines.append(f"    esp.addAdaptiveStep({step['level']}, {step['wakeupPeriod']}, "
+                     f"{step['nMeasurements']});\n")
+    fast = adaptive.get('fast', None)
+    if fast is not None:
+        lines.append(f"    esp.setAdaptiveFast({fast.get('level', 0)}, {fast['wakeupPeriod']}, "
+                     f"{fast['nMeasurements']}, {fast['hold']});\n")
+        for field, rate in fast.get('rates', {}).items():
+            if field not in QUANTIZATION_HEADERS:
+                sys.stderr.write(f"Unknown field in adaptive rates: {field}\n")
+                exit(-1)
+            lines.append(f"    esp.setAdaptiveRate({QUANTIZATION_HEADERS[field]}, {rate});\n")
+    return lines
+
+
 # Read command line argument
 if len(sys.argv) != 2 or not sys.argv[1].lower().endswith(('.yaml', '.yml')):
     sys.stderr.write("Wrong arguments.\nPlease specify YAML configuration file name.\n")
@@ -119,6 +184,49 @@ with open("templates/setup.txt", 'r') as setup:
     for line in setup:
         sketch_lines.append(line)
 
+# Write quantization overrides
+quantization = parameters.get('configuration', {}).get('quantization', {})
+version = parameters.get('configuration', {}).get('version', DEFAULT_VAL)
+sketch_lines.extend(quantization_lines(quantization, version))
+
+# Write aggregation mode
+aggregation = parameters.get('configuration', {}).get('aggregation', 0)
+if aggregation > 0:
+    sketch_lines.append(f"    esp.initAggregation({aggregation});\n")
+
+# Write adaptive sampling policy
+adaptive = parameters.get('configuration', {}).get('adaptive', {})
+sketch_lines.extend(adaptive_lines(adaptive))
+
+# Write store-and-forward, confirming one uplink out of confirmEvery while the network is up
+store_forward = parameters.get('configuration', {}).get('storeForward', False)
+if isinstance(store_forward, dict):
+    sketch_lines.append(f"    esp.initStoreForward({store_forward.get('confirmEvery', 1)});\n")
+elif store_forward:
+    sketch_lines.append("    esp.initStoreForward();\n")
+
+# Write binary Wi-Fi uplinks
+if parameters.get('configuration', {}).get('wifi', {}).get('binary', False):
+    sketch_lines.append("    esp.initWifiBinary();\n")
+
+# Write static IP configuration of the Wi-Fi
+static_ip = parameters.get('configuration', {}).get('wifi', {}).get('staticIp', {})
+if static_ip:
+    sketch_lines.append(f"    esp.setWifiStaticIp(\"{static_ip['ip']}\", \"{static_ip['gateway']}\", "
+                        f"\"{static_ip['subnet']}\", \"{static_ip['dns']}\");\n")
+
+# Write scans of the Wi-Fi geolocation
+scan = parameters.get('configuration', {}).get('wifi', {}).get('scan', {})
+if scan:
+    passive = 'true' if scan.get('passive', False) else 'false'
+    seen_channels = 'true' if scan.get('seenChannels', False) else 'false'
+    sketch_lines.append(f"    esp.setWifiScan({passive}, {seen_channels}, {scan.get('channelTime', 120)});\n")
+
+# Write wake cycle profiler
+profile = parameters.get('configuration', {}).get('profile', 0)
+if profile > 0:
+    sketch_lines.append(f"    esp.initProfiler({profile});\n")
+
 # Write sensors methods
 if len(sensors) > 0:
     sensors_methods = {}
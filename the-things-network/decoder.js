@@ -1,3 +1,5 @@
+// BEGIN GENERATED FIELDS
+// Generated by generate-decoder.py from arduino/libraries/Packet/PacketFields.h, do not edit.
 // Header values definitions
 var HEADER_BATTERY     = 0x01;
 var HEADER_TEMPERATURE = 0x02;
@@ -11,27 +13,226 @@ var HEADER_CO2         = 0x09;
 var HEADER_NOISE       = 0x0A;
 var HEADER_AIR_QUALITY = 0x0B;
 
+// Versions 1 to 3: fields, indexed by header, with their size in bytes
+// and the number of decimal places of floats.
+var FIELDS = {};
+FIELDS[HEADER_BATTERY] = {name: "battery", size: 1, precision: 0, isFloat: false, location: false};
+FIELDS[HEADER_TEMPERATURE] = {name: "temperature", size: 4, precision: 2, isFloat: true, location: false};
+FIELDS[HEADER_PRESSURE] = {name: "pressure", size: 4, precision: 2, isFloat: true, location: false};
+FIELDS[HEADER_HUMIDITY] = {name: "humidity", size: 4, precision: 2, isFloat: true, location: false};
+FIELDS[HEADER_ALTITUDE] = {name: "altitude", size: 4, precision: 2, isFloat: true, location: true};
+FIELDS[HEADER_LIGHT] = {name: "light", size: 2, precision: 0, isFloat: false, location: false};
+FIELDS[HEADER_LATITUDE] = {name: "latitude", size: 4, precision: 6, isFloat: true, location: true};
+FIELDS[HEADER_LONGITUDE] = {name: "longitude", size: 4, precision: 6, isFloat: true, location: true};
+FIELDS[HEADER_CO2] = {name: "co2", size: 4, precision: 2, isFloat: true, location: false};
+FIELDS[HEADER_NOISE] = {name: "noise", size: 2, precision: 0, isFloat: false, location: false};
+FIELDS[HEADER_AIR_QUALITY] = {name: "airQuality", size: 4, precision: 2, isFloat: true, location: false};
+
+// Versions 4 and 5: fields in payload order, with their default quantization
+// (minimum in resolution steps, resolution = mantissa * 10^exponent, width in bytes).
+var LOCATION_FIELDS_V4 = [
+  {header: HEADER_LATITUDE, name: "latitude", min: -200000000, mantissa: 1, exponent: -6, width: 4},
+  {header: HEADER_LONGITUDE, name: "longitude", min: -200000000, mantissa: 1, exponent: -6, width: 4},
+  {header: HEADER_ALTITUDE, name: "altitude", min: -20000, mantissa: 1, exponent: -2, width: 4}
+];
+var MEASUREMENT_FIELDS_V4 = [
+  {header: HEADER_BATTERY, name: "battery", min: 0, mantissa: 1, exponent: 0, width: 1},
+  {header: HEADER_TEMPERATURE, name: "temperature", min: -20000, mantissa: 1, exponent: -2, width: 4},
+  {header: HEADER_PRESSURE, name: "pressure", min: -20000, mantissa: 1, exponent: -2, width: 4},
+  {header: HEADER_HUMIDITY, name: "humidity", min: -20000, mantissa: 1, exponent: -2, width: 4},
+  {header: HEADER_LIGHT, name: "light", min: 0, mantissa: 1, exponent: 0, width: 2},
+  {header: HEADER_CO2, name: "co2", min: -20000, mantissa: 1, exponent: -2, width: 4},
+  {header: HEADER_NOISE, name: "noise", min: 0, mantissa: 1, exponent: 0, width: 2},
+  {header: HEADER_AIR_QUALITY, name: "airQuality", min: -20000, mantissa: 1, exponent: -2, width: 4}
+];
+// END GENERATED FIELDS
+
+var ABSENT_DELTA = 0;
+// Flag on the version byte, set if the payload announces non-default quantizations
+var QUANTIZATION_FLAG = 0x80;
+// Flag on the version byte, set if the payload contains the statistics of the samples
+// of a reporting period (minimum, maximum, mean and standard deviation of each field)
+var AGGREGATE_FLAG = 0x40;
+var VERSION_FLAGS = QUANTIZATION_FLAG | AGGREGATE_FLAG;
+var MANTISSAS = [1, 2, 5];
+
+// Fragments of a batch that does not fit in one frame, sent on their own port,
+// with a header: sequence number of the batch, timestamp of the first measurement
+// of the fragment and timestamp of the last measurement of the batch
+var FRAGMENT_PORT = 3;
+var FRAGMENT_HEADER_SIZE = 3;
+
+// Summaries of the wake cycle profiler of the devices, sent on their own port:
+// version, number of wake cycles, bitmap of the phases, then for each phase
+// its count, mean and maximum durations (in microseconds) as varints,
+// and its histogram (one count per nibble, bucket bounds from 1 ms, times 4 per bucket)
+var PROFILE_PORT = 4;
+var PROFILE_HEADER_SIZE = 4;
+var PROFILE_BUCKETS = 8;
+var PROFILE_PHASES = ["setup", "join", "acquisition", "warmup", "build", "loraTx", "rxWindows", "wifi"];
+var PROFILE_READ = 8;
+var PROFILE_MAX_SENSORS = 8;
+
+// Uplinks sent again after an outage of the network, on their own port, with a header:
+// age of the last measurement of the uplink when it is sent again (in minutes, 2 bytes),
+// and port of the original uplink (payload or fragment)
+var STORED_PORT = 5;
+var STORED_HEADER_SIZE = 3;
+
 // Entry function
 function decodeUplink(input) {
+  if (input.fPort == FRAGMENT_PORT)
+    return decodeFragment(input.bytes);
+  if (input.fPort == PROFILE_PORT)
+    return decodeProfile(input.bytes);
+  if (input.fPort == STORED_PORT)
+    return decodeStored(input.bytes);
+  var data = decodePayload(input.bytes);
+  if (data === null) {
+    // Unknown version, drop packet
+    return {};
+  }
+  return {
+    data: data,
+    warnings: [],
+    errors: []
+  };
+}
+
+/**
+ * Decodes a payload, according to its version number.
+ * @param bytes: payload received
+ * @returns: decoded payload, or null if the version is unknown
+ */
+function decodePayload(bytes) {
   // Match on version number
-  switch (input.bytes[0]) {
+  switch (bytes[0] & ~VERSION_FLAGS) {
     case 1:
-      return {
-          data: decoder_v1(input.bytes),
-          warnings: [],
-          errors: []
-        };
+      if (bytes[0] & VERSION_FLAGS)
+        return null;
+      return decoder_v1(bytes);
     case 2:
     case 3:
-      return {
-          data: decoder_v2(input.bytes),
-          warnings: [],
-          errors: []
-        };
+      if (bytes[0] & VERSION_FLAGS)
+        return null;
+      return decoder_v2(bytes);
+    case 4:
+    case 5:
+      return decoder_v4(bytes);
     default:
-      // Unknown version, drop packet
-      return {};
+      return null;
+  }
+}
+
+/**
+ * Fragment decoder.
+ * A fragment is a payload containing some measurements of a batch, preceded by the fragment header.
+ * The timestamps of the measurements are shifted to their timestamps in the batch,
+ * so that the fragments of a batch can be processed independently.
+ * @param bytes: fragment received
+ * @returns: decoded fragment, with its sequence number and the last timestamp of the batch
+ */
+function decodeFragment(bytes) {
+  if (bytes.length <= FRAGMENT_HEADER_SIZE) {
+    return {
+      errors: ["fragment too short"]
+    };
+  }
+  var first = bytes[1];
+  var data = decodePayload(bytes.slice(FRAGMENT_HEADER_SIZE));
+  if (data === null || !("measurements" in data) || "statistics" in data) {
+    return {
+      errors: ["unknown fragment version"]
+    };
+  }
+  for (var i = 0; i < data.measurements.length; i++)
+    data.measurements[i].timestamp += first;
+  data.sequence = bytes[0];
+  data.lastTimestamp = bytes[2];
+  return {
+    data: data,
+    warnings: [],
+    errors: []
+  };
+}
+
+/**
+ * Decoder of the uplinks sent again after an outage of the network.
+ * The payload or fragment is decoded like the original uplink, with its age,
+ * so that the timestamps of its measurements are shifted back by the age.
+ * @param bytes: stored uplink received
+ * @returns: decoded payload or fragment, with the age of its last measurement (in minutes)
+ */
+function decodeStored(bytes) {
+  if (bytes.length <= STORED_HEADER_SIZE) {
+    return {
+      errors: ["stored uplink too short"]
+    };
+  }
+  var age = (bytes[0] << 8) | bytes[1];
+  var inner = bytes.slice(STORED_HEADER_SIZE);
+  var result;
+  if (bytes[2] == FRAGMENT_PORT) {
+    result = decodeFragment(inner);
+  } else {
+    var data = decodePayload(inner);
+    result = data === null ? {errors: ["unknown stored version"]} : {data: data, warnings: [], errors: []};
   }
+  if ("data" in result)
+    result.data.age = age;
+  return result;
+}
+
+/**
+ * Decoder of the summaries of the wake cycle profiler.
+ * The reading of the sensors is profiled per sensor, in the order in which they are added to the device.
+ * @param bytes: summary received
+ * @returns: decoded summary, with the statistics of each phase (durations in milliseconds)
+ */
+function decodeProfile(bytes) {
+  if (bytes.length < PROFILE_HEADER_SIZE || bytes[0] != 1) {
+    return {
+      errors: ["unknown profile version"]
+    };
+  }
+  var data = {
+    cycles: bytes[1],
+    phases: {}
+  };
+  var bitmap = rebuildInt(bytes, 2, 2);
+  var payload_idx = PROFILE_HEADER_SIZE;
+  for (var phase = 0; phase < PROFILE_READ + PROFILE_MAX_SENSORS; phase++) {
+    if (!(bitmap & (1 << phase)))
+      continue;
+    var name = phase < PROFILE_READ ? PROFILE_PHASES[phase] : "read" + (phase - PROFILE_READ);
+    var count = readVarint(bytes, payload_idx);
+    payload_idx += count.size;
+    var mean = readVarint(bytes, payload_idx);
+    payload_idx += mean.size;
+    var max = readVarint(bytes, payload_idx);
+    payload_idx += max.size;
+    var histogram = [];
+    for (var i = 0; i < PROFILE_BUCKETS / 2; i++) {
+      histogram.push(bytes[payload_idx] >> 4, bytes[payload_idx] & 0x0F);
+      payload_idx++;
+    }
+    data.phases[name] = {
+      count: count.value,
+      mean: mean.value / 1000,
+      max: max.value / 1000,
+      histogram: histogram
+    };
+  }
+  if (payload_idx != bytes.length) {
+    return {
+      errors: ["malformed profile"]
+    };
+  }
+  return {
+    data: data,
+    warnings: [],
+    errors: []
+  };
 }
 
 /**
@@ -84,8 +285,208 @@ function decoder_v2(bytes) {
   return decoded;
 }
 
+/**
+ * Payload decoder, V4 and V5
+ * The fields are announced by a presence bitmap, have no header,
+ * and are quantized (see LOCATION_FIELDS_V4 and MEASUREMENT_FIELDS_V4).
+ * In V5, the measurements after the first one are zig-zag varint deltas
+ * with the previous value of the same field.
+ * Aggregated payloads contain the statistics of each field instead of the measurements:
+ * the means are returned as one measurement, and all the statistics in "statistics".
+ * @param bytes: payload received
+ * @returns: decoded payload
+ */
+function decoder_v4(bytes) {
+  var version = bytes[0] & ~VERSION_FLAGS;
+  var decoded = {
+    version: version,
+    interval: bytes[1],
+    measurements: []
+  };
+  var count = bytes[2];
+  var bitmap = rebuildInt(bytes, 3, 2);
+  var payload_idx = 5;
+  // Non-default quantizations
+  var quantizations = {};
+  if (bytes[0] & QUANTIZATION_FLAG) {
+    var overrides = rebuildInt(bytes, payload_idx, 2);
+    payload_idx += 2;
+    for (var header = 1; header <= HEADER_AIR_QUALITY; header++) {
+      if (isPresent(overrides, header)) {
+        quantizations[header] = readQuantization(bytes, payload_idx);
+        payload_idx += 5;
+      }
+    }
+  }
+  // Location, once per batch
+  for (var f = 0; f < LOCATION_FIELDS_V4.length; f++) {
+    var field = quantizations[LOCATION_FIELDS_V4[f].header] || LOCATION_FIELDS_V4[f];
+    var name = LOCATION_FIELDS_V4[f].name;
+    if (isPresent(bitmap, LOCATION_FIELDS_V4[f].header)) {
+      var data = readFieldValue(bytes, payload_idx, field);
+      if (data !== null)
+        decoded[name] = dequantize(data, field);
+      payload_idx += field.width;
+    }
+  }
+  if (bytes[0] & AGGREGATE_FLAG)
+    return decodeAggregates(bytes, payload_idx, bitmap, quantizations, decoded);
+  // Measurements, with implicit timestamps
+  var references = {};
+  for (var i = 0; i < count; i++) {
+    var measurement = {timestamp: i};
+    for (var f = 0; f < MEASUREMENT_FIELDS_V4.length; f++) {
+      var field = quantizations[MEASUREMENT_FIELDS_V4[f].header] || MEASUREMENT_FIELDS_V4[f];
+      var name = MEASUREMENT_FIELDS_V4[f].name;
+      if (!isPresent(bitmap, MEASUREMENT_FIELDS_V4[f].header))
+        continue;
+      var data;
+      if (version == 5 && i > 0) {
+        var varint = readVarint(bytes, payload_idx);
+        payload_idx += varint.size;
+        data = null;
+        if (varint.value != ABSENT_DELTA)
+          data = ((references[name] || 0) + decodeZigZag(varint.value - 1)) >>> 0;
+      } else {
+        data = readFieldValue(bytes, payload_idx, field);
+        payload_idx += field.width;
+      }
+      if (data !== null) {
+        references[name] = data;
+        measurement[name] = dequantize(data, field);
+      }
+    }
+    decoded.measurements.push(measurement);
+  }
+  return decoded;
+}
+
+/**
+ * Decodes the statistics of an aggregated V4 or V5 payload: for each present field,
+ * its minimum, maximum and mean, quantized like the field, and its standard deviation,
+ * quantized with the resolution of the field but without its minimum.
+ * @param bytes: payload received
+ * @param payload_idx: index of the first statistic in the payload
+ * @param bitmap: presence bitmap
+ * @param quantizations: non-default quantizations, indexed by header
+ * @param decoded: decoded payload, with the location
+ * @returns: decoded payload, with the number of samples, the means and the statistics
+ */
+function decodeAggregates(bytes, payload_idx, bitmap, quantizations, decoded) {
+  var STATISTICS = ["min", "max", "mean", "stddev"];
+  var means = {timestamp: 0};
+  decoded.samples = bytes[2];
+  decoded.statistics = {};
+  for (var f = 0; f < MEASUREMENT_FIELDS_V4.length; f++) {
+    var field = quantizations[MEASUREMENT_FIELDS_V4[f].header] || MEASUREMENT_FIELDS_V4[f];
+    var name = MEASUREMENT_FIELDS_V4[f].name;
+    if (!isPresent(bitmap, MEASUREMENT_FIELDS_V4[f].header))
+      continue;
+    var statistics = {};
+    for (var s = 0; s < STATISTICS.length; s++) {
+      var data = readFieldValue(bytes, payload_idx, field);
+      payload_idx += field.width;
+      if (data === null)
+        continue;
+      if (STATISTICS[s] == "stddev")
+        statistics.stddev = dequantize(data, {min: 0, mantissa: field.mantissa, exponent: field.exponent});
+      else
+        statistics[STATISTICS[s]] = dequantize(data, field);
+    }
+    decoded.statistics[name] = statistics;
+    if ("mean" in statistics)
+      means[name] = statistics.mean;
+  }
+  decoded.measurements.push(means);
+  return decoded;
+}
+
+/**
+ * Checks if a field is present in the presence bitmap of a V4 or V5 payload.
+ * @param bitmap: presence bitmap
+ * @param header: header of the field
+ * @return: true if the field is present, false otherwise
+ */
+function isPresent(bitmap, header) {
+  return (bitmap & (1 << (header - 1))) != 0;
+}
+
+/**
+ * Reads a quantization descriptor, in a V4 or V5 payload:
+ * width - 1 (2 bits), index of the mantissa (2 bits), signed exponent (4 bits),
+ * then the signed minimum value in resolution steps (4 bytes).
+ * @param bytes: payload, represented by an array of bytes
+ * @param index: index at which the descriptor is in the payload
+ * @return: the quantization of the field
+ */
+function readQuantization(bytes, index) {
+  var descriptor = bytes[index];
+  var exponent = descriptor & 0x0F;
+  return {
+    min: rebuildInt(bytes, index + 1, 4),
+    mantissa: MANTISSAS[(descriptor >> 4) & 0x03],
+    exponent: exponent >= 8 ? exponent - 16 : exponent,
+    width: (descriptor >> 6) + 1
+  };
+}
+
+/**
+ * Reads the quantized value of a field, in a V4 or V5 payload.
+ * @param bytes: payload, represented by an array of bytes
+ * @param index: index at which the value is in the payload
+ * @param field: quantization of the field
+ * @return: the quantized value, or null if it is absent from the measurement
+ */
+function readFieldValue(bytes, index, field) {
+  var data = rebuildInt(bytes, index, field.width) >>> 0;
+  // Absent if all bits are set
+  if (data == Math.pow(2, 8*field.width) - 1)
+    return null;
+  return data;
+}
+
+/**
+ * Converts a quantized value to the value of the field.
+ * @param data: quantized value
+ * @param field: quantization of the field
+ * @return: the value of the field
+ */
+function dequantize(data, field) {
+  var steps = (field.min + data) * field.mantissa;
+  if (field.exponent < 0)
+    return steps / Math.pow(10, -field.exponent);
+  return steps * Math.pow(10, field.exponent);
+}
+
+/**
+ * Reads a varint, i.e. 7 bits per byte, least significant first,
+ * with the most significant bit set on all bytes but the last.
+ * @param bytes: payload, represented by an array of bytes
+ * @param index: index at which the varint is in the payload
+ * @return: object with the value of the varint and its size in bytes
+ */
+function readVarint(bytes, index) {
+  var value = 0;
+  var size = 0;
+  do {
+    value += (bytes[index+size] & 0x7F) * Math.pow(2, 7*size);
+    size++;
+  } while (bytes[index+size-1] & 0x80);
+  return {value: value, size: size};
+}
+
+/**
+ * Decodes a zig-zag encoded int (0, -1, 1, -2, ... are encoded as 0, 1, 2, 3, ...).
+ * @param data: zig-zag encoded int, on 32 bits
+ * @return: the signed int
+ */
+function decodeZigZag(data) {
+  return (data >>> 1) ^ -(data & 1);
+}
+
 /**
  * Rebuilds an int of a specific size, at a specific index of the payload.
+ * Ints of 4 bytes are signed, smaller ints are unsigned.
  * @param bytes: payload, represented by an array of bytes
  * @param index: index at which the int data is in the payload
  * @param size: size of the int in bytes
@@ -120,9 +521,7 @@ function rebuildFloat(bytes, index, precision) {
  * @return: true if the header represents said data, false otherwise
  */
 function isFixedHeader(header) {
-  return (header == HEADER_LATITUDE ||
-          header == HEADER_LONGITUDE ||
-          header == HEADER_ALTITUDE);
+  return FIELDS[header] !== undefined && FIELDS[header].location;
 }
 
 /**
@@ -132,66 +531,17 @@ function isFixedHeader(header) {
  * @return: a JSON object representing the value
  */
 function readValue(bytes, index) {
-  var size;
-  obj = {};
-  var data_index = index + 1;
-  switch (bytes[index]) {
-    case HEADER_BATTERY: // Battery percentage, 8-bit int
-      size = 1;
-      obj.battery = rebuildInt(bytes, data_index, size);
-      break;
-    case HEADER_TEMPERATURE: // Temperature, 32-bit float
-      size = 4;
-      var precision = 2;
-      obj.temperature = rebuildFloat(bytes, data_index, precision);
-      break;
-    case HEADER_PRESSURE: // Pressure, 32-bit float
-      size = 4;
-      var precision = 2;
-      obj.pressure = rebuildFloat(bytes, data_index, precision);
-      break;
-    case HEADER_HUMIDITY: // Humidity, 32-bit float
-      size = 4;
-      var precision = 2;
-      obj.humidity = rebuildFloat(bytes, data_index, precision);
-      break;
-    case HEADER_ALTITUDE: // Altitude, 32-bit float
-      size = 4;
-      var precision = 2;
-      obj.altitude = rebuildFloat(bytes, data_index, precision);
-      break;
-    case HEADER_LIGHT: // Light, 16-bit int
-      size = 2;
-      obj.light = rebuildInt(bytes, data_index, size);
-      break;
-    case HEADER_LATITUDE: // Latitude, 32-bit float
-      size = 4;
-      var precision = 6;
-      obj.latitude = rebuildFloat(bytes, data_index, precision);
-      break;
-    case HEADER_LONGITUDE: // Longitude, 32-bit float
-      size = 4;
-      var precision = 6;
-      obj.longitude = rebuildFloat(bytes, data_index, precision);
-      break;
-    case HEADER_CO2: // CO2 concentration, 32-bit float
-      size = 4;
-      var precision = 2;
-      obj.co2 = rebuildFloat(bytes, data_index, precision);
-      break;
-    case HEADER_NOISE: // Noise, 16-bit int
-      size = 2;
-      obj.noise = rebuildInt(bytes, data_index, size);
-      break;
-    case HEADER_AIR_QUALITY: // Air quality, 32-bit float
-      size = 4;
-      var precision = 2;
-      obj.airQuality = rebuildFloat(bytes, data_index, precision);
-      break;
-    default:
-      size = 0;
+  var obj = {};
+  var field = FIELDS[bytes[index]];
+  if (field === undefined) {
+    obj.size = 1;
+    return obj;
   }
-  obj.size = size + 1;
+  if (field.isFloat)
+    obj[field.name] = rebuildFloat(bytes, index + 1, field.precision);
+  else
+    obj[field.name] = rebuildInt(bytes, index + 1, field.size);
+  obj.size = field.size + 1;
   return obj;
 }
 
@@ -207,3 +557,8 @@ function mergeObjects(obj_1, obj_2) {
       obj_1[field] = obj_2[field];
   }
 }
+
+// Export of the decoder to the cloud function, decoding the binary uplinks sent over Wi-Fi
+// (The Things Network runs the decoder without modules)
+if (typeof module !== "undefined")
+  module.exports = { decodeUplink: decodeUplink };
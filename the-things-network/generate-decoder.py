@@ -0,0 +1,105 @@
+import os
+import re
+import shutil
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+SCHEMA_PATH = os.path.join(SCRIPT_DIR, "..", "arduino", "libraries", "Packet", "PacketFields.h")
+DECODER_PATH = os.path.join(SCRIPT_DIR, "decoder.js")
+# Copy of the decoder deployed with the cloud functions, whose app root is the functions directory
+FUNCTIONS_DECODER_PATH = os.path.join(SCRIPT_DIR, "..", "functions", "shared", "decoder.js")
+BEGIN_MARKER = "// BEGIN GENERATED FIELDS"
+END_MARKER = "// END GENERATED FIELDS"
+SIZES = {
+    "uint8_t": 1,
+    "uint16_t": 2,
+    "float": 4
+}
+
+
+def parse_schema(path):
+    """
+    Parses the field schema of the Packet library (PACKET_FIELDS macro).
+    :param path: path to the PacketFields.h file
+    :return: list of the fields, in the order of the schema
+    """
+    fields = []
+    with open(path, "r") as schema_file:
+        for line in schema_file:
+            match = re.match(r"\s*X\((.*)\)\s*\\?\s*$", line)
+            if match is None:
+                continue
+            values = [value.strip() for value in match.group(1).split(",")]
+            fields.append({
+                "id": values[0],
+                "header": int(values[1], 16),
+                "type": values[4],
+                "precision": int(values[5]),
+                "name": values[6].strip('"'),
+                "location": values[7] == "true",
+                "min": int(values[8]),
+                "exponent": int(values[9]),
+                "mantissa": int(values[10]),
+                "width": int(values[11])
+            })
+    return fields
+
+
+def quantization_line(field):
+    """
+    Formats a field with its default quantization, for versions 4 and 5.
+    :param field: field of the schema
+    :return: JavaScript object literal of the field
+    """
+    return "  {header: %s, name: \"%s\", min: %d, mantissa: %d, exponent: %d, width: %d}" % (
+        field["id"], field["name"], field["min"], field["mantissa"], field["exponent"], field["width"])
+
+
+def generate_block(fields):
+    """
+    Generates the field definitions of the decoder.
+    :param fields: list of the fields, in the order of the schema
+    :return: lines of the generated block
+    """
+    by_header = sorted(fields, key=lambda field: field["header"])
+    lines = [BEGIN_MARKER,
+             "// Generated by generate-decoder.py from arduino/libraries/Packet/PacketFields.h, do not edit.",
+             "// Header values definitions"]
+    width = max(len(field["id"]) for field in fields)
+    for field in by_header:
+        lines.append("var %s = 0x%02X;" % (field["id"].ljust(width), field["header"]))
+    lines.append("")
+    lines.append("// Versions 1 to 3: fields, indexed by header, with their size in bytes")
+    lines.append("// and the number of decimal places of floats.")
+    lines.append("var FIELDS = {};")
+    for field in by_header:
+        lines.append("FIELDS[%s] = {name: \"%s\", size: %d, precision: %d, isFloat: %s, location: %s};" % (
+            field["id"], field["name"], SIZES[field["type"]], field["precision"],
+            "true" if field["type"] == "float" else "false",
+            "true" if field["location"] else "false"))
+    lines.append("")
+    lines.append("// Versions 4 and 5: fields in payload order, with their default quantization")
+    lines.append("// (minimum in resolution steps, resolution = mantissa * 10^exponent, width in bytes).")
+    lines.append("var LOCATION_FIELDS_V4 = [")
+    lines.append(",\n".join(quantization_line(field) for field in fields if field["location"]))
+    lines.append("];")
+    lines.append("var MEASUREMENT_FIELDS_V4 = [")
+    lines.append(",\n".join(quantization_line(field) for field in by_header if not field["location"]))
+    lines.append("];")
+    lines.append(END_MARKER)
+    return lines
+
+
+def main():
+    fields = parse_schema(SCHEMA_PATH)
+    with open(DECODER_PATH, "r") as decoder_file:
+        decoder = decoder_file.read()
+    begin = decoder.index(BEGIN_MARKER)
+    end = decoder.index(END_MARKER) + len(END_MARKER)
+    decoder = decoder[:begin] + "\n".join(generate_block(fields)) + decoder[end:]
+    with open(DECODER_PATH, "w") as decoder_file:
+        decoder_file.write(decoder)
+    shutil.copyfile(DECODER_PATH, FUNCTIONS_DECODER_PATH)
+
+
+if __name__ == "__main__":
+    main()